@@ -23,7 +23,9 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "glob-util.h"
+#include "format-table.h"
 #include "hashmap.h"
+#include "json.h"
 #include "locale-util.h"
 #include "log.h"
 #include "pager.h"
@@ -73,6 +75,7 @@ static const char *arg_host = NULL;
 static UnitFileScope arg_scope = UNIT_FILE_SYSTEM;
 static bool arg_man = true;
 static bool arg_generators = false;
+static bool arg_json = false;
 static const char *arg_root = NULL;
 
 struct boot_times {
@@ -117,6 +120,9 @@ struct unit_times {
         usec_t deactivated;
         usec_t deactivating;
         usec_t time;
+        uint64_t cpu_usage_nsec;
+        uint64_t memory_current;
+        uint64_t tasks_current;
 };
 
 struct host_info {
@@ -196,6 +202,11 @@ static int compare_unit_time(const struct unit_times *a, const struct unit_times
         return CMP(b->time, a->time);
 }
 
+static int compare_unit_cpu_usage(const struct unit_times *a, const struct unit_times *b) {
+        /* Units without accounting data (UINT64_MAX) go last */
+        return CMP(b->cpu_usage_nsec + 1, a->cpu_usage_nsec + 1);
+}
+
 static int compare_unit_start(const struct unit_times *a, const struct unit_times *b) {
         return CMP(a->activating, b->activating);
 }
@@ -321,21 +332,71 @@ static void free_host_info(struct host_info *hi) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(struct host_info*, free_host_info);
 
-static int acquire_time_data(sd_bus *bus, struct unit_times **out) {
+/* How many property queries to have in flight at a time at most */
+#define UNIT_TIMES_QUERIES_MAX 64U
+
+struct unit_times_query {
+        sd_bus_slot *slot;
+        struct unit_times *t;
+        size_t *n_pending;
+        int *error;
+};
+
+static void unit_times_queries_free(struct unit_times_query *q, size_t n) {
+        size_t k;
+
+        for (k = 0; k < n; k++)
+                sd_bus_slot_unref(q[k].slot);
+        free(q);
+}
+
+static int on_unit_times(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
         static const struct bus_properties_map property_map[] = {
                 { "InactiveExitTimestampMonotonic",  "t", NULL, offsetof(struct unit_times, activating)   },
                 { "ActiveEnterTimestampMonotonic",   "t", NULL, offsetof(struct unit_times, activated)    },
                 { "ActiveExitTimestampMonotonic",    "t", NULL, offsetof(struct unit_times, deactivating) },
                 { "InactiveEnterTimestampMonotonic", "t", NULL, offsetof(struct unit_times, deactivated)  },
+                { "CPUUsageNSec",                    "t", NULL, offsetof(struct unit_times, cpu_usage_nsec) },
+                { "MemoryCurrent",                   "t", NULL, offsetof(struct unit_times, memory_current) },
+                { "TasksCurrent",                    "t", NULL, offsetof(struct unit_times, tasks_current)  },
                 {},
         };
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        struct unit_times_query *q = userdata;
+        int r;
+
+        assert(m);
+        assert(q);
+
+        assert(*q->n_pending > 0);
+        (*q->n_pending)--;
+
+        if (sd_bus_message_is_method_error(m, NULL)) {
+                r = sd_bus_error_copy(&error, sd_bus_message_get_error(m));
+                goto fail;
+        }
+
+        r = bus_message_map_all_properties(m, property_map, BUS_MAP_STRDUP, &error, q->t);
+        if (r < 0)
+                goto fail;
+
+        return 0;
+
+fail:
+        if (*q->error == 0)
+                *q->error = log_error_errno(r, "Failed to get timestamp properties of unit %s: %s", q->t->name, bus_error_message(&error, r));
+        return 0;
+}
+
+static int acquire_time_data(sd_bus *bus, struct unit_times **out) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
         _cleanup_(unit_times_freep) struct unit_times *unit_times = NULL;
+        struct unit_times_query *queries = NULL;
+        size_t allocated = 0, c = 0, n = 0, k, n_pending = 0;
         struct boot_times *boot_times = NULL;
-        size_t allocated = 0, c = 0;
+        int r, error_pending = 0;
         UnitInfo u;
-        int r;
 
         r = acquire_boot_times(bus, &boot_times);
         if (r < 0)
@@ -357,28 +418,104 @@ static int acquire_time_data(sd_bus *bus, struct unit_times **out) {
                 return bus_log_parse_error(r);
 
         while ((r = bus_parse_unit_info(reply, &u)) > 0) {
-                struct unit_times *t;
+                if (!GREEDY_REALLOC0(unit_times, allocated, n+2))
+                        return log_oom();
 
-                if (!GREEDY_REALLOC(unit_times, allocated, c+2))
+                unit_times[n] = (struct unit_times) {
+                        .has_data = true,
+                        .name = strdup(u.id),
+                        /* Not all units have these, and the manager reports UINT64_MAX if accounting is off */
+                        .cpu_usage_nsec = UINT64_MAX,
+                        .memory_current = UINT64_MAX,
+                        .tasks_current = UINT64_MAX,
+                };
+                if (!unit_times[n++].name)
                         return log_oom();
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
 
-                unit_times[c+1].has_data = false;
-                t = &unit_times[c];
-                t->name = NULL;
+        if (n == 0) {
+                *out = TAKE_PTR(unit_times);
+                return 0;
+        }
 
-                assert_cc(sizeof(usec_t) == sizeof(uint64_t));
+        /* Querying the properties one unit after the other means one round trip per unit, which adds up quickly on
+         * remote connections. Hence, keep a number of queries in flight and collect the replies as they come in.
+         * Not all of them at once though, as dbus-daemon refuses more pending replies than max_replies_per_connection
+         * (128 by default) when we come in via the bus. */
+        queries = new0(struct unit_times_query, n);
+        if (!queries)
+                return log_oom();
 
-                r = bus_map_all_properties(
-                                bus,
-                                "org.freedesktop.systemd1",
-                                u.unit_path,
-                                property_map,
-                                BUS_MAP_STRDUP,
-                                &error,
-                                NULL,
-                                t);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to get timestamp properties of unit %s: %s", u.id, bus_error_message(&error, r));
+        r = sd_bus_message_rewind(reply, true);
+        if (r < 0)
+                goto finish;
+
+        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
+        if (r < 0) {
+                r = bus_log_parse_error(r);
+                goto finish;
+        }
+
+        k = 0;
+        while (k < n || n_pending > 0) {
+
+                while (k < n && n_pending < UNIT_TIMES_QUERIES_MAX) {
+                        r = bus_parse_unit_info(reply, &u);
+                        if (r <= 0) {
+                                r = bus_log_parse_error(r < 0 ? r : -EBADMSG);
+                                goto finish;
+                        }
+
+                        queries[k] = (struct unit_times_query) {
+                                .t = unit_times + k,
+                                .n_pending = &n_pending,
+                                .error = &error_pending,
+                        };
+
+                        r = sd_bus_call_method_async(
+                                        bus,
+                                        &queries[k].slot,
+                                        "org.freedesktop.systemd1",
+                                        u.unit_path,
+                                        "org.freedesktop.DBus.Properties",
+                                        "GetAll",
+                                        on_unit_times,
+                                        queries + k,
+                                        "s", "");
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to query timestamp properties of unit %s: %m", u.id);
+                                goto finish;
+                        }
+
+                        n_pending++;
+                        k++;
+                }
+
+                r = sd_bus_process(bus, NULL);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to process bus messages: %m");
+                        goto finish;
+                }
+                if (r > 0)
+                        continue;
+
+                r = sd_bus_wait(bus, (uint64_t) -1);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to wait for bus messages: %m");
+                        goto finish;
+                }
+        }
+
+        r = error_pending;
+        if (r < 0)
+                goto finish;
+
+        assert_cc(sizeof(usec_t) == sizeof(uint64_t));
+
+        for (k = 0; k < n; k++) {
+                struct unit_times *t = unit_times + k;
 
                 subtract_timestamp(&t->activating, boot_times->reverse_offset);
                 subtract_timestamp(&t->activated, boot_times->reverse_offset);
@@ -392,21 +529,24 @@ static int acquire_time_data(sd_bus *bus, struct unit_times **out) {
                 else
                         t->time = 0;
 
-                if (t->activating == 0)
+                if (t->activating == 0) {
+                        t->name = mfree(t->name);
                         continue;
+                }
 
-                t->name = strdup(u.id);
-                if (!t->name)
-                        return log_oom();
-
-                t->has_data = true;
-                c++;
+                unit_times[c++] = *t;
         }
-        if (r < 0)
-                return bus_log_parse_error(r);
+
+        /* Terminate the array, dropping what we moved or freed above */
+        for (k = c; k < n; k++)
+                unit_times[k] = (struct unit_times) {};
 
         *out = TAKE_PTR(unit_times);
-        return c;
+        r = c;
+
+finish:
+        unit_times_queries_free(queries, n);
+        return r;
 }
 
 static int acquire_host_info(sd_bus *bus, struct host_info **hi) {
@@ -1068,6 +1208,137 @@ static int analyze_blame(int argc, char *argv[], void *userdata) {
         return 0;
 }
 
+static int dump_costs_json(struct unit_times *times) {
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+        JsonVariant **elements = NULL;
+        struct unit_times *u;
+        size_t n = 0, allocated = 0;
+        int r;
+
+        for (u = times; u->has_data; u++) {
+                _cleanup_(json_variant_unrefp) JsonVariant *cpu = NULL, *memory = NULL, *tasks = NULL;
+
+                if (!GREEDY_REALLOC(elements, allocated, n + 1)) {
+                        r = log_oom();
+                        goto finish;
+                }
+
+                /* Counters that are not available are left as NULL, which is turned into a JSON null */
+                if ((u->cpu_usage_nsec != UINT64_MAX && json_variant_new_unsigned(&cpu, u->cpu_usage_nsec) < 0) ||
+                    (u->memory_current != UINT64_MAX && json_variant_new_unsigned(&memory, u->memory_current) < 0) ||
+                    (u->tasks_current != UINT64_MAX && json_variant_new_unsigned(&tasks, u->tasks_current) < 0)) {
+                        r = log_oom();
+                        goto finish;
+                }
+
+                r = json_build(elements + n, JSON_BUILD_OBJECT(
+                                       JSON_BUILD_PAIR("unit", JSON_BUILD_STRING(u->name)),
+                                       JSON_BUILD_PAIR("activatingUSec", JSON_BUILD_UNSIGNED(u->activating)),
+                                       JSON_BUILD_PAIR("timeUSec", JSON_BUILD_UNSIGNED(u->time)),
+                                       JSON_BUILD_PAIR("cpuUsageNSec", JSON_BUILD_VARIANT(cpu)),
+                                       JSON_BUILD_PAIR("memoryCurrent", JSON_BUILD_VARIANT(memory)),
+                                       JSON_BUILD_PAIR("tasksCurrent", JSON_BUILD_VARIANT(tasks))));
+                if (r < 0) {
+                        log_error_errno(r, "Failed to build JSON object: %m");
+                        goto finish;
+                }
+
+                n++;
+        }
+
+        r = json_variant_new_array(&v, elements, n);
+        if (r < 0) {
+                log_error_errno(r, "Failed to build JSON array: %m");
+                goto finish;
+        }
+
+        json_variant_dump(v, JSON_FORMAT_NEWLINE, stdout, NULL);
+        r = 0;
+
+finish:
+        json_variant_unref_many(elements, n);
+        free(elements);
+        return r;
+}
+
+static int analyze_costs(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(unit_times_freep) struct unit_times *times = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        struct unit_times *u;
+        size_t k;
+        int n, r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create bus connection: %m");
+
+        n = acquire_time_data(bus, &times);
+        if (n <= 0)
+                return n;
+
+        typesafe_qsort(times, n, compare_unit_cpu_usage);
+
+        if (arg_json)
+                return dump_costs_json(times);
+
+        table = table_new("TIME", "CPU", "MEMORY", "TASKS", "UNIT");
+        if (!table)
+                return log_oom();
+
+        for (k = 0; k < 4; k++)
+                (void) table_set_align_percent(table, TABLE_HEADER_CELL(k), 100);
+
+        for (u = times; u->has_data; u++) {
+                TableCell *cell;
+
+                r = table_add_cell(table, &cell, TABLE_TIMESPAN, &u->time);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add table cell: %m");
+                (void) table_set_align_percent(table, cell, 100);
+
+                if (u->cpu_usage_nsec != UINT64_MAX) {
+                        usec_t cpu = u->cpu_usage_nsec / NSEC_PER_USEC;
+
+                        r = table_add_cell(table, &cell, TABLE_TIMESPAN, &cpu);
+                } else
+                        r = table_add_cell(table, &cell, TABLE_EMPTY, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add table cell: %m");
+                (void) table_set_align_percent(table, cell, 100);
+
+                if (u->memory_current != UINT64_MAX)
+                        r = table_add_cell(table, &cell, TABLE_SIZE, &u->memory_current);
+                else
+                        r = table_add_cell(table, &cell, TABLE_EMPTY, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add table cell: %m");
+                (void) table_set_align_percent(table, cell, 100);
+
+                if (u->tasks_current != UINT64_MAX) {
+                        uint32_t tasks = (uint32_t) MIN(u->tasks_current, (uint64_t) UINT32_MAX);
+
+                        r = table_add_cell(table, &cell, TABLE_UINT32, &tasks);
+                } else
+                        r = table_add_cell(table, &cell, TABLE_EMPTY, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add table cell: %m");
+                (void) table_set_align_percent(table, cell, 100);
+
+                r = table_add_cell(table, NULL, TABLE_STRING, u->name);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add table cell: %m");
+        }
+
+        (void) pager_open(arg_pager_flags);
+
+        r = table_print(table, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to show table: %m");
+
+        return 0;
+}
+
 static int analyze_time(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         _cleanup_free_ char *buf = NULL;
@@ -1334,6 +1605,37 @@ static int dump(int argc, char *argv[], void *userdata) {
         return copy_bytes(fd, STDOUT_FILENO, (uint64_t) -1, 0);
 }
 
+static int dump_trace(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        int fd = -1;
+        int r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create bus connection: %m");
+
+        r = sd_bus_call_method(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "DumpTraceByFileDescriptor",
+                        &error,
+                        &reply,
+                        NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue method call DumpTraceByFileDescriptor: %s", bus_error_message(&error, r));
+
+        r = sd_bus_message_read(reply, "h", &fd);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        fflush(stdout);
+        return copy_bytes(fd, STDOUT_FILENO, (uint64_t) -1, 0);
+}
+
 static int cat_config(int argc, char *argv[], void *userdata) {
         char **arg;
         int r;
@@ -1806,15 +2108,18 @@ static int help(int argc, char *argv[], void *userdata) {
                "                           earlier than the latest in the branch\n"
                "     --man[=BOOL]          Do [not] check for existence of man pages\n"
                "     --generators[=BOOL]   Do [not] run unit generators (requires privileges)\n"
+               "     --json                Output costs in JSON format\n"
                "\nCommands:\n"
                "  time                     Print time spent in the kernel\n"
                "  blame                    Print list of running units ordered by time to init\n"
+               "  costs                    Print resource usage of units along with their time to init\n"
                "  critical-chain [UNIT...] Print a tree of the time critical chain of units\n"
                "  plot                     Output SVG graphic showing service initialization\n"
                "  dot [UNIT...]            Output dependency graph in man:dot(1) format\n"
                "  log-level [LEVEL]        Get/set logging threshold for manager\n"
                "  log-target [TARGET]      Get/set logging target for manager\n"
                "  dump                     Output state serialization of service manager\n"
+               "  trace                    Output recorded trace events of service manager\n"
                "  cat-config               Show configuration file and drop-ins\n"
                "  unit-paths               List load directories for units\n"
                "  syscall-filter [NAME...] Print list of syscalls in seccomp filter\n"
@@ -1848,6 +2153,7 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_NO_PAGER,
                 ARG_MAN,
                 ARG_GENERATORS,
+                ARG_JSON,
         };
 
         static const struct option options[] = {
@@ -1865,6 +2171,7 @@ static int parse_argv(int argc, char *argv[]) {
                 { "no-pager",     no_argument,       NULL, ARG_NO_PAGER         },
                 { "man",          optional_argument, NULL, ARG_MAN              },
                 { "generators",   optional_argument, NULL, ARG_GENERATORS       },
+                { "json",         no_argument,       NULL, ARG_JSON             },
                 { "host",         required_argument, NULL, 'H'                  },
                 { "machine",      required_argument, NULL, 'M'                  },
                 {}
@@ -1968,6 +2275,10 @@ static int parse_argv(int argc, char *argv[]) {
 
                         break;
 
+                case ARG_JSON:
+                        arg_json = true;
+                        break;
+
                 case '?':
                         return -EINVAL;
 
@@ -1995,6 +2306,7 @@ int main(int argc, char *argv[]) {
                 { "help",              VERB_ANY, VERB_ANY, 0,            help                   },
                 { "time",              VERB_ANY, 1,        VERB_DEFAULT, analyze_time           },
                 { "blame",             VERB_ANY, 1,        0,            analyze_blame          },
+                { "costs",             VERB_ANY, 1,        0,            analyze_costs          },
                 { "critical-chain",    VERB_ANY, VERB_ANY, 0,            analyze_critical_chain },
                 { "plot",              VERB_ANY, 1,        0,            analyze_plot           },
                 { "dot",               VERB_ANY, VERB_ANY, 0,            dot                    },
@@ -2006,6 +2318,7 @@ int main(int argc, char *argv[]) {
                 { "set-log-target",    2,        2,        0,            set_log_target         },
                 { "get-log-target",    VERB_ANY, 1,        0,            get_log_target         },
                 { "dump",              VERB_ANY, 1,        0,            dump                   },
+                { "trace",             VERB_ANY, 1,        0,            dump_trace             },
                 { "cat-config",        2,        VERB_ANY, 0,            cat_config             },
                 { "unit-paths",        1,        1,        0,            dump_unit_paths        },
                 { "syscall-filter",    VERB_ANY, VERB_ANY, 0,            dump_syscall_filters   },
@@ -167,11 +167,18 @@ int copy_bytes_full(
                 }
         }
 
+        /* If the output shall be sparse we need to look at the data ourselves, hence skip the in-kernel copy
+         * methods */
+        if (copy_flags & COPY_SPARSE)
+                try_cfr = try_sendfile = try_splice = false;
+
         for (;;) {
                 ssize_t n;
 
-                if (max_bytes <= 0)
-                        return 1; /* return > 0 if we hit the max_bytes limit */
+                if (max_bytes <= 0) {
+                        r = 1; /* return > 0 if we hit the max_bytes limit */
+                        goto finish;
+                }
 
                 if (max_bytes != UINT64_MAX && m > max_bytes)
                         m = max_bytes;
@@ -277,6 +284,14 @@ int copy_bytes_full(
                         if (n == 0) /* EOF */
                                 break;
 
+                        if (copy_flags & COPY_SPARSE) {
+                                z = sparse_write(fdt, buf, n, 64);
+                                if (z < 0)
+                                        return (int) z;
+
+                                goto next;
+                        }
+
                         z = (size_t) n;
                         do {
                                 ssize_t k;
@@ -319,7 +334,26 @@ int copy_bytes_full(
                 m = MAX(MIN(COPY_BUFFER_SIZE, max_bytes), m - n);
         }
 
-        return 0; /* return 0 if we hit EOF earlier than the size limit */
+        r = 0; /* return 0 if we hit EOF earlier than the size limit */
+
+finish:
+        if (copy_flags & COPY_SPARSE) {
+                struct stat st;
+                off_t p;
+
+                /* If the data ended in a hole we only seeked over it, hence make sure the file is long enough */
+                p = lseek(fdt, 0, SEEK_CUR);
+                if (p < 0)
+                        return -errno;
+
+                if (fstat(fdt, &st) < 0)
+                        return -errno;
+
+                if (st.st_size < p && ftruncate(fdt, p) < 0)
+                        return -errno;
+        }
+
+        return r;
 }
 
 static int fd_copy_symlink(
@@ -381,7 +415,12 @@ static int fd_copy_regular(
         if (fdt < 0)
                 return -errno;
 
-        r = copy_bytes(fdf, fdt, (uint64_t) -1, copy_flags);
+        /* We always copy the whole file here, and both fds are freshly opened, hence if reflinking is requested try
+         * it right away, which saves copy_bytes() querying and adjusting the file offsets around it. */
+        if ((copy_flags & COPY_REFLINK) && btrfs_reflink(fdf, fdt) >= 0)
+                r = 0;
+        else
+                r = copy_bytes(fdf, fdt, (uint64_t) -1, copy_flags & ~COPY_REFLINK);
         if (r < 0) {
                 (void) unlinkat(dt, to, 0);
                 return r;
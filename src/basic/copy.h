@@ -11,6 +11,7 @@ typedef enum CopyFlags {
         COPY_MERGE      = 1 << 1, /* Merge existing trees with our new one to copy */
         COPY_REPLACE    = 1 << 2, /* Replace an existing file if there's one */
         COPY_SAME_MOUNT = 1 << 3, /* Don't descend recursively into other file systems, across mount point boundaries */
+        COPY_SPARSE     = 1 << 4, /* Seek over runs of NUL bytes instead of writing them, output must be a regular file */
 } CopyFlags;
 
 int copy_file_fd(const char *from, int to, CopyFlags copy_flags);
@@ -188,6 +188,48 @@ _pure_ static bool fd_in_set(int fd, const int fdset[], size_t n_fdset) {
         return false;
 }
 
+static int cmp_int(const int *a, const int *b) {
+        return *a < *b ? -1 : *a > *b ? 1 : 0;
+}
+
+static int close_all_fds_by_range(const int except[], size_t n_except) {
+        _cleanup_free_ int *sorted_malloc = NULL;
+        int *sorted, prev = 2; /* fds 0…2 always stay open */
+        size_t i;
+
+        /* Closes everything from fd 3 on that is not listed in except[], with one close_range() call for each
+         * gap between the fds to keep and one for everything after the last of them. That's independent of the
+         * number of fds actually open, unlike enumerating /proc/self/fd. */
+
+        if (n_except > 0) {
+                if (n_except > 64) {
+                        sorted = sorted_malloc = newdup(int, except, n_except);
+                        if (!sorted)
+                                return -ENOMEM;
+                } else {
+                        sorted = newa(int, n_except);
+                        memcpy(sorted, except, sizeof(int) * n_except);
+                }
+
+                typesafe_qsort(sorted, n_except, cmp_int);
+
+                for (i = 0; i < n_except; i++) {
+                        if (sorted[i] <= prev) /* below 3, or a duplicate */
+                                continue;
+
+                        if (sorted[i] > prev + 1 && close_range(prev + 1, sorted[i] - 1, 0) < 0)
+                                return -errno;
+
+                        prev = sorted[i];
+                }
+        }
+
+        if (prev < INT_MAX && close_range(prev + 1, -1, 0) < 0)
+                return -errno;
+
+        return 0;
+}
+
 int close_all_fds(const int except[], size_t n_except) {
         _cleanup_closedir_ DIR *d = NULL;
         struct dirent *de;
@@ -195,6 +237,12 @@ int close_all_fds(const int except[], size_t n_except) {
 
         assert(n_except == 0 || except);
 
+        /* Try close_range() first. If that fails, for example because the kernel is too old (ENOSYS) or a seccomp
+         * filter refuses it (EPERM), fall back to enumerating the fds. That's safe even if we already closed some
+         * of the fds before failing, as the fallback only looks at what is still open. */
+        if (close_all_fds_by_range(except, n_except) >= 0)
+                return 0;
+
         d = opendir("/proc/self/fd");
         if (!d) {
                 struct rlimit rl;
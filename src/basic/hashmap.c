@@ -1334,7 +1334,8 @@ void *internal_hashmap_get(HashmapBase *h, const void *key) {
         struct hashmap_base_entry *e;
         unsigned hash, idx;
 
-        if (!h)
+        /* Lookups in allocated but empty hashmaps are common, don't bother hashing the key for them */
+        if (!h || n_entries(h) == 0)
                 return NULL;
 
         hash = bucket_hash(h, key);
@@ -1350,7 +1351,7 @@ void *hashmap_get2(Hashmap *h, const void *key, void **key2) {
         struct plain_hashmap_entry *e;
         unsigned hash, idx;
 
-        if (!h)
+        if (!h || n_entries(HASHMAP_BASE(h)) == 0)
                 return NULL;
 
         hash = bucket_hash(h, key);
@@ -1368,7 +1369,7 @@ void *hashmap_get2(Hashmap *h, const void *key, void **key2) {
 bool internal_hashmap_contains(HashmapBase *h, const void *key) {
         unsigned hash;
 
-        if (!h)
+        if (!h || n_entries(h) == 0)
                 return false;
 
         hash = bucket_hash(h, key);
@@ -1380,7 +1381,7 @@ void *internal_hashmap_remove(HashmapBase *h, const void *key) {
         unsigned hash, idx;
         void *data;
 
-        if (!h)
+        if (!h || n_entries(h) == 0)
                 return NULL;
 
         hash = bucket_hash(h, key);
@@ -1400,7 +1401,7 @@ void *hashmap_remove2(Hashmap *h, const void *key, void **rkey) {
         unsigned hash, idx;
         void *data;
 
-        if (!h) {
+        if (!h || n_entries(HASHMAP_BASE(h)) == 0) {
                 if (rkey)
                         *rkey = NULL;
                 return NULL;
@@ -1517,7 +1518,7 @@ void *hashmap_remove_value(Hashmap *h, const void *key, void *value) {
         struct plain_hashmap_entry *e;
         unsigned hash, idx;
 
-        if (!h)
+        if (!h || n_entries(HASHMAP_BASE(h)) == 0)
                 return NULL;
 
         hash = bucket_hash(h, key);
@@ -309,7 +309,7 @@ static int process_special_field(JournalImporter *imp, char *line) {
         return 0;
 }
 
-int journal_importer_process_data(JournalImporter *imp) {
+static int process_data_one(JournalImporter *imp) {
         int r;
 
         switch(imp->state) {
@@ -442,6 +442,19 @@ int journal_importer_process_data(JournalImporter *imp) {
         }
 }
 
+int journal_importer_process_data(JournalImporter *imp) {
+        int r;
+
+        /* Parses fields until the entry is complete (returns 1), we hit EOF (returns 0), or need more data
+         * (returns -EAGAIN), so that callers don't have to come back for each field. */
+
+        do
+                r = process_data_one(imp);
+        while (r == 0 && imp->state != IMPORTER_STATE_EOF);
+
+        return r;
+}
+
 int journal_importer_push_data(JournalImporter *imp, const char *data, size_t size) {
         assert(imp);
         assert(imp->state != IMPORTER_STATE_EOF);
@@ -462,9 +475,10 @@ int journal_importer_push_data(JournalImporter *imp, const char *data, size_t si
 void journal_importer_drop_iovw(JournalImporter *imp) {
         size_t remain, target;
 
-        /* This function drops processed data that along with the iovw that points at it */
+        /* This function drops processed data that along with the iovw that points at it. The iovec array
+         * itself is kept around for the next entry. */
 
-        iovw_free_contents(&imp->iovw);
+        imp->iovw.count = 0;
 
         /* possibly reset buffer position */
         remain = imp->filled - imp->offset;
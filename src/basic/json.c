@@ -1362,6 +1362,11 @@ static int json_format(FILE *f, JsonVariant *v, unsigned flags, const char *pref
                 break;
 
         case JSON_VARIANT_STRING: {
+                /* All characters we need to escape, i.e. the ones handled in the switch statement below */
+                static const char escape[] =
+                        "\"\\/"
+                        "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+                        "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f";
                 const char *q;
 
                 fputc('"', f);
@@ -1370,6 +1375,18 @@ static int json_format(FILE *f, JsonVariant *v, unsigned flags, const char *pref
                         fputs(ANSI_GREEN, f);
 
                 for (q = json_variant_string(v); *q; q++) {
+                        size_t k;
+
+                        /* Write out runs of characters that need no escaping in one go, instead of character by
+                         * character */
+                        k = strcspn(q, escape);
+                        if (k > 0) {
+                                fwrite(q, 1, k, f);
+                                q += k;
+
+                                if (*q == 0)
+                                        break;
+                        }
 
                         switch (*q) {
 
@@ -1835,8 +1852,24 @@ static int json_parse_string(const char **p, char **ret) {
         c++;
 
         for (;;) {
+                const char *e;
                 int len;
 
+                /* Fast path: find the longest run of printable ASCII characters that need no further processing
+                 * and copy it in one go, so that we don't validate and grow the buffer byte by byte for the
+                 * common case of strings that contain no escapes and no non-ASCII characters. Note that this
+                 * works regardless of whether 'char' is signed or not. */
+                for (e = c; *e >= ' ' && *e < 0x7f && !IN_SET(*e, '"', '\\'); e++)
+                        ;
+                if (e > c) {
+                        if (!GREEDY_REALLOC(s, allocated, n + (e - c) + 1))
+                                return -ENOMEM;
+
+                        memcpy(s + n, c, e - c);
+                        n += e - c;
+                        c = e;
+                }
+
                 /* Check for EOF */
                 if (*c == 0)
                         return -EINVAL;
@@ -1942,6 +1975,11 @@ static int json_parse_string(const char **p, char **ret) {
         }
 }
 
+static inline bool json_isdigit(char c) {
+        /* Unlike strchr("0123456789", c) this doesn't need a function call per digit, and doesn't match NUL */
+        return c >= '0' && c <= '9';
+}
+
 static int json_parse_number(const char **p, JsonValue *ret) {
         bool negative = false, exponent_negative = false, is_real = false;
         long double x = 0.0, y = 0.0, exponent = 0.0, shift = 1.0;
@@ -1997,21 +2035,21 @@ static int json_parse_number(const char **p, JsonValue *ret) {
                         x = 10.0 * x + (*c - '0');
 
                         c++;
-                } while (strchr("0123456789", *c) && *c != 0);
+                } while (json_isdigit(*c));
         }
 
         if (*c == '.') {
                 is_real = true;
                 c++;
 
-                if (!strchr("0123456789", *c) || *c == 0)
+                if (!json_isdigit(*c))
                         return -EINVAL;
 
                 do {
                         y = 10.0 * y + (*c - '0');
                         shift = 10.0 * shift;
                         c++;
-                } while (strchr("0123456789", *c) && *c != 0);
+                } while (json_isdigit(*c));
         }
 
         if (IN_SET(*c, 'e', 'E')) {
@@ -2024,13 +2062,13 @@ static int json_parse_number(const char **p, JsonValue *ret) {
                 } else if (*c == '+')
                         c++;
 
-                if (!strchr("0123456789", *c) || *c == 0)
+                if (!json_isdigit(*c))
                         return -EINVAL;
 
                 do {
                         exponent = 10.0 * exponent + (*c - '0');
                         c++;
-                } while (strchr("0123456789", *c) && *c != 0);
+                } while (json_isdigit(*c));
         }
 
         *p = c;
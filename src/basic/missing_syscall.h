@@ -3,6 +3,7 @@
 
 /* Missing glibc definitions to access certain kernel APIs */
 
+#include <limits.h>
 #include <sys/types.h>
 
 #if !HAVE_PIVOT_ROOT
@@ -428,3 +429,188 @@ static inline ssize_t missing_statx(int dfd, const char *filename, unsigned flag
 
 #  define statx missing_statx
 #endif
+
+/* ======================================================================= */
+
+#if !HAVE_PIDFD_OPEN
+#  ifndef __NR_pidfd_open
+#    if defined __alpha__
+#      define __NR_pidfd_open 544
+#    elif defined __ia64__
+#      define __NR_pidfd_open 1458
+#    elif defined _MIPS_SIM
+#      if _MIPS_SIM == _MIPS_SIM_ABI32
+#        define __NR_pidfd_open 4434
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_NABI32
+#        define __NR_pidfd_open 6434
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_ABI64
+#        define __NR_pidfd_open 5434
+#      endif
+#    else
+#      define __NR_pidfd_open 434 /* the same on all other architectures */
+#    endif
+#  endif
+
+static inline int missing_pidfd_open(pid_t pid, unsigned flags) {
+#  ifdef __NR_pidfd_open
+        return syscall(__NR_pidfd_open, pid, flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define pidfd_open missing_pidfd_open
+#endif
+
+/* ======================================================================= */
+
+#if !HAVE_CLOSE_RANGE
+#  ifndef __NR_close_range
+#    if defined __alpha__
+#      define __NR_close_range 546
+#    elif defined __ia64__
+#      define __NR_close_range 1460
+#    elif defined _MIPS_SIM
+#      if _MIPS_SIM == _MIPS_SIM_ABI32
+#        define __NR_close_range 4436
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_NABI32
+#        define __NR_close_range 6436
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_ABI64
+#        define __NR_close_range 5436
+#      endif
+#    else
+#      define __NR_close_range 436 /* the same on all other architectures */
+#    endif
+#  endif
+
+static inline int missing_close_range(int first_fd, int end_fd, unsigned flags) {
+#  ifdef __NR_close_range
+        /* The kernel takes the fds as unsigned, with UINT_MAX meaning "up to the end". We use signed fds
+         * everywhere, hence map -1 to UINT_MAX and refuse any other negative values. */
+        if (first_fd < 0 || (end_fd < 0 && end_fd != -1)) {
+                errno = EBADF;
+                return -1;
+        }
+
+        return (int) syscall(__NR_close_range,
+                             (unsigned) first_fd,
+                             end_fd == -1 ? UINT_MAX : (unsigned) end_fd,
+                             flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define close_range missing_close_range
+#endif
+
+/* ======================================================================= */
+
+#if !HAVE_OPEN_TREE
+#  ifndef __NR_open_tree
+#    if defined __alpha__
+#      define __NR_open_tree 538
+#    elif defined __ia64__
+#      define __NR_open_tree 1452
+#    elif defined _MIPS_SIM
+#      if _MIPS_SIM == _MIPS_SIM_ABI32
+#        define __NR_open_tree 4428
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_NABI32
+#        define __NR_open_tree 6428
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_ABI64
+#        define __NR_open_tree 5428
+#      endif
+#    else
+#      define __NR_open_tree 428 /* the same on all other architectures */
+#    endif
+#  endif
+
+static inline int missing_open_tree(int dfd, const char *filename, unsigned flags) {
+#  ifdef __NR_open_tree
+        return (int) syscall(__NR_open_tree, dfd, filename, flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define open_tree missing_open_tree
+#endif
+
+/* ======================================================================= */
+
+#if !HAVE_MOVE_MOUNT
+#  ifndef __NR_move_mount
+#    if defined __alpha__
+#      define __NR_move_mount 539
+#    elif defined __ia64__
+#      define __NR_move_mount 1453
+#    elif defined _MIPS_SIM
+#      if _MIPS_SIM == _MIPS_SIM_ABI32
+#        define __NR_move_mount 4429
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_NABI32
+#        define __NR_move_mount 6429
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_ABI64
+#        define __NR_move_mount 5429
+#      endif
+#    else
+#      define __NR_move_mount 429 /* the same on all other architectures */
+#    endif
+#  endif
+
+static inline int missing_move_mount(int from_dfd, const char *from_pathname, int to_dfd, const char *to_pathname, unsigned flags) {
+#  ifdef __NR_move_mount
+        return (int) syscall(__NR_move_mount, from_dfd, from_pathname, to_dfd, to_pathname, flags);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define move_mount missing_move_mount
+#endif
+
+/* ======================================================================= */
+
+#if !HAVE_MOUNT_SETATTR
+#  ifndef __NR_mount_setattr
+#    if defined __alpha__
+#      define __NR_mount_setattr 552
+#    elif defined __ia64__
+#      define __NR_mount_setattr 1466
+#    elif defined _MIPS_SIM
+#      if _MIPS_SIM == _MIPS_SIM_ABI32
+#        define __NR_mount_setattr 4442
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_NABI32
+#        define __NR_mount_setattr 6442
+#      endif
+#      if _MIPS_SIM == _MIPS_SIM_ABI64
+#        define __NR_mount_setattr 5442
+#      endif
+#    else
+#      define __NR_mount_setattr 442 /* the same on all other architectures */
+#    endif
+#  endif
+
+static inline int missing_mount_setattr(int dfd, const char *path, unsigned flags, struct mount_attr *attr, size_t size) {
+#  ifdef __NR_mount_setattr
+        return (int) syscall(__NR_mount_setattr, dfd, path, flags, attr, size);
+#  else
+        errno = ENOSYS;
+        return -1;
+#  endif
+}
+
+#  define mount_setattr missing_mount_setattr
+#endif
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
+#include <poll.h>
 #include <stdio_ext.h>
 #include <stdlib.h>
 #include <string.h>
@@ -382,6 +383,38 @@ static int get_mount_flags(const char *path, unsigned long *flags) {
 /* Use this function only if do you have direct access to /proc/self/mountinfo
  * and need the caller to open it for you. This is the case when /proc is
  * masked or not mounted. Otherwise, use bind_remount_recursive. */
+static bool mountinfo_changed(FILE *proc_self_mountinfo) {
+        struct pollfd pollfd = {
+                .fd = fileno(proc_self_mountinfo),
+                .events = POLLPRI,
+        };
+
+        /* The kernel flags POLLERR|POLLPRI on /proc/self/mountinfo whenever the mount table changed since
+         * the last time this was checked. If we can't tell, assume it changed. */
+
+        if (poll(&pollfd, 1, 0) < 0)
+                return true;
+
+        return pollfd.revents & (POLLERR|POLLPRI);
+}
+
+static int remount_tracked(FILE *proc_self_mountinfo, bool *changed, const char *source, const char *target, unsigned long flags) {
+        int r;
+
+        /* Checks whether somebody else changed the mount table right before our own mount() call, and
+         * acknowledges the change the call itself causes right after it, so that it isn't mistaken for a
+         * foreign one. */
+
+        if (mountinfo_changed(proc_self_mountinfo))
+                *changed = true;
+
+        r = mount(source, target, NULL, flags, NULL) < 0 ? -errno : 0;
+
+        (void) mountinfo_changed(proc_self_mountinfo);
+
+        return r;
+}
+
 int bind_remount_recursive_with_mountinfo(const char *prefix, bool ro, char **blacklist, FILE *proc_self_mountinfo) {
         _cleanup_set_free_free_ Set *done = NULL;
         _cleanup_free_ char *cleaned = NULL;
@@ -412,7 +445,7 @@ int bind_remount_recursive_with_mountinfo(const char *prefix, bool ro, char **bl
 
         for (;;) {
                 _cleanup_set_free_free_ Set *todo = NULL;
-                bool top_autofs = false;
+                bool top_autofs = false, created = false, changed = false;
                 char *x;
                 unsigned long orig_flags;
 
@@ -420,6 +453,8 @@ int bind_remount_recursive_with_mountinfo(const char *prefix, bool ro, char **bl
                 if (!todo)
                         return -ENOMEM;
 
+                /* Forget about earlier changes, we are about to read the current state anyway */
+                (void) mountinfo_changed(proc_self_mountinfo);
                 rewind(proc_self_mountinfo);
 
                 for (;;) {
@@ -510,17 +545,20 @@ int bind_remount_recursive_with_mountinfo(const char *prefix, bool ro, char **bl
                 if (!set_contains(done, cleaned) &&
                     !set_contains(todo, cleaned)) {
                         /* The prefix directory itself is not yet a mount, make it one. */
-                        if (mount(cleaned, cleaned, NULL, MS_BIND|MS_REC, NULL) < 0)
-                                return -errno;
+                        r = remount_tracked(proc_self_mountinfo, &changed, cleaned, cleaned, MS_BIND|MS_REC);
+                        if (r < 0)
+                                return r;
 
                         orig_flags = 0;
                         (void) get_mount_flags(cleaned, &orig_flags);
                         orig_flags &= ~MS_RDONLY;
 
-                        if (mount(NULL, cleaned, NULL, orig_flags|MS_BIND|MS_REMOUNT|(ro ? MS_RDONLY : 0), NULL) < 0)
-                                return -errno;
+                        r = remount_tracked(proc_self_mountinfo, &changed, NULL, cleaned, orig_flags|MS_BIND|MS_REMOUNT|(ro ? MS_RDONLY : 0));
+                        if (r < 0)
+                                return r;
 
                         log_debug("Made top-level directory %s a mount point.", prefix);
+                        created = true;
 
                         x = strdup(cleaned);
                         if (!x)
@@ -563,11 +601,21 @@ int bind_remount_recursive_with_mountinfo(const char *prefix, bool ro, char **bl
                         (void) get_mount_flags(x, &orig_flags);
                         orig_flags &= ~MS_RDONLY;
 
-                        if (mount(NULL, x, NULL, orig_flags|MS_BIND|MS_REMOUNT|(ro ? MS_RDONLY : 0), NULL) < 0)
-                                return -errno;
+                        r = remount_tracked(proc_self_mountinfo, &changed, NULL, x, orig_flags|MS_BIND|MS_REMOUNT|(ro ? MS_RDONLY : 0));
+                        if (r < 0)
+                                return r;
 
                         log_debug("Remounted %s read-only.", x);
                 }
+
+                /* Remounting existing mounts doesn't create any new ones. Hence, unless we just turned the
+                 * prefix into a recursive bind mount ourselves, or somebody else changed the mount table
+                 * while we were processing it (for example because a mount propagated in from the host),
+                 * another pass over /proc/self/mountinfo would find nothing new to do, and we can skip it. */
+                if (mountinfo_changed(proc_self_mountinfo))
+                        changed = true;
+                if (!created && !changed)
+                        return 0;
         }
 }
 
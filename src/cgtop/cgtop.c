@@ -428,7 +428,7 @@ static int process(
 }
 
 static int refresh_one(
-                const char *controller,
+                char **controllers,
                 const char *path,
                 Hashmap *a,
                 Hashmap *b,
@@ -438,20 +438,25 @@ static int refresh_one(
 
         _cleanup_closedir_ DIR *d = NULL;
         Group *ours = NULL;
+        char **c;
         int r;
 
-        assert(controller);
+        assert(!strv_isempty(controllers));
         assert(path);
         assert(a);
 
         if (depth > arg_depth)
                 return 0;
 
-        r = process(controller, path, a, b, iteration, &ours);
-        if (r < 0)
-                return r;
+        STRV_FOREACH(c, controllers) {
+                r = process(*c, path, a, b, iteration, &ours);
+                if (r < 0)
+                        return r;
+        }
 
-        r = cg_enumerate_subgroups(controller, path, &d);
+        /* All controllers passed in live in the same hierarchy, hence enumerating the subgroups through the first
+         * one is enough. */
+        r = cg_enumerate_subgroups(controllers[0], path, &d);
         if (r == -ENOENT)
                 return 0;
         if (r < 0)
@@ -473,7 +478,7 @@ static int refresh_one(
 
                 path_simplify(p, false);
 
-                r = refresh_one(controller, p, a, b, iteration, depth + 1, &child);
+                r = refresh_one(controllers, p, a, b, iteration, depth + 1, &child);
                 if (r < 0)
                         return r;
 
@@ -481,7 +486,7 @@ static int refresh_one(
                     IN_SET(arg_count, COUNT_ALL_PROCESSES, COUNT_USERSPACE_PROCESSES) &&
                     child &&
                     child->n_tasks_valid &&
-                    streq(controller, SYSTEMD_CGROUP_CONTROLLER)) {
+                    strv_contains(controllers, SYSTEMD_CGROUP_CONTROLLER)) {
 
                         /* Recursively sum up processes */
 
@@ -504,8 +509,18 @@ static int refresh(const char *root, Hashmap *a, Hashmap *b, unsigned iteration)
         const char *c;
         int r;
 
-        FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpu", "cpuacct", "memory", "io", "blkio", "pids") {
-                r = refresh_one(c, root, a, b, iteration, 0, NULL);
+        r = cg_all_unified();
+        if (r < 0)
+                return r;
+        if (r > 0)
+                /* On the unified hierarchy all controllers share one tree, hence walk it only once, and read all
+                 * attributes of each group while we are at it. "cpuacct" and "blkio" don't exist there. */
+                return refresh_one(STRV_MAKE(SYSTEMD_CGROUP_CONTROLLER, "cpu", "memory", "io", "pids"), root, a, b, iteration, 0, NULL);
+
+        /* On the legacy hierarchies each controller has a tree of its own. We read the CPU usage from "cpuacct"
+         * there, and "io" is not available. */
+        FOREACH_STRING(c, SYSTEMD_CGROUP_CONTROLLER, "cpuacct", "memory", "blkio", "pids") {
+                r = refresh_one(STRV_MAKE(c), root, a, b, iteration, 0, NULL);
                 if (r < 0)
                         return r;
         }
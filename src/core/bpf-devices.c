@@ -3,9 +3,15 @@
 
 #include "bpf-devices.h"
 #include "bpf-program.h"
+#include "fd-util.h"
+#include "set.h"
+#include "siphash24.h"
 
 #define PASS_JUMP_OFF 4096
 
+/* Don't keep an unbounded number of distinct device policies loaded in the kernel */
+#define BPF_DEVICE_PROGRAMS_CACHE_MAX 256U
+
 static int bpf_access_type(const char *acc) {
         int r = 0;
 
@@ -127,6 +133,89 @@ int cgroup_init_device_bpf(BPFProgram **ret, CGroupDevicePolicy policy, bool whi
         return 0;
 }
 
+static void device_program_hash_func(const void *p, struct siphash *state) {
+        const BPFProgram *prog = p;
+
+        siphash24_compress(&prog->prog_type, sizeof(prog->prog_type), state);
+        siphash24_compress(&prog->n_instructions, sizeof(prog->n_instructions), state);
+        siphash24_compress(prog->instructions, sizeof(struct bpf_insn) * prog->n_instructions, state);
+}
+
+static int device_program_compare_func(const void *_a, const void *_b) {
+        const BPFProgram *a = _a, *b = _b;
+
+        if (a->prog_type != b->prog_type)
+                return a->prog_type < b->prog_type ? -1 : 1;
+        if (a->n_instructions != b->n_instructions)
+                return a->n_instructions < b->n_instructions ? -1 : 1;
+
+        return memcmp(a->instructions, b->instructions, sizeof(struct bpf_insn) * a->n_instructions);
+}
+
+static const struct hash_ops device_program_hash_ops = {
+        .hash = device_program_hash_func,
+        .compare = device_program_compare_func,
+};
+
+static int device_program_load_shared(Manager *m, BPFProgram *prog) {
+        _cleanup_(bpf_program_unrefp) BPFProgram *cached = NULL;
+        BPFProgram *found;
+        int r;
+
+        assert(m);
+        assert(prog);
+
+        /* Device control programs reference no maps, hence two programs with the same instructions behave the same,
+         * and one kernel object may be attached to any number of cgroups. Many units (containers in particular) use
+         * the same device policy, hence let's load each distinct program into the kernel only once, and pass around
+         * new fds to that. This saves the verifier run and the kernel memory for each of the copies. The attachment
+         * is still tracked by each BPFProgram object separately, hence detaching works as before. */
+
+        if (prog->kernel_fd >= 0)
+                return 0;
+
+        found = set_get(m->bpf_device_programs, prog);
+        if (found) {
+                prog->kernel_fd = fcntl(found->kernel_fd, F_DUPFD_CLOEXEC, 3);
+                if (prog->kernel_fd < 0)
+                        return -errno;
+
+                return 0;
+        }
+
+        r = bpf_program_load_kernel(prog, NULL, 0);
+        if (r < 0)
+                return r;
+
+        if (set_size(m->bpf_device_programs) >= BPF_DEVICE_PROGRAMS_CACHE_MAX)
+                return 0;
+
+        /* Keep a copy that is never attached anywhere, so that detaching the unit's program doesn't affect the
+         * cache, and the cache doesn't keep the unit's program attached. */
+        r = bpf_program_new(prog->prog_type, &cached);
+        if (r < 0)
+                return r;
+
+        r = bpf_program_add_instructions(cached, prog->instructions, prog->n_instructions);
+        if (r < 0)
+                return r;
+
+        cached->kernel_fd = fcntl(prog->kernel_fd, F_DUPFD_CLOEXEC, 3);
+        if (cached->kernel_fd < 0)
+                return -errno;
+
+        r = set_ensure_allocated(&m->bpf_device_programs, &device_program_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = set_put(m->bpf_device_programs, cached);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(cached);
+        return 0;
+}
+
 int cgroup_apply_device_bpf(Unit *u, BPFProgram *prog, CGroupDevicePolicy policy, bool whitelist) {
         struct bpf_insn post_insn[] = {
                 /* return DENY */
@@ -172,11 +261,21 @@ int cgroup_apply_device_bpf(Unit *u, BPFProgram *prog, CGroupDevicePolicy policy
         if (r < 0)
                 return log_error_errno(r, "Extending device control BPF program failed: %m");
 
+        /* If the very same program is installed already there's nothing to do. This also matters because the
+         * programs might share one kernel object, and the kernel refuses attaching the same object twice to the
+         * same cgroup. */
+        if (u->bpf_device_control_installed &&
+            device_program_compare_func(u->bpf_device_control_installed, prog) == 0)
+                return 0;
+
+        r = device_program_load_shared(u->manager, prog);
+        if (r < 0)
+                log_unit_debug_errno(u, r, "Failed to share device control BPF program, ignoring: %m");
+
         r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, u->cgroup_path, NULL, &path);
         if (r < 0)
                 return log_error_errno(r, "Failed to determine cgroup path: %m");
 
-
         r = bpf_program_cgroup_attach(prog, BPF_CGROUP_DEVICE, path, BPF_F_ALLOW_MULTI);
         if (r < 0)
                 return log_error_errno(r, "Attaching device control BPF program to cgroup %s failed: %m", path);
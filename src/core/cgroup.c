@@ -14,6 +14,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
+#include "manager-trace.h"
 #include "parse-util.h"
 #include "path-util.h"
 #include "process-util.h"
@@ -556,12 +557,54 @@ static uint64_t cgroup_context_cpu_shares(CGroupContext *c, ManagerState state)
                 return CGROUP_CPU_SHARES_DEFAULT;
 }
 
+static int unit_cgroup_set_attribute(Unit *u, const char *controller, const char *attribute, const char *value) {
+        _cleanup_free_ char *k = NULL, *v = NULL;
+        char *old_key, *old_value;
+        int r;
+
+        assert(u);
+        assert(attribute);
+        assert(value);
+
+        /* Writes a cgroup attribute of the unit, but skips the write if the very same value was written before
+         * into the same cgroup. Only use this for attributes that carry a single value, not for the ones that take
+         * per-device lines, such as io.max or devices.allow, where a write only changes part of the setting. */
+
+        if (streq_ptr(hashmap_get(u->cgroup_attribute_cache, attribute), value))
+                return 0;
+
+        r = cg_set_attribute(controller, u->cgroup_path, attribute, value);
+
+        /* The old value is stale now, and if the write failed we don't know what the kernel has */
+        old_value = hashmap_remove2(u->cgroup_attribute_cache, attribute, (void**) &old_key);
+        free(old_value);
+        free(old_key);
+
+        if (r < 0)
+                return r;
+
+        /* The cache is only an optimization, hence don't fail if we can't update it */
+        k = strdup(attribute);
+        v = strdup(value);
+        if (!k || !v)
+                return 0;
+
+        if (hashmap_ensure_allocated(&u->cgroup_attribute_cache, &string_hash_ops) < 0)
+                return 0;
+
+        if (hashmap_put(u->cgroup_attribute_cache, k, v) < 0)
+                return 0;
+
+        k = v = NULL;
+        return 0;
+}
+
 static void cgroup_apply_unified_cpu_config(Unit *u, uint64_t weight, uint64_t quota) {
         char buf[MAX(DECIMAL_STR_MAX(uint64_t) + 1, (DECIMAL_STR_MAX(usec_t) + 1) * 2)];
         int r;
 
         xsprintf(buf, "%" PRIu64 "\n", weight);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.weight", buf);
+        r = unit_cgroup_set_attribute(u, "cpu", "cpu.weight", buf);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.weight: %m");
@@ -572,7 +615,7 @@ static void cgroup_apply_unified_cpu_config(Unit *u, uint64_t weight, uint64_t q
         else
                 xsprintf(buf, "max " USEC_FMT "\n", CGROUP_CPU_QUOTA_PERIOD_USEC);
 
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.max", buf);
+        r = unit_cgroup_set_attribute(u, "cpu", "cpu.max", buf);
 
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
@@ -584,22 +627,22 @@ static void cgroup_apply_legacy_cpu_config(Unit *u, uint64_t shares, uint64_t qu
         int r;
 
         xsprintf(buf, "%" PRIu64 "\n", shares);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.shares", buf);
+        r = unit_cgroup_set_attribute(u, "cpu", "cpu.shares", buf);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.shares: %m");
 
         xsprintf(buf, USEC_FMT "\n", CGROUP_CPU_QUOTA_PERIOD_USEC);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_period_us", buf);
+        r = unit_cgroup_set_attribute(u, "cpu", "cpu.cfs_period_us", buf);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.cfs_period_us: %m");
 
         if (quota != USEC_INFINITY) {
                 xsprintf(buf, USEC_FMT "\n", quota * CGROUP_CPU_QUOTA_PERIOD_USEC / USEC_PER_SEC);
-                r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_quota_us", buf);
+                r = unit_cgroup_set_attribute(u, "cpu", "cpu.cfs_quota_us", buf);
         } else
-                r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_quota_us", "-1");
+                r = unit_cgroup_set_attribute(u, "cpu", "cpu.cfs_quota_us", "-1");
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.cfs_quota_us: %m");
@@ -773,7 +816,7 @@ static void cgroup_apply_unified_memory_limit(Unit *u, const char *file, uint64_
         if (v != CGROUP_LIMIT_MAX)
                 xsprintf(buf, "%" PRIu64 "\n", v);
 
-        r = cg_set_attribute("memory", u->cgroup_path, file, buf);
+        r = unit_cgroup_set_attribute(u, "memory", file, buf);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set %s: %m", file);
@@ -1035,7 +1078,7 @@ static void cgroup_context_apply(
                         else
                                 xsprintf(buf, "%" PRIu64 "\n", val);
 
-                        r = cg_set_attribute("memory", path, "memory.limit_in_bytes", buf);
+                        r = unit_cgroup_set_attribute(u, "memory", "memory.limit_in_bytes", buf);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set memory.limit_in_bytes: %m");
@@ -1159,9 +1202,9 @@ static void cgroup_context_apply(
                                 char buf[DECIMAL_STR_MAX(uint64_t) + 2];
 
                                 sprintf(buf, "%" PRIu64 "\n", c->tasks_max);
-                                r = cg_set_attribute("pids", path, "pids.max", buf);
+                                r = unit_cgroup_set_attribute(u, "pids", "pids.max", buf);
                         } else
-                                r = cg_set_attribute("pids", path, "pids.max", "max");
+                                r = unit_cgroup_set_attribute(u, "pids", "pids.max", "max");
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set pids.max: %m");
@@ -1586,6 +1629,12 @@ static int unit_create_cgroup(
                 return log_unit_error_errno(u, r, "Failed to create cgroup %s: %m", u->cgroup_path);
         created = r;
 
+        /* A freshly created cgroup has the kernel defaults set, forget what we wrote into an earlier incarnation.
+         * If the set of controllers changed we might have gained new per-controller cgroups on the legacy
+         * hierarchies, hence be careful and start from scratch in that case too. */
+        if (created || !u->cgroup_realized || u->cgroup_realized_mask != target_mask)
+                u->cgroup_attribute_cache = hashmap_free_free_free(u->cgroup_attribute_cache);
+
         /* Start watching it */
         (void) unit_watch_cgroup(u);
 
@@ -1816,6 +1865,7 @@ static void unit_remove_from_cgroup_realize_queue(Unit *u) {
  * Returns 0 on success and < 0 on failure. */
 static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
         CGroupMask target_mask, enable_mask;
+        usec_t begin;
         int r;
 
         assert(u);
@@ -1836,6 +1886,8 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
         }
 
         /* And then do the real work */
+        begin = manager_trace_now(u->manager);
+
         r = unit_create_cgroup(u, target_mask, enable_mask);
         if (r < 0)
                 return r;
@@ -1844,6 +1896,9 @@ static int unit_realize_cgroup_now(Unit *u, ManagerState state) {
         cgroup_context_apply(u, target_mask, state);
         cgroup_xattr_apply(u);
 
+        if (begin > 0)
+                manager_trace_event(u->manager, TRACE_EVENT_CGROUP_REALIZE, u, NULL, begin, now(CLOCK_MONOTONIC));
+
         /* Now, reset the invalidation mask */
         u->cgroup_invalidated_mask = 0;
         return 0;
@@ -1899,6 +1954,12 @@ static void unit_add_siblings_to_cgroup_realize_queue(Unit *u) {
                         if (UNIT_DEREF(m->slice) != slice)
                                 continue;
 
+                        /* Already queued, e.g. because we were called for another
+                         * unit in the same slice before. Skip the mask calculations
+                         * below, they are not cheap for slices. */
+                        if (m->in_cgroup_realize_queue)
+                                continue;
+
                         /* No point in doing cgroup application for units
                          * without active processes. */
                         if (UNIT_IS_INACTIVE_OR_FAILED(unit_active_state(m)))
@@ -1948,6 +2009,8 @@ void unit_release_cgroup(Unit *u) {
 
         /* Forgets all cgroup details for this cgroup */
 
+        u->cgroup_attribute_cache = hashmap_free_free_free(u->cgroup_attribute_cache);
+
         if (u->cgroup_path) {
                 (void) hashmap_remove(u->manager->cgroup_unit, u->cgroup_path);
                 u->cgroup_path = mfree(u->cgroup_path);
@@ -2211,12 +2274,20 @@ void unit_add_to_cgroup_empty_queue(Unit *u) {
 }
 
 static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_set_free_ Set *units = NULL;
         Manager *m = userdata;
+        Iterator i;
+        Unit *u;
 
         assert(s);
         assert(fd >= 0);
         assert(m);
 
+        /* We get an event each time a cgroup.events file changes, i.e. whenever a cgroup becomes populated or
+         * empty. Busy cgroups hence might have queued multiple events since the last iteration. First drain the
+         * inotify fd and collect the affected units, and then check each of them only once, as that involves
+         * reading cgroup.events from cgroupfs. */
+
         for (;;) {
                 union inotify_event_buffer buffer;
                 struct inotify_event *e;
@@ -2225,14 +2296,12 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                 l = read(fd, &buffer, sizeof(buffer));
                 if (l < 0) {
                         if (IN_SET(errno, EINTR, EAGAIN))
-                                return 0;
+                                break;
 
                         return log_error_errno(errno, "Failed to read control group inotify events: %m");
                 }
 
                 FOREACH_INOTIFY_EVENT(e, buffer, l) {
-                        Unit *u;
-
                         if (e->wd < 0)
                                 /* Queue overflow has no watch descriptor */
                                 continue;
@@ -2249,9 +2318,20 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                                  * this here safely. */
                                 continue;
 
-                        unit_add_to_cgroup_empty_queue(u);
+                        if (u->in_cgroup_empty_queue)
+                                continue;
+
+                        /* If we can't remember the unit for later, process it right-away */
+                        if (set_ensure_allocated(&units, NULL) < 0 ||
+                            set_put(units, u) < 0)
+                                unit_add_to_cgroup_empty_queue(u);
                 }
         }
+
+        SET_FOREACH(u, units, i)
+                unit_add_to_cgroup_empty_queue(u);
+
+        return 0;
 }
 
 static int cg_bpf_mask_supported(CGroupMask *ret) {
@@ -2437,6 +2517,8 @@ void manager_shutdown_cgroup(Manager *m, bool delete) {
 
         m->cgroup_inotify_wd_unit = hashmap_free(m->cgroup_inotify_wd_unit);
 
+        m->bpf_device_programs = set_free_with_destructor(m->bpf_device_programs, bpf_program_unref);
+
         m->cgroup_inotify_event_source = sd_event_source_unref(m->cgroup_inotify_event_source);
         m->cgroup_inotify_fd = safe_close(m->cgroup_inotify_fd);
 
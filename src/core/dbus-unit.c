@@ -1242,6 +1242,33 @@ void bus_unit_send_removed_signal(Unit *u) {
         r = bus_foreach_bus(u->manager, u->bus_track, send_removed_signal, u);
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit remove signal for %s: %m", u->id);
+
+        bus_unit_invalidate_property_cache(u);
+}
+
+void bus_unit_invalidate_property_cache(Unit *u) {
+        Iterator i, j;
+        const char *t;
+        sd_bus *b;
+
+        assert(u);
+
+        /* The ExecContext and KillContext properties are cached by sd-bus per object path. Make sure a unit
+         * later loaded under the same name doesn't get the values of this one. We don't send
+         * InterfacesRemoved for units, hence this needs to be done explicitly, for all names of the unit and
+         * on every bus the unit objects are registered on, regardless of any subscriptions. */
+
+        SET_FOREACH(t, u->names, i) {
+                _cleanup_free_ char *p = NULL;
+
+                p = unit_dbus_path_from_name(t);
+
+                /* Without the path, drop everything rather than keeping stale values around */
+                SET_FOREACH(b, u->manager->private_buses, j)
+                        (void) sd_bus_invalidate_property_cache(b, p, NULL);
+                if (u->manager->api_bus)
+                        (void) sd_bus_invalidate_property_cache(u->manager->api_bus, p, NULL);
+        }
 }
 
 int bus_unit_queue_job(
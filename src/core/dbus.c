@@ -46,6 +46,9 @@
 
 #define CONNECTIONS_MAX 4096
 
+/* Signals from the bus tend to come in bursts, dispatch a couple of them per event loop iteration */
+#define BUS_PROCESS_BATCH 16U
+
 static void destroy_bus(Manager *m, sd_bus **bus);
 
 int bus_send_pending_reload_message(Manager *m) {
@@ -897,6 +900,8 @@ int bus_init_api(Manager *m) {
                 if (r < 0)
                         return log_error_errno(r, "Failed to attach API bus to event loop: %m");
 
+                (void) sd_bus_set_process_batch(bus, BUS_PROCESS_BATCH);
+
                 r = bus_setup_disconnected_match(m, bus);
                 if (r < 0)
                         return r;
@@ -958,6 +963,8 @@ int bus_init_system(Manager *m) {
                 if (r < 0)
                         return log_error_errno(r, "Failed to attach system bus to event loop: %m");
 
+                (void) sd_bus_set_process_batch(bus, BUS_PROCESS_BATCH);
+
                 r = bus_setup_disconnected_match(m, bus);
                 if (r < 0)
                         return r;
@@ -1,14 +1,17 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
+#include <poll.h>
 #include <sys/epoll.h>
 
 #include "alloc-util.h"
 #include "bus-error.h"
 #include "dbus-device.h"
+#include "device-monitor-private.h"
 #include "device-private.h"
 #include "device-util.h"
 #include "device.h"
+#include "io-util.h"
 #include "log.h"
 #include "parse-util.h"
 #include "path-util.h"
@@ -25,6 +28,9 @@ static const UnitActiveState state_translation_table[_DEVICE_STATE_MAX] = {
         [DEVICE_PLUGGED] = UNIT_ACTIVE,
 };
 
+/* The maximum number of uevents we process in one go */
+#define DEVICE_BATCH_MAX 256U
+
 static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata);
 static void device_update_found_one(Device *d, DeviceFound found, DeviceFound mask);
 
@@ -865,42 +871,45 @@ static void device_propagate_reload_by_sysfs(Manager *m, const char *sysfs) {
         }
 }
 
-static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
-        Manager *m = userdata;
+static int device_event_get(sd_device *dev, const char **ret_sysfs, const char **ret_action) {
+        int r;
+
+        assert(dev);
+        assert(ret_sysfs);
+        assert(ret_action);
+
+        r = sd_device_get_syspath(dev, ret_sysfs);
+        if (r < 0)
+                return log_device_error_errno(dev, r, "Failed to get device sys path: %m");
+
+        r = sd_device_get_property_value(dev, "ACTION", ret_action);
+        if (r < 0)
+                return log_device_error_errno(dev, r, "Failed to get udev action string: %m");
+
+        return 0;
+}
+
+static void device_dispatch_event(Manager *m, sd_device *dev) {
         const char *action, *sysfs;
         int r;
 
         assert(m);
         assert(dev);
 
-        r = sd_device_get_syspath(dev, &sysfs);
-        if (r < 0) {
-                log_device_error_errno(dev, r, "Failed to get device sys path: %m");
-                return 0;
-        }
+        /* The first half of processing a uevent: everything that needs to happen before the load queue is
+         * dispatched. */
 
-        r = sd_device_get_property_value(dev, "ACTION", &action);
-        if (r < 0) {
-                log_device_error_errno(dev, r, "Failed to get udev action string: %m");
-                return 0;
-        }
+        if (device_event_get(dev, &sysfs, &action) < 0)
+                return;
 
         if (streq(action, "change"))
                 device_propagate_reload_by_sysfs(m, sysfs);
 
-        /* A change event can signal that a device is becoming ready, in particular if
-         * the device is using the SYSTEMD_READY logic in udev
-         * so we need to reach the else block of the follwing if, even for change events */
-        if (streq(action, "remove"))  {
+        if (streq(action, "remove")) {
                 r = swap_process_device_remove(m, dev);
                 if (r < 0)
                         log_device_warning_errno(dev, r, "Failed to process swap device remove event, ignoring: %m");
 
-                /* If we get notified that a device was removed by
-                 * udev, then it's completely gone, hence unset all
-                 * found bits */
-                device_update_found_by_sysfs(m, sysfs, 0, DEVICE_FOUND_UDEV|DEVICE_FOUND_MOUNT|DEVICE_FOUND_SWAP);
-
         } else if (device_is_ready(dev)) {
 
                 (void) device_process_new(m, dev);
@@ -908,18 +917,109 @@ static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *
                 r = swap_process_device_new(m, dev);
                 if (r < 0)
                         log_device_warning_errno(dev, r, "Failed to process swap device new event, ignoring: %m");
+        }
+}
 
-                manager_dispatch_load_queue(m);
+static void device_dispatch_event_found(Manager *m, sd_device *dev) {
+        const char *action, *sysfs;
+
+        assert(m);
+        assert(dev);
+
+        /* The second half: update the found bits now that the units created in the first half are loaded. */
+
+        if (device_event_get(dev, &sysfs, &action) < 0)
+                return;
+
+        /* A change event can signal that a device is becoming ready, in particular if
+         * the device is using the SYSTEMD_READY logic in udev
+         * so we need to reach the else block of the follwing if, even for change events */
+        if (streq(action, "remove"))
+                /* If we get notified that a device was removed by
+                 * udev, then it's completely gone, hence unset all
+                 * found bits */
+                device_update_found_by_sysfs(m, sysfs, 0, DEVICE_FOUND_UDEV|DEVICE_FOUND_MOUNT|DEVICE_FOUND_SWAP);
 
+        else if (device_is_ready(dev))
                 /* The device is found now, set the udev found bit */
                 device_update_found_by_sysfs(m, sysfs, DEVICE_FOUND_UDEV, DEVICE_FOUND_UDEV);
 
-        } else {
+        else
                 /* The device is nominally around, but not ready for
                  * us. Hence unset the udev bit, but leave the rest
                  * around. */
-
                 device_update_found_by_sysfs(m, sysfs, 0, DEVICE_FOUND_UDEV);
+}
+
+static bool device_event_coalesce(sd_device **batch, size_t n, sd_device *dev) {
+        const char *sysfs, *action, *other_sysfs, *other_action;
+        size_t i;
+
+        assert(batch || n == 0);
+        assert(dev);
+
+        /* If the most recent queued event for the same device is a change event, and so is this one, the
+         * newer one supersedes the older one. Returns true if dev took the place of a queued event. */
+
+        if (sd_device_get_syspath(dev, &sysfs) < 0 ||
+            sd_device_get_property_value(dev, "ACTION", &action) < 0 ||
+            !streq(action, "change"))
+                return false;
+
+        for (i = n; i > 0; i--) {
+                if (sd_device_get_syspath(batch[i-1], &other_sysfs) < 0)
+                        continue;
+                if (!streq(sysfs, other_sysfs))
+                        continue;
+
+                if (sd_device_get_property_value(batch[i-1], "ACTION", &other_action) < 0 ||
+                    !streq(other_action, "change"))
+                        return false;
+
+                sd_device_unref(batch[i-1]);
+                batch[i-1] = sd_device_ref(dev);
+                return true;
+        }
+
+        return false;
+}
+
+static int device_dispatch_io(sd_device_monitor *monitor, sd_device *dev, void *userdata) {
+        sd_device *batch[DEVICE_BATCH_MAX];
+        Manager *m = userdata;
+        size_t n = 0, i;
+        int fd, r;
+
+        assert(m);
+        assert(dev);
+
+        batch[n++] = sd_device_ref(dev);
+
+        /* During coldplug udev sends us a storm of events. Pick up whatever else is already queued right away, so
+         * that we only have to dispatch the load queue once for all of them, and repeated change events for the
+         * same device are only processed once. */
+        fd = device_monitor_get_fd(monitor);
+        while (n < DEVICE_BATCH_MAX && fd >= 0 && fd_wait_for_event(fd, POLLIN, 0) > 0) {
+                _cleanup_(sd_device_unrefp) sd_device *next = NULL;
+
+                r = device_monitor_receive_device(monitor, &next);
+                if (r == -EAGAIN || r == 0) /* Message was ignored or filtered */
+                        continue;
+                if (r < 0)
+                        break;
+
+                if (!device_event_coalesce(batch, n, next))
+                        batch[n++] = TAKE_PTR(next);
+        }
+
+        for (i = 0; i < n; i++)
+                device_dispatch_event(m, batch[i]);
+
+        manager_dispatch_load_queue(m);
+
+        for (i = 0; i < n; i++) {
+                device_dispatch_event_found(m, batch[i]);
+                sd_device_unref(batch[i]);
         }
 
         return 0;
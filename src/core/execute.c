@@ -65,6 +65,7 @@
 #include "log.h"
 #include "macro.h"
 #include "manager.h"
+#include "manager-trace.h"
 #include "missing.h"
 #include "mkdir.h"
 #include "namespace.h"
@@ -3572,6 +3573,7 @@ int exec_spawn(Unit *unit,
         _cleanup_strv_free_ char **files_env = NULL;
         size_t n_storage_fds = 0, n_socket_fds = 0;
         _cleanup_free_ char *line = NULL;
+        usec_t begin;
         pid_t pid;
 
         assert(unit);
@@ -3581,6 +3583,8 @@ int exec_spawn(Unit *unit,
         assert(params);
         assert(params->fds || (params->n_socket_fds + params->n_storage_fds <= 0));
 
+        begin = manager_trace_now(unit->manager);
+
         if (context->std_input == EXEC_INPUT_SOCKET ||
             context->std_output == EXEC_OUTPUT_SOCKET ||
             context->std_error == EXEC_OUTPUT_SOCKET) {
@@ -3668,6 +3672,9 @@ int exec_spawn(Unit *unit,
 
         exec_status_start(&command->exec_status, pid);
 
+        if (begin > 0)
+                manager_trace_event(unit->manager, TRACE_EVENT_EXEC_SPAWN, unit, command->path, begin, now(CLOCK_MONOTONIC));
+
         *ret = pid;
         return 0;
 }
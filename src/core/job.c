@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
+#include <sys/resource.h>
 
 #include "sd-id128.h"
 #include "sd-messages.h"
@@ -14,6 +15,7 @@
 #include "job.h"
 #include "log.h"
 #include "macro.h"
+#include "manager-trace.h"
 #include "parse-util.h"
 #include "serialize.h"
 #include "set.h"
@@ -72,7 +74,7 @@ void job_unlink(Job *j) {
         assert(!j->object_list);
 
         if (j->in_run_queue) {
-                LIST_REMOVE(run_queue, j->manager->run_queue, j);
+                prioq_remove(j->manager->run_queue, j, &j->run_queue_idx);
                 j->in_run_queue = false;
         }
 
@@ -657,7 +659,7 @@ int job_run_and_invalidate(Job *j) {
         assert(j->type < _JOB_TYPE_MAX_IN_TRANSACTION);
         assert(j->in_run_queue);
 
-        LIST_REMOVE(run_queue, j->manager->run_queue, j);
+        prioq_remove(j->manager->run_queue, j, &j->run_queue_idx);
         j->in_run_queue = false;
 
         if (j->state != JOB_WAITING)
@@ -978,6 +980,27 @@ static int job_save_pending_finished_job(Job *j) {
         return set_put(j->manager->pending_finished_jobs, j);
 }
 
+static void job_trace(Job *j) {
+        const char *type, *detail;
+        usec_t n;
+
+        assert(j);
+
+        if (!manager_trace_enabled(j->manager))
+                return;
+
+        n = now(CLOCK_MONOTONIC);
+        type = job_type_to_string(j->type);
+        detail = strjoina(type, "/", job_result_to_string(j->result));
+
+        /* Jobs that never ran only waited, e.g. for dependencies that failed */
+        if (j->begin_running_usec > 0) {
+                manager_trace_event(j->manager, TRACE_EVENT_JOB_WAITING, j->unit, type, j->begin_usec, j->begin_running_usec);
+                manager_trace_event(j->manager, TRACE_EVENT_JOB_RUNNING, j->unit, detail, j->begin_running_usec, n);
+        } else
+                manager_trace_event(j->manager, TRACE_EVENT_JOB_WAITING, j->unit, detail, j->begin_usec, n);
+}
+
 int job_finish_and_invalidate(Job *j, JobResult result, bool recursive, bool already) {
         Unit *u;
         Unit *other;
@@ -1000,6 +1023,8 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive, bool alr
         if (!already)
                 job_emit_done_status_message(u, j->id, t, result);
 
+        job_trace(j);
+
         /* Patch restart jobs so that they become normal start jobs */
         if (result == JOB_DONE && t == JOB_RESTART) {
 
@@ -1138,6 +1163,44 @@ int job_start_timer(Job *j, bool job_running) {
         return 0;
 }
 
+static uint64_t job_run_queue_priority(Job *j) {
+        ExecContext *c;
+        unsigned n;
+        int nice;
+
+        assert(j);
+
+        /* Calculates the order in which runnable jobs are dispatched: first by the Nice= level configured for
+         * the unit, then by the number of units ordered after it, so that jobs likely to be on a critical
+         * path to some target fork off their processes before leaf jobs. Higher values are dispatched earlier.
+         * This is calculated once when the job is enqueued, so that the order doesn't change under our feet,
+         * while the job waits in the queue. */
+
+        c = unit_get_exec_context(j->unit);
+        nice = c && c->nice_set ? c->nice : 0;
+
+        n = hashmap_size(j->unit->dependencies[UNIT_BEFORE]);
+
+        return ((uint64_t) (PRIO_MAX - nice) << 32) | n;
+}
+
+static int job_compare_run_queue(const void *a, const void *b) {
+        const Job *x = a, *y = b;
+
+        if (x->run_queue_priority > y->run_queue_priority)
+                return -1;
+        if (x->run_queue_priority < y->run_queue_priority)
+                return 1;
+
+        /* Keep the order deterministic among equals */
+        if (x->id < y->id)
+                return -1;
+        if (x->id > y->id)
+                return 1;
+
+        return 0;
+}
+
 void job_add_to_run_queue(Job *j) {
         int r;
 
@@ -1147,14 +1210,27 @@ void job_add_to_run_queue(Job *j) {
         if (j->in_run_queue)
                 return;
 
-        if (!j->manager->run_queue) {
+        r = prioq_ensure_allocated(&j->manager->run_queue, job_compare_run_queue);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to allocate job run queue, ignoring: %m");
+                return;
+        }
+
+        j->run_queue_priority = job_run_queue_priority(j);
+
+        r = prioq_put(j->manager->run_queue, j, &j->run_queue_idx);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to put job in run queue, ignoring: %m");
+                return;
+        }
+
+        j->in_run_queue = true;
+
+        if (prioq_size(j->manager->run_queue) == 1) {
                 r = sd_event_source_set_enabled(j->manager->run_queue_event_source, SD_EVENT_ONESHOT);
                 if (r < 0)
                         log_warning_errno(r, "Failed to enable job run queue event source, ignoring: %m");
         }
-
-        LIST_PREPEND(run_queue, j->manager->run_queue, j);
-        j->in_run_queue = true;
 }
 
 void job_add_to_dbus_queue(Job *j) {
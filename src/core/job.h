@@ -115,13 +115,16 @@ struct Job {
         Unit *unit;
 
         LIST_FIELDS(Job, transaction);
-        LIST_FIELDS(Job, run_queue);
         LIST_FIELDS(Job, dbus_queue);
         LIST_FIELDS(Job, gc_queue);
 
         LIST_HEAD(JobDependency, subject_list);
         LIST_HEAD(JobDependency, object_list);
 
+        /* Position and sort key in the manager's run queue */
+        unsigned run_queue_idx;
+        uint64_t run_queue_priority;
+
         /* Used for graph algs as a "I have been here" marker */
         Job* marker;
         unsigned generation;
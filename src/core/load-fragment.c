@@ -1627,7 +1627,6 @@ int config_parse_path_spec(const char *unit,
         s->unit = UNIT(p);
         s->path = TAKE_PTR(k);
         s->type = b;
-        s->inotify_fd = -1;
 
         LIST_PREPEND(spec, p->specs, s);
 
@@ -4447,38 +4446,56 @@ static int load_from_path(Unit *u, const char *path) {
                 }
 
         } else  {
+                const char *cached;
                 char **p;
 
-                STRV_FOREACH(p, u->manager->lookup_paths.search_path) {
-
-                        /* Instead of opening the path right away, we manually
-                         * follow all symlinks and add their name to our unit
-                         * name set while doing so */
-                        filename = path_make_absolute(path, *p);
+                /* If the path cache knows where this name is found first in the search path, try that
+                 * directly. If that fails for some reason, fall back to the full search below. */
+                cached = hashmap_get(u->manager->unit_name_map, path);
+                if (cached) {
+                        filename = strdup(cached);
                         if (!filename)
                                 return -ENOMEM;
 
-                        if (u->manager->unit_path_cache &&
-                            !set_get(u->manager->unit_path_cache, filename))
-                                r = -ENOENT;
-                        else
-                                r = open_follow(&filename, &f, symlink_names, &id);
-                        if (r >= 0)
-                                break;
-                        filename = mfree(filename);
+                        r = open_follow(&filename, &f, symlink_names, &id);
+                        if (r < 0) {
+                                filename = mfree(filename);
+                                set_clear_free(symlink_names);
+                        }
+                }
 
-                        /* ENOENT means that the file is missing or is a dangling symlink.
-                         * ENOTDIR means that one of paths we expect to be is a directory
-                         * is not a directory, we should just ignore that.
-                         * EACCES means that the directory or file permissions are wrong.
-                         */
-                        if (r == -EACCES)
-                                log_debug_errno(r, "Cannot access \"%s\": %m", filename);
-                        else if (!IN_SET(r, -ENOENT, -ENOTDIR))
-                                return r;
+                if (!filename) {
+                        STRV_FOREACH(p, u->manager->lookup_paths.search_path) {
 
-                        /* Empty the symlink names for the next run */
-                        set_clear_free(symlink_names);
+                                /* Instead of opening the path right away, we manually
+                                 * follow all symlinks and add their name to our unit
+                                 * name set while doing so */
+                                filename = path_make_absolute(path, *p);
+                                if (!filename)
+                                        return -ENOMEM;
+
+                                if (u->manager->unit_path_cache &&
+                                    !set_get(u->manager->unit_path_cache, filename))
+                                        r = -ENOENT;
+                                else
+                                        r = open_follow(&filename, &f, symlink_names, &id);
+                                if (r >= 0)
+                                        break;
+                                filename = mfree(filename);
+
+                                /* ENOENT means that the file is missing or is a dangling symlink.
+                                 * ENOTDIR means that one of paths we expect to be is a directory
+                                 * is not a directory, we should just ignore that.
+                                 * EACCES means that the directory or file permissions are wrong.
+                                 */
+                                if (r == -EACCES)
+                                        log_debug_errno(r, "Cannot access \"%s\": %m", filename);
+                                else if (!IN_SET(r, -ENOENT, -ENOTDIR))
+                                        return r;
+
+                                /* Empty the symlink names for the next run */
+                                set_clear_free(symlink_names);
+                        }
                 }
         }
 
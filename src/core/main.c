@@ -5,6 +5,7 @@
 #include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
+#include <stdio_ext.h>
 #include <string.h>
 #include <sys/mount.h>
 #include <sys/prctl.h>
@@ -51,6 +52,7 @@
 #include "loopback-setup.h"
 #include "machine-id-setup.h"
 #include "manager.h"
+#include "manager-trace.h"
 #include "missing.h"
 #include "mount-setup.h"
 #include "os-util.h"
@@ -128,6 +130,7 @@ static bool arg_default_tasks_accounting = true;
 static uint64_t arg_default_tasks_max = UINT64_MAX;
 static sd_id128_t arg_machine_id = {};
 static EmergencyAction arg_cad_burst_action = EMERGENCY_ACTION_REBOOT_FORCE;
+static unsigned arg_trace_events = 0;
 
 _noreturn_ static void freeze_or_reboot(void) {
 
@@ -480,6 +483,15 @@ static int parse_proc_cmdline_item(const char *key, const char *value, void *dat
 
                 (void) parse_path_argument_and_warn(value, false, &arg_watchdog_device);
 
+        } else if (proc_cmdline_key_streq(key, "systemd.trace_events")) {
+
+                if (value) {
+                        r = safe_atou(value, &arg_trace_events);
+                        if (r < 0)
+                                log_warning_errno(r, "Failed to parse number of trace events '%s', ignoring: %m", value);
+                } else
+                        arg_trace_events = MANAGER_TRACE_EVENTS_DEFAULT;
+
         } else if (streq(key, "quiet") && !value) {
 
                 if (arg_show_status == _SHOW_STATUS_INVALID)
@@ -710,6 +722,7 @@ static int parse_config_file(void) {
                 { "Manager", "DefaultTasksAccounting",    config_parse_bool,             0, &arg_default_tasks_accounting          },
                 { "Manager", "DefaultTasksMax",           config_parse_tasks_max,        0, &arg_default_tasks_max                 },
                 { "Manager", "CtrlAltDelBurstAction",     config_parse_emergency_action, 0, &arg_cad_burst_action                  },
+                { "Manager", "TraceEvents",               config_parse_unsigned,         0, &arg_trace_events                      },
                 {}
         };
 
@@ -764,6 +777,7 @@ static void set_manager_defaults(Manager *m) {
 }
 
 static void set_manager_settings(Manager *m) {
+        int r;
 
         assert(m);
 
@@ -777,6 +791,10 @@ static void set_manager_settings(Manager *m) {
         m->cad_burst_action = arg_cad_burst_action;
 
         manager_set_show_status(m, arg_show_status);
+
+        r = manager_trace_setup(m, arg_trace_events);
+        if (r < 0)
+                log_warning_errno(r, "Failed to allocate trace event buffer, ignoring: %m");
 }
 
 static int parse_argv(int argc, char *argv[]) {
@@ -1024,6 +1042,8 @@ static int parse_argv(int argc, char *argv[]) {
                         if (!f)
                                 return log_error_errno(errno, "Failed to open serialization fd %d: %m", fd);
 
+                        (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+
                         safe_fclose(arg_serialization);
                         arg_serialization = f;
 
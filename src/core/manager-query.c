@@ -0,0 +1,385 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fs-util.h"
+#include "json.h"
+#include "log.h"
+#include "manager-query.h"
+#include "mkdir.h"
+#include "process-util.h"
+#include "selinux-util.h"
+#include "set.h"
+#include "socket-util.h"
+#include "string-util.h"
+#include "umask-util.h"
+#include "unit.h"
+
+/* A small read-only query interface for PID 1, for clients that poll a few pieces of unit state at a high rate and
+ * for which a D-Bus method call is too expensive. Each request is a single JSON object in a single SOCK_SEQPACKET
+ * packet, modelled after Varlink:
+ *
+ *     {"method":"io.systemd.Manager.GetUnitByPID","parameters":{"pid":4711}}
+ *
+ * and each answer is a single packet in return, either {"parameters":{...}} or {"error":"..."}.
+ * Requests are processed strictly in order, and a connection that doesn't read its replies is dropped. */
+
+#define QUERY_CONNECTIONS_MAX 512U
+#define QUERY_REQUEST_SIZE_MAX 4096U
+
+typedef struct QueryConnection {
+        Manager *manager;
+        int fd;
+        sd_event_source *event_source;
+} QueryConnection;
+
+static QueryConnection* query_connection_free(QueryConnection *c) {
+        if (!c)
+                return NULL;
+
+        if (c->manager)
+                (void) set_remove(c->manager->query_connections, c);
+
+        sd_event_source_unref(c->event_source);
+        safe_close(c->fd);
+
+        return mfree(c);
+}
+
+static int query_reply_unit(Unit *u, JsonVariant **ret) {
+        _cleanup_free_ char *path = NULL;
+
+        assert(u);
+        assert(ret);
+
+        path = unit_dbus_path(u);
+        if (!path)
+                return -ENOMEM;
+
+        return json_build(ret, JSON_BUILD_OBJECT(
+                                  JSON_BUILD_PAIR("parameters", JSON_BUILD_OBJECT(
+                                                  JSON_BUILD_PAIR("unit", JSON_BUILD_STRING(u->id)),
+                                                  JSON_BUILD_PAIR("path", JSON_BUILD_STRING(path)),
+                                                  JSON_BUILD_PAIR("loadState", JSON_BUILD_STRING(unit_load_state_to_string(u->load_state))),
+                                                  JSON_BUILD_PAIR("activeState", JSON_BUILD_STRING(unit_active_state_to_string(unit_active_state(u)))),
+                                                  JSON_BUILD_PAIR("subState", JSON_BUILD_STRING(unit_sub_state_to_string(u)))))));
+}
+
+static int query_reply_error(const char *error, JsonVariant **ret) {
+        assert(error);
+        assert(ret);
+
+        return json_build(ret, JSON_BUILD_OBJECT(JSON_BUILD_PAIR("error", JSON_BUILD_STRING(error))));
+}
+
+static int query_get_unit_by_pid(QueryConnection *c, JsonVariant *parameters, JsonVariant **ret) {
+        static const JsonDispatch dispatch_table[] = {
+                { "pid", JSON_VARIANT_UNSIGNED, json_dispatch_uint32, 0, 0 },
+                {}
+        };
+
+        uint32_t pid = 0;
+        Unit *u;
+        int r;
+
+        assert(c);
+        assert(ret);
+
+        r = json_dispatch(parameters, dispatch_table, NULL, 0, &pid);
+        if (r < 0)
+                return query_reply_error("org.varlink.service.InvalidParameter", ret);
+
+        /* Like on the bus, PID 0 refers to the caller */
+        if (pid == 0) {
+                struct ucred ucred;
+
+                r = getpeercred(c->fd, &ucred);
+                if (r < 0)
+                        return r;
+
+                pid = ucred.pid;
+        }
+
+        if (pid <= 0 || pid > INT32_MAX)
+                return query_reply_error("org.varlink.service.InvalidParameter", ret);
+
+        u = manager_get_unit_by_pid(c->manager, (pid_t) pid);
+        if (!u)
+                return query_reply_error("io.systemd.Manager.NoUnitForPID", ret);
+
+        return query_reply_unit(u, ret);
+}
+
+static int query_get_unit(QueryConnection *c, JsonVariant *parameters, JsonVariant **ret) {
+        static const JsonDispatch dispatch_table[] = {
+                { "name", JSON_VARIANT_STRING, json_dispatch_string, 0, JSON_MANDATORY },
+                {}
+        };
+
+        _cleanup_free_ char *name = NULL;
+        Unit *u;
+        int r;
+
+        assert(c);
+        assert(ret);
+
+        r = json_dispatch(parameters, dispatch_table, NULL, 0, &name);
+        if (r < 0)
+                return query_reply_error("org.varlink.service.InvalidParameter", ret);
+
+        u = manager_get_unit(c->manager, name);
+        if (!u)
+                return query_reply_error("io.systemd.Manager.NoSuchUnit", ret);
+
+        return query_reply_unit(u, ret);
+}
+
+static int query_process(QueryConnection *c, JsonVariant *request, JsonVariant **ret) {
+        _cleanup_(json_variant_unrefp) JsonVariant *empty = NULL;
+        JsonVariant *method, *parameters;
+        int r;
+
+        assert(c);
+        assert(ret);
+
+        if (!json_variant_is_object(request))
+                return -EBADMSG;
+
+        method = json_variant_by_key(request, "method");
+        if (!method || !json_variant_is_string(method))
+                return -EBADMSG;
+
+        parameters = json_variant_by_key(request, "parameters");
+        if (!parameters) {
+                r = json_variant_new_object(&empty, NULL, 0);
+                if (r < 0)
+                        return r;
+
+                parameters = empty;
+        }
+
+        if (streq(json_variant_string(method), "io.systemd.Manager.GetUnitByPID"))
+                return query_get_unit_by_pid(c, parameters, ret);
+        if (streq(json_variant_string(method), "io.systemd.Manager.GetUnit"))
+                return query_get_unit(c, parameters, ret);
+
+        return query_reply_error("org.varlink.service.MethodNotFound", ret);
+}
+
+static int query_on_io(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_(json_variant_unrefp) JsonVariant *request = NULL, *reply = NULL;
+        QueryConnection *c = userdata;
+        char buf[QUERY_REQUEST_SIZE_MAX + 1];
+        _cleanup_free_ char *text = NULL;
+        ssize_t n;
+        int r;
+
+        assert(c);
+
+        n = recv(c->fd, buf, QUERY_REQUEST_SIZE_MAX, MSG_DONTWAIT|MSG_TRUNC);
+        if (n < 0) {
+                if (IN_SET(errno, EAGAIN, EINTR))
+                        return 0;
+
+                log_debug_errno(errno, "Failed to read query request, dropping connection: %m");
+                goto drop;
+        }
+        if (n == 0) /* EOF */
+                goto drop;
+        if ((size_t) n > QUERY_REQUEST_SIZE_MAX) {
+                log_debug("Query request too large, dropping connection.");
+                goto drop;
+        }
+
+        buf[n] = 0;
+
+        r = json_parse(buf, &request, NULL, NULL);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to parse query request, dropping connection: %m");
+                goto drop;
+        }
+
+        r = query_process(c, request, &reply);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to process query request, dropping connection: %m");
+                goto drop;
+        }
+
+        r = json_variant_format(reply, 0, &text);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to format query reply, dropping connection: %m");
+                goto drop;
+        }
+
+        /* We never block on a client, if it's not reading its replies fast enough, it's gone */
+        if (send(c->fd, text, strlen(text), MSG_DONTWAIT|MSG_NOSIGNAL) < 0) {
+                log_debug_errno(errno, "Failed to send query reply, dropping connection: %m");
+                goto drop;
+        }
+
+        return 0;
+
+drop:
+        query_connection_free(c);
+        return 0;
+}
+
+int manager_query_add_connection(Manager *m, int fd) {
+        QueryConnection *c;
+        int r;
+
+        assert(m);
+        assert(fd >= 0);
+
+        /* Serves requests on a connected SOCK_SEQPACKET socket. Takes possession of the fd on success. */
+
+        if (set_size(m->query_connections) >= QUERY_CONNECTIONS_MAX)
+                return -EBUSY;
+
+        r = set_ensure_allocated(&m->query_connections, NULL);
+        if (r < 0)
+                return r;
+
+        c = new(QueryConnection, 1);
+        if (!c)
+                return -ENOMEM;
+
+        *c = (QueryConnection) {
+                .fd = -1,
+        };
+
+        r = sd_event_add_io(m->event, &c->event_source, fd, EPOLLIN, query_on_io, c);
+        if (r < 0) {
+                query_connection_free(c);
+                return r;
+        }
+
+        (void) sd_event_source_set_description(c->event_source, "query-connection");
+
+        r = set_put(m->query_connections, c);
+        if (r < 0) {
+                query_connection_free(c);
+                return r;
+        }
+
+        c->manager = m;
+        c->fd = fd;
+        return 0;
+}
+
+static int query_on_connection(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_close_ int nfd = -1;
+        Manager *m = userdata;
+        int r;
+
+        assert(s);
+        assert(m);
+
+        nfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+        if (nfd < 0) {
+                log_warning_errno(errno, "Failed to accept query connection, ignoring: %m");
+                return 0;
+        }
+
+        r = manager_query_add_connection(m, nfd);
+        if (r == -EBUSY) {
+                log_warning("Too many concurrent query connections, refusing");
+                return 0;
+        }
+        if (r < 0) {
+                log_warning_errno(r, "Failed to set up query connection, ignoring: %m");
+                return 0;
+        }
+
+        TAKE_FD(nfd);
+        return 0;
+}
+
+int manager_query_init(Manager *m) {
+        _cleanup_close_ int fd = -1;
+        union sockaddr_union sa = {};
+        sd_event_source *s;
+        int r, salen;
+
+        assert(m);
+
+        if (m->query_listen_fd >= 0)
+                return 0;
+
+        if (MANAGER_IS_TEST_RUN(m))
+                return 0;
+
+        /* The requests carry no bus message we could do SELinux access checks on, hence don't offer this
+         * interface at all if a policy is loaded. */
+        if (mac_selinux_use())
+                return 0;
+
+        if (MANAGER_IS_SYSTEM(m)) {
+
+                if (getpid_cached() != 1)
+                        return 0;
+
+                salen = sockaddr_un_set_path(&sa.un, "/run/systemd/query");
+        } else {
+                const char *e, *joined;
+
+                e = secure_getenv("XDG_RUNTIME_DIR");
+                if (!e)
+                        return 0;
+
+                joined = strjoina(e, "/systemd/query");
+                salen = sockaddr_un_set_path(&sa.un, joined);
+        }
+        if (salen < 0)
+                return log_error_errno(salen, "Can't set path for AF_UNIX socket to bind to: %m");
+
+        RUN_WITH_UMASK(0022)
+                (void) mkdir_parents_label(sa.un.sun_path, 0755);
+        (void) sockaddr_un_unlink(&sa.un);
+
+        fd = socket(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+        if (fd < 0)
+                return log_error_errno(errno, "Failed to allocate query socket: %m");
+
+        /* Don't rely on the umask we happen to run with: the system manager's socket may be used by everybody,
+         * since all it offers is read-only, the user manager's only by its user, like the rest of the runtime
+         * directory. */
+        RUN_WITH_UMASK(MANAGER_IS_SYSTEM(m) ? 0111 : 0177)
+                r = bind(fd, &sa.sa, salen);
+        if (r < 0)
+                return log_error_errno(errno, "Failed to bind query socket: %m");
+
+        r = listen(fd, SOMAXCONN);
+        if (r < 0)
+                return log_error_errno(errno, "Failed to make query socket listening: %m");
+
+        r = sd_event_add_io(m->event, &s, fd, EPOLLIN, query_on_connection, m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate event source: %m");
+
+        (void) sd_event_source_set_description(s, "query-connection-listen");
+
+        m->query_listen_fd = TAKE_FD(fd);
+        m->query_listen_event_source = s;
+
+        log_debug("Successfully created query socket.");
+
+        return 0;
+}
+
+void manager_query_done(Manager *m) {
+        QueryConnection *c;
+
+        assert(m);
+
+        while ((c = set_first(m->query_connections)))
+                query_connection_free(c);
+
+        m->query_connections = set_free(m->query_connections);
+
+        m->query_listen_event_source = sd_event_source_unref(m->query_listen_event_source);
+        m->query_listen_fd = safe_close(m->query_listen_fd);
+}
@@ -0,0 +1,8 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include "manager.h"
+
+int manager_query_init(Manager *m);
+int manager_query_add_connection(Manager *m, int fd);
+void manager_query_done(Manager *m);
@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "json.h"
+#include "manager-trace.h"
+#include "string-table.h"
+#include "unit.h"
+
+/* An opt-in record of what the manager spent its time on, for finding out where boot and restart latency goes.
+ * Events are kept in a ring buffer of fixed size, and on request exported in the Chrome trace event format
+ * (which Perfetto and chrome://tracing can load), with one track per unit. Recording an event costs two
+ * allocations and a clock read, hence this is off by default. */
+
+static const char* const trace_event_type_table[_TRACE_EVENT_TYPE_MAX] = {
+        [TRACE_EVENT_JOB_WAITING] = "job-waiting",
+        [TRACE_EVENT_JOB_RUNNING] = "job-running",
+        [TRACE_EVENT_EXEC_SPAWN] = "exec-spawn",
+        [TRACE_EVENT_CGROUP_REALIZE] = "cgroup-realize",
+};
+
+DEFINE_PRIVATE_STRING_TABLE_LOOKUP_TO_STRING(trace_event_type, TraceEventType);
+
+static void trace_event_done(TraceEvent *e) {
+        assert(e);
+
+        e->unit = mfree(e->unit);
+        e->detail = mfree(e->detail);
+}
+
+void manager_trace_done(Manager *m) {
+        size_t i;
+
+        assert(m);
+
+        for (i = 0; i < m->n_trace_events; i++)
+                trace_event_done(m->trace_events + i);
+
+        m->trace_events = mfree(m->trace_events);
+        m->trace_events_max = m->n_trace_events = m->trace_events_next = 0;
+}
+
+int manager_trace_setup(Manager *m, unsigned n_events) {
+        TraceEvent *events;
+
+        assert(m);
+
+        n_events = MIN(n_events, MANAGER_TRACE_EVENTS_MAX);
+        if (n_events == m->trace_events_max)
+                return 0;
+
+        /* Changing the size drops what was recorded so far, which only happens if the setting is changed
+         * between reloads anyway. */
+        manager_trace_done(m);
+
+        if (n_events == 0)
+                return 0;
+
+        events = new0(TraceEvent, n_events);
+        if (!events)
+                return -ENOMEM;
+
+        m->trace_events = events;
+        m->trace_events_max = n_events;
+
+        return 0;
+}
+
+void manager_trace_event(Manager *m, TraceEventType type, Unit *u, const char *detail, usec_t begin, usec_t end) {
+        TraceEvent *e;
+
+        assert(m);
+        assert(type >= 0 && type < _TRACE_EVENT_TYPE_MAX);
+        assert(u);
+
+        if (!manager_trace_enabled(m))
+                return;
+
+        /* If tracing was turned on while something was in progress, we don't know when it began */
+        if (begin == 0 || begin > end)
+                return;
+
+        e = m->trace_events + m->trace_events_next;
+        if (m->n_trace_events < m->trace_events_max)
+                m->n_trace_events++;
+        else
+                trace_event_done(e); /* Overwrite the oldest event */
+
+        m->trace_events_next = (m->trace_events_next + 1) % m->trace_events_max;
+
+        *e = (TraceEvent) {
+                .type = type,
+                .unit = strdup(u->id),
+                .detail = detail ? strdup(detail) : NULL,
+                .begin = begin,
+                .end = end,
+        };
+
+        /* If we are out of memory we lose the event, but keep the slot consistent */
+        if (!e->unit)
+                e->detail = mfree(e->detail);
+}
+
+static int trace_event_append_json(
+                const TraceEvent *e,
+                Hashmap *tracks,
+                JsonVariant ***array,
+                size_t *n_array,
+                size_t *n_allocated) {
+
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+        unsigned tid;
+        int r;
+
+        assert(e);
+        assert(e->unit);
+
+        tid = PTR_TO_UINT(hashmap_get(tracks, e->unit));
+        assert(tid > 0);
+
+        if (e->detail)
+                r = json_build(&v, JSON_BUILD_OBJECT(
+                                               JSON_BUILD_PAIR("name", JSON_BUILD_STRING(trace_event_type_to_string(e->type))),
+                                               JSON_BUILD_PAIR("cat", JSON_BUILD_STRING("systemd")),
+                                               JSON_BUILD_PAIR("ph", JSON_BUILD_STRING("X")),
+                                               JSON_BUILD_PAIR("ts", JSON_BUILD_UNSIGNED(e->begin)),
+                                               JSON_BUILD_PAIR("dur", JSON_BUILD_UNSIGNED(e->end - e->begin)),
+                                               JSON_BUILD_PAIR("pid", JSON_BUILD_UNSIGNED(1)),
+                                               JSON_BUILD_PAIR("tid", JSON_BUILD_UNSIGNED(tid)),
+                                               JSON_BUILD_PAIR("args", JSON_BUILD_OBJECT(
+                                                                               JSON_BUILD_PAIR("detail", JSON_BUILD_STRING(e->detail))))));
+        else
+                r = json_build(&v, JSON_BUILD_OBJECT(
+                                               JSON_BUILD_PAIR("name", JSON_BUILD_STRING(trace_event_type_to_string(e->type))),
+                                               JSON_BUILD_PAIR("cat", JSON_BUILD_STRING("systemd")),
+                                               JSON_BUILD_PAIR("ph", JSON_BUILD_STRING("X")),
+                                               JSON_BUILD_PAIR("ts", JSON_BUILD_UNSIGNED(e->begin)),
+                                               JSON_BUILD_PAIR("dur", JSON_BUILD_UNSIGNED(e->end - e->begin)),
+                                               JSON_BUILD_PAIR("pid", JSON_BUILD_UNSIGNED(1)),
+                                               JSON_BUILD_PAIR("tid", JSON_BUILD_UNSIGNED(tid))));
+        if (r < 0)
+                return r;
+
+        if (!GREEDY_REALLOC(*array, *n_allocated, *n_array + 1))
+                return -ENOMEM;
+
+        (*array)[(*n_array)++] = TAKE_PTR(v);
+        return 0;
+}
+
+static int track_append_json(
+                const char *unit,
+                unsigned tid,
+                JsonVariant ***array,
+                size_t *n_array,
+                size_t *n_allocated) {
+
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+        int r;
+
+        /* Name the track after the unit */
+        r = json_build(&v, JSON_BUILD_OBJECT(
+                                       JSON_BUILD_PAIR("name", JSON_BUILD_STRING("thread_name")),
+                                       JSON_BUILD_PAIR("ph", JSON_BUILD_STRING("M")),
+                                       JSON_BUILD_PAIR("pid", JSON_BUILD_UNSIGNED(1)),
+                                       JSON_BUILD_PAIR("tid", JSON_BUILD_UNSIGNED(tid)),
+                                       JSON_BUILD_PAIR("args", JSON_BUILD_OBJECT(
+                                                                       JSON_BUILD_PAIR("name", JSON_BUILD_STRING(unit))))));
+        if (r < 0)
+                return r;
+
+        if (!GREEDY_REALLOC(*array, *n_allocated, *n_array + 1))
+                return -ENOMEM;
+
+        (*array)[(*n_array)++] = TAKE_PTR(v);
+        return 0;
+}
+
+int manager_get_trace_string(Manager *m, char **ret) {
+        _cleanup_(json_variant_unrefp) JsonVariant *events = NULL, *v = NULL;
+        _cleanup_hashmap_free_ Hashmap *tracks = NULL;
+        JsonVariant **array = NULL;
+        size_t n_array = 0, n_allocated = 0, i;
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        tracks = hashmap_new(&string_hash_ops);
+        if (!tracks)
+                return -ENOMEM;
+
+        /* Walk the ring from the oldest event to the newest one */
+        for (i = 0; i < m->n_trace_events; i++) {
+                const TraceEvent *e;
+                unsigned tid;
+
+                e = m->trace_events + (m->trace_events_next + m->trace_events_max - m->n_trace_events + i) % m->trace_events_max;
+                if (!e->unit)
+                        continue;
+
+                if (!hashmap_get(tracks, e->unit)) {
+                        tid = hashmap_size(tracks) + 1;
+
+                        r = hashmap_put(tracks, e->unit, UINT_TO_PTR(tid));
+                        if (r < 0)
+                                goto finish;
+
+                        r = track_append_json(e->unit, tid, &array, &n_array, &n_allocated);
+                        if (r < 0)
+                                goto finish;
+                }
+
+                r = trace_event_append_json(e, tracks, &array, &n_array, &n_allocated);
+                if (r < 0)
+                        goto finish;
+        }
+
+        r = json_variant_new_array(&events, array, n_array);
+        if (r < 0)
+                goto finish;
+
+        r = json_build(&v, JSON_BUILD_OBJECT(
+                                       JSON_BUILD_PAIR("traceEvents", JSON_BUILD_VARIANT(events)),
+                                       JSON_BUILD_PAIR("displayTimeUnit", JSON_BUILD_STRING("ms"))));
+        if (r < 0)
+                goto finish;
+
+        r = json_variant_format(v, 0, ret);
+
+finish:
+        for (i = 0; i < n_array; i++)
+                json_variant_unref(array[i]);
+        free(array);
+
+        return r;
+}
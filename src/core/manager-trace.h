@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include "manager.h"
+#include "time-util.h"
+
+/* How many trace events to keep if tracing is turned on without a size, and at most */
+#define MANAGER_TRACE_EVENTS_DEFAULT (64U*1024U)
+#define MANAGER_TRACE_EVENTS_MAX (1024U*1024U)
+
+typedef enum TraceEventType {
+        TRACE_EVENT_JOB_WAITING,      /* from enqueuing a job until it is run, i.e. waiting for dependencies */
+        TRACE_EVENT_JOB_RUNNING,      /* from running a job until it finished */
+        TRACE_EVENT_EXEC_SPAWN,       /* preparing and forking off a process in exec_spawn() */
+        TRACE_EVENT_CGROUP_REALIZE,   /* creating a unit's cgroup and applying its attributes */
+        _TRACE_EVENT_TYPE_MAX,
+        _TRACE_EVENT_TYPE_INVALID = -1,
+} TraceEventType;
+
+struct TraceEvent {
+        TraceEventType type;
+        char *unit;
+        char *detail;
+        usec_t begin;   /* CLOCK_MONOTONIC */
+        usec_t end;
+};
+
+int manager_trace_setup(Manager *m, unsigned n_events);
+void manager_trace_done(Manager *m);
+
+static inline bool manager_trace_enabled(Manager *m) {
+        return m->trace_events_max > 0;
+}
+
+/* Returns a timestamp to pass as 'begin' to manager_trace_event() later, or 0 if tracing is off, so that
+ * callers don't need to query the clock only to throw the result away. */
+static inline usec_t manager_trace_now(Manager *m) {
+        return manager_trace_enabled(m) ? now(CLOCK_MONOTONIC) : 0;
+}
+
+void manager_trace_event(Manager *m, TraceEventType type, Unit *u, const char *detail, usec_t begin, usec_t end);
+
+int manager_get_trace_string(Manager *m, char **ret);
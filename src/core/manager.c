@@ -38,6 +38,7 @@
 #include "dbus.h"
 #include "dirent-util.h"
 #include "env-util.h"
+#include "event-util.h"
 #include "escape.h"
 #include "exec-util.h"
 #include "execute.h"
@@ -52,6 +53,8 @@
 #include "log.h"
 #include "macro.h"
 #include "manager.h"
+#include "manager-query.h"
+#include "manager-trace.h"
 #include "missing.h"
 #include "mkdir.h"
 #include "parse-util.h"
@@ -96,6 +99,9 @@
 /* How many units and jobs to process of the bus queue before returning to the event loop. */
 #define MANAGER_BUS_MESSAGE_BUDGET 100U
 
+/* How many notification datagrams to process before returning to the event loop. */
+#define NOTIFY_BATCH_MAX 64U
+
 static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_cgroups_agent_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_signal_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
@@ -750,6 +756,7 @@ int manager_new(UnitFileScope scope, ManagerTestRunFlags test_run_flags, Manager
                 .time_change_fd = -1,
                 .user_lookup_fds = { -1, -1 },
                 .private_listen_fd = -1,
+                .query_listen_fd = -1,
                 .dev_autofs_fd = -1,
                 .cgroup_inotify_fd = -1,
                 .pin_cgroupfs_fd = -1,
@@ -1270,7 +1277,7 @@ static void manager_clear_jobs_and_units(Manager *m) {
         manager_dispatch_cleanup_queue(m);
 
         assert(!m->load_queue);
-        assert(!m->run_queue);
+        assert(prioq_isempty(m->run_queue));
         assert(!m->dbus_unit_queue);
         assert(!m->dbus_job_queue);
         assert(!m->cleanup_queue);
@@ -1306,6 +1313,8 @@ Manager* manager_free(Manager *m) {
         lookup_paths_flush_generator(&m->lookup_paths);
 
         bus_done(m);
+        manager_query_done(m);
+        manager_trace_done(m);
 
         exec_runtime_vacuum(m);
         hashmap_free(m->exec_runtime_by_id);
@@ -1330,6 +1339,7 @@ Manager* manager_free(Manager *m) {
         sd_event_source_unref(m->timezone_change_event_source);
         sd_event_source_unref(m->jobs_in_progress_event_source);
         sd_event_source_unref(m->run_queue_event_source);
+        prioq_free(m->run_queue);
         sd_event_source_unref(m->user_lookup_event_source);
         sd_event_source_unref(m->sync_bus_names_event_source);
 
@@ -1352,6 +1362,7 @@ Manager* manager_free(Manager *m) {
         strv_free(m->client_environment);
 
         hashmap_free(m->cgroup_unit);
+        hashmap_free(m->unit_name_map);
         set_free_free(m->unit_path_cache);
 
         free(m->switch_root);
@@ -1456,16 +1467,20 @@ static void manager_build_unit_path_cache(Manager *m) {
 
         assert(m);
 
+        m->unit_name_map = hashmap_free(m->unit_name_map);
         set_free_free(m->unit_path_cache);
 
         m->unit_path_cache = set_new(&path_hash_ops);
-        if (!m->unit_path_cache) {
+        m->unit_name_map = hashmap_new(&string_hash_ops);
+        if (!m->unit_path_cache || !m->unit_name_map) {
                 r = -ENOMEM;
                 goto fail;
         }
 
         /* This simply builds a list of files we know exist, so that
-         * we don't always have to go to disk */
+         * we don't always have to go to disk. In the same pass we also remember for each file name the
+         * path it is found at first in the search path, which is where load_from_path() will find it,
+         * so that it doesn't have to probe every search path entry for every unit. */
 
         STRV_FOREACH(i, m->lookup_paths.search_path) {
                 _cleanup_closedir_ DIR *d = NULL;
@@ -1490,6 +1505,14 @@ static void manager_build_unit_path_cache(Manager *m) {
                         r = set_consume(m->unit_path_cache, p);
                         if (r < 0)
                                 goto fail;
+                        if (r == 0) /* Already known, and 'p' is freed now */
+                                continue;
+
+                        /* Both key and value point into the string now owned by the set. An earlier search
+                         * path entry takes precedence, hence don't replace existing entries. */
+                        r = hashmap_put(m->unit_name_map, p + strlen(p) - strlen(de->d_name), p);
+                        if (r < 0 && r != -EEXIST)
+                                goto fail;
                 }
         }
 
@@ -1497,6 +1520,7 @@ static void manager_build_unit_path_cache(Manager *m) {
 
 fail:
         log_warning_errno(r, "Failed to build unit path cache, proceeding without: %m");
+        m->unit_name_map = hashmap_free(m->unit_name_map);
         m->unit_path_cache = set_free_free(m->unit_path_cache);
 }
 
@@ -1702,6 +1726,9 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
                         /* This shouldn't fail, except if things are really broken. */
                         return r;
 
+                /* The query socket is an optional extra, failing to set it up is not fatal */
+                (void) manager_query_init(m);
+
                 /* Connect to the bus if we are good for it */
                 manager_setup_bus(m);
 
@@ -2087,6 +2114,9 @@ void manager_dump(Manager *m, FILE *f, const char *prefix) {
 
         manager_dump_units(m, f, prefix);
         manager_dump_jobs(m, f, prefix);
+
+        /* Which event sources keep the main loop busy, as "event.<source>.<counter> <value>" lines */
+        (void) event_dump_source_stats(m->event, f, strjoina(strempty(prefix), "event."));
 }
 
 int manager_get_dump_string(Manager *m, char **ret) {
@@ -2134,7 +2164,7 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
         assert(source);
         assert(m);
 
-        while ((j = m->run_queue)) {
+        while ((j = prioq_peek(m->run_queue))) {
                 assert(j->installed);
                 assert(j->in_run_queue);
 
@@ -2268,6 +2298,13 @@ static void manager_invoke_notify_message(
         if (UNIT_VTABLE(u)->notify_message) {
                 _cleanup_strv_free_ char **tags = NULL;
 
+                /* Most messages (such as a bare WATCHDOG=1) consist of a single assignment, avoid splitting
+                 * those up into a freshly allocated strv. */
+                if (!strpbrk(buf, NEWLINE)) {
+                        UNIT_VTABLE(u)->notify_message(u, ucred, STRV_MAKE((char*) buf), fds);
+                        return;
+                }
+
                 tags = strv_split(buf, NEWLINE);
                 if (!tags) {
                         log_oom();
@@ -2287,10 +2324,9 @@ static void manager_invoke_notify_message(
         }
 }
 
-static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+static int manager_receive_notify_message(Manager *m) {
 
         _cleanup_fdset_free_ FDSet *fds = NULL;
-        Manager *m = userdata;
         char buf[NOTIFY_BUFFER_MAX+1];
         struct iovec iovec = {
                 .iov_base = buf,
@@ -2318,17 +2354,14 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         ssize_t n;
 
         assert(m);
-        assert(m->notify_fd == fd);
 
-        if (revents != EPOLLIN) {
-                log_warning("Got unexpected poll event for notify fd.");
-                return 0;
-        }
+        /* Returns 0 if there was nothing to read, > 0 if a message was taken off the socket (regardless if it was
+         * valid or not), and < 0 on a fatal error. */
 
         n = recvmsg(m->notify_fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC);
         if (n < 0) {
                 if (IN_SET(errno, EAGAIN, EINTR))
-                        return 0; /* Spurious wakeup, try again */
+                        return 0; /* Spurious wakeup or queue drained, try again */
 
                 /* If this is any other, real error, then let's stop processing this socket. This of course means we
                  * won't take notification messages anymore, but that's still better than busy looping around this:
@@ -2357,25 +2390,25 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
                 if (r < 0) {
                         close_many(fd_array, n_fds);
                         log_oom();
-                        return 0;
+                        return 1;
                 }
         }
 
         if (!ucred || !pid_is_valid(ucred->pid)) {
                 log_warning("Received notify message without valid credentials. Ignoring.");
-                return 0;
+                return 1;
         }
 
         if ((size_t) n >= sizeof(buf) || (msghdr.msg_flags & MSG_TRUNC)) {
                 log_warning("Received notify message exceeded maximum size. Ignoring.");
-                return 0;
+                return 1;
         }
 
         /* As extra safety check, let's make sure the string we get doesn't contain embedded NUL bytes. We permit one
          * trailing NUL byte in the message, but don't expect it. */
         if (n > 1 && memchr(buf, 0, n-1)) {
                 log_warning("Received notify message with embedded NUL bytes. Ignoring.");
-                return 0;
+                return 1;
         }
 
         /* Make sure it's NUL-terminated. */
@@ -2420,6 +2453,31 @@ static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t
         if (fdset_size(fds) > 0)
                 log_warning("Got extra auxiliary fds with notification message, closing them.");
 
+        return 1;
+}
+
+static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = userdata;
+        unsigned i;
+        int r;
+
+        assert(m);
+        assert(m->notify_fd == fd);
+
+        if (revents != EPOLLIN) {
+                log_warning("Got unexpected poll event for notify fd.");
+                return 0;
+        }
+
+        /* With many services sending frequent WATCHDOG=1 or STATUS= updates, do not go through a full event loop
+         * iteration per datagram, but handle whatever is queued up, up to a limit so that we don't starve
+         * everything else. */
+        for (i = 0; i < NOTIFY_BATCH_MAX; i++) {
+                r = manager_receive_notify_message(m);
+                if (r <= 0)
+                        return r;
+        }
+
         return 0;
 }
 
@@ -2853,6 +2911,7 @@ int manager_loop(Manager *m) {
         assert(m->objective == MANAGER_OK); /* Ensure manager_startup() has been called */
 
         /* Release the path cache */
+        m->unit_name_map = hashmap_free(m->unit_name_map);
         m->unit_path_cache = set_free_free(m->unit_path_cache);
 
         manager_check_finished(m);
@@ -3086,6 +3145,10 @@ int manager_open_serialization(Manager *m, FILE **_f) {
                 return -errno;
         }
 
+        /* The serialization is written and read from our main thread only, line by line and item by item, hence
+         * save the stdio locking for each of the many small calls */
+        (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+
         *_f = f;
         return 0;
 }
@@ -3479,10 +3542,14 @@ int manager_reload(Manager *m) {
         _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
         _cleanup_fdset_free_ FDSet *fds = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        char buf[FORMAT_TIMESPAN_MAX];
+        usec_t start;
         int r;
 
         assert(m);
 
+        start = now(CLOCK_MONOTONIC);
+
         r = manager_open_serialization(m, &f);
         if (r < 0)
                 return log_error_errno(r, "Failed to create serialization file: %m");
@@ -3547,6 +3614,7 @@ int manager_reload(Manager *m) {
         (void) manager_setup_notify(m);
         (void) manager_setup_cgroups_agent(m);
         (void) manager_setup_user_lookup_fd(m);
+        (void) manager_query_init(m);
 
         /* Third, fire things up! */
         manager_coldplug(m);
@@ -3564,6 +3632,8 @@ int manager_reload(Manager *m) {
                 manager_flush_finished_jobs(m);
 
         m->send_reloading_done = true;
+
+        log_info("Reloading finished in %s.", format_timespan(buf, sizeof(buf), now(CLOCK_MONOTONIC) - start, USEC_PER_MSEC));
         return 0;
 }
 
@@ -13,6 +13,7 @@
 #include "hashmap.h"
 #include "ip-address-access.h"
 #include "list.h"
+#include "prioq.h"
 #include "ratelimit.h"
 
 struct libmnt_monitor;
@@ -22,6 +23,7 @@ typedef struct Unit Unit;
 #define MANAGER_MAX_NAMES 131072 /* 128K */
 
 typedef struct Manager Manager;
+typedef struct TraceEvent TraceEvent;
 
 /* An externally visible state. We don't actually maintain this as state variable, but derive it from various fields
  * when requested */
@@ -137,7 +139,7 @@ struct Manager {
         LIST_HEAD(Unit, load_queue); /* this is actually more a stack than a queue, but uh. */
 
         /* Jobs that need to be run */
-        LIST_HEAD(Job, run_queue);   /* more a stack than a queue, too */
+        Prioq *run_queue;
 
         /* Units and jobs that have not yet been announced via
          * D-Bus. When something about a job changes it is added here
@@ -211,6 +213,7 @@ struct Manager {
         UnitFileScope unit_file_scope;
         LookupPaths lookup_paths;
         Set *unit_path_cache;
+        Hashmap *unit_name_map; /* unit file name → first path in unit_path_cache, in search path order */
 
         char **transient_environment;  /* The environment, as determined from config files, kernel cmdline and environment generators */
         char **client_environment;     /* Environment variables created by clients through the bus API */
@@ -227,6 +230,8 @@ struct Manager {
         /* Data specific to the mount subsystem */
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
+        sd_event_source *mount_rescan_event_source;
+        RateLimit mount_rescan_ratelimit;
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -239,6 +244,15 @@ struct Manager {
         int private_listen_fd;
         sd_event_source *private_listen_event_source;
 
+        /* Data specific to the JSON query socket, see manager-query.c */
+        int query_listen_fd;
+        sd_event_source *query_listen_event_source;
+        Set *query_connections;
+
+        /* Ring buffer of trace events, see manager-trace.c */
+        TraceEvent *trace_events;
+        size_t trace_events_max, n_trace_events, trace_events_next;
+
         /* Contains all the clients that are subscribed to signals via
         the API bus. Note that private bus connections are always
         considered subscribes, since they last for very short only,
@@ -273,6 +287,9 @@ struct Manager {
         /* A defer event for handling cgroup empty events and processing them after SIGCHLD in all cases. */
         sd_event_source *cgroup_empty_event_source;
 
+        /* Loaded device control BPF programs, for sharing them between units with the same device policy */
+        Set *bpf_device_programs;
+
         /* Make sure the user cannot accidentally unmount our cgroup
          * file system */
         int pin_cgroupfs_fd;
@@ -25,6 +25,7 @@
 #include "parse-util.h"
 #include "path-util.h"
 #include "process-util.h"
+#include "ratelimit.h"
 #include "serialize.h"
 #include "special.h"
 #include "string-table.h"
@@ -35,6 +36,9 @@
 
 #define RETRY_UMOUNT_MAX 32
 
+#define MOUNT_RESCAN_INTERVAL_USEC (1 * USEC_PER_SEC)
+#define MOUNT_RESCAN_BURST 5
+
 DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_table*, mnt_free_table);
 DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_iter*, mnt_free_iter);
 
@@ -1652,6 +1656,7 @@ static void mount_shutdown(Manager *m) {
         assert(m);
 
         m->mount_event_source = sd_event_source_unref(m->mount_event_source);
+        m->mount_rescan_event_source = sd_event_source_unref(m->mount_rescan_event_source);
 
         mnt_unref_monitor(m->mount_monitor);
         m->mount_monitor = NULL;
@@ -1754,6 +1759,10 @@ static void mount_enumerate(Manager *m) {
                 }
 
                 (void) sd_event_source_set_description(m->mount_event_source, "mount-monitor-dispatch");
+
+                /* Every libmount event means reparsing all of /proc/self/mountinfo and going through all mount
+                 * units, which gets expensive if somebody (un)mounts in a tight loop. */
+                RATELIMIT_INIT(m->mount_rescan_ratelimit, MOUNT_RESCAN_INTERVAL_USEC, MOUNT_RESCAN_BURST);
         }
 
         r = mount_load_proc_self_mountinfo(m, false);
@@ -1766,39 +1775,14 @@ fail:
         mount_shutdown(m);
 }
 
-static int mount_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+static int mount_process_proc_self_mountinfo(Manager *m) {
         _cleanup_set_free_ Set *around = NULL, *gone = NULL;
-        Manager *m = userdata;
         const char *what;
         Iterator i;
         Unit *u;
         int r;
 
         assert(m);
-        assert(revents & EPOLLIN);
-
-        if (fd == mnt_monitor_get_fd(m->mount_monitor)) {
-                bool rescan = false;
-
-                /* Drain all events and verify that the event is valid.
-                 *
-                 * Note that libmount also monitors /run/mount mkdir if the
-                 * directory does not exist yet. The mkdir may generate event
-                 * which is irrelevant for us.
-                 *
-                 * error: r < 0; valid: r == 0, false positive: rc == 1 */
-                do {
-                        r = mnt_monitor_next_change(m->mount_monitor, NULL, NULL);
-                        if (r == 0)
-                                rescan = true;
-                        else if (r < 0)
-                                return log_error_errno(r, "Failed to drain libmount events: %m");
-                } while (r == 0);
-
-                log_debug("libmount event [rescan: %s]", yes_no(rescan));
-                if (!rescan)
-                        return 0;
-        }
 
         r = mount_load_proc_self_mountinfo(m, true);
         if (r < 0) {
@@ -1902,6 +1886,82 @@ static int mount_dispatch_io(sd_event_source *source, int fd, uint32_t revents,
         return 0;
 }
 
+static int mount_dispatch_rescan(sd_event_source *source, usec_t usec, void *userdata) {
+        Manager *m = userdata;
+        int r;
+
+        assert(m);
+
+        /* The rate limit interval is over, pick up everything that happened in the meantime in one go, and
+         * start listening for events again. The events that queued up while we weren't listening are
+         * covered by the rescan below, hence drop them, so that they don't trigger a second one. */
+        m->mount_rescan_event_source = sd_event_source_unref(m->mount_rescan_event_source);
+
+        r = mnt_monitor_event_cleanup(m->mount_monitor);
+        if (r < 0)
+                log_warning_errno(r, "Failed to drain libmount events, ignoring: %m");
+
+        r = sd_event_source_set_enabled(m->mount_event_source, SD_EVENT_ON);
+        if (r < 0)
+                log_warning_errno(r, "Failed to reenable mount watch, ignoring: %m");
+
+        return mount_process_proc_self_mountinfo(m);
+}
+
+static int mount_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = userdata;
+        int r;
+
+        assert(m);
+        assert(revents & EPOLLIN);
+
+        if (fd == mnt_monitor_get_fd(m->mount_monitor)) {
+                bool rescan = false;
+
+                /* Drain all events and verify that the event is valid.
+                 *
+                 * Note that libmount also monitors /run/mount mkdir if the
+                 * directory does not exist yet. The mkdir may generate event
+                 * which is irrelevant for us.
+                 *
+                 * error: r < 0; valid: r == 0, false positive: rc == 1 */
+                do {
+                        r = mnt_monitor_next_change(m->mount_monitor, NULL, NULL);
+                        if (r == 0)
+                                rescan = true;
+                        else if (r < 0)
+                                return log_error_errno(r, "Failed to drain libmount events: %m");
+                } while (r == 0);
+
+                log_debug("libmount event [rescan: %s]", yes_no(rescan));
+                if (!rescan)
+                        return 0;
+        }
+
+        if (!ratelimit_below(&m->mount_rescan_ratelimit)) {
+                /* Too many changes in a short time. Stop watching for a while and process all of them
+                 * together once the interval is over. */
+                r = sd_event_add_time(m->event, &m->mount_rescan_event_source, CLOCK_MONOTONIC,
+                                      m->mount_rescan_ratelimit.begin + m->mount_rescan_ratelimit.interval, 0,
+                                      mount_dispatch_rescan, m);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to allocate mount rescan timer, rescanning right away: %m");
+                else {
+                        (void) sd_event_source_set_priority(m->mount_rescan_event_source, SD_EVENT_PRIORITY_NORMAL-10);
+                        (void) sd_event_source_set_description(m->mount_rescan_event_source, "mount-rescan");
+
+                        r = sd_event_source_set_enabled(m->mount_event_source, SD_EVENT_OFF);
+                        if (r < 0)
+                                log_warning_errno(r, "Failed to disable mount watch, ignoring: %m");
+
+                        log_debug("Mount table changing rapidly, delaying rescan.");
+                        return 0;
+                }
+        }
+
+        return mount_process_proc_self_mountinfo(m);
+}
+
 static void mount_reset_failed(Unit *u) {
         Mount *m = MOUNT(u);
 
@@ -1176,9 +1176,12 @@ int setup_namespace(
                     strv_isempty(read_write_paths))
                         dissect_image_flags |= DISSECT_IMAGE_READ_ONLY;
 
-                r = loop_device_make_by_path(root_image,
-                                             dissect_image_flags & DISSECT_IMAGE_READ_ONLY ? O_RDONLY : O_RDWR,
-                                             &loop_device);
+                /* Read-only images are commonly used by many services at the same time (think portable services),
+                 * hence share the loop device, and with it any verity device on top, between them. */
+                if (dissect_image_flags & DISSECT_IMAGE_READ_ONLY)
+                        r = loop_device_make_by_path_shared(root_image, &loop_device);
+                else
+                        r = loop_device_make_by_path(root_image, O_RDWR, &loop_device);
                 if (r < 0)
                         return log_debug_errno(r, "Failed to create loop device for root image: %m");
 
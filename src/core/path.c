@@ -1,14 +1,13 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
-#include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <unistd.h>
 
+#include "alloc-util.h"
 #include "bus-error.h"
 #include "bus-util.h"
 #include "dbus-path.h"
-#include "fd-util.h"
 #include "fs-util.h"
 #include "glob-util.h"
 #include "macro.h"
@@ -29,9 +28,40 @@ static const UnitActiveState state_translation_table[_PATH_STATE_MAX] = {
         [PATH_FAILED] = UNIT_FAILED
 };
 
-static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata);
+static int path_dispatch_inotify(sd_event_source *source, const struct inotify_event *event, void *userdata);
 
-int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
+static int path_spec_add_watch(PathSpec *s, const char *path, uint32_t mask, sd_event_inotify_handler_t handler, sd_event_source **ret) {
+        _cleanup_(sd_event_source_unrefp) sd_event_source *source = NULL;
+        int r;
+
+        assert(s);
+        assert(path);
+        assert(handler);
+
+        if (!GREEDY_REALLOC(s->event_sources, s->n_event_sources_allocated, s->n_event_sources + 1))
+                return -ENOMEM;
+
+        /* All watches go through sd-event's inotify sources, which share a single inotify instance among all units
+         * and all watches on the same inode. Coalescing means we are dispatched only once per event loop iteration,
+         * no matter how many events are queued for us. */
+        r = sd_event_add_inotify(s->unit->manager->event, &source, path, mask, handler, s);
+        if (r < 0)
+                return r;
+
+        r = sd_event_source_set_inotify_coalesce(source, true);
+        if (r < 0)
+                return r;
+
+        s->event_sources[s->n_event_sources++] = source;
+
+        if (ret)
+                *ret = source;
+        TAKE_PTR(source);
+
+        return 0;
+}
+
+int path_spec_watch(PathSpec *s, sd_event_inotify_handler_t handler) {
 
         static const int flags_table[_PATH_TYPE_MAX] = {
                 [PATH_EXISTS] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
@@ -51,22 +81,11 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
 
         path_spec_unwatch(s);
 
-        s->inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
-        if (s->inotify_fd < 0) {
-                r = -errno;
-                goto fail;
-        }
-
-        r = sd_event_add_io(s->unit->manager->event, &s->event_source, s->inotify_fd, EPOLLIN, handler, s);
-        if (r < 0)
-                goto fail;
-
-        (void) sd_event_source_set_description(s->event_source, "path");
-
         /* This function assumes the path was passed through path_simplify()! */
         assert(!strstr(s->path, "//"));
 
         for (slash = strchr(s->path, '/'); ; slash = strchr(slash+1, '/')) {
+                sd_event_source *source;
                 char *cut = NULL;
                 int flags;
                 char tmp;
@@ -80,15 +99,15 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                 } else
                         flags = flags_table[s->type];
 
-                r = inotify_add_watch(s->inotify_fd, s->path, flags);
+                r = path_spec_add_watch(s, s->path, flags, handler, &source);
                 if (r < 0) {
-                        if (IN_SET(errno, EACCES, ENOENT)) {
+                        if (IN_SET(r, -EACCES, -ENOENT)) {
                                 if (cut)
                                         *cut = tmp;
                                 break;
                         }
 
-                        r = log_warning_errno(errno, "Failed to add watch on %s: %s", s->path, errno == ENOSPC ? "too many watches" : strerror(-r));
+                        log_warning_errno(r, "Failed to add watch on %s: %s", s->path, r == -ENOSPC ? "too many watches" : strerror(-r));
                         if (cut)
                                 *cut = tmp;
                         goto fail;
@@ -101,7 +120,7 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                                 char tmp2 = *cut2;
                                 *cut2 = '\0';
 
-                                (void) inotify_add_watch(s->inotify_fd, s->path, IN_MOVE_SELF);
+                                (void) path_spec_add_watch(s, s->path, IN_MOVE_SELF, handler, NULL);
                                 /* Error is ignored, the worst can happen is we get spurious events. */
 
                                 *cut2 = tmp2;
@@ -115,13 +134,13 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                         oldslash = slash;
                 else {
                         /* whole path has been iterated over */
-                        s->primary_wd = r;
+                        s->primary_event_source = source;
                         break;
                 }
         }
 
         if (!exists) {
-                r = log_error_errno(errno, "Failed to add watch on any of the components of %s: %m", s->path);
+                r = log_error_errno(r, "Failed to add watch on any of the components of %s: %m", s->path);
                 /* either EACCESS or ENOENT */
                 goto fail;
         }
@@ -134,38 +153,26 @@ fail:
 }
 
 void path_spec_unwatch(PathSpec *s) {
-        assert(s);
-
-        s->event_source = sd_event_source_unref(s->event_source);
-        s->inotify_fd = safe_close(s->inotify_fd);
-}
-
-int path_spec_fd_event(PathSpec *s, uint32_t revents) {
-        union inotify_event_buffer buffer;
-        struct inotify_event *e;
-        ssize_t l;
-        int r = 0;
+        size_t i;
 
-        if (revents != EPOLLIN) {
-                log_error("Got invalid poll event on inotify.");
-                return -EINVAL;
-        }
+        assert(s);
 
-        l = read(s->inotify_fd, &buffer, sizeof(buffer));
-        if (l < 0) {
-                if (IN_SET(errno, EAGAIN, EINTR))
-                        return 0;
+        for (i = 0; i < s->n_event_sources; i++)
+                sd_event_source_unref(s->event_sources[i]);
 
-                return log_error_errno(errno, "Failed to read inotify event: %m");
-        }
+        s->n_event_sources = 0;
+        s->primary_event_source = NULL;
+}
 
-        FOREACH_INOTIFY_EVENT(e, buffer, l) {
-                if (IN_SET(s->type, PATH_CHANGED, PATH_MODIFIED) &&
-                    s->primary_wd == e->wd)
-                        r = 1;
-        }
+bool path_spec_inotify_event(PathSpec *s, sd_event_source *source, const struct inotify_event *event) {
+        assert(s);
+        assert(source);
+        assert(event);
 
-        return r;
+        /* An overflow is passed to all watches, and tells us nothing about the path itself */
+        return IN_SET(s->type, PATH_CHANGED, PATH_MODIFIED) &&
+                source == s->primary_event_source &&
+                (event->mask & ~IN_Q_OVERFLOW) != 0;
 }
 
 static bool path_spec_check_good(PathSpec *s, bool initial) {
@@ -227,8 +234,9 @@ static void path_spec_dump(PathSpec *s, FILE *f, const char *prefix) {
 
 void path_spec_done(PathSpec *s) {
         assert(s);
-        assert(s->inotify_fd == -1);
+        assert(s->n_event_sources == 0);
 
+        free(s->event_sources);
         free(s->path);
 }
 
@@ -399,7 +407,7 @@ static int path_watch(Path *p) {
         assert(p);
 
         LIST_FOREACH(spec, s, p->specs) {
-                r = path_spec_watch(s, path_dispatch_io);
+                r = path_spec_watch(s, path_dispatch_inotify);
                 if (r < 0)
                         return r;
         }
@@ -653,14 +661,14 @@ _pure_ static const char *path_sub_state_to_string(Unit *u) {
         return path_state_to_string(PATH(u)->state);
 }
 
-static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+static int path_dispatch_inotify(sd_event_source *source, const struct inotify_event *event, void *userdata) {
         PathSpec *s = userdata;
         Path *p;
-        int changed;
+        bool changed;
 
         assert(s);
         assert(s->unit);
-        assert(fd >= 0);
+        assert(event);
 
         p = PATH(s->unit);
 
@@ -669,18 +677,7 @@ static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
 
         /* log_debug("inotify wakeup on %s.", u->id); */
 
-        LIST_FOREACH(spec, s, p->specs)
-                if (path_spec_owns_inotify_fd(s, fd))
-                        break;
-
-        if (!s) {
-                log_error("Got event on unknown fd.");
-                goto fail;
-        }
-
-        changed = path_spec_fd_event(s, revents);
-        if (changed < 0)
-                goto fail;
+        changed = path_spec_inotify_event(s, source, event);
 
         /* If we are already running, then remember that one event was
          * dispatched so that we restart the service only if something
@@ -693,10 +690,6 @@ static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
                 path_enter_waiting(p, false, true);
 
         return 0;
-
-fail:
-        path_enter_dead(p, PATH_FAILURE_RESOURCES);
-        return 0;
 }
 
 static void path_trigger_notify(Unit *u, Unit *other) {
@@ -21,26 +21,23 @@ typedef struct PathSpec {
 
         char *path;
 
-        sd_event_source *event_source;
+        /* One inotify event source for each watched path component, the last one watches the path itself */
+        sd_event_source **event_sources;
+        size_t n_event_sources, n_event_sources_allocated;
+        sd_event_source *primary_event_source;
 
         LIST_FIELDS(struct PathSpec, spec);
 
         PathType type;
-        int inotify_fd;
-        int primary_wd;
 
         bool previous_exists;
 } PathSpec;
 
-int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler);
+int path_spec_watch(PathSpec *s, sd_event_inotify_handler_t handler);
 void path_spec_unwatch(PathSpec *s);
-int path_spec_fd_event(PathSpec *s, uint32_t events);
+bool path_spec_inotify_event(PathSpec *s, sd_event_source *source, const struct inotify_event *event);
 void path_spec_done(PathSpec *s);
 
-static inline bool path_spec_owns_inotify_fd(PathSpec *s, int fd) {
-        return s->inotify_fd == fd;
-}
-
 typedef enum PathResult {
         PATH_SUCCESS,
         PATH_FAILURE_RESOURCES,
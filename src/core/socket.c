@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <mqueue.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/epoll.h>
 #include <sys/stat.h>
@@ -45,6 +46,9 @@
 #include "unit.h"
 #include "user-util.h"
 
+/* How many connections to accept on an Accept=yes socket in one go before returning to the event loop */
+#define SOCKET_ACCEPT_BATCH_MAX 16U
+
 struct SocketPeer {
         unsigned n_ref;
 
@@ -2924,12 +2928,33 @@ static int socket_dispatch_io(sd_event_source *source, int fd, uint32_t revents,
         if (p->socket->accept &&
             p->type == SOCKET_SOCKET &&
             socket_address_can_accept(&p->address)) {
+                unsigned n;
 
-                cfd = socket_accept_in_cgroup(p->socket, p, fd);
-                if (cfd < 0)
-                        goto fail;
+                /* Under a connection storm, go through the backlog in batches instead of making one full
+                 * event loop iteration per connection. The listening socket is blocking, hence only call
+                 * accept() again if poll() tells us there's another connection pending already. */
+                for (n = 0; n < SOCKET_ACCEPT_BATCH_MAX; n++) {
+                        if (n > 0) {
+                                int r;
+
+                                if (p->socket->state != SOCKET_LISTENING)
+                                        break;
+
+                                /* Anything but plain POLLIN is left to the next event loop iteration */
+                                r = fd_wait_for_event(fd, POLLIN, 0);
+                                if (r != POLLIN)
+                                        break;
+                        }
+
+                        cfd = socket_accept_in_cgroup(p->socket, p, fd);
+                        if (cfd < 0)
+                                goto fail;
 
-                socket_apply_socket_options(p->socket, cfd);
+                        socket_apply_socket_options(p->socket, cfd);
+                        socket_enter_running(p->socket, cfd);
+                }
+
+                return 0;
         }
 
         socket_enter_running(p->socket, cfd);
@@ -376,9 +376,16 @@ static void timer_enter_waiting(Timer *t, bool initial, bool time_change) {
                                         b = ts.realtime;
                         }
 
-                        r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
-                        if (r < 0)
-                                continue;
+                        if (!v->calendar_next_elapse_valid || v->calendar_base != b) {
+                                v->calendar_next_elapse_valid = false;
+
+                                r = calendar_spec_next_usec(v->calendar_spec, b, &v->next_elapse);
+                                if (r < 0)
+                                        continue;
+
+                                v->calendar_base = b;
+                                v->calendar_next_elapse_valid = true;
+                        }
 
                         if (!found_realtime)
                                 t->next_elapse_realtime = v->next_elapse;
@@ -812,9 +819,14 @@ static void timer_time_change(Unit *u) {
 
 static void timer_timezone_change(Unit *u) {
         Timer *t = TIMER(u);
+        TimerValue *v;
 
         assert(u);
 
+        /* The cached calendar elapse times were calculated for the old timezone */
+        LIST_FOREACH(value, v, t->values)
+                v->calendar_next_elapse_valid = false;
+
         if (t->state != TIMER_WAITING)
                 return;
 
@@ -25,6 +25,12 @@ typedef struct TimerValue {
         CalendarSpec *calendar_spec; /* only for calendar events */
         usec_t next_elapse;
 
+        /* The base time next_elapse was last calculated from, only for calendar events. Calculating the next
+         * elapse is not cheap (for specs with a timezone it involves forking), and it only depends on the base and
+         * the timezone rules, hence we don't recalculate it if neither changed. */
+        usec_t calendar_base;
+        bool calendar_next_elapse_valid;
+
         LIST_FIELDS(struct TimerValue, value);
 } TimerValue;
 
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <sys/mount.h>
 #include <sys/swap.h>
+#include <sys/wait.h>
 
 /* This needs to be after sys/mount.h :( */
 #include <libmount.h>
@@ -72,7 +73,7 @@ int mount_points_list_get(const char *mountinfo, MountPoint **head) {
 
         for (;;) {
                 struct libmnt_fs *fs;
-                const char *path, *fstype;
+                const char *path, *fstype, *source;
                 _cleanup_free_ char *options = NULL;
                 _cleanup_free_ char *p = NULL;
                 unsigned long remount_flags = 0u;
@@ -174,6 +175,9 @@ int mount_points_list_get(const char *mountinfo, MountPoint **head) {
                 m->remount_flags = remount_flags;
                 m->try_remount_ro = try_remount_ro;
 
+                source = mnt_fs_get_source(fs);
+                m->loop_backed = source && path_startswith(source, "/dev/loop");
+
                 LIST_PREPEND(mount_point, *head, m);
         }
 
@@ -426,19 +430,26 @@ static int remount_with_timeout(MountPoint *m, int umount_log_level) {
         return r;
 }
 
-static int umount_with_timeout(MountPoint *m, int umount_log_level) {
+typedef struct UmountChild {
+        MountPoint *mount_point;
         pid_t pid;
-        int r;
+        usec_t until;
+} UmountChild;
 
-        BLOCK_SIGNALS(SIGCHLD);
+/* How many unmount helper processes to run at the same time */
+#define UMOUNT_CHILDREN_MAX 64U
+
+static int umount_fork(MountPoint *m, int umount_log_level, pid_t *ret_pid) {
+        int r;
 
         assert(m);
+        assert(ret_pid);
 
         /* Due to the possiblity of a umount operation hanging, we
          * fork a child process and set a timeout. If the timeout
          * lapses, the assumption is that that particular umount
          * failed. */
-        r = safe_fork("(sd-umount)", FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_LOG|FORK_REOPEN_LOG, &pid);
+        r = safe_fork("(sd-umount)", FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_LOG|FORK_REOPEN_LOG, ret_pid);
         if (r < 0)
                 return r;
         if (r == 0) {
@@ -458,28 +469,124 @@ static int umount_with_timeout(MountPoint *m, int umount_log_level) {
                 _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
         }
 
-        r = wait_for_terminate_with_timeout(pid, DEFAULT_TIMEOUT_USEC);
+        return 0;
+}
+
+static void umount_child_done(UmountChild *c, int r, bool *changed, int *n_failed) {
+        assert(c);
+        assert(changed);
+        assert(n_failed);
+
         if (r == -ETIMEDOUT) {
-                log_error_errno(r, "Unmounting '%s' timed out, issuing SIGKILL to PID " PID_FMT ".", m->path, pid);
-                (void) kill(pid, SIGKILL);
+                log_error_errno(r, "Unmounting '%s' timed out, issuing SIGKILL to PID " PID_FMT ".", c->mount_point->path, c->pid);
+                (void) kill(c->pid, SIGKILL);
         } else if (r == -EPROTO)
-                log_debug_errno(r, "Unmounting '%s' failed abnormally, child process " PID_FMT " aborted or exited non-zero.", m->path, pid);
+                log_debug_errno(r, "Unmounting '%s' failed abnormally, child process " PID_FMT " aborted or exited non-zero.", c->mount_point->path, c->pid);
         else if (r < 0)
-                log_error_errno(r, "Unmounting '%s' failed unexpectedly, couldn't wait for child process " PID_FMT ": %m", m->path, pid);
+                log_error_errno(r, "Unmounting '%s' failed unexpectedly, couldn't wait for child process " PID_FMT ": %m", c->mount_point->path, c->pid);
 
-        return r;
+        if (r < 0)
+                (*n_failed)++;
+        else
+                *changed = true;
+}
+
+static bool umount_child_blocks(const UmountChild *c, const char *path) {
+        assert(c);
+
+        if (!path)
+                return false;
+
+        /* Mounts below the one we want to unmount next (or stacked on top of it) need to be gone first. A loop
+         * device might be backed by a file on any of the other file systems, and we don't want MNT_FORCE to abort
+         * the I/O of its unmount, hence let those finish before starting anything else. */
+        return c->mount_point->loop_backed ||
+                path_startswith(c->mount_point->path, path);
+}
+
+static int umount_children_wait(
+                UmountChild *children,
+                size_t *n_children,
+                const char *path,
+                size_t max_children,
+                bool *changed,
+                int *n_failed) {
+
+        sigset_t mask;
+
+        assert(children);
+        assert(n_children);
+
+        /* Waits until at most max_children unmount helpers are left running, and none of them is in the way of
+         * unmounting path. SIGCHLD needs to be blocked by the caller. */
+
+        assert_se(sigemptyset(&mask) == 0);
+        assert_se(sigaddset(&mask, SIGCHLD) == 0);
+
+        for (;;) {
+                usec_t n, until = USEC_INFINITY;
+                bool blocked = false;
+                struct timespec ts;
+                size_t i;
+
+                n = now(CLOCK_MONOTONIC);
+
+                /* Reap everything that is done already. Iterate backwards, so that we can fill gaps with the
+                 * last entry. */
+                for (i = *n_children; i > 0; i--) {
+                        UmountChild *c = children + i - 1;
+                        siginfo_t status = {};
+                        int r;
+
+                        if (waitid(P_PID, c->pid, &status, WEXITED|WNOHANG) < 0)
+                                r = -errno;
+                        else if (status.si_pid == c->pid)
+                                r = status.si_code == CLD_EXITED && status.si_status == 0 ? 0 : -EPROTO;
+                        else if (n >= c->until)
+                                r = -ETIMEDOUT;
+                        else {
+                                until = MIN(until, c->until);
+                                blocked = blocked || umount_child_blocks(c, path);
+                                continue;
+                        }
+
+                        umount_child_done(c, r, changed, n_failed);
+                        *c = children[--(*n_children)];
+                }
+
+                if (!blocked && *n_children <= max_children)
+                        return 0;
+
+                if (sigtimedwait(&mask, NULL, timespec_store(&ts, until - n)) < 0 &&
+                    !IN_SET(errno, EAGAIN, EINTR))
+                        return -errno;
+        }
 }
 
 /* This includes remounting readonly, which changes the kernel mount options.
  * Therefore the list passed to this function is invalidated, and should not be reused. */
 static int mount_points_list_umount(MountPoint **head, bool *changed, int umount_log_level) {
+        UmountChild children[UMOUNT_CHILDREN_MAX];
+        size_t n_children = 0;
         MountPoint *m;
-        int n_failed = 0;
+        int n_failed = 0, r;
+
+        BLOCK_SIGNALS(SIGCHLD);
 
         assert(head);
         assert(changed);
 
+        /* Independent mounts are unmounted in parallel, each with its own timeout, so that a couple of hanging
+         * network file systems don't add up. The list is ordered newest first, and we only wait for the
+         * unmounts of what is in the way before going on with the next entry. */
+
         LIST_FOREACH(mount_point, m, *head) {
+                pid_t pid;
+
+                r = umount_children_wait(children, &n_children, m->path, UMOUNT_CHILDREN_MAX - 1, changed, &n_failed);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to wait for unmount processes: %m");
+
                 if (m->try_remount_ro) {
                         /* We always try to remount directories
                          * read-only first, before we go on and umount
@@ -518,12 +625,22 @@ static int mount_points_list_umount(MountPoint **head, bool *changed, int umount
                         continue;
 
                 /* Trying to umount */
-                if (umount_with_timeout(m, umount_log_level) < 0)
+                if (umount_fork(m, umount_log_level, &pid) < 0) {
                         n_failed++;
-                else
-                        *changed = true;
+                        continue;
+                }
+
+                children[n_children++] = (UmountChild) {
+                        .mount_point = m,
+                        .pid = pid,
+                        .until = usec_add(now(CLOCK_MONOTONIC), DEFAULT_TIMEOUT_USEC),
+                };
         }
 
+        r = umount_children_wait(children, &n_children, NULL, 0, changed, &n_failed);
+        if (r < 0)
+                return log_error_errno(r, "Failed to wait for unmount processes: %m");
+
         return n_failed;
 }
 
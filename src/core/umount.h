@@ -21,6 +21,7 @@ typedef struct MountPoint {
         char *remount_options;
         unsigned long remount_flags;
         bool try_remount_ro;
+        bool loop_backed;
         dev_t devnum;
         LIST_FIELDS(struct MountPoint, mount_point);
 } MountPoint;
@@ -257,6 +257,9 @@ typedef struct Unit {
         CGroupMask cgroup_members_mask;
         int cgroup_inotify_wd;
 
+        /* Attribute name → the value we last successfully wrote to it, for the single-valued attributes */
+        Hashmap *cgroup_attribute_cache;
+
         /* Device Controller BPF program */
         BPFProgram *bpf_device_control_installed;
 
@@ -137,6 +137,10 @@ int coredump_vacuum(int exclude_fd, uint64_t keep_free, uint64_t max_use) {
                 return log_error_errno(errno, "Can't open coredump directory: %m");
         }
 
+        /* Without a size limit to enforce, there's no need to sum up all files if the free space is fine already */
+        if (max_use == 0 && !vacuum_necessary(dirfd(d), 0, keep_free, 0))
+                return 0;
+
         for (;;) {
                 _cleanup_(vacuum_candidate_hashmap_freep) Hashmap *h = NULL;
                 struct vacuum_candidate *worst = NULL;
@@ -374,7 +374,8 @@ static int save_external_coredump(
         if (fd < 0)
                 return log_error_errno(fd, "Failed to create temporary file for coredump %s: %m", fn);
 
-        r = copy_bytes(input_fd, fd, max_size, 0);
+        /* Cores usually contain lots of zero pages, don't bother writing them out */
+        r = copy_bytes(input_fd, fd, max_size, COPY_SPARSE);
         if (r < 0) {
                 log_error_errno(r, "Cannot store coredump of %s (%s): %m", context[CONTEXT_PID], context[CONTEXT_COMM]);
                 goto fail;
@@ -712,6 +713,22 @@ static bool is_pid1_crash(const char *context[_CONTEXT_MAX]) {
 
 #define SUBMIT_COREDUMP_FIELDS 4
 
+static void release_input_fd(int fd) {
+        _cleanup_close_ int null_fd = -1;
+
+        assert(fd >= 0);
+
+        /* Replace the fd rather than closing it, so that the caller's ownership of it (or of STDIN) stays intact. */
+        null_fd = open("/dev/null", O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (null_fd < 0) {
+                log_debug_errno(errno, "Failed to open /dev/null, not releasing coredump pipe: %m");
+                return;
+        }
+
+        if (dup3(null_fd, fd, fd == STDIN_FILENO ? 0 : O_CLOEXEC) < 0)
+                log_debug_errno(errno, "Failed to release coredump pipe, ignoring: %m");
+}
+
 static int submit_coredump(
                 const char *context[_CONTEXT_MAX],
                 struct iovec *iovec,
@@ -732,12 +749,19 @@ static int submit_coredump(
 
         journald_crash = is_journald_crash(context);
 
-        /* Vacuum before we write anything again */
-        (void) coredump_vacuum(-1, arg_keep_free, arg_max_use);
+        /* Vacuum before we write anything again, but only if we are short on disk space: the crashing process is
+         * pinned until we have read its core, hence don't scan the directory for the size limit now. That one is
+         * enforced below anyway. */
+        (void) coredump_vacuum(-1, arg_keep_free, 0);
 
         /* Always stream the coredump to disk, if that's possible */
         r = save_external_coredump(context, input_fd,
                                    &filename, &coredump_node_fd, &coredump_fd, &coredump_size, &truncated);
+
+        /* We are done reading the core. Let go of the pipe right-away, so that the kernel doesn't remain blocked
+         * writing the rest of a truncated core while we generate the stack trace and talk to the journal. */
+        release_input_fd(input_fd);
+
         if (r < 0)
                 /* Skip whole core dumping part */
                 goto log;
@@ -1,9 +1,15 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <limits.h>
+#include <unistd.h>
+
 #include "import-compress.h"
 #include "string-table.h"
 #include "util.h"
 
+/* The memory the multi-threaded xz decoder may use before it falls back to decoding in a single thread */
+#define IMPORT_UNCOMPRESS_XZ_MEMLIMIT_THREADING (512U * 1024U * 1024U)
+
 void import_compress_free(ImportCompress *c) {
         assert(c);
 
@@ -20,6 +26,13 @@ void import_compress_free(ImportCompress *c) {
                         BZ2_bzCompressEnd(&c->bzip2);
                 else
                         BZ2_bzDecompressEnd(&c->bzip2);
+#endif
+#if HAVE_ZSTD
+        } else if (c->type == IMPORT_COMPRESS_ZSTD) {
+                if (c->encoding)
+                        ZSTD_freeCCtx(c->zstd_cctx);
+                else
+                        ZSTD_freeDCtx(c->zstd_dctx);
 #endif
         }
 
@@ -36,6 +49,9 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
         static const uint8_t bzip2_signature[] = {
                 'B', 'Z', 'h'
         };
+        static const uint8_t zstd_signature[] = {
+                0x28, 0xb5, 0x2f, 0xfd
+        };
 
         int r;
 
@@ -44,9 +60,10 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
         if (c->type != IMPORT_COMPRESS_UNKNOWN)
                 return 1;
 
-        if (size < MAX3(sizeof(xz_signature),
-                        sizeof(gzip_signature),
-                        sizeof(bzip2_signature)))
+        if (size < MAX(MAX3(sizeof(xz_signature),
+                            sizeof(gzip_signature),
+                            sizeof(bzip2_signature)),
+                       sizeof(zstd_signature)))
                 return 0;
 
         assert(data);
@@ -54,7 +71,19 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
         if (memcmp(data, xz_signature, sizeof(xz_signature)) == 0) {
                 lzma_ret xzr;
 
+#if HAVE_LZMA_STREAM_DECODER_MT
+                /* Decompressing is the bottleneck when pulling large images over fast links, hence let
+                 * liblzma decode independent blocks on all CPUs, if the image was compressed in multiple
+                 * blocks (i.e. with "xz -T"). Single-block streams are decoded in a single thread as before. */
+                xzr = lzma_stream_decoder_mt(&c->xz, &(const lzma_mt) {
+                                .flags = LZMA_TELL_UNSUPPORTED_CHECK | LZMA_CONCATENATED,
+                                .threads = MAX(lzma_cputhreads(), 1U),
+                                .memlimit_threading = IMPORT_UNCOMPRESS_XZ_MEMLIMIT_THREADING,
+                                .memlimit_stop = UINT64_MAX,
+                        });
+#else
                 xzr = lzma_stream_decoder(&c->xz, UINT64_MAX, LZMA_TELL_UNSUPPORTED_CHECK | LZMA_CONCATENATED);
+#endif
                 if (xzr != LZMA_OK)
                         return -EIO;
 
@@ -74,6 +103,15 @@ int import_uncompress_detect(ImportCompress *c, const void *data, size_t size) {
                         return -EIO;
 
                 c->type = IMPORT_COMPRESS_BZIP2;
+#endif
+#if HAVE_ZSTD
+        } else if (memcmp(data, zstd_signature, sizeof(zstd_signature)) == 0) {
+                c->zstd_dctx = ZSTD_createDCtx();
+                if (!c->zstd_dctx)
+                        return -ENOMEM;
+
+                c->zstd_frame_left = 0;
+                c->type = IMPORT_COMPRESS_ZSTD;
 #endif
         } else
                 c->type = IMPORT_COMPRESS_UNCOMPRESSED;
@@ -114,7 +152,9 @@ int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCo
                 c->xz.next_in = data;
                 c->xz.avail_in = size;
 
-                while (c->xz.avail_in > 0) {
+                /* Keep going while the output buffer comes back full, the decoder might have more for us even
+                 * if it consumed all input */
+                do {
                         uint8_t buffer[16 * 1024];
                         lzma_ret lzr;
 
@@ -128,7 +168,10 @@ int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCo
                         r = callback(buffer, sizeof(buffer) - c->xz.avail_out, userdata);
                         if (r < 0)
                                 return r;
-                }
+
+                        if (lzr == LZMA_STREAM_END)
+                                break;
+                } while (c->xz.avail_in > 0 || c->xz.avail_out == 0);
 
                 break;
 
@@ -176,6 +219,41 @@ int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCo
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {
+                        .src = data,
+                        .size = size,
+                };
+
+                /* Like for xz, data might still be buffered inside of the decoder as long as the output buffer
+                 * comes back full, except if a frame was completely decoded and flushed. */
+                for (;;) {
+                        uint8_t buffer[16 * 1024];
+                        ZSTD_outBuffer output = {
+                                .dst = buffer,
+                                .size = sizeof(buffer),
+                        };
+                        size_t k;
+
+                        k = ZSTD_decompressStream(c->zstd_dctx, &output, &input);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        c->zstd_frame_left = k;
+
+                        r = callback(buffer, output.pos, userdata);
+                        if (r < 0)
+                                return r;
+
+                        if (input.pos >= input.size && (output.pos < output.size || k == 0))
+                                break;
+                }
+
+                break;
+        }
+#endif
+
         default:
                 assert_not_reached("Unknown compression");
         }
@@ -183,6 +261,65 @@ int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCo
         return 1;
 }
 
+int import_uncompress_finish(ImportCompress *c, ImportCompressCallback callback, void *userdata) {
+        int r;
+
+        assert(c);
+        assert(callback);
+
+        /* Called at the end of the input, to retrieve what the decoder still buffers internally and to check that
+         * the stream is complete. The multi-threaded xz decoder in particular holds back the output of the last
+         * blocks until told that no more input follows. */
+
+        if (c->encoding)
+                return -EINVAL;
+
+        switch (c->type) {
+
+        case IMPORT_COMPRESS_XZ:
+                c->xz.next_in = NULL;
+                c->xz.avail_in = 0;
+
+                for (;;) {
+                        uint8_t buffer[16 * 1024];
+                        lzma_ret lzr;
+
+                        c->xz.next_out = buffer;
+                        c->xz.avail_out = sizeof(buffer);
+
+                        lzr = lzma_code(&c->xz, LZMA_FINISH);
+                        if (lzr == LZMA_BUF_ERROR) /* The stream ended prematurely */
+                                return -EBADMSG;
+                        if (!IN_SET(lzr, LZMA_OK, LZMA_STREAM_END))
+                                return -EIO;
+
+                        r = callback(buffer, sizeof(buffer) - c->xz.avail_out, userdata);
+                        if (r < 0)
+                                return r;
+
+                        if (lzr == LZMA_STREAM_END)
+                                break;
+                }
+
+                break;
+
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD:
+                /* import_uncompress() already retrieved all output, but the input might end in the middle of a
+                 * frame, which the decoder won't tell us about by itself */
+                if (c->zstd_frame_left != 0)
+                        return -EBADMSG;
+
+                break;
+#endif
+
+        default:
+                break;
+        }
+
+        return 0;
+}
+
 int import_compress_init(ImportCompress *c, ImportCompressType t) {
         int r;
 
@@ -219,6 +356,25 @@ int import_compress_init(ImportCompress *c, ImportCompressType t) {
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                long n;
+
+                c->zstd_cctx = ZSTD_createCCtx();
+                if (!c->zstd_cctx)
+                        return -ENOMEM;
+
+                /* Compress on all CPUs, if libzstd was built with multi-threading support. If not, this fails and
+                 * we compress in a single thread. */
+                n = sysconf(_SC_NPROCESSORS_ONLN);
+                if (n > 1)
+                        (void) ZSTD_CCtx_setParameter(c->zstd_cctx, ZSTD_c_nbWorkers, (int) MIN(n, (long) INT_MAX));
+
+                c->type = IMPORT_COMPRESS_ZSTD;
+                break;
+        }
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
                 c->type = IMPORT_COMPRESS_UNCOMPRESSED;
                 break;
@@ -339,6 +495,37 @@ int import_compress(ImportCompress *c, const void *data, size_t size, void **buf
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {
+                        .src = data,
+                        .size = size,
+                };
+
+                while (input.pos < input.size) {
+                        ZSTD_outBuffer output;
+                        size_t k;
+
+                        r = enlarge_buffer(buffer, buffer_size, buffer_allocated);
+                        if (r < 0)
+                                return r;
+
+                        output = (ZSTD_outBuffer) {
+                                .dst = (uint8_t*) *buffer + *buffer_size,
+                                .size = *buffer_allocated - *buffer_size,
+                        };
+
+                        k = ZSTD_compressStream2(c->zstd_cctx, &output, &input, ZSTD_e_continue);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        *buffer_size += output.pos;
+                }
+
+                break;
+        }
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
 
                 if (*buffer_allocated < size) {
@@ -443,6 +630,35 @@ int import_compress_finish(ImportCompress *c, void **buffer, size_t *buffer_size
                 break;
 #endif
 
+#if HAVE_ZSTD
+        case IMPORT_COMPRESS_ZSTD: {
+                ZSTD_inBuffer input = {};
+                size_t k;
+
+                do {
+                        ZSTD_outBuffer output;
+
+                        r = enlarge_buffer(buffer, buffer_size, buffer_allocated);
+                        if (r < 0)
+                                return r;
+
+                        output = (ZSTD_outBuffer) {
+                                .dst = (uint8_t*) *buffer + *buffer_size,
+                                .size = *buffer_allocated - *buffer_size,
+                        };
+
+                        /* Returns the number of bytes still to flush, hence loop until that's zero */
+                        k = ZSTD_compressStream2(c->zstd_cctx, &output, &input, ZSTD_e_end);
+                        if (ZSTD_isError(k))
+                                return -EIO;
+
+                        *buffer_size += output.pos;
+                } while (k != 0);
+
+                break;
+        }
+#endif
+
         case IMPORT_COMPRESS_UNCOMPRESSED:
                 break;
 
@@ -461,6 +677,9 @@ static const char* const import_compress_type_table[_IMPORT_COMPRESS_TYPE_MAX] =
 #if HAVE_BZIP2
         [IMPORT_COMPRESS_BZIP2] = "bzip2",
 #endif
+#if HAVE_ZSTD
+        [IMPORT_COMPRESS_ZSTD] = "zstd",
+#endif
 };
 
 DEFINE_STRING_TABLE_LOOKUP(import_compress_type, ImportCompressType);
@@ -7,6 +7,9 @@
 #include <lzma.h>
 #include <sys/types.h>
 #include <zlib.h>
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "macro.h"
 
@@ -16,6 +19,7 @@ typedef enum ImportCompressType {
         IMPORT_COMPRESS_XZ,
         IMPORT_COMPRESS_GZIP,
         IMPORT_COMPRESS_BZIP2,
+        IMPORT_COMPRESS_ZSTD,
         _IMPORT_COMPRESS_TYPE_MAX,
         _IMPORT_COMPRESS_TYPE_INVALID = -1,
 } ImportCompressType;
@@ -28,8 +32,15 @@ typedef struct ImportCompress {
                 z_stream gzip;
 #if HAVE_BZIP2
                 bz_stream bzip2;
+#endif
+#if HAVE_ZSTD
+                ZSTD_CCtx *zstd_cctx;
+                ZSTD_DCtx *zstd_dctx;
 #endif
         };
+#if HAVE_ZSTD
+        size_t zstd_frame_left; /* The last ZSTD_decompressStream() result, 0 if at a frame boundary */
+#endif
 } ImportCompress;
 
 typedef int (*ImportCompressCallback)(const void *data, size_t size, void *userdata);
@@ -38,6 +49,7 @@ void import_compress_free(ImportCompress *c);
 
 int import_uncompress_detect(ImportCompress *c, const void *data, size_t size);
 int import_uncompress(ImportCompress *c, const void *data, size_t size, ImportCompressCallback callback, void *userdata);
+int import_uncompress_finish(ImportCompress *c, ImportCompressCallback callback, void *userdata);
 
 int import_compress_init(ImportCompress *c, ImportCompressType t);
 int import_compress(ImportCompress *c, const void *data, size_t size, void **buffer, size_t *buffer_size, size_t *buffer_allocated);
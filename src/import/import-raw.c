@@ -339,6 +339,12 @@ static int raw_import_process(RawImport *i) {
                         goto finish;
                 }
 
+                r = import_uncompress_finish(&i->compress, raw_import_write, i);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to decode and write: %m");
+                        goto finish;
+                }
+
                 r = raw_import_finish(i);
                 goto finish;
         }
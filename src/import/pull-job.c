@@ -83,6 +83,8 @@ static int pull_job_restart(PullJob *j) {
         return 0;
 }
 
+static int pull_job_write_uncompressed(const void *p, size_t sz, void *userdata);
+
 void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
         PullJob *j = NULL;
         CURLcode code;
@@ -154,6 +156,12 @@ void pull_job_curl_on_finished(CurlGlue *g, CURL *curl, CURLcode result) {
                 goto finish;
         }
 
+        r = import_uncompress_finish(&j->compress, pull_job_write_uncompressed, j);
+        if (r < 0) {
+                log_error_errno(r, "Failed to decompress the end of the download: %m");
+                goto finish;
+        }
+
         if (j->checksum_context) {
                 uint8_t *k;
 
@@ -61,35 +61,80 @@ static uint32_t HEADER_HEADER_LENGTH(const Header *h) {
         return be32toh(h->header_length);
 }
 
-static int copy_cluster(
+/* Contiguous clusters are copied in one go, up to this size */
+#define QCOW2_COPY_RUN_MAX (1024U*1024U)
+
+static bool memory_is_zero(const void *p, size_t n) {
+        const uint8_t *q = p;
+
+        /* Compares the buffer with itself shifted by one byte, which is about as fast as it gets */
+        return n == 0 || (q[0] == 0 && memcmp(q, q + 1, n - 1) == 0);
+}
+
+static int write_nonzero_clusters(
+                int dfd, uint64_t doffset,
+                const uint8_t *buffer,
+                uint64_t size,
+                uint64_t cluster_size) {
+
+        uint64_t i = 0;
+
+        /* The destination file has been truncated before, hence all-zero clusters don't need to be written,
+         * they simply remain holes. The remaining clusters are written in as few calls as possible. */
+
+        while (i < size) {
+                uint64_t n;
+                ssize_t l;
+
+                if (memory_is_zero(buffer + i, cluster_size)) {
+                        i += cluster_size;
+                        continue;
+                }
+
+                for (n = cluster_size; i + n < size; n += cluster_size)
+                        if (memory_is_zero(buffer + i + n, cluster_size))
+                                break;
+
+                l = pwrite(dfd, buffer + i, n, doffset + i);
+                if (l < 0)
+                        return -errno;
+                if ((uint64_t) l != n)
+                        return -EIO;
+
+                i += n;
+        }
+
+        return 0;
+}
+
+static int copy_clusters(
                 int sfd, uint64_t soffset,
                 int dfd, uint64_t doffset,
+                uint64_t size,
                 uint64_t cluster_size,
                 void *buffer) {
 
         ssize_t l;
         int r;
 
-        r = btrfs_clone_range(sfd, soffset, dfd, doffset, cluster_size);
+        if (size == 0)
+                return 0;
+
+        r = btrfs_clone_range(sfd, soffset, dfd, doffset, size);
         if (r >= 0)
                 return r;
 
-        l = pread(sfd, buffer, cluster_size, soffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
-                return -EIO;
-
-        l = pwrite(dfd, buffer, cluster_size, doffset);
+        l = pread(sfd, buffer, size, soffset);
         if (l < 0)
                 return -errno;
-        if ((uint64_t) l != cluster_size)
+        if ((uint64_t) l != size)
                 return -EIO;
 
-        return 0;
+        return write_nonzero_clusters(dfd, doffset, buffer, size, cluster_size);
 }
 
 static int decompress_cluster(
+                z_stream *s,
                 int sfd, uint64_t soffset,
                 int dfd, uint64_t doffset,
                 uint64_t compressed_size,
@@ -98,7 +143,6 @@ static int decompress_cluster(
                 void *buffer2) {
 
         _cleanup_free_ void *large_buffer = NULL;
-        z_stream s = {};
         uint64_t sz;
         ssize_t l;
         int r;
@@ -120,28 +164,22 @@ static int decompress_cluster(
         if ((uint64_t) l != compressed_size)
                 return -EIO;
 
-        s.next_in = buffer1;
-        s.avail_in = compressed_size;
-        s.next_out = buffer2;
-        s.avail_out = cluster_size;
-
-        r = inflateInit2(&s, -12);
+        /* Reuse the stream the caller initialized, instead of allocating the inflate state for each cluster */
+        r = inflateReset(s);
         if (r != Z_OK)
                 return -EIO;
 
-        r = inflate(&s, Z_FINISH);
-        sz = (uint8_t*) s.next_out - (uint8_t*) buffer2;
-        inflateEnd(&s);
-        if (r != Z_STREAM_END || sz != cluster_size)
-                return -EIO;
+        s->next_in = buffer1;
+        s->avail_in = compressed_size;
+        s->next_out = buffer2;
+        s->avail_out = cluster_size;
 
-        l = pwrite(dfd, buffer2, cluster_size, doffset);
-        if (l < 0)
-                return -errno;
-        if ((uint64_t) l != cluster_size)
+        r = inflate(s, Z_FINISH);
+        sz = (uint8_t*) s->next_out - (uint8_t*) buffer2;
+        if (r != Z_STREAM_END || sz != cluster_size)
                 return -EIO;
 
-        return 0;
+        return write_nonzero_clusters(dfd, doffset, buffer2, cluster_size, cluster_size);
 }
 
 static int normalize_offset(
@@ -229,6 +267,9 @@ static int verify_header(const Header *header) {
 int qcow2_convert(int qcow2_fd, int raw_fd) {
         _cleanup_free_ void *buffer1 = NULL, *buffer2 = NULL;
         _cleanup_free_ be64_t *l1_table = NULL, *l2_table = NULL;
+        uint64_t run_soffset = 0, run_doffset = 0, run_size = 0, run_max;
+        bool inflate_initialized = false;
+        z_stream s = {};
         uint64_t sz, i;
         Header header;
         ssize_t l;
@@ -252,7 +293,9 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
         if (!l2_table)
                 return -ENOMEM;
 
-        buffer1 = malloc(HEADER_CLUSTER_SIZE(&header));
+        /* The first buffer is used both for runs of uncompressed clusters, and for compressed clusters */
+        run_max = MAX(HEADER_CLUSTER_SIZE(&header), QCOW2_COPY_RUN_MAX);
+        buffer1 = malloc(run_max);
         if (!buffer1)
                 return -ENOMEM;
 
@@ -279,15 +322,19 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
 
                 r = normalize_offset(&header, l1_table[i], &l2_begin, NULL, NULL);
                 if (r < 0)
-                        return r;
+                        goto finish;
                 if (r == 0)
                         continue;
 
                 l = pread(qcow2_fd, l2_table, HEADER_CLUSTER_SIZE(&header), l2_begin);
-                if (l < 0)
-                        return -errno;
-                if ((uint64_t) l != HEADER_CLUSTER_SIZE(&header))
-                        return -EIO;
+                if (l < 0) {
+                        r = -errno;
+                        goto finish;
+                }
+                if ((uint64_t) l != HEADER_CLUSTER_SIZE(&header)) {
+                        r = -EIO;
+                        goto finish;
+                }
 
                 for (j = 0; j < HEADER_L2_SIZE(&header); j++) {
                         uint64_t data_begin, p, compressed_size;
@@ -297,27 +344,67 @@ int qcow2_convert(int qcow2_fd, int raw_fd) {
 
                         r = normalize_offset(&header, l2_table[j], &data_begin, &compressed, &compressed_size);
                         if (r < 0)
-                                return r;
+                                goto finish;
                         if (r == 0)
                                 continue;
 
-                        if (compressed)
-                                r = decompress_cluster(
-                                                qcow2_fd, data_begin,
-                                                raw_fd, p,
-                                                compressed_size, HEADER_CLUSTER_SIZE(&header),
-                                                buffer1, buffer2);
-                        else
-                                r = copy_cluster(
-                                                qcow2_fd, data_begin,
-                                                raw_fd, p,
-                                                HEADER_CLUSTER_SIZE(&header), buffer1);
+                        if (!compressed) {
+                                /* Images are usually written front to back, hence uncompressed clusters tend to be
+                                 * stored contiguously. Collect them into runs, so that we can copy them with a
+                                 * single call. */
+                                if (run_size > 0 &&
+                                    data_begin == run_soffset + run_size &&
+                                    p == run_doffset + run_size &&
+                                    run_size + HEADER_CLUSTER_SIZE(&header) <= run_max) {
+                                        run_size += HEADER_CLUSTER_SIZE(&header);
+                                        continue;
+                                }
+
+                                r = copy_clusters(qcow2_fd, run_soffset, raw_fd, run_doffset, run_size,
+                                                  HEADER_CLUSTER_SIZE(&header), buffer1);
+                                if (r < 0)
+                                        goto finish;
+
+                                run_soffset = data_begin;
+                                run_doffset = p;
+                                run_size = HEADER_CLUSTER_SIZE(&header);
+                                continue;
+                        }
+
+                        r = copy_clusters(qcow2_fd, run_soffset, raw_fd, run_doffset, run_size,
+                                          HEADER_CLUSTER_SIZE(&header), buffer1);
+                        if (r < 0)
+                                goto finish;
+                        run_size = 0;
+
+                        if (!inflate_initialized) {
+                                if (inflateInit2(&s, -12) != Z_OK) {
+                                        r = -EIO;
+                                        goto finish;
+                                }
+
+                                inflate_initialized = true;
+                        }
+
+                        r = decompress_cluster(
+                                        &s,
+                                        qcow2_fd, data_begin,
+                                        raw_fd, p,
+                                        compressed_size, HEADER_CLUSTER_SIZE(&header),
+                                        buffer1, buffer2);
                         if (r < 0)
-                                return r;
+                                goto finish;
                 }
         }
 
-        return 0;
+        r = copy_clusters(qcow2_fd, run_soffset, raw_fd, run_doffset, run_size,
+                          HEADER_CLUSTER_SIZE(&header), buffer1);
+
+finish:
+        if (inflate_initialized)
+                inflateEnd(&s);
+
+        return r;
 }
 
 int qcow2_detect(int fd) {
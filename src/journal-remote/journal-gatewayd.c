@@ -3,10 +3,17 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <microhttpd.h>
+#include <pthread.h>
+#include <stdio_ext.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#if HAVE_PCRE2
+#  define PCRE2_CODE_UNIT_WIDTH 8
+#  include <pcre2.h>
+#endif
+
 #include "sd-bus.h"
 #include "sd-daemon.h"
 #include "sd-journal.h"
@@ -27,13 +34,32 @@
 
 #define JOURNAL_WAIT_TIMEOUT (10*USEC_PER_SEC)
 
+/* How many idle journal handles to keep around for reuse by later requests */
+#define JOURNAL_POOL_MAX 8U
+
 static char *arg_key_pem = NULL;
 static char *arg_cert_pem = NULL;
 static char *arg_trust_pem = NULL;
 static char *arg_directory = NULL;
 
+typedef struct JournalPoolEntry {
+        sd_journal *journal;
+        char *arguments; /* the URL arguments the installed matches were generated from */
+        char *cursor;    /* the entry the handle was left positioned on */
+} JournalPoolEntry;
+
+/* Opening the journal means enumerating, opening and mapping every journal file, and seeking means bisecting
+ * each of them again. Clients polling /entries do this every few seconds, hence keep the handles of finished
+ * requests around, and hand them to the next request. The pool is shared by all connection threads. */
+static JournalPoolEntry journal_pool[JOURNAL_POOL_MAX];
+static unsigned journal_pool_n = 0;
+static pthread_mutex_t journal_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 typedef struct RequestMeta {
         sd_journal *journal;
+        char *arguments;
+        bool resumed;
+        bool positioned;
 
         OutputMode mode;
 
@@ -42,7 +68,7 @@ typedef struct RequestMeta {
         uint64_t n_entries;
         bool n_entries_set;
 
-        FILE *tmp;
+        char *buffer;
         uint64_t delta, size;
 
         int argument_parse_error;
@@ -52,6 +78,11 @@ typedef struct RequestMeta {
 
         uint64_t n_fields;
         bool n_fields_set;
+
+#if HAVE_PCRE2
+        pcre2_code *pattern;
+        pcre2_match_data *pattern_md;
+#endif
 } RequestMeta;
 
 static const char* const mime_types[_OUTPUT_MODE_MAX] = {
@@ -62,6 +93,90 @@ static const char* const mime_types[_OUTPUT_MODE_MAX] = {
         [OUTPUT_EXPORT] = "application/vnd.fdo.journal",
 };
 
+static void journal_pool_entry_done(JournalPoolEntry *e) {
+        assert(e);
+
+        sd_journal_close(e->journal);
+        free(e->arguments);
+        free(e->cursor);
+}
+
+static sd_journal *journal_pool_take(const char *arguments, const char *cursor, bool *ret_resumed) {
+        JournalPoolEntry e = {};
+        unsigned i;
+        bool resumed = false;
+
+        assert(ret_resumed);
+
+        assert_se(pthread_mutex_lock(&journal_pool_mutex) == 0);
+
+        if (journal_pool_n > 0) {
+                /* Prefer a handle that has the same matches installed and is still sitting on the entry the client
+                 * wants to continue from, otherwise take the most recently returned one. */
+                i = journal_pool_n - 1;
+
+                if (cursor) {
+                        unsigned k;
+
+                        for (k = 0; k < journal_pool_n; k++)
+                                if (streq_ptr(journal_pool[k].cursor, cursor) &&
+                                    streq_ptr(journal_pool[k].arguments, arguments)) {
+                                        i = k;
+                                        resumed = true;
+                                        break;
+                                }
+                }
+
+                e = journal_pool[i];
+                memmove(journal_pool + i, journal_pool + i + 1, (journal_pool_n - i - 1) * sizeof(JournalPoolEntry));
+                journal_pool_n--;
+        }
+
+        assert_se(pthread_mutex_unlock(&journal_pool_mutex) == 0);
+
+        free(e.arguments);
+        free(e.cursor);
+
+        *ret_resumed = resumed;
+        return e.journal;
+}
+
+static void journal_pool_put(sd_journal *j, char *arguments) {
+        JournalPoolEntry e = {
+                .journal = j,
+                .arguments = arguments,
+        }, evicted = {};
+
+        assert(j);
+
+        /* Takes possession of both the journal and the arguments string */
+
+        (void) sd_journal_get_cursor(j, &e.cursor);
+
+        assert_se(pthread_mutex_lock(&journal_pool_mutex) == 0);
+
+        if (journal_pool_n >= JOURNAL_POOL_MAX) {
+                evicted = journal_pool[0];
+                memmove(journal_pool, journal_pool + 1, (journal_pool_n - 1) * sizeof(JournalPoolEntry));
+                journal_pool_n--;
+        }
+
+        journal_pool[journal_pool_n++] = e;
+
+        assert_se(pthread_mutex_unlock(&journal_pool_mutex) == 0);
+
+        journal_pool_entry_done(&evicted);
+}
+
+static void journal_pool_flush(void) {
+        assert_se(pthread_mutex_lock(&journal_pool_mutex) == 0);
+
+        while (journal_pool_n > 0)
+                journal_pool_entry_done(&journal_pool[--journal_pool_n]);
+
+        assert_se(pthread_mutex_unlock(&journal_pool_mutex) == 0);
+}
+
 static RequestMeta *request_meta(void **connection_cls) {
         RequestMeta *m;
 
@@ -88,46 +203,116 @@ static void request_meta_free(
         if (!m)
                 return;
 
-        sd_journal_close(m->journal);
+        if (m->journal)
+                journal_pool_put(m->journal, m->arguments);
+        else
+                free(m->arguments);
 
-        safe_fclose(m->tmp);
+#if HAVE_PCRE2
+        pcre2_match_data_free(m->pattern_md);
+        pcre2_code_free(m->pattern);
+#endif
 
+        free(m->buffer);
         free(m->cursor);
         free(m);
 }
 
 static int open_journal(RequestMeta *m) {
+        sd_journal *j;
+        bool resumed;
+        int r;
+
         assert(m);
 
         if (m->journal)
                 return 0;
 
-        if (arg_directory)
-                return sd_journal_open_directory(&m->journal, arg_directory, 0);
-        else
-                return sd_journal_open(&m->journal, SD_JOURNAL_LOCAL_ONLY|SD_JOURNAL_SYSTEM);
+        j = journal_pool_take(m->arguments, m->cursor, &resumed);
+        if (j) {
+                /* Pick up journal files that were rotated, added or removed while the handle was idle */
+                r = sd_journal_process(j);
+                if (r < 0) {
+                        log_debug_errno(r, "Failed to process pooled journal handle, opening a new one: %m");
+                        sd_journal_close(j);
+                        j = NULL;
+                } else if (!resumed)
+                        sd_journal_flush_matches(j);
+        }
+
+        if (!j) {
+                if (arg_directory)
+                        r = sd_journal_open_directory(&j, arg_directory, 0);
+                else
+                        r = sd_journal_open(&j, SD_JOURNAL_LOCAL_ONLY|SD_JOURNAL_SYSTEM);
+                if (r < 0)
+                        return r;
+
+                /* Set up inotify right away, so that sd_journal_process() can bring the handle up to date
+                 * when it is reused from the pool later on. */
+                (void) sd_journal_get_fd(j);
+                resumed = false;
+        }
+
+        m->journal = j;
+        m->resumed = resumed;
+
+        return 0;
 }
 
-static int request_meta_ensure_tmp(RequestMeta *m) {
+static FILE *request_meta_open_buffer(RequestMeta *m, size_t *size) {
+        FILE *f;
+
         assert(m);
+        assert(size);
 
-        if (m->tmp)
-                rewind(m->tmp);
-        else {
-                int fd;
+        /* Serialize each entry into memory, and hand it to microhttpd from there. This avoids a round trip
+         * through a temporary file for every single entry. */
 
-                fd = open_tmpfile_unlinkable("/tmp", O_RDWR|O_CLOEXEC);
-                if (fd < 0)
-                        return fd;
+        m->buffer = mfree(m->buffer);
 
-                m->tmp = fdopen(fd, "w+");
-                if (!m->tmp) {
-                        safe_close(fd);
-                        return -errno;
-                }
-        }
+        f = open_memstream(&m->buffer, size);
+        if (!f)
+                return NULL;
 
-        return 0;
+        (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+
+        return f;
+}
+
+static int request_meta_match_pattern(RequestMeta *m) {
+#if HAVE_PCRE2
+        const void *message;
+        size_t len;
+        int r;
+
+        assert(m);
+
+        if (!m->pattern)
+                return 1;
+
+        r = sd_journal_get_data(m->journal, "MESSAGE", &message, &len);
+        if (r == -ENOENT)
+                return 0;
+        if (r < 0)
+                return r;
+
+        assert_se(message = startswith(message, "MESSAGE="));
+
+        r = pcre2_match(m->pattern,
+                        message,
+                        len - strlen("MESSAGE="),
+                        0,      /* start at offset 0 in the subject */
+                        0,      /* default options */
+                        m->pattern_md,
+                        NULL);
+        if (r == PCRE2_ERROR_NOMATCH)
+                return 0;
+        if (r < 0)
+                return -EINVAL;
+#endif
+
+        return 1;
 }
 
 static ssize_t request_reader_entries(
@@ -138,7 +323,7 @@ static ssize_t request_reader_entries(
 
         RequestMeta *m = cls;
         int r;
-        size_t n, k;
+        size_t n;
 
         assert(m);
         assert(buf);
@@ -148,7 +333,8 @@ static ssize_t request_reader_entries(
         pos -= m->delta;
 
         while (pos >= m->size) {
-                off_t sz;
+                size_t sz = 0;
+                _cleanup_fclose_ FILE *f = NULL;
 
                 /* End of this entry, so let's serialize the next
                  * one */
@@ -157,7 +343,18 @@ static ssize_t request_reader_entries(
                     m->n_entries <= 0)
                         return MHD_CONTENT_READER_END_OF_STREAM;
 
-                if (m->n_skip < 0)
+                if (m->positioned) {
+                        /* The journal already points to the cursor entry, hence we need one step less than
+                         * after a seek. */
+                        if (m->n_skip < 0)
+                                r = sd_journal_previous_skip(m->journal, (uint64_t) -m->n_skip);
+                        else if (m->n_skip > 0)
+                                r = sd_journal_next_skip(m->journal, (uint64_t) m->n_skip);
+                        else
+                                r = 1;
+
+                        m->positioned = false;
+                } else if (m->n_skip < 0)
                         r = sd_journal_previous_skip(m->journal, (uint64_t) -m->n_skip + 1);
                 else if (m->n_skip > 0)
                         r = sd_journal_next_skip(m->journal, (uint64_t) m->n_skip + 1);
@@ -197,6 +394,16 @@ static ssize_t request_reader_entries(
                                 return MHD_CONTENT_READER_END_OF_STREAM;
                 }
 
+                r = request_meta_match_pattern(m);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to match entry against pattern: %m");
+                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                }
+                if (r == 0) {
+                        m->n_skip = 0;
+                        continue;
+                }
+
                 pos -= m->size;
                 m->delta += m->size;
 
@@ -205,50 +412,40 @@ static ssize_t request_reader_entries(
 
                 m->n_skip = 0;
 
-                r = request_meta_ensure_tmp(m);
-                if (r < 0) {
-                        log_error_errno(r, "Failed to create temporary file: %m");
+                f = request_meta_open_buffer(m, &sz);
+                if (!f) {
+                        log_oom();
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                r = show_journal_entry(m->tmp, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
+                r = show_journal_entry(f, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
                                    NULL, NULL, NULL);
                 if (r < 0) {
                         log_error_errno(r, "Failed to serialize item: %m");
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                sz = ftello(m->tmp);
-                if (sz == (off_t) -1) {
-                        log_error_errno(errno, "Failed to retrieve file position: %m");
+                r = fflush_and_check(f);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to serialize item: %m");
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
                 m->size = (uint64_t) sz;
         }
 
-        if (m->tmp == NULL && m->follow)
+        if (!m->buffer && m->follow)
                 return 0;
 
-        if (fseeko(m->tmp, pos, SEEK_SET) < 0) {
-                log_error_errno(errno, "Failed to seek to position: %m");
-                return MHD_CONTENT_READER_END_WITH_ERROR;
-        }
-
         n = m->size - pos;
         if (n < 1)
                 return 0;
         if (n > max)
                 n = max;
 
-        errno = 0;
-        k = fread(buf, 1, n, m->tmp);
-        if (k != n) {
-                log_error("Failed to read from file: %s", errno ? strerror(errno) : "Premature EOF");
-                return MHD_CONTENT_READER_END_WITH_ERROR;
-        }
+        memcpy(buf, m->buffer + pos, n);
 
-        return (ssize_t) k;
+        return (ssize_t) n;
 }
 
 static int request_parse_accept(
@@ -342,6 +539,42 @@ static int request_parse_range(
         return 0;
 }
 
+static int request_parse_pattern(RequestMeta *m, const char *pattern) {
+#if HAVE_PCRE2
+        unsigned flags = PCRE2_CASELESS;
+        PCRE2_SIZE erroroffset;
+        const char *p;
+        int errorcode;
+
+        assert(m);
+        assert(pattern);
+
+        if (m->pattern)
+                return -EINVAL;
+
+        /* Like journalctl --grep=, match case insensitively unless the pattern contains upper case characters */
+        for (p = pattern; *p; p++)
+                if (*p >= 'A' && *p <= 'Z') {
+                        flags = 0;
+                        break;
+                }
+
+        m->pattern = pcre2_compile((PCRE2_SPTR8) pattern, PCRE2_ZERO_TERMINATED, flags, &errorcode, &erroroffset, NULL);
+        if (!m->pattern)
+                return -EINVAL;
+
+        (void) pcre2_jit_compile(m->pattern, PCRE2_JIT_COMPLETE);
+
+        m->pattern_md = pcre2_match_data_create(1, NULL);
+        if (!m->pattern_md)
+                return -ENOMEM;
+
+        return 0;
+#else
+        return -EOPNOTSUPP;
+#endif
+}
+
 static int request_parse_arguments_iterator(
                 void *cls,
                 enum MHD_ValueKind kind,
@@ -391,6 +624,20 @@ static int request_parse_arguments_iterator(
                 return MHD_YES;
         }
 
+        if (streq(key, "grep")) {
+                r = request_parse_pattern(m, strempty(value));
+                if (r < 0) {
+                        m->argument_parse_error = r;
+                        return MHD_NO;
+                }
+
+                return MHD_YES;
+        }
+
+        /* A handle resumed from the pool already has exactly these matches installed */
+        if (m->resumed)
+                return MHD_YES;
+
         if (streq(key, "boot")) {
                 if (isempty(value))
                         r = true;
@@ -438,6 +685,40 @@ static int request_parse_arguments_iterator(
         return MHD_YES;
 }
 
+static int request_collect_arguments_iterator(
+                void *cls,
+                enum MHD_ValueKind kind,
+                const char *key,
+                const char *value) {
+
+        RequestMeta *m = cls;
+
+        assert(m);
+
+        if (!strextend(&m->arguments, strempty(key), "=", strempty(value), "\n", NULL)) {
+                m->argument_parse_error = -ENOMEM;
+                return MHD_NO;
+        }
+
+        return MHD_YES;
+}
+
+static int request_collect_arguments(
+                RequestMeta *m,
+                struct MHD_Connection *connection) {
+
+        assert(m);
+        assert(connection);
+
+        /* Remember the arguments verbatim, so that a journal handle returned to the pool can be matched up
+         * with a later request that installs the very same matches. */
+
+        m->argument_parse_error = 0;
+        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, request_collect_arguments_iterator, m);
+
+        return m->argument_parse_error;
+}
+
 static int request_parse_arguments(
                 RequestMeta *m,
                 struct MHD_Connection *connection) {
@@ -462,16 +743,19 @@ static int request_handler_entries(
         assert(connection);
         assert(m);
 
-        r = open_journal(m);
-        if (r < 0)
-                return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to open journal: %m");
-
         if (request_parse_accept(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Accept header.");
 
         if (request_parse_range(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse Range header.");
 
+        if (request_collect_arguments(m, connection) < 0)
+                return respond_oom(connection);
+
+        r = open_journal(m);
+        if (r < 0)
+                return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to open journal: %m");
+
         if (request_parse_arguments(m, connection) < 0)
                 return mhd_respond(connection, MHD_HTTP_BAD_REQUEST, "Failed to parse URL arguments.");
 
@@ -483,7 +767,12 @@ static int request_handler_entries(
                 m->n_entries_set = true;
         }
 
-        if (m->cursor)
+        if (m->resumed && m->cursor && sd_journal_test_cursor(m->journal, m->cursor) > 0) {
+                /* The pooled handle still sits on the requested entry, continue from there instead of
+                 * seeking in all files again. */
+                m->positioned = true;
+                r = 0;
+        } else if (m->cursor)
                 r = sd_journal_seek_cursor(m->journal, m->cursor);
         else if (m->n_skip >= 0)
                 r = sd_journal_seek_head(m->journal);
@@ -534,7 +823,7 @@ static ssize_t request_reader_fields(
 
         RequestMeta *m = cls;
         int r;
-        size_t n, k;
+        size_t n;
 
         assert(m);
         assert(buf);
@@ -544,9 +833,9 @@ static ssize_t request_reader_fields(
         pos -= m->delta;
 
         while (pos >= m->size) {
-                off_t sz;
+                size_t sz = 0, l;
+                _cleanup_fclose_ FILE *f = NULL;
                 const void *d;
-                size_t l;
 
                 /* End of this field, so let's serialize the next
                  * one */
@@ -568,44 +857,34 @@ static ssize_t request_reader_fields(
                 if (m->n_fields_set)
                         m->n_fields -= 1;
 
-                r = request_meta_ensure_tmp(m);
-                if (r < 0) {
-                        log_error_errno(r, "Failed to create temporary file: %m");
+                f = request_meta_open_buffer(m, &sz);
+                if (!f) {
+                        log_oom();
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                r = output_field(m->tmp, m->mode, d, l);
+                r = output_field(f, m->mode, d, l);
                 if (r < 0) {
                         log_error_errno(r, "Failed to serialize item: %m");
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                sz = ftello(m->tmp);
-                if (sz == (off_t) -1) {
-                        log_error_errno(errno, "Failed to retrieve file position: %m");
+                r = fflush_and_check(f);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to serialize item: %m");
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
                 m->size = (uint64_t) sz;
         }
 
-        if (fseeko(m->tmp, pos, SEEK_SET) < 0) {
-                log_error_errno(errno, "Failed to seek to position: %m");
-                return MHD_CONTENT_READER_END_WITH_ERROR;
-        }
-
         n = m->size - pos;
         if (n > max)
                 n = max;
 
-        errno = 0;
-        k = fread(buf, 1, n, m->tmp);
-        if (k != n) {
-                log_error("Failed to read from file: %s", errno ? strerror(errno) : "Premature EOF");
-                return MHD_CONTENT_READER_END_WITH_ERROR;
-        }
+        memcpy(buf, m->buffer + pos, n);
 
-        return (ssize_t) k;
+        return (ssize_t) n;
 }
 
 static int request_handler_fields(
@@ -1078,5 +1357,7 @@ finish:
         if (d)
                 MHD_stop_daemon(d);
 
+        journal_pool_flush();
+
         return r;
 }
@@ -179,51 +179,87 @@ static void request_meta_free(void *cls,
         }
 }
 
-static int process_http_upload(
+static bool process_http_entries(
                 struct MHD_Connection *connection,
-                const char *upload_data,
-                size_t *upload_data_size,
-                RemoteSource *source) {
+                RemoteSource *source,
+                int *ret) {
 
-        bool finished = false;
-        size_t remaining;
         int r;
 
         assert(source);
+        assert(ret);
 
-        log_trace("%s: connection %p, %zu bytes",
-                  __func__, connection, *upload_data_size);
-
-        if (*upload_data_size) {
-                log_trace("Received %zu bytes", *upload_data_size);
-
-                r = journal_importer_push_data(&source->importer,
-                                               upload_data, *upload_data_size);
-                if (r < 0)
-                        return mhd_respond_oom(connection);
-
-                *upload_data_size = 0;
-        } else
-                finished = true;
+        /* Writes all complete entries received so far. Returns true if processing failed and a response has
+         * been queued, whose result is returned in *ret. */
 
         for (;;) {
                 r = process_source(source,
                                    journal_remote_server_global->compress,
                                    journal_remote_server_global->seal);
                 if (r == -EAGAIN)
-                        break;
+                        return false;
                 else if (r < 0) {
                         log_warning("Failed to process data for connection %p", connection);
                         if (r == -E2BIG)
-                                return mhd_respondf(connection,
+                                *ret = mhd_respondf(connection,
                                                     r, MHD_HTTP_PAYLOAD_TOO_LARGE,
                                                     "Entry is too large, maximum is " STRINGIFY(DATA_SIZE_MAX) " bytes.");
                         else
-                                return mhd_respondf(connection,
+                                *ret = mhd_respondf(connection,
                                                     r, MHD_HTTP_UNPROCESSABLE_ENTITY,
                                                     "Processing failed: %m.");
+                        return true;
                 }
         }
+}
+
+static int process_http_upload(
+                struct MHD_Connection *connection,
+                const char *upload_data,
+                size_t *upload_data_size,
+                RemoteSource *source) {
+
+        bool finished = false;
+        size_t remaining;
+        int r, ret;
+
+        assert(source);
+
+        log_trace("%s: connection %p, %zu bytes",
+                  __func__, connection, *upload_data_size);
+
+        if (*upload_data_size) {
+                const char *p = upload_data;
+                size_t l = *upload_data_size;
+
+                log_trace("Received %zu bytes", *upload_data_size);
+
+                *upload_data_size = 0;
+
+                do {
+                        r = source_push_data(source, &p, &l);
+                        if (r == -ENOMEM)
+                                return mhd_respond_oom(connection);
+                        if (r < 0)
+                                return mhd_respondf(connection,
+                                                    r, MHD_HTTP_UNPROCESSABLE_ENTITY,
+                                                    "Failed to decompress data: %m.");
+
+                        if (process_http_entries(connection, source, &ret))
+                                return ret;
+                } while (r > 0);
+        } else {
+                finished = true;
+
+                r = source_finish_data(source);
+                if (r < 0)
+                        return mhd_respondf(connection,
+                                            r, MHD_HTTP_UNPROCESSABLE_ENTITY,
+                                            "Compressed data is truncated.");
+
+                if (process_http_entries(connection, source, &ret))
+                        return ret;
+        }
 
         if (!finished)
                 return MHD_YES;
@@ -315,6 +351,16 @@ static int request_handler(
                 return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "%m");
 
         hostname = NULL;
+
+        header = MHD_lookup_connection_value(connection,
+                                             MHD_HEADER_KIND, "Content-Encoding");
+        r = source_set_encoding(*connection_cls, header);
+        if (r == -ENOMEM)
+                return respond_oom(connection);
+        else if (r < 0)
+                return mhd_respondf(connection, r, MHD_HTTP_UNSUPPORTED_MEDIA_TYPE,
+                                    "Content-Encoding: %s is not supported.", header);
+
         return MHD_YES;
 }
 
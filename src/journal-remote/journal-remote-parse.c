@@ -19,6 +19,11 @@ void source_free(RemoteSource *source) {
         sd_event_source_unref(source->event);
         sd_event_source_unref(source->buffer_event);
 
+#if HAVE_ZSTD
+        ZSTD_freeDStream(source->zstd);
+        free(source->zstd_buffer);
+#endif
+
         free(source);
 }
 
@@ -47,6 +52,121 @@ RemoteSource* source_new(int fd, bool passive_fd, char *name, Writer *writer) {
         return source;
 }
 
+int source_set_encoding(RemoteSource *source, const char *encoding) {
+        assert(source);
+
+        if (!encoding || streq(encoding, "identity"))
+                return 0;
+
+#if HAVE_ZSTD
+        if (streq(encoding, "zstd")) {
+                size_t k;
+
+                if (source->zstd)
+                        return 0;
+
+                source->zstd = ZSTD_createDStream();
+                if (!source->zstd)
+                        return -ENOMEM;
+
+                k = ZSTD_initDStream(source->zstd);
+                if (ZSTD_isError(k))
+                        return -ENOMEM;
+
+                return 0;
+        }
+#endif
+
+        return -EPROTONOSUPPORT;
+}
+
+int source_push_data(RemoteSource *source, const char **data, size_t *size) {
+        int r;
+
+        assert(source);
+        assert(data);
+        assert(size);
+
+        /* Hands the received data to the importer, decompressing it first if necessary. Compressed data is
+         * decompressed one buffer at a time, so that the data can be processed in between, instead of
+         * decompressing everything into memory at once. Returns 1 if this should be called again, 0 if all
+         * data has been consumed. */
+
+#if HAVE_ZSTD
+        if (source->zstd) {
+                ZSTD_inBuffer input = {
+                        .src = *data,
+                        .size = *size,
+                };
+                ZSTD_outBuffer output;
+                size_t k;
+
+                if (*size == 0 && !source->zstd_pending)
+                        return 0;
+
+                if (!source->zstd_buffer) {
+                        source->zstd_buffer = malloc(ZSTD_DStreamOutSize());
+                        if (!source->zstd_buffer)
+                                return -ENOMEM;
+                }
+
+                output = (ZSTD_outBuffer) {
+                        .dst = source->zstd_buffer,
+                        .size = ZSTD_DStreamOutSize(),
+                };
+
+                k = ZSTD_decompressStream(source->zstd, &output, &input);
+                if (ZSTD_isError(k)) {
+                        log_debug("ZSTD decoder failed: %s", ZSTD_getErrorName(k));
+                        return -EBADMSG;
+                }
+
+                *data += input.pos;
+                *size -= input.pos;
+
+                /* ZSTD_decompressStream() returns 0 only when a frame has been fully decoded and flushed */
+                source->zstd_incomplete = k != 0;
+
+                /* If the output buffer is full, there might be more output pending, even if all input has
+                 * been consumed */
+                source->zstd_pending = output.pos == output.size;
+
+                if (output.pos > 0) {
+                        r = journal_importer_push_data(&source->importer, source->zstd_buffer, output.pos);
+                        if (r < 0)
+                                return r;
+                }
+
+                return *size > 0 || source->zstd_pending;
+        }
+#endif
+
+        r = journal_importer_push_data(&source->importer, *data, *size);
+        if (r < 0)
+                return r;
+
+        *data += *size;
+        *size = 0;
+
+        return 0;
+}
+
+int source_finish_data(RemoteSource *source) {
+        assert(source);
+
+        /* Called when the sender signalled the end of the data. Returns -EBADMSG if the compressed stream
+         * ended in the middle of a frame, in which case the tail of the data is lost. */
+
+#if HAVE_ZSTD
+        if (source->zstd && source->zstd_incomplete) {
+                log_debug("ZSTD stream ended in the middle of a frame.");
+                return -EBADMSG;
+        }
+#endif
+
+        return 0;
+}
+
 int process_source(RemoteSource *source, bool compress, bool seal) {
         int r;
 
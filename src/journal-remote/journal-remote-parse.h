@@ -1,6 +1,10 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 #pragma once
 
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "sd-event.h"
 
 #include "journal-importer.h"
@@ -13,8 +17,19 @@ typedef struct RemoteSource {
 
         sd_event_source *event;
         sd_event_source *buffer_event;
+
+#if HAVE_ZSTD
+        /* For uploads with "Content-Encoding: zstd" */
+        ZSTD_DStream *zstd;
+        void *zstd_buffer;
+        bool zstd_pending;
+        bool zstd_incomplete;
+#endif
 } RemoteSource;
 
 RemoteSource* source_new(int fd, bool passive_fd, char *name, Writer *writer);
 void source_free(RemoteSource *source);
+int source_set_encoding(RemoteSource *source, const char *encoding);
+int source_push_data(RemoteSource *source, const char **data, size_t *size);
+int source_finish_data(RemoteSource *source);
 int process_source(RemoteSource *source, bool compress, bool seal);
@@ -29,6 +29,9 @@
 
 #define REMOTE_JOURNAL_PATH "/var/log/journal/remote"
 
+/* How many entries to process from a raw source at max before turning to the other sources */
+#define RAW_SOURCE_BATCH_MAX 64U
+
 #define filename_escape(s) xescape((s), "/ ")
 
 static int open_output(RemoteServer *s, Writer *w, const char* host) {
@@ -420,6 +423,20 @@ int journal_remote_handle_raw_source(
                 return 1;
 }
 
+static int handle_raw_source_batch(sd_event_source *event, int fd) {
+        unsigned i;
+        int r = 1;
+
+        /* Process a couple of entries in one go, to save on event loop iterations, but not all of them, so that
+         * a busy source doesn't keep us from the others. Note that the source might be gone when this doesn't
+         * return 1. */
+
+        for (i = 0; i < RAW_SOURCE_BATCH_MAX && r == 1; i++)
+                r = journal_remote_handle_raw_source(event, fd, EPOLLIN, journal_remote_server_global);
+
+        return r;
+}
+
 static int dispatch_raw_source_until_block(sd_event_source *event,
                                            void *userdata) {
         RemoteSource *source = userdata;
@@ -428,7 +445,7 @@ static int dispatch_raw_source_until_block(sd_event_source *event,
         /* Make sure event stays around even if source is destroyed */
         sd_event_source_ref(event);
 
-        r = journal_remote_handle_raw_source(event, source->importer.fd, EPOLLIN, journal_remote_server_global);
+        r = handle_raw_source_batch(event, source->importer.fd);
         if (r != 1)
                 /* No more data for now */
                 sd_event_source_set_enabled(event, SD_EVENT_OFF);
@@ -448,7 +465,7 @@ static int dispatch_raw_source_event(sd_event_source *event,
         assert(source->event);
         assert(source->buffer_event);
 
-        r = journal_remote_handle_raw_source(event, fd, EPOLLIN, journal_remote_server_global);
+        r = handle_raw_source_batch(event, fd);
         if (r == 1)
                 /* Might have more data. We need to rerun the handler
                  * until we are sure the buffer is exhausted. */
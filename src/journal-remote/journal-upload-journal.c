@@ -226,6 +226,7 @@ static ssize_t write_entry(char *buf, size_t size, Uploader *u) {
                         buf[pos++] = '\n';
                         u->entry_state++;
                         u->entries_sent++;
+                        u->batch_entries++;
 
                         return pos;
 
@@ -268,6 +269,16 @@ static size_t journal_input_callback(void *buf, size_t size, size_t nmemb, void
 
         while (j && filled < size * nmemb) {
                 if (u->entry_state == ENTRY_DONE) {
+                        if (u->batch_size > 0 && u->batch_entries >= u->batch_size) {
+                                /* Finish this request, so that the server acknowledges the entries sent so far
+                                 * and we can save the cursor. The next request is started right away. */
+                                log_debug("Uploaded %u entries, finishing request.", u->batch_entries);
+
+                                u->batch_full = true;
+                                u->uploading = false;
+                                break;
+                        }
+
                         r = sd_journal_next(j);
                         if (r < 0) {
                                 log_error_errno(r, "Failed to move to next entry in journal: %m");
@@ -325,6 +336,8 @@ static int process_journal_input(Uploader *u, int skip) {
         if (u->uploading)
                 return 0;
 
+        u->batch_full = false;
+
         r = sd_journal_next_skip(u->journal, skip);
         if (r < 0)
                 return log_error_errno(r, "Failed to skip to next entry: %m");
@@ -333,11 +346,13 @@ static int process_journal_input(Uploader *u, int skip) {
 
         /* have data */
         u->entry_state = ENTRY_CURSOR;
+        u->batch_entries = 0;
         return start_upload(u, journal_input_callback, u);
 }
 
 int check_journal_input(Uploader *u) {
-        if (u->input_event) {
+        /* If the previous request was finished because it was full, there are more entries waiting already */
+        if (u->input_event && !u->batch_full) {
                 int r;
 
                 r = sd_journal_process(u->journal);
@@ -45,6 +45,8 @@ static const char *arg_machine = NULL;
 static bool arg_merge = false;
 static int arg_follow = -1;
 static const char *arg_save_state = NULL;
+static bool arg_compress = false;
+static unsigned arg_batch_size = 0;
 
 static void close_fd_input(Uploader *u);
 
@@ -161,6 +163,78 @@ static int load_cursor_state(Uploader *u) {
         return 0;
 }
 
+#if HAVE_ZSTD
+static size_t zstd_input_callback(void *buf, size_t size, size_t nmemb, void *userp) {
+        Uploader *u = userp;
+        ZSTD_outBuffer output = {
+                .dst = buf,
+                .size = size * nmemb,
+        };
+        size_t k;
+
+        assert(u);
+        assert(!size_multiply_overflow(size, nmemb));
+
+        /* Wraps the actual input callback and compresses what it returns. Since zstd looks back a couple of
+         * megabytes for matches, field values repeated between entries, which make up most of the export format,
+         * are compressed very well. Each upload is a single zstd frame. */
+
+        while (output.pos < output.size) {
+                if (u->zstd_input.pos >= u->zstd_input.size && !u->zstd_eof) {
+                        size_t n, m = ZSTD_CStreamInSize();
+
+                        n = u->zstd_input_callback(u->zstd_buffer, 1, m, u->zstd_input_data);
+                        if (n == CURL_READFUNC_ABORT)
+                                return n;
+                        assert(n <= m);
+
+                        u->zstd_input = (ZSTD_inBuffer) {
+                                .src = u->zstd_buffer,
+                                .size = n,
+                        };
+                        u->zstd_eof = n == 0;
+
+                        if (n > 0 && n < m) {
+                                /* The input is exhausted for now, hence don't let what we have so far sit in
+                                 * the compressor until more arrives. */
+                                k = ZSTD_compressStream(u->zstd, &output, &u->zstd_input);
+                                if (ZSTD_isError(k))
+                                        goto fail;
+
+                                if (u->zstd_input.pos >= u->zstd_input.size) {
+                                        k = ZSTD_flushStream(u->zstd, &output);
+                                        if (ZSTD_isError(k))
+                                                goto fail;
+                                        if (output.pos > 0)
+                                                break;
+                                }
+
+                                continue;
+                        }
+                }
+
+                if (!u->zstd_eof) {
+                        k = ZSTD_compressStream(u->zstd, &output, &u->zstd_input);
+                        if (ZSTD_isError(k))
+                                goto fail;
+                } else {
+                        k = ZSTD_endStream(u->zstd, &output);
+                        if (ZSTD_isError(k))
+                                goto fail;
+                        if (k == 0)
+                                /* The frame is complete */
+                                break;
+                }
+        }
+
+        return output.pos;
+
+fail:
+        log_error("Failed to compress upload: %s", ZSTD_getErrorName(k));
+        return CURL_READFUNC_ABORT;
+}
+#endif
+
 int start_upload(Uploader *u,
                  size_t (*input_callback)(void *ptr,
                                           size_t size,
@@ -172,6 +246,39 @@ int start_upload(Uploader *u,
         assert(u);
         assert(input_callback);
 
+#if HAVE_ZSTD
+        if (arg_compress) {
+                size_t k;
+
+                if (!u->zstd) {
+                        u->zstd = ZSTD_createCStream();
+                        if (!u->zstd)
+                                return log_oom();
+                }
+
+                if (!u->zstd_buffer) {
+                        u->zstd_buffer = malloc(ZSTD_CStreamInSize());
+                        if (!u->zstd_buffer)
+                                return log_oom();
+                }
+
+                /* Start a new frame for each upload */
+                k = ZSTD_initCStream(u->zstd, 0);
+                if (ZSTD_isError(k)) {
+                        log_error("Failed to initialize zstd compression: %s", ZSTD_getErrorName(k));
+                        return -ENOMEM;
+                }
+
+                u->zstd_input_callback = input_callback;
+                u->zstd_input_data = data;
+                u->zstd_input = (ZSTD_inBuffer) {};
+                u->zstd_eof = false;
+
+                input_callback = zstd_input_callback;
+                data = u;
+        }
+#endif
+
         if (!u->header) {
                 struct curl_slist *h;
 
@@ -179,6 +286,12 @@ int start_upload(Uploader *u,
                 if (!h)
                         return log_oom();
 
+                if (arg_compress) {
+                        h = curl_slist_append(h, "Content-Encoding: zstd");
+                        if (!h)
+                                return log_oom();
+                }
+
                 h = curl_slist_append(h, "Transfer-Encoding: chunked");
                 if (!h) {
                         curl_slist_free_all(h);
@@ -433,6 +546,7 @@ static int setup_uploader(Uploader *u, const char *url, const char *state_file)
                 return log_oom();
 
         u->state_file = state_file;
+        u->batch_size = arg_batch_size;
 
         r = sd_event_default(&u->events);
         if (r < 0)
@@ -454,6 +568,11 @@ static void destroy_uploader(Uploader *u) {
         curl_slist_free_all(u->header);
         free(u->answer);
 
+#if HAVE_ZSTD
+        ZSTD_freeCStream(u->zstd);
+        free(u->zstd_buffer);
+#endif
+
         free(u->last_cursor);
         free(u->current_cursor);
 
@@ -517,6 +636,8 @@ static int parse_config(void) {
                 { "Upload",  "ServerKeyFile",          config_parse_path,   0, &arg_key    },
                 { "Upload",  "ServerCertificateFile",  config_parse_path,   0, &arg_cert   },
                 { "Upload",  "TrustedCertificateFile", config_parse_path,   0, &arg_trust  },
+                { "Upload",  "Compress",               config_parse_bool,   0, &arg_compress },
+                { "Upload",  "BatchSize",              config_parse_unsigned, 0, &arg_batch_size },
                 {}};
 
         return config_parse_many_nulstr(PKGSYSCONFDIR "/journal-upload.conf",
@@ -556,6 +677,8 @@ static int help(void) {
                "     --follow[=BOOL]        Do [not] wait for input\n"
                "     --save-state[=FILE]    Save uploaded cursors (default \n"
                "                            " STATE_FILE ")\n"
+               "     --compress[=BOOL]      Compress the upload with zstd\n"
+               "     --batch-size=ENTRIES   Upload at most this many entries per request\n"
                "\nSee the %s for details.\n"
                , program_invocation_short_name
                , link
@@ -577,6 +700,8 @@ static int parse_argv(int argc, char *argv[]) {
                 ARG_AFTER_CURSOR,
                 ARG_FOLLOW,
                 ARG_SAVE_STATE,
+                ARG_COMPRESS,
+                ARG_BATCH_SIZE,
         };
 
         static const struct option options[] = {
@@ -596,6 +721,8 @@ static int parse_argv(int argc, char *argv[]) {
                 { "after-cursor", required_argument, NULL, ARG_AFTER_CURSOR   },
                 { "follow",       optional_argument, NULL, ARG_FOLLOW         },
                 { "save-state",   optional_argument, NULL, ARG_SAVE_STATE     },
+                { "compress",     optional_argument, NULL, ARG_COMPRESS       },
+                { "batch-size",   required_argument, NULL, ARG_BATCH_SIZE     },
                 {}
         };
 
@@ -723,6 +850,29 @@ static int parse_argv(int argc, char *argv[]) {
                         arg_save_state = optarg ?: STATE_FILE;
                         break;
 
+                case ARG_COMPRESS:
+                        if (optarg) {
+                                r = parse_boolean(optarg);
+                                if (r < 0) {
+                                        log_error("Failed to parse --compress= parameter.");
+                                        return -EINVAL;
+                                }
+
+                                arg_compress = r;
+                        } else
+                                arg_compress = true;
+
+                        break;
+
+                case ARG_BATCH_SIZE:
+                        r = safe_atou(optarg, &arg_batch_size);
+                        if (r < 0) {
+                                log_error("Failed to parse --batch-size= parameter.");
+                                return -EINVAL;
+                        }
+
+                        break;
+
                 case '?':
                         log_error("Unknown option %s.", argv[optind-1]);
                         return -EINVAL;
@@ -745,6 +895,13 @@ static int parse_argv(int argc, char *argv[]) {
                 return -EINVAL;
         }
 
+#if !HAVE_ZSTD
+        if (arg_compress) {
+                log_error("Compression requested, but zstd support is not compiled in.");
+                return -EOPNOTSUPP;
+        }
+#endif
+
         if (optind < argc && (arg_directory || arg_file || arg_machine || arg_journal_type)) {
                 log_error("Input arguments make no sense with journal input.");
                 return -EINVAL;
@@ -850,7 +1007,8 @@ int main(int argc, char **argv) {
                                 break;
                 }
 
-                r = sd_event_run(u.events, u.timeout);
+                /* Don't wait for new journal events if we have more entries queued up already */
+                r = sd_event_run(u.events, u.batch_full ? 0 : u.timeout);
                 if (r < 0) {
                         log_error_errno(r, "Failed to run event loop: %m");
                         break;
@@ -2,6 +2,10 @@
 
 #include <inttypes.h>
 
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "sd-event.h"
 #include "sd-journal.h"
 #include "time-util.h"
@@ -34,6 +38,16 @@ typedef struct Uploader {
         sd_event_source *input_event;
         uint64_t timeout;
 
+#if HAVE_ZSTD
+        /* "Content-Encoding: zstd" compression of the upload */
+        ZSTD_CStream *zstd;
+        size_t (*zstd_input_callback)(void *ptr, size_t size, size_t nmemb, void *userdata);
+        void *zstd_input_data;
+        void *zstd_buffer;
+        ZSTD_inBuffer zstd_input;
+        bool zstd_eof;
+#endif
+
         /* fd stuff */
         int input;
 
@@ -48,6 +62,11 @@ typedef struct Uploader {
         const char *state_file;
 
         size_t entries_sent;
+
+        /* Finish each request after this many entries (0 for no limit), so that the cursor is saved regularly */
+        unsigned batch_size;
+        unsigned batch_entries;
+        bool batch_full;
         char *last_cursor, *current_cursor;
         usec_t watchdog_timestamp;
         usec_t watchdog_usec;
@@ -589,40 +589,70 @@ static const char *find_id(void *p, sd_id128_t id) {
                 le64toh(f->offset);
 }
 
-int catalog_get(const char* database, sd_id128_t id, char **_text) {
-        _cleanup_close_ int fd = -1;
-        void *p = NULL;
-        struct stat st = {};
-        char *text = NULL;
-        int r;
+CatalogMap* catalog_map_free(CatalogMap *m) {
+        if (!m)
+                return NULL;
+
+        if (m->p)
+                munmap(m->p, m->st.st_size);
+
+        return mfree(m);
+}
+
+int catalog_get_mapped(CatalogMap **map, const char *database, sd_id128_t id, char **_text) {
+        struct stat st;
+        char *text;
         const char *s;
+        int r;
 
+        assert(map);
         assert(_text);
 
-        r = open_mmap(database, &fd, &st, &p);
-        if (r < 0)
-                return r;
+        /* Like catalog_get(), but keeps the database mapped in *map between calls, as long as the file is not
+         * replaced or modified. Callers looking up the catalog entries of many journal entries hence don't pay for
+         * opening and mapping the database each time. */
+
+        if (stat(database, &st) < 0)
+                return -errno;
+
+        if (!*map ||
+            (*map)->st.st_dev != st.st_dev ||
+            (*map)->st.st_ino != st.st_ino ||
+            (*map)->st.st_size != st.st_size ||
+            timespec_load_nsec(&(*map)->st.st_mtim) != timespec_load_nsec(&st.st_mtim)) {
+                _cleanup_close_ int fd = -1;
+                CatalogMap *m;
+
+                m = new0(CatalogMap, 1);
+                if (!m)
+                        return -ENOMEM;
 
-        s = find_id(p, id);
-        if (!s) {
-                r = -ENOENT;
-                goto finish;
+                r = open_mmap(database, &fd, &m->st, &m->p);
+                if (r < 0) {
+                        free(m);
+                        return r;
+                }
+
+                catalog_map_free(*map);
+                *map = m;
         }
 
+        s = find_id((*map)->p, id);
+        if (!s)
+                return -ENOENT;
+
         text = strdup(s);
-        if (!text) {
-                r = -ENOMEM;
-                goto finish;
-        }
+        if (!text)
+                return -ENOMEM;
 
         *_text = text;
-        r = 0;
+        return 0;
+}
 
-finish:
-        if (p)
-                munmap(p, st.st_size);
+int catalog_get(const char* database, sd_id128_t id, char **_text) {
+        _cleanup_(catalog_map_freep) CatalogMap *m = NULL;
 
-        return r;
+        return catalog_get_mapped(&m, database, id, _text);
 }
 
 static char *find_header(const char *s, const char *header) {
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <sys/stat.h>
 
 #include "sd-id128.h"
 
@@ -11,6 +12,15 @@
 int catalog_import_file(Hashmap *h, const char *path);
 int catalog_update(const char* database, const char* root, const char* const* dirs);
 int catalog_get(const char* database, sd_id128_t id, char **data);
+
+typedef struct CatalogMap {
+        struct stat st;
+        void *p;
+} CatalogMap;
+
+CatalogMap* catalog_map_free(CatalogMap *m);
+DEFINE_TRIVIAL_CLEANUP_FUNC(CatalogMap*, catalog_map_free);
+int catalog_get_mapped(CatalogMap **map, const char *database, sd_id128_t id, char **data);
 int catalog_list(FILE *f, const char* database, bool oneline);
 int catalog_list_items(FILE *f, const char* database, bool oneline, char **items);
 int catalog_file_lang(const char *filename, char **lang);
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -15,6 +16,11 @@
 #include <lz4frame.h>
 #endif
 
+#if HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
 #include "alloc-util.h"
 #include "compress.h"
 #include "fd-util.h"
@@ -31,11 +37,71 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(LZ4F_compressionContext_t, LZ4F_freeCompressionConte
 DEFINE_TRIVIAL_CLEANUP_FUNC(LZ4F_decompressionContext_t, LZ4F_freeDecompressionContext);
 #endif
 
+#if HAVE_ZSTD
+static pthread_key_t zstd_dctx_key;
+static pthread_once_t zstd_dctx_once = PTHREAD_ONCE_INIT;
+static int zstd_dctx_key_error = 0;
+
+static void zstd_dctx_free(void *p) {
+        ZSTD_freeDCtx(p);
+}
+
+static void zstd_dctx_key_create(void) {
+        zstd_dctx_key_error = pthread_key_create(&zstd_dctx_key, zstd_dctx_free);
+}
+
+static ZSTD_DCtx *zstd_dctx_get(void) {
+        ZSTD_DCtx *dctx;
+        size_t k;
+
+        /* Data objects are small, and setting up a decompression context costs more than decompressing
+         * most of them. Hence keep one context per thread around and reuse it, it is released when the
+         * thread exits. */
+
+        if (pthread_once(&zstd_dctx_once, zstd_dctx_key_create) != 0 || zstd_dctx_key_error != 0)
+                return NULL;
+
+        dctx = pthread_getspecific(zstd_dctx_key);
+        if (dctx) {
+                /* Forget about whatever the previous, possibly failed, use left behind */
+                k = ZSTD_initDStream(dctx);
+                if (!ZSTD_isError(k))
+                        return dctx;
+
+                ZSTD_freeDCtx(dctx);
+                (void) pthread_setspecific(zstd_dctx_key, NULL);
+        }
+
+        dctx = ZSTD_createDCtx();
+        if (!dctx)
+                return NULL;
+
+        if (pthread_setspecific(zstd_dctx_key, dctx) != 0) {
+                ZSTD_freeDCtx(dctx);
+                return NULL;
+        }
+
+        return dctx;
+}
+
+static int zstd_ret_to_errno(size_t ret) {
+        switch (ZSTD_getErrorCode(ret)) {
+        case ZSTD_error_dstSize_tooSmall:
+                return -ENOBUFS;
+        case ZSTD_error_memory_allocation:
+                return -ENOMEM;
+        default:
+                return -EBADMSG;
+        }
+}
+#endif
+
 #define ALIGN_8(l) ALIGN_TO(l, sizeof(size_t))
 
 static const char* const object_compressed_table[_OBJECT_COMPRESSED_MAX] = {
         [OBJECT_COMPRESSED_XZ] = "XZ",
         [OBJECT_COMPRESSED_LZ4] = "LZ4",
+        [OBJECT_COMPRESSED_ZSTD] = "ZSTD",
 };
 
 DEFINE_STRING_TABLE_LOOKUP(object_compressed, int);
@@ -108,6 +174,35 @@ int compress_blob_lz4(const void *src, uint64_t src_size,
 #endif
 }
 
+int compress_blob_zstd(const void *src, uint64_t src_size,
+                       void *dst, size_t dst_alloc_size, size_t *dst_size) {
+#if HAVE_ZSTD
+        size_t k;
+
+        assert(src);
+        assert(src_size > 0);
+        assert(dst);
+        assert(dst_alloc_size > 0);
+        assert(dst_size);
+
+        /* Returns < 0 if we couldn't compress the data or the
+         * compressed result is longer than the original. The frame
+         * header records the uncompressed size, hence we don't need
+         * to prefix it ourselves like we do for LZ4. Each object is a
+         * self-contained frame, no dictionary is used, so that any
+         * object can be decoded on its own. */
+
+        k = ZSTD_compress(dst, dst_alloc_size, src, src_size, 0);
+        if (ZSTD_isError(k))
+                return zstd_ret_to_errno(k);
+
+        *dst_size = k;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
 int decompress_blob_xz(const void *src, uint64_t src_size,
                        void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
 
@@ -208,6 +303,63 @@ int decompress_blob_lz4(const void *src, uint64_t src_size,
 #endif
 }
 
+int decompress_blob_zstd(const void *src, uint64_t src_size,
+                         void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
+
+#if HAVE_ZSTD
+        ZSTD_DCtx *dctx;
+        ZSTD_inBuffer input;
+        ZSTD_outBuffer output;
+        unsigned long long size;
+        size_t k;
+
+        assert(src);
+        assert(src_size > 0);
+        assert(dst);
+        assert(dst_alloc_size);
+        assert(dst_size);
+        assert(*dst_alloc_size == 0 || *dst);
+
+        size = ZSTD_getFrameContentSize(src, src_size);
+        if (IN_SET(size, ZSTD_CONTENTSIZE_ERROR, ZSTD_CONTENTSIZE_UNKNOWN))
+                return -EBADMSG;
+
+        if (dst_max > 0 && size > dst_max)
+                size = dst_max;
+        if (size > SIZE_MAX)
+                return -E2BIG;
+
+        if (!greedy_realloc(dst, dst_alloc_size, MAX(ZSTD_DStreamOutSize(), size), 1))
+                return -ENOMEM;
+
+        dctx = zstd_dctx_get();
+        if (!dctx)
+                return -ENOMEM;
+
+        input = (ZSTD_inBuffer) {
+                .src = src,
+                .size = src_size,
+        };
+        output = (ZSTD_outBuffer) {
+                .dst = *dst,
+                .size = *dst_alloc_size,
+        };
+
+        k = ZSTD_decompressStream(dctx, &output, &input);
+        if (ZSTD_isError(k)) {
+                log_debug("ZSTD decoder failed: %s", ZSTD_getErrorName(k));
+                return zstd_ret_to_errno(k);
+        }
+        if (output.pos < size)
+                return -EBADMSG;
+
+        *dst_size = size;
+        return 0;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
 int decompress_blob(int compression,
                     const void *src, uint64_t src_size,
                     void **dst, size_t *dst_alloc_size, size_t* dst_size, size_t dst_max) {
@@ -217,6 +369,9 @@ int decompress_blob(int compression,
         else if (compression == OBJECT_COMPRESSED_LZ4)
                 return decompress_blob_lz4(src, src_size,
                                            dst, dst_alloc_size, dst_size, dst_max);
+        else if (compression == OBJECT_COMPRESSED_ZSTD)
+                return decompress_blob_zstd(src, src_size,
+                                            dst, dst_alloc_size, dst_size, dst_max);
         else
                 return -EBADMSG;
 }
@@ -342,6 +497,66 @@ int decompress_startswith_lz4(const void *src, uint64_t src_size,
 #endif
 }
 
+int decompress_startswith_zstd(const void *src, uint64_t src_size,
+                               void **buffer, size_t *buffer_size,
+                               const void *prefix, size_t prefix_len,
+                               uint8_t extra) {
+#if HAVE_ZSTD
+        ZSTD_DCtx *dctx;
+        ZSTD_inBuffer input;
+        ZSTD_outBuffer output;
+        unsigned long long size;
+        size_t k;
+
+        /* Checks whether the decompressed blob starts with the
+         * mentioned prefix. The byte extra needs to follow the
+         * prefix */
+
+        assert(src);
+        assert(src_size > 0);
+        assert(buffer);
+        assert(buffer_size);
+        assert(prefix);
+        assert(*buffer_size == 0 || *buffer);
+
+        size = ZSTD_getFrameContentSize(src, src_size);
+        if (IN_SET(size, ZSTD_CONTENTSIZE_ERROR, ZSTD_CONTENTSIZE_UNKNOWN))
+                return -EBADMSG;
+
+        if (size < prefix_len + 1)
+                return 0; /* Decompressed text too short to match the prefix and extra */
+
+        if (!(greedy_realloc(buffer, buffer_size, MAX(ZSTD_DStreamOutSize(), prefix_len + 1), 1)))
+                return -ENOMEM;
+
+        dctx = zstd_dctx_get();
+        if (!dctx)
+                return -ENOMEM;
+
+        input = (ZSTD_inBuffer) {
+                .src = src,
+                .size = src_size,
+        };
+        output = (ZSTD_outBuffer) {
+                .dst = *buffer,
+                .size = *buffer_size,
+        };
+
+        k = ZSTD_decompressStream(dctx, &output, &input);
+        if (ZSTD_isError(k)) {
+                log_debug("ZSTD decoder failed: %s", ZSTD_getErrorName(k));
+                return zstd_ret_to_errno(k);
+        }
+        if (output.pos < prefix_len + 1)
+                return -EBADMSG;
+
+        return memcmp(*buffer, prefix, prefix_len) == 0 &&
+                ((const uint8_t*) *buffer)[prefix_len] == extra;
+#else
+        return -EPROTONOSUPPORT;
+#endif
+}
+
 int decompress_startswith(int compression,
                           const void *src, uint64_t src_size,
                           void **buffer, size_t *buffer_size,
@@ -357,6 +572,11 @@ int decompress_startswith(int compression,
                                                  buffer, buffer_size,
                                                  prefix, prefix_len,
                                                  extra);
+        else if (compression == OBJECT_COMPRESSED_ZSTD)
+                return decompress_startswith_zstd(src, src_size,
+                                                  buffer, buffer_size,
+                                                  prefix, prefix_len,
+                                                  extra);
         else
                 return -EBADMSG;
 }
@@ -266,6 +266,11 @@ int journal_file_hmac_put_object(JournalFile *f, ObjectType type, Object *o, uin
                 gcry_md_write(f->hmac, &o->tag.seqnum, sizeof(o->tag.seqnum));
                 gcry_md_write(f->hmac, &o->tag.epoch, sizeof(o->tag.epoch));
                 break;
+
+        case OBJECT_BLOOM_FILTER:
+                /* All */
+                gcry_md_write(f->hmac, &o->bloom_filter.n_functions, le64toh(o->object.size) - offsetof(BloomFilterObject, n_functions));
+                break;
         default:
                 return -EINVAL;
         }
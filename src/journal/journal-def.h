@@ -23,6 +23,7 @@ typedef struct EntryObject EntryObject;
 typedef struct HashTableObject HashTableObject;
 typedef struct EntryArrayObject EntryArrayObject;
 typedef struct TagObject TagObject;
+typedef struct BloomFilterObject BloomFilterObject;
 
 typedef struct EntryItem EntryItem;
 typedef struct HashItem HashItem;
@@ -39,6 +40,7 @@ typedef enum ObjectType {
         OBJECT_FIELD_HASH_TABLE,
         OBJECT_ENTRY_ARRAY,
         OBJECT_TAG,
+        OBJECT_BLOOM_FILTER,
         _OBJECT_TYPE_MAX
 } ObjectType;
 
@@ -46,10 +48,11 @@ typedef enum ObjectType {
 enum {
         OBJECT_COMPRESSED_XZ = 1 << 0,
         OBJECT_COMPRESSED_LZ4 = 1 << 1,
+        OBJECT_COMPRESSED_ZSTD = 1 << 2,
         _OBJECT_COMPRESSED_MAX
 };
 
-#define OBJECT_COMPRESSION_MASK (OBJECT_COMPRESSED_XZ | OBJECT_COMPRESSED_LZ4)
+#define OBJECT_COMPRESSION_MASK (OBJECT_COMPRESSED_XZ | OBJECT_COMPRESSED_LZ4 | OBJECT_COMPRESSED_ZSTD)
 
 struct ObjectHeader {
         uint8_t type;
@@ -83,6 +86,9 @@ struct EntryItem {
         le64_t hash;
 } _packed_;
 
+/* In files with the HEADER_INCOMPATIBLE_COMPACT flag entry items and entry array items are stored as 32bit
+ * offsets, and entry items do not carry a copy of the data object hash. Such files may not grow beyond
+ * 4 GiB. */
 struct EntryObject {
         ObjectHeader object;
         le64_t seqnum;
@@ -90,7 +96,12 @@ struct EntryObject {
         le64_t monotonic;
         sd_id128_t boot_id;
         le64_t xor_hash;
-        EntryItem items[];
+        union {
+                EntryItem regular[0];
+                struct {
+                        le32_t object_offset;
+                } _packed_ compact[0];
+        } _packed_ items;
 } _packed_;
 
 struct HashItem {
@@ -106,7 +117,10 @@ struct HashTableObject {
 struct EntryArrayObject {
         ObjectHeader object;
         le64_t next_entry_array_offset;
-        le64_t items[];
+        union {
+                le64_t regular[0];
+                le32_t compact[0];
+        } _packed_ items;
 } _packed_;
 
 #define TAG_LENGTH (256/8)
@@ -118,6 +132,18 @@ struct TagObject {
         uint8_t tag[TAG_LENGTH]; /* SHA-256 HMAC */
 } _packed_;
 
+/* A blocked bloom filter over the hashes of all data objects of the file, written when the file is
+ * archived. Files that contain such an object carry the HEADER_INCOMPATIBLE_BLOOM_FILTER flag. The upper 32 bits of a data object hash select one of the BLOOM_FILTER_BLOCK_SIZE sized blocks
+ * of the filter, the lower 32 bits select the n_functions bits set in that block, so that a lookup only
+ * touches a single block. */
+#define BLOOM_FILTER_BLOCK_SIZE 64
+
+struct BloomFilterObject {
+        ObjectHeader object;
+        le64_t n_functions;
+        uint8_t bits[];
+} _packed_;
+
 union Object {
         ObjectHeader object;
         DataObject data;
@@ -126,6 +152,7 @@ union Object {
         HashTableObject hash_table;
         EntryArrayObject entry_array;
         TagObject tag;
+        BloomFilterObject bloom_filter;
 };
 
 enum {
@@ -139,19 +166,27 @@ enum {
 enum {
         HEADER_INCOMPATIBLE_COMPRESSED_XZ = 1 << 0,
         HEADER_INCOMPATIBLE_COMPRESSED_LZ4 = 1 << 1,
+        HEADER_INCOMPATIBLE_COMPRESSED_ZSTD = 1 << 2,
+        HEADER_INCOMPATIBLE_KEYED_HASH = 1 << 3,
+        HEADER_INCOMPATIBLE_COMPACT = 1 << 4,
+        HEADER_INCOMPATIBLE_BLOOM_FILTER = 1 << 5,
 };
 
-#define HEADER_INCOMPATIBLE_ANY (HEADER_INCOMPATIBLE_COMPRESSED_XZ|HEADER_INCOMPATIBLE_COMPRESSED_LZ4)
-
-#if HAVE_XZ && HAVE_LZ4
-#  define HEADER_INCOMPATIBLE_SUPPORTED HEADER_INCOMPATIBLE_ANY
-#elif HAVE_XZ
-#  define HEADER_INCOMPATIBLE_SUPPORTED HEADER_INCOMPATIBLE_COMPRESSED_XZ
-#elif HAVE_LZ4
-#  define HEADER_INCOMPATIBLE_SUPPORTED HEADER_INCOMPATIBLE_COMPRESSED_LZ4
-#else
-#  define HEADER_INCOMPATIBLE_SUPPORTED 0
-#endif
+#define HEADER_INCOMPATIBLE_ANY                 \
+        (HEADER_INCOMPATIBLE_COMPRESSED_XZ |    \
+         HEADER_INCOMPATIBLE_COMPRESSED_LZ4 |   \
+         HEADER_INCOMPATIBLE_COMPRESSED_ZSTD |  \
+         HEADER_INCOMPATIBLE_KEYED_HASH |       \
+         HEADER_INCOMPATIBLE_COMPACT |          \
+         HEADER_INCOMPATIBLE_BLOOM_FILTER)
+
+#define HEADER_INCOMPATIBLE_SUPPORTED                                   \
+        ((HAVE_XZ ? HEADER_INCOMPATIBLE_COMPRESSED_XZ : 0) |            \
+         (HAVE_LZ4 ? HEADER_INCOMPATIBLE_COMPRESSED_LZ4 : 0) |          \
+         (HAVE_ZSTD ? HEADER_INCOMPATIBLE_COMPRESSED_ZSTD : 0) |        \
+         HEADER_INCOMPATIBLE_KEYED_HASH |                               \
+         HEADER_INCOMPATIBLE_COMPACT |                                  \
+         HEADER_INCOMPATIBLE_BLOOM_FILTER)
 
 enum {
         HEADER_COMPATIBLE_SEALED = 1
@@ -197,8 +232,10 @@ struct Header {
         /* Added in 189 */
         le64_t n_tags;
         le64_t n_entry_arrays;
+        /* Added in 240 */
+        le64_t bloom_filter_offset;
 
-        /* Size: 240 */
+        /* Size: 248 */
 } _packed_;
 
 #define FSS_HEADER_SIGNATURE ((char[]) { 'K', 'S', 'H', 'H', 'R', 'H', 'L', 'P' })
@@ -5,6 +5,7 @@
 #include <linux/fs.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/statvfs.h>
 #include <sys/uio.h>
@@ -14,7 +15,10 @@
 #include "btrfs-util.h"
 #include "chattr-util.h"
 #include "compress.h"
+#include "copy.h"
+#include "env-util.h"
 #include "fd-util.h"
+#include "fileio.h"
 #include "fs-util.h"
 #include "journal-authenticate.h"
 #include "journal-def.h"
@@ -25,6 +29,7 @@
 #include "random-util.h"
 #include "sd-event.h"
 #include "set.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
@@ -67,8 +72,31 @@
 /* How many entries to keep in the entry array chain cache at max */
 #define CHAIN_CACHE_MAX 20
 
-/* How much to increase the journal file size at once each time we allocate something new. */
+/* How many entry array chains to keep a skip index for at max */
+#define CHAIN_INDEX_MAX 64
+
+/* How many entry array chains to remember the tail of when appending at max */
+#define CHAIN_TAILS_MAX 4096
+
+/* How many recently appended data objects to remember at max */
+#define DATA_CACHE_MAX 1024
+
+/* How many data objects copied from this file into another one to remember the new location of at max */
+#define COPY_OFFSETS_MAX (64U*1024U)
+
+/* The bloom filter parameters, for a false positive rate of about 1% */
+#define BLOOM_FILTER_BITS_PER_ITEM 10
+#define BLOOM_FILTER_N_FUNCTIONS 7
+
+/* How much to increase the journal file size at once each time we allocate something new. If the file
+ * needs to grow again within FILE_SIZE_INCREASE_FAST_USEC the increment is doubled, up to
+ * FILE_SIZE_INCREASE_MAX, and it drops back to the minimum once the file grows slower again. */
 #define FILE_SIZE_INCREASE (8ULL*1024ULL*1024ULL)              /* 8MB */
+#define FILE_SIZE_INCREASE_MAX (64ULL*1024ULL*1024ULL)         /* 64MB */
+#define FILE_SIZE_INCREASE_FAST_USEC (10*USEC_PER_SEC)
+
+/* On tmpfs every allocated byte is memory, hence grow files there in much smaller steps */
+#define FILE_SIZE_INCREASE_TMPFS (1024ULL*1024ULL)             /* 1MB */
 
 /* Reread fstat() of the file for detecting deletions at least this often */
 #define LAST_STAT_REFRESH_USEC (5*USEC_PER_SEC)
@@ -334,6 +362,27 @@ bool journal_file_is_offlining(JournalFile *f) {
         return true;
 }
 
+typedef struct ChainIndexItem {
+        uint64_t array; /* the array */
+        uint64_t begin; /* the first item in the array */
+        uint64_t total; /* the total number of items in all arrays before this one in the chain */
+        uint64_t size;  /* the number of items in the array */
+} ChainIndexItem;
+
+typedef struct ChainIndex {
+        uint64_t first; /* the array at the beginning of the chain */
+        ChainIndexItem *items;
+        size_t n_items, n_allocated;
+} ChainIndex;
+
+static ChainIndex* chain_index_free(ChainIndex *ci) {
+        if (!ci)
+                return NULL;
+
+        free(ci->items);
+        return mfree(ci);
+}
+
 JournalFile* journal_file_close(JournalFile *f) {
         assert(f);
 
@@ -380,8 +429,12 @@ JournalFile* journal_file_close(JournalFile *f) {
         mmap_cache_unref(f->mmap);
 
         ordered_hashmap_free_free(f->chain_cache);
+        ordered_hashmap_free_with_destructor(f->chain_index, chain_index_free);
+        ordered_hashmap_free_free(f->chain_tails);
+        ordered_hashmap_free_free(f->data_cache);
+        hashmap_free_free(f->copy_offsets);
 
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
         free(f->compress_buffer);
 #endif
 
@@ -412,7 +465,10 @@ static int journal_file_init_header(JournalFile *f, JournalFile *template) {
 
         h.incompatible_flags |= htole32(
                 f->compress_xz * HEADER_INCOMPATIBLE_COMPRESSED_XZ |
-                f->compress_lz4 * HEADER_INCOMPATIBLE_COMPRESSED_LZ4);
+                f->compress_lz4 * HEADER_INCOMPATIBLE_COMPRESSED_LZ4 |
+                f->compress_zstd * HEADER_INCOMPATIBLE_COMPRESSED_ZSTD |
+                f->keyed_hash * HEADER_INCOMPATIBLE_KEYED_HASH |
+                f->compact * HEADER_INCOMPATIBLE_COMPACT);
 
         h.compatible_flags = htole32(
                 f->seal * HEADER_COMPATIBLE_SEALED);
@@ -482,7 +538,7 @@ static bool warn_wrong_flags(const JournalFile *f, bool compatible) {
                                   f->path, type, flags & ~any);
                 flags = (flags & any) & ~supported;
                 if (flags) {
-                        const char* strv[3];
+                        const char* strv[7];
                         unsigned n = 0;
                         _cleanup_free_ char *t = NULL;
 
@@ -492,6 +548,14 @@ static bool warn_wrong_flags(const JournalFile *f, bool compatible) {
                                 strv[n++] = "xz-compressed";
                         if (!compatible && (flags & HEADER_INCOMPATIBLE_COMPRESSED_LZ4))
                                 strv[n++] = "lz4-compressed";
+                        if (!compatible && (flags & HEADER_INCOMPATIBLE_COMPRESSED_ZSTD))
+                                strv[n++] = "zstd-compressed";
+                        if (!compatible && (flags & HEADER_INCOMPATIBLE_KEYED_HASH))
+                                strv[n++] = "keyed-hash";
+                        if (!compatible && (flags & HEADER_INCOMPATIBLE_COMPACT))
+                                strv[n++] = "compact";
+                        if (!compatible && (flags & HEADER_INCOMPATIBLE_BLOOM_FILTER))
+                                strv[n++] = "bloom-filter";
                         strv[n] = NULL;
                         assert(n < ELEMENTSOF(strv));
 
@@ -540,6 +604,9 @@ static int journal_file_verify_header(JournalFile *f) {
         if (UINT64_MAX - header_size < arena_size || header_size + arena_size > (uint64_t) f->last_stat.st_size)
                 return -ENODATA;
 
+        if (JOURNAL_HEADER_COMPACT(f->header) && header_size + arena_size > JOURNAL_COMPACT_SIZE_MAX)
+                return -EBADMSG;
+
         if (le64toh(f->header->tail_object_offset) > header_size + arena_size)
                 return -ENODATA;
 
@@ -549,6 +616,15 @@ static int journal_file_verify_header(JournalFile *f) {
             !VALID64(le64toh(f->header->entry_array_offset)))
                 return -ENODATA;
 
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            !VALID64(le64toh(f->header->bloom_filter_offset)))
+                return -ENODATA;
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            le64toh(f->header->bloom_filter_offset) != 0 &&
+            !JOURNAL_HEADER_BLOOM_FILTER(f->header))
+                return -EBADMSG;
+
         if (f->writable) {
                 sd_id128_t machine_id;
                 uint8_t state;
@@ -587,6 +663,9 @@ static int journal_file_verify_header(JournalFile *f) {
 
         f->compress_xz = JOURNAL_HEADER_COMPRESSED_XZ(f->header);
         f->compress_lz4 = JOURNAL_HEADER_COMPRESSED_LZ4(f->header);
+        f->compress_zstd = JOURNAL_HEADER_COMPRESSED_ZSTD(f->header);
+        f->keyed_hash = JOURNAL_HEADER_KEYED_HASH(f->header);
+        f->compact = JOURNAL_HEADER_COMPACT(f->header);
 
         f->seal = JOURNAL_HEADER_SEALED(f->header);
 
@@ -616,8 +695,28 @@ static int journal_file_fstat(JournalFile *f) {
         return 0;
 }
 
+static uint64_t journal_file_next_size_increase(JournalFile *f, usec_t n) {
+        assert(f);
+
+        if (f->on_tmpfs)
+                return FILE_SIZE_INCREASE_TMPFS;
+
+        /* Under a high write rate the file grows every few seconds, and each posix_fallocate() (and the
+         * remapping that follows) shows up as a latency spike. Hence grow in larger steps while that's the
+         * case, but don't keep more space preallocated than necessary for files that are written slowly. */
+        if (f->allocation_increase > 0 &&
+            f->last_allocation_usec > 0 &&
+            n < f->last_allocation_usec + FILE_SIZE_INCREASE_FAST_USEC)
+                f->allocation_increase = MIN(f->allocation_increase * 2, FILE_SIZE_INCREASE_MAX);
+        else
+                f->allocation_increase = FILE_SIZE_INCREASE;
+
+        return f->allocation_increase;
+}
+
 static int journal_file_allocate(JournalFile *f, uint64_t offset, uint64_t size) {
-        uint64_t old_size, new_size;
+        uint64_t old_size, new_size, increase, rounded, available = UINT64_MAX;
+        usec_t n;
         int r;
 
         assert(f);
@@ -657,12 +756,14 @@ static int journal_file_allocate(JournalFile *f, uint64_t offset, uint64_t size)
         if (f->metrics.max_size > 0 && new_size > f->metrics.max_size)
                 return -E2BIG;
 
+        /* Refuse to go over 4G in compact mode so offsets can be stored in 32bit. */
+        if (JOURNAL_HEADER_COMPACT(f->header) && new_size > JOURNAL_COMPACT_SIZE_MAX)
+                return -E2BIG;
+
         if (new_size > f->metrics.min_size && f->metrics.keep_free > 0) {
                 struct statvfs svfs;
 
                 if (fstatvfs(f->fd, &svfs) >= 0) {
-                        uint64_t available;
-
                         available = LESS_BY((uint64_t) svfs.f_bfree * (uint64_t) svfs.f_bsize, f->metrics.keep_free);
 
                         if (new_size - old_size > available)
@@ -670,20 +771,34 @@ static int journal_file_allocate(JournalFile *f, uint64_t offset, uint64_t size)
                 }
         }
 
-        /* Increase by larger blocks at once */
-        new_size = DIV_ROUND_UP(new_size, FILE_SIZE_INCREASE) * FILE_SIZE_INCREASE;
+        n = now(CLOCK_MONOTONIC);
+
+        /* Increase by larger blocks at once, but don't let the rounding eat into keep_free */
+        increase = journal_file_next_size_increase(f, n);
+        rounded = DIV_ROUND_UP(new_size, increase) * increase;
+        if (rounded - old_size > available)
+                rounded = MAX(new_size, (old_size + available) / page_size() * page_size());
+        new_size = rounded;
         if (f->metrics.max_size > 0 && new_size > f->metrics.max_size)
                 new_size = f->metrics.max_size;
+        if (JOURNAL_HEADER_COMPACT(f->header) && new_size > JOURNAL_COMPACT_SIZE_MAX)
+                new_size = JOURNAL_COMPACT_SIZE_MAX;
 
         /* Note that the glibc fallocate() fallback is very
            inefficient, hence we try to minimize the allocation area
-           as we can. */
+           as we can. This is also needed on tmpfs, where extending
+           the file without allocating would turn a full file system
+           into SIGBUS for the writer, rather than an error here. */
         r = posix_fallocate(f->fd, old_size, new_size - old_size);
         if (r != 0)
                 return -r;
 
         f->header->arena_size = htole64(new_size - le64toh(f->header->header_size));
 
+        f->last_allocation_usec = n;
+        f->n_allocations++;
+        f->allocation_usec += now(CLOCK_MONOTONIC) - n;
+
         return journal_file_fstat(f);
 }
 
@@ -729,6 +844,7 @@ static uint64_t minimum_header_size(Object *o) {
                 [OBJECT_FIELD_HASH_TABLE] = sizeof(HashTableObject),
                 [OBJECT_ENTRY_ARRAY] = sizeof(EntryArrayObject),
                 [OBJECT_TAG] = sizeof(TagObject),
+                [OBJECT_BLOOM_FILTER] = sizeof(BloomFilterObject),
         };
 
         if (o->object.type >= ELEMENTSOF(table) || table[o->object.type] <= 0)
@@ -800,7 +916,7 @@ static int journal_file_check_object(JournalFile *f, uint64_t offset, Object *o)
                 break;
 
         case OBJECT_ENTRY:
-                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) % sizeof(EntryItem) != 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) % journal_file_entry_item_size(f) != 0) {
                         log_debug(
                               "Bad entry size (<= %zu): %"PRIu64": %"PRIu64,
                               offsetof(EntryObject, items),
@@ -809,10 +925,10 @@ static int journal_file_check_object(JournalFile *f, uint64_t offset, Object *o)
                         return -EBADMSG;
                 }
 
-                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) / sizeof(EntryItem) <= 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) / journal_file_entry_item_size(f) <= 0) {
                         log_debug(
                               "Invalid number items in entry: %"PRIu64": %"PRIu64,
-                              (le64toh(o->object.size) - offsetof(EntryObject, items)) / sizeof(EntryItem),
+                              (le64toh(o->object.size) - offsetof(EntryObject, items)) / journal_file_entry_item_size(f),
                               offset);
                         return -EBADMSG;
                 }
@@ -858,8 +974,8 @@ static int journal_file_check_object(JournalFile *f, uint64_t offset, Object *o)
                 break;
 
         case OBJECT_ENTRY_ARRAY:
-                if ((le64toh(o->object.size) - offsetof(EntryArrayObject, items)) % sizeof(le64_t) != 0 ||
-                    (le64toh(o->object.size) - offsetof(EntryArrayObject, items)) / sizeof(le64_t) <= 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryArrayObject, items)) % journal_file_entry_array_item_size(f) != 0 ||
+                    (le64toh(o->object.size) - offsetof(EntryArrayObject, items)) / journal_file_entry_array_item_size(f) <= 0) {
                         log_debug(
                               "Invalid object entry array size: %"PRIu64": %"PRIu64,
                               le64toh(o->object.size),
@@ -894,6 +1010,32 @@ static int journal_file_check_object(JournalFile *f, uint64_t offset, Object *o)
                         return -EBADMSG;
                 }
 
+                break;
+
+        case OBJECT_BLOOM_FILTER:
+                if (!JOURNAL_HEADER_BLOOM_FILTER(f->header)) {
+                        log_debug("Bloom filter object in file without bloom filter flag: %"PRIu64, offset);
+                        return -EBADMSG;
+                }
+
+                if ((le64toh(o->object.size) - offsetof(BloomFilterObject, bits)) % BLOOM_FILTER_BLOCK_SIZE != 0 ||
+                    (le64toh(o->object.size) - offsetof(BloomFilterObject, bits)) / BLOOM_FILTER_BLOCK_SIZE <= 0) {
+                        log_debug(
+                              "Invalid object bloom filter size: %"PRIu64": %"PRIu64,
+                              le64toh(o->object.size),
+                              offset);
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->bloom_filter.n_functions) <= 0 ||
+                    le64toh(o->bloom_filter.n_functions) > BLOOM_FILTER_BLOCK_SIZE * 8) {
+                        log_debug(
+                              "Invalid object bloom filter number of functions: %"PRIu64": %"PRIu64,
+                              le64toh(o->bloom_filter.n_functions),
+                              offset);
+                        return -EBADMSG;
+                }
+
                 break;
         }
 
@@ -996,9 +1138,17 @@ static uint64_t journal_file_entry_seqnum(JournalFile *f, uint64_t *seqnum) {
         return r;
 }
 
+static uint64_t bloom_filter_object_size(uint64_t n_data) {
+        uint64_t n_blocks;
+
+        n_blocks = DIV_ROUND_UP(n_data * BLOOM_FILTER_BITS_PER_ITEM, BLOOM_FILTER_BLOCK_SIZE * 8);
+
+        return offsetof(Object, bloom_filter.bits) + n_blocks * BLOOM_FILTER_BLOCK_SIZE;
+}
+
 int journal_file_append_object(JournalFile *f, ObjectType type, uint64_t size, Object **ret, uint64_t *offset) {
         int r;
-        uint64_t p;
+        uint64_t p, reserve = 0;
         Object *tail, *o;
         void *t;
 
@@ -1024,7 +1174,12 @@ int journal_file_append_object(JournalFile *f, ObjectType type, uint64_t size, O
                 p += ALIGN64(le64toh(tail->object.size));
         }
 
-        r = journal_file_allocate(f, p, size);
+        /* The bloom filter is written when the file is archived, which most often happens because the file
+         * reached its size limit. Hence keep room for it, growing with every data object. */
+        if (type != OBJECT_BLOOM_FILTER && JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                reserve = ALIGN64(bloom_filter_object_size(le64toh(f->header->n_data) + (type == OBJECT_DATA)));
+
+        r = journal_file_allocate(f, p, size + reserve);
         if (r < 0)
                 return r;
 
@@ -1160,6 +1315,20 @@ int journal_file_map_field_hash_table(JournalFile *f) {
         return 0;
 }
 
+uint64_t journal_file_hash_data(JournalFile *f, const void *data, size_t sz) {
+        assert(f);
+        assert(f->header);
+
+        /* Files with the keyed hash flag use siphash keyed with the file ID, so that the hash table chains
+         * cannot be flooded with crafted collisions and long payloads are hashed faster. Classic files use
+         * the Jenkins hash. */
+
+        if (JOURNAL_HEADER_KEYED_HASH(f->header))
+                return siphash24(data, sz, f->header->file_id.bytes);
+
+        return jenkins_hash64(data, sz);
+}
+
 static int journal_file_link_field(
                 JournalFile *f,
                 Object *o,
@@ -1253,6 +1422,10 @@ static int journal_file_link_data(
         if (JOURNAL_HEADER_CONTAINS(f->header, n_data))
                 f->header->n_data = htole64(le64toh(f->header->n_data) + 1);
 
+        /* The bloom filter only covers the data objects that existed when it was written */
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                f->header->bloom_filter_offset = 0;
+
         return 0;
 }
 
@@ -1321,13 +1494,69 @@ int journal_file_find_field_object(
         assert(f);
         assert(field && size > 0);
 
-        hash = hash64(field, size);
+        hash = journal_file_hash_data(f, field, size);
 
         return journal_file_find_field_object_with_hash(f,
                                                         field, size, hash,
                                                         ret, offset);
 }
 
+static uint64_t bloom_filter_bit(uint64_t hash, uint64_t n_blocks, uint64_t i) {
+        uint32_t a = (uint32_t) hash, b = (uint32_t) (hash >> 32);
+
+        /* Returns the i-th bit to set for the specified hash. The upper half of the hash selects the block,
+         * the lower half the bits in it, using double hashing with an odd step so that all bits differ. */
+
+        return (b % n_blocks) * BLOOM_FILTER_BLOCK_SIZE * 8 +
+                (a + i * ((a >> 9) | 1)) % (BLOOM_FILTER_BLOCK_SIZE * 8);
+}
+
+static void bloom_filter_add(uint8_t *bits, uint64_t n_blocks, uint64_t n_functions, uint64_t hash) {
+        uint64_t i;
+
+        for (i = 0; i < n_functions; i++) {
+                uint64_t b = bloom_filter_bit(hash, n_blocks, i);
+
+                bits[b / 8] |= 1U << (b % 8);
+        }
+}
+
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash) {
+        uint64_t p, n_blocks, n_functions, i;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Returns 0 if the file definitely contains no data object with the specified hash, and > 0 if it
+         * might. Files without a bloom filter might contain anything. */
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) ||
+            !JOURNAL_HEADER_BLOOM_FILTER(f->header))
+                return 1;
+
+        p = le64toh(f->header->bloom_filter_offset);
+        if (p == 0)
+                return 1;
+
+        r = journal_file_move_to_object(f, OBJECT_BLOOM_FILTER, p, &o);
+        if (r < 0)
+                return r;
+
+        n_blocks = (le64toh(o->object.size) - offsetof(BloomFilterObject, bits)) / BLOOM_FILTER_BLOCK_SIZE;
+        n_functions = le64toh(o->bloom_filter.n_functions);
+
+        for (i = 0; i < n_functions; i++) {
+                uint64_t b = bloom_filter_bit(hash, n_blocks, i);
+
+                if (!(o->bloom_filter.bits[b / 8] & (1U << (b % 8))))
+                        return 0;
+        }
+
+        return 1;
+}
+
 int journal_file_find_data_object_with_hash(
                 JournalFile *f,
                 const void *data, uint64_t size, uint64_t hash,
@@ -1344,6 +1573,11 @@ int journal_file_find_data_object_with_hash(
         if (le64toh(f->header->data_hash_table_size) <= 0)
                 return 0;
 
+        /* If the bloom filter says the data isn't there, we don't need to look at the hash table at all. */
+        r = journal_file_bloom_filter_test(f, hash);
+        if (r <= 0)
+                return r;
+
         /* Map the data hash table, if it isn't mapped yet. */
         r = journal_file_map_data_hash_table(f);
         if (r < 0)
@@ -1369,7 +1603,7 @@ int journal_file_find_data_object_with_hash(
                         goto next;
 
                 if (o->object.flags & OBJECT_COMPRESSION_MASK) {
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
                         uint64_t l;
                         size_t rsize = 0;
 
@@ -1427,7 +1661,7 @@ int journal_file_find_data_object(
         assert(f);
         assert(data || size == 0);
 
-        hash = hash64(data, size);
+        hash = journal_file_hash_data(f, data, size);
 
         return journal_file_find_data_object_with_hash(f,
                                                        data, size, hash,
@@ -1447,7 +1681,7 @@ static int journal_file_append_field(
         assert(f);
         assert(field && size > 0);
 
-        hash = hash64(field, size);
+        hash = journal_file_hash_data(f, field, size);
 
         r = journal_file_find_field_object_with_hash(f, field, size, hash, &o, &p);
         if (r < 0)
@@ -1496,12 +1730,116 @@ static int journal_file_append_field(
         return 0;
 }
 
+typedef struct DataCacheItem {
+        uint64_t hash;
+        uint64_t size;
+        uint64_t offset;
+        uint64_t xor_hash; /* the contribution to the entry's XOR hash, see journal_file_entry_xor_hash() */
+} DataCacheItem;
+
+static uint64_t journal_file_entry_xor_hash(JournalFile *f, const void *data, uint64_t size, uint64_t hash) {
+        assert(f);
+
+        /* The XOR hash identifies an entry across files (and ends up in cursors), hence it must not depend on
+         * the per-file key. For keyed files calculate the Jenkins hash separately, for classic files we can
+         * simply reuse the value stored in the data object. */
+        if (JOURNAL_HEADER_KEYED_HASH(f->header))
+                return jenkins_hash64(data, size);
+
+        return hash;
+}
+
+static int data_cache_find(
+                JournalFile *f,
+                const void *data, uint64_t size, uint64_t hash,
+                Object **ret, uint64_t *offset, uint64_t *ret_xor_hash) {
+
+        uint64_t p, xor_hash;
+        DataCacheItem *ci;
+        Object *o;
+        int r;
+
+        assert(f);
+
+        ci = ordered_hashmap_get(f->data_cache, &hash);
+        if (!ci || ci->size != size)
+                return 0;
+
+        p = ci->offset;
+        xor_hash = ci->xor_hash;
+
+        /* The hash is not good enough to identify the data, hence compare the payload too. We only ever
+         * remember uncompressed objects, so this doesn't need to look at anything but the object itself,
+         * instead of the hash table and the hash chain. */
+        r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+        if (r < 0)
+                return r;
+
+        if (le64toh(o->data.hash) != hash ||
+            (o->object.flags & OBJECT_COMPRESSION_MASK) ||
+            le64toh(o->object.size) != offsetof(Object, data.payload) + size ||
+            memcmp(o->data.payload, data, size) != 0)
+                return 0;
+
+        /* Move the item to the end, so that the least recently used one is evicted first. If that fails the
+         * item is gone, hence don't look at it anymore afterwards. */
+        assert_se(ordered_hashmap_remove(f->data_cache, &hash) == ci);
+        if (ordered_hashmap_put(f->data_cache, &ci->hash, ci) < 0)
+                free(ci);
+
+        if (ret)
+                *ret = o;
+        if (offset)
+                *offset = p;
+        if (ret_xor_hash)
+                *ret_xor_hash = xor_hash;
+
+        return 1;
+}
+
+static void data_cache_put(JournalFile *f, Object *o, uint64_t offset, uint64_t xor_hash) {
+        DataCacheItem *ci;
+        uint64_t hash;
+
+        assert(f);
+        assert(o);
+
+        if (o->object.flags & OBJECT_COMPRESSION_MASK)
+                return;
+
+        hash = le64toh(o->data.hash);
+
+        ci = ordered_hashmap_get(f->data_cache, &hash);
+        if (!ci) {
+                if (ordered_hashmap_ensure_allocated(&f->data_cache, &uint64_hash_ops) < 0)
+                        return;
+
+                if (ordered_hashmap_size(f->data_cache) >= DATA_CACHE_MAX)
+                        ci = ordered_hashmap_steal_first(f->data_cache);
+                else
+                        ci = new(DataCacheItem, 1);
+                if (!ci)
+                        return;
+
+                ci->hash = hash;
+
+                if (ordered_hashmap_put(f->data_cache, &ci->hash, ci) < 0) {
+                        free(ci);
+                        return;
+                }
+        }
+
+        ci->size = le64toh(o->object.size) - offsetof(Object, data.payload);
+        ci->offset = offset;
+        ci->xor_hash = xor_hash;
+}
+
 static int journal_file_append_data(
                 JournalFile *f,
                 const void *data, uint64_t size,
-                Object **ret, uint64_t *offset) {
+                Object **ret, uint64_t *offset, uint64_t *ret_xor_hash) {
 
-        uint64_t hash, p;
+        uint64_t hash, xor_hash, p;
         uint64_t osize;
         Object *o;
         int r, compression = 0;
@@ -1510,12 +1848,23 @@ static int journal_file_append_data(
         assert(f);
         assert(data || size == 0);
 
-        hash = hash64(data, size);
+        hash = journal_file_hash_data(f, data, size);
+
+        /* journald appends the same few values (_HOSTNAME=, _BOOT_ID=, _SYSTEMD_UNIT=, ...) over and over
+         * again, hence first check whether we appended this one recently. */
+        r = data_cache_find(f, data, size, hash, ret, offset, ret_xor_hash);
+        if (r != 0)
+                return r < 0 ? r : 0;
+
+        /* Not cached, hence calculate the XOR hash contribution once now, and remember it with the offset, so
+         * that keyed files don't need to hash the payload a second time for every entry referencing it. */
+        xor_hash = journal_file_entry_xor_hash(f, data, size, hash);
 
         r = journal_file_find_data_object_with_hash(f, data, size, hash, &o, &p);
         if (r < 0)
                 return r;
         if (r > 0) {
+                data_cache_put(f, o, p, xor_hash);
 
                 if (ret)
                         *ret = o;
@@ -1523,6 +1872,9 @@ static int journal_file_append_data(
                 if (offset)
                         *offset = p;
 
+                if (ret_xor_hash)
+                        *ret_xor_hash = xor_hash;
+
                 return 0;
         }
 
@@ -1533,11 +1885,12 @@ static int journal_file_append_data(
 
         o->data.hash = htole64(hash);
 
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
         if (JOURNAL_FILE_COMPRESS(f) && size >= f->compress_threshold_bytes) {
                 size_t rsize = 0;
 
-                compression = compress_blob(data, size, o->data.payload, size - 1, &rsize);
+                /* Use what the file was created with, readers of it might not know any other algorithm */
+                compression = compress_blob(journal_file_compression(f), data, size, o->data.payload, size - 1, &rsize);
 
                 if (compression >= 0) {
                         o->object.size = htole64(offsetof(Object, data.payload) + rsize);
@@ -1570,6 +1923,8 @@ static int journal_file_append_data(
         if (r < 0)
                 return r;
 
+        data_cache_put(f, o, p, xor_hash);
+
         if (!data)
                 eq = NULL;
         else
@@ -1594,25 +1949,30 @@ static int journal_file_append_data(
         if (offset)
                 *offset = p;
 
+        if (ret_xor_hash)
+                *ret_xor_hash = xor_hash;
+
         return 0;
 }
 
-uint64_t journal_file_entry_n_items(Object *o) {
+uint64_t journal_file_entry_n_items(JournalFile *f, Object *o) {
+        assert(f);
         assert(o);
 
         if (o->object.type != OBJECT_ENTRY)
                 return 0;
 
-        return (le64toh(o->object.size) - offsetof(Object, entry.items)) / sizeof(EntryItem);
+        return (le64toh(o->object.size) - offsetof(Object, entry.items)) / journal_file_entry_item_size(f);
 }
 
-uint64_t journal_file_entry_array_n_items(Object *o) {
+uint64_t journal_file_entry_array_n_items(JournalFile *f, Object *o) {
+        assert(f);
         assert(o);
 
         if (o->object.type != OBJECT_ENTRY_ARRAY)
                 return 0;
 
-        return (le64toh(o->object.size) - offsetof(Object, entry_array.items)) / sizeof(uint64_t);
+        return (le64toh(o->object.size) - offsetof(Object, entry_array.items)) / journal_file_entry_array_item_size(f);
 }
 
 uint64_t journal_file_hash_table_n_items(Object *o) {
@@ -1624,12 +1984,92 @@ uint64_t journal_file_hash_table_n_items(Object *o) {
         return (le64toh(o->object.size) - offsetof(Object, hash_table.items)) / sizeof(HashItem);
 }
 
+static void write_entry_array_item(JournalFile *f, Object *o, uint64_t i, uint64_t p) {
+        assert(f);
+        assert(o);
+
+        if (JOURNAL_HEADER_COMPACT(f->header)) {
+                assert(p <= UINT32_MAX);
+                o->entry_array.items.compact[i] = htole32(p);
+        } else
+                o->entry_array.items.regular[i] = htole64(p);
+}
+
+static int journal_file_append_entry_array(JournalFile *f, uint64_t n, Object **ret, uint64_t *offset) {
+        Object *o;
+        uint64_t q;
+        int r;
+
+        assert(f);
+        assert(f->header);
+        assert(n > 0);
+
+        r = journal_file_append_object(f, OBJECT_ENTRY_ARRAY,
+                                       offsetof(Object, entry_array.items) + n * journal_file_entry_array_item_size(f),
+                                       &o, &q);
+        if (r < 0)
+                return r;
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_ENTRY_ARRAY, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        if (JOURNAL_HEADER_CONTAINS(f->header, n_entry_arrays))
+                f->header->n_entry_arrays = htole64(le64toh(f->header->n_entry_arrays) + 1);
+
+        if (ret)
+                *ret = o;
+
+        if (offset)
+                *offset = q;
+
+        return 0;
+}
+
+typedef struct ChainTail {
+        uint64_t first; /* the array at the beginning of the chain */
+        uint64_t array; /* the last array in the chain we appended to */
+        uint64_t total; /* the total number of items in all arrays before this one in the chain */
+} ChainTail;
+
+static void chain_tail_put(JournalFile *f, uint64_t first, uint64_t array, uint64_t total) {
+        ChainTail *t;
+
+        assert(f);
+
+        t = ordered_hashmap_get(f->chain_tails, &first);
+        if (!t) {
+                if (ordered_hashmap_ensure_allocated(&f->chain_tails, &uint64_hash_ops) < 0)
+                        return;
+
+                if (ordered_hashmap_size(f->chain_tails) >= CHAIN_TAILS_MAX)
+                        t = ordered_hashmap_steal_first(f->chain_tails);
+                else
+                        t = new(ChainTail, 1);
+                if (!t)
+                        return;
+
+                t->first = first;
+
+                if (ordered_hashmap_put(f->chain_tails, &t->first, t) < 0) {
+                        free(t);
+                        return;
+                }
+        }
+
+        t->array = array;
+        t->total = total;
+}
+
 static int link_entry_into_array(JournalFile *f,
                                  le64_t *first,
                                  le64_t *idx,
                                  uint64_t p) {
         int r;
         uint64_t n = 0, ap = 0, q, i, a, hidx;
+        ChainTail *t;
         Object *o;
 
         assert(f);
@@ -1640,16 +2080,26 @@ static int link_entry_into_array(JournalFile *f,
 
         a = le64toh(*first);
         i = hidx = le64toh(*idx);
+
+        /* Chains are only ever extended at the end, hence if we remember where we appended to last, we can
+         * continue there instead of walking the whole chain for every single entry. */
+        t = a > 0 ? ordered_hashmap_get(f->chain_tails, &a) : NULL;
+        if (t && t->total <= hidx) {
+                a = t->array;
+                i = hidx - t->total;
+        }
+
         while (a > 0) {
 
                 r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &o);
                 if (r < 0)
                         return r;
 
-                n = journal_file_entry_array_n_items(o);
+                n = journal_file_entry_array_n_items(f, o);
                 if (i < n) {
-                        o->entry_array.items[i] = htole64(p);
+                        write_entry_array_item(f, o, i, p);
                         *idx = htole64(hidx + 1);
+                        chain_tail_put(f, le64toh(*first), a, hidx - i);
                         return 0;
                 }
 
@@ -1666,19 +2116,11 @@ static int link_entry_into_array(JournalFile *f,
         if (n < 4)
                 n = 4;
 
-        r = journal_file_append_object(f, OBJECT_ENTRY_ARRAY,
-                                       offsetof(Object, entry_array.items) + n * sizeof(uint64_t),
-                                       &o, &q);
-        if (r < 0)
-                return r;
-
-#if HAVE_GCRYPT
-        r = journal_file_hmac_put_object(f, OBJECT_ENTRY_ARRAY, o, q);
+        r = journal_file_append_entry_array(f, n, &o, &q);
         if (r < 0)
                 return r;
-#endif
 
-        o->entry_array.items[i] = htole64(p);
+        write_entry_array_item(f, o, i, p);
 
         if (ap == 0)
                 *first = htole64(q);
@@ -1690,10 +2132,8 @@ static int link_entry_into_array(JournalFile *f,
                 o->entry_array.next_entry_array_offset = htole64(q);
         }
 
-        if (JOURNAL_HEADER_CONTAINS(f->header, n_entry_arrays))
-                f->header->n_entry_arrays = htole64(le64toh(f->header->n_entry_arrays) + 1);
-
         *idx = htole64(hidx + 1);
+        chain_tail_put(f, le64toh(*first), q, hidx - i);
 
         return 0;
 }
@@ -1734,7 +2174,7 @@ static int journal_file_link_entry_item(JournalFile *f, Object *o, uint64_t offs
         assert(o);
         assert(offset > 0);
 
-        p = le64toh(o->entry.items[i].object_offset);
+        p = journal_file_entry_item_object_offset(f, o, i);
         if (p == 0)
                 return -EINVAL;
 
@@ -1780,7 +2220,7 @@ static int journal_file_link_entry(JournalFile *f, Object *o, uint64_t offset) {
         f->header->tail_entry_monotonic = o->entry.monotonic;
 
         /* Link up the items */
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(f, o);
         for (i = 0; i < n; i++) {
                 r = journal_file_link_entry_item(f, o, offset, i);
                 if (r < 0)
@@ -1800,6 +2240,7 @@ static int journal_file_append_entry_internal(
                 Object **ret, uint64_t *offset) {
         uint64_t np;
         uint64_t osize;
+        unsigned i;
         Object *o;
         int r;
 
@@ -1808,14 +2249,20 @@ static int journal_file_append_entry_internal(
         assert(items || n_items == 0);
         assert(ts);
 
-        osize = offsetof(Object, entry.items) + (n_items * sizeof(EntryItem));
+        osize = offsetof(Object, entry.items) + (n_items * journal_file_entry_item_size(f));
 
         r = journal_file_append_object(f, OBJECT_ENTRY, osize, &o, &np);
         if (r < 0)
                 return r;
 
         o->entry.seqnum = htole64(journal_file_entry_seqnum(f, seqnum));
-        memcpy_safe(o->entry.items, items, n_items * sizeof(EntryItem));
+        if (JOURNAL_HEADER_COMPACT(f->header))
+                for (i = 0; i < n_items; i++) {
+                        assert(le64toh(items[i].object_offset) <= UINT32_MAX);
+                        o->entry.items.compact[i].object_offset = htole32(le64toh(items[i].object_offset));
+                }
+        else
+                memcpy_safe(o->entry.items.regular, items, n_items * sizeof(EntryItem));
         o->entry.realtime = htole64(ts->realtime);
         o->entry.monotonic = htole64(ts->monotonic);
         o->entry.xor_hash = htole64(xor_hash);
@@ -1858,9 +2305,14 @@ void journal_file_post_change(JournalFile *f) {
 }
 
 static int post_change_thunk(sd_event_source *timer, uint64_t usec, void *userdata) {
-        assert(userdata);
+        JournalFile *f = userdata;
+
+        assert(f);
 
-        journal_file_post_change(userdata);
+        journal_file_post_change(f);
+
+        if (sd_event_now(sd_event_source_get_event(timer), CLOCK_MONOTONIC, &f->post_change_last_usec) < 0)
+                f->post_change_last_usec = usec;
 
         return 1;
 }
@@ -1886,7 +2338,11 @@ static void schedule_post_change(JournalFile *f) {
                 goto fail;
         }
 
-        r = sd_event_source_set_time(f->post_change_timer, now + f->post_change_timer_period);
+        /* If we didn't post a change for a full period, do so right away on the next event loop iteration, i.e. once the
+         * batch of entries we are currently processing is written, so that followers see sporadic messages without
+         * delay. Otherwise wait until the period since the last post elapsed, so that followers are woken up at most
+         * once per period under load. */
+        r = sd_event_source_set_time(f->post_change_timer, MAX(now, usec_add(f->post_change_last_usec, f->post_change_timer_period)));
         if (r < 0) {
                 log_debug_errno(r, "Failed to set time for scheduling ftruncate: %m");
                 goto fail;
@@ -1915,7 +2371,10 @@ int journal_file_enable_post_change_timer(JournalFile *f, sd_event *e, usec_t t)
         assert(e);
         assert(t);
 
-        r = sd_event_add_time(e, &timer, CLOCK_MONOTONIC, 0, 0, post_change_thunk, f);
+        /* An accuracy of 0 means the default of 250ms, which would delay the immediate post after an idle period
+         * that schedule_post_change() arranges for. Ask for the tightest accuracy instead; the period between two
+         * posts under load is what keeps the wakeups down. */
+        r = sd_event_add_time(e, &timer, CLOCK_MONOTONIC, 0, 1, post_change_thunk, f);
         if (r < 0)
                 return r;
 
@@ -1946,6 +2405,7 @@ int journal_file_append_entry(
         int r;
         uint64_t xor_hash = 0;
         struct dual_timestamp _ts;
+        bool sorted = true;
 
         assert(f);
         assert(f->header);
@@ -1975,21 +2435,26 @@ int journal_file_append_entry(
         items = newa(EntryItem, MAX(1u, n_iovec));
 
         for (i = 0; i < n_iovec; i++) {
-                uint64_t p;
+                uint64_t p, x;
                 Object *o;
 
-                r = journal_file_append_data(f, iovec[i].iov_base, iovec[i].iov_len, &o, &p);
+                r = journal_file_append_data(f, iovec[i].iov_base, iovec[i].iov_len, &o, &p, &x);
                 if (r < 0)
                         return r;
 
-                xor_hash ^= le64toh(o->data.hash);
+                if (i > 0 && p < le64toh(items[i-1].object_offset))
+                        sorted = false;
+
+                xor_hash ^= x;
                 items[i].object_offset = htole64(p);
                 items[i].hash = o->data.hash;
         }
 
         /* Order by the position on disk, in order to improve seek
-         * times for rotating media. */
-        typesafe_qsort(items, n_iovec, entry_item_cmp);
+         * times for rotating media. Entries of the same client are mostly made of the same data objects in
+         * the same order, which frequently means the items are already in order, hence skip the sort then. */
+        if (!sorted)
+                typesafe_qsort(items, n_iovec, entry_item_cmp);
 
         r = journal_file_append_entry_internal(f, ts, boot_id, xor_hash, items, n_iovec, seqnum, ret, offset);
 
@@ -2086,9 +2551,9 @@ static int generic_array_get(
                 if (r < 0)
                         return r;
 
-                k = journal_file_entry_array_n_items(o);
+                k = journal_file_entry_array_n_items(f, o);
                 if (i < k) {
-                        p = le64toh(o->entry_array.items[i]);
+                        p = journal_file_entry_array_item(f, o, i);
                         goto found;
                 }
 
@@ -2101,7 +2566,7 @@ static int generic_array_get(
 
 found:
         /* Let's cache this item for the next invocation */
-        chain_cache_put(f->chain_cache, ci, first, a, le64toh(o->entry_array.items[0]), t, i);
+        chain_cache_put(f->chain_cache, ci, first, a, journal_file_entry_array_item(f, o, 0), t, i);
 
         r = journal_file_move_to_object(f, OBJECT_ENTRY, p, &o);
         if (r < 0)
@@ -2152,31 +2617,179 @@ enum {
         TEST_RIGHT
 };
 
-static int generic_array_bisect(
-                JournalFile *f,
-                uint64_t first,
-                uint64_t n,
-                uint64_t needle,
-                int (*test_object)(JournalFile *f, uint64_t p, uint64_t needle),
-                direction_t direction,
-                Object **ret,
-                uint64_t *offset,
-                uint64_t *idx) {
-
-        uint64_t a, p, t = 0, i = 0, last_p = 0, last_index = (uint64_t) -1;
-        bool subtract_one = false;
-        Object *o, *array = NULL;
+static int chain_index_get(JournalFile *f, uint64_t first, uint64_t n, ChainIndex **ret) {
+        ChainIndex *ci;
+        uint64_t a, total;
+        Object *o;
         int r;
-        ChainCacheItem *ci;
 
         assert(f);
-        assert(test_object);
+        assert(ret);
 
-        /* Start with the first array in the chain */
-        a = first;
+        /* Returns the skip index for the chain starting at 'first', covering at least the arrays that contain
+         * the first 'n' items of the chain. The index only records where each array begins, and since arrays
+         * are never resized or moved, only ever appended to the end of the chain, the part of the index we
+         * already know stays valid and we only need to extend it at the tail. Returns 0 if we couldn't
+         * allocate a new index, in which case the caller should just walk the chain. */
 
-        ci = ordered_hashmap_get(f->chain_cache, &first);
-        if (ci && n > ci->total && ci->begin != 0) {
+        ci = ordered_hashmap_get(f->chain_index, &first);
+        if (!ci) {
+                if (ordered_hashmap_size(f->chain_index) >= CHAIN_INDEX_MAX)
+                        chain_index_free(ordered_hashmap_steal_first(f->chain_index));
+
+                ci = new0(ChainIndex, 1);
+                if (!ci)
+                        goto nomem;
+
+                ci->first = first;
+
+                if (ordered_hashmap_put(f->chain_index, &ci->first, ci) < 0) {
+                        free(ci);
+                        goto nomem;
+                }
+        }
+
+        if (ci->n_items == 0) {
+                a = first;
+                total = 0;
+        } else {
+                ChainIndexItem *last = ci->items + ci->n_items - 1;
+
+                total = last->total + last->size;
+                if (total >= n)
+                        goto finish;
+
+                /* The tail array is the only one whose next pointer might have changed since we looked */
+                r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, last->array, &o);
+                if (r < 0)
+                        return r;
+
+                a = le64toh(o->entry_array.next_entry_array_offset);
+        }
+
+        while (a > 0 && total < n) {
+                uint64_t k, p;
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY_ARRAY, a, &o);
+                if (r < 0)
+                        return r;
+
+                k = journal_file_entry_array_n_items(f, o);
+                p = journal_file_entry_array_item(f, o, 0);
+                if (k <= 0 || p <= 0)
+                        break;
+
+                if (!GREEDY_REALLOC(ci->items, ci->n_allocated, ci->n_items + 1))
+                        break;
+
+                ci->items[ci->n_items++] = (ChainIndexItem) {
+                        .array = a,
+                        .begin = p,
+                        .total = total,
+                        .size = k,
+                };
+
+                total += k;
+                a = le64toh(o->entry_array.next_entry_array_offset);
+        }
+
+finish:
+        *ret = ci;
+        return 1;
+
+nomem:
+        *ret = NULL;
+        return 0;
+}
+
+static int chain_index_seek(
+                JournalFile *f,
+                uint64_t first,
+                uint64_t n,
+                uint64_t needle,
+                int (*test_object)(JournalFile *f, uint64_t p, uint64_t needle),
+                uint64_t *array,
+                uint64_t *total) {
+
+        ChainIndex *ci;
+        size_t left, right;
+        int r;
+
+        assert(f);
+        assert(test_object);
+        assert(array);
+        assert(total);
+
+        /* Finds the last array in the first 'n' items of the chain whose first item is left of the needle,
+         * and hence the first array the needle might be located in, without walking the chain. Only looks
+         * at arrays after the one passed in via 'array' and 'total', and leaves them untouched if there's
+         * no array further right to jump to. */
+
+        r = chain_index_get(f, first, n, &ci);
+        if (r <= 0)
+                return r;
+
+        /* Skip over the arrays we don't need to look at, as the caller already starts right of them */
+        for (left = 0; left < ci->n_items; left++)
+                if (ci->items[left].total > *total)
+                        break;
+
+        for (right = left; right < ci->n_items; right++)
+                if (ci->items[right].total >= n)
+                        break;
+
+        /* Bisect for the first array whose first item is not left of the needle */
+        while (left < right) {
+                size_t i = left + (right - left) / 2;
+
+                r = test_object(f, ci->items[i].begin, needle);
+                if (r == -EBADMSG) {
+                        /* Let the chain walk deal with this */
+                        right = i;
+                        continue;
+                }
+                if (r < 0)
+                        return r;
+
+                if (r == TEST_LEFT)
+                        left = i + 1;
+                else
+                        right = i;
+        }
+
+        if (left == 0 || ci->items[left - 1].total <= *total)
+                return 0;
+
+        *array = ci->items[left - 1].array;
+        *total = ci->items[left - 1].total;
+        return 1;
+}
+
+static int generic_array_bisect(
+                JournalFile *f,
+                uint64_t first,
+                uint64_t n,
+                uint64_t needle,
+                int (*test_object)(JournalFile *f, uint64_t p, uint64_t needle),
+                direction_t direction,
+                Object **ret,
+                uint64_t *offset,
+                uint64_t *idx) {
+
+        uint64_t a, p, t = 0, i = 0, last_p = 0, last_index = (uint64_t) -1, total;
+        bool subtract_one = false;
+        Object *o, *array = NULL;
+        int r;
+        ChainCacheItem *ci;
+
+        assert(f);
+        assert(test_object);
+
+        /* Start with the first array in the chain */
+        a = first;
+
+        ci = ordered_hashmap_get(f->chain_cache, &first);
+        if (ci && n > ci->total && ci->begin != 0) {
                 /* Ah, we have iterated this bisection array chain
                  * previously! Let's see if we can skip ahead in the
                  * chain, as far as the last time. But we can't jump
@@ -2200,6 +2813,18 @@ static int generic_array_bisect(
                 }
         }
 
+        /* Use the skip index of this chain to jump even further ahead, instead of walking the chain array by
+         * array. */
+        total = t;
+        r = chain_index_seek(f, first, t + n, needle, test_object, &a, &total);
+        if (r < 0)
+                return r;
+        if (r > 0) {
+                n -= total - t;
+                t = total;
+                last_index = ci && ci->array == a ? ci->last_index : (uint64_t) -1;
+        }
+
         while (a > 0) {
                 uint64_t left, right, k, lp;
 
@@ -2207,13 +2832,13 @@ static int generic_array_bisect(
                 if (r < 0)
                         return r;
 
-                k = journal_file_entry_array_n_items(array);
+                k = journal_file_entry_array_n_items(f, array);
                 right = MIN(k, n);
                 if (right <= 0)
                         return 0;
 
                 i = right - 1;
-                lp = p = le64toh(array->entry_array.items[i]);
+                lp = p = journal_file_entry_array_item(f, array, i);
                 if (p <= 0)
                         r = -EBADMSG;
                 else
@@ -2246,7 +2871,7 @@ static int generic_array_bisect(
                                 if (last_index > 0) {
                                         uint64_t x = last_index - 1;
 
-                                        p = le64toh(array->entry_array.items[x]);
+                                        p = journal_file_entry_array_item(f, array, x);
                                         if (p <= 0)
                                                 return -EBADMSG;
 
@@ -2266,7 +2891,7 @@ static int generic_array_bisect(
                                 if (last_index < right) {
                                         uint64_t y = last_index + 1;
 
-                                        p = le64toh(array->entry_array.items[y]);
+                                        p = journal_file_entry_array_item(f, array, y);
                                         if (p <= 0)
                                                 return -EBADMSG;
 
@@ -2296,7 +2921,7 @@ static int generic_array_bisect(
                                 assert(left < right);
                                 i = (left + right) / 2;
 
-                                p = le64toh(array->entry_array.items[i]);
+                                p = journal_file_entry_array_item(f, array, i);
                                 if (p <= 0)
                                         r = -EBADMSG;
                                 else
@@ -2344,14 +2969,14 @@ found:
                 return 0;
 
         /* Let's cache this item for the next invocation */
-        chain_cache_put(f->chain_cache, ci, first, a, le64toh(array->entry_array.items[0]), t, subtract_one ? (i > 0 ? i-1 : (uint64_t) -1) : i);
+        chain_cache_put(f->chain_cache, ci, first, a, journal_file_entry_array_item(f, array, 0), t, subtract_one ? (i > 0 ? i-1 : (uint64_t) -1) : i);
 
         if (subtract_one && i == 0)
                 p = last_p;
         else if (subtract_one)
-                p = le64toh(array->entry_array.items[i-1]);
+                p = journal_file_entry_array_item(f, array, i-1);
         else
-                p = le64toh(array->entry_array.items[i]);
+                p = journal_file_entry_array_item(f, array, i);
 
         r = journal_file_move_to_object(f, OBJECT_ENTRY, p, &o);
         if (r < 0)
@@ -2615,8 +3240,10 @@ int journal_file_compare_locations(JournalFile *af, JournalFile *bf) {
         assert(af->header);
         assert(bf);
         assert(bf->header);
-        assert(af->location_type == LOCATION_SEEK);
-        assert(bf->location_type == LOCATION_SEEK);
+        /* The file whose candidate entry was picked last is marked LOCATION_DISCRETE, but still refers to
+         * that entry, hence may be compared too. */
+        assert(IN_SET(af->location_type, LOCATION_SEEK, LOCATION_DISCRETE));
+        assert(IN_SET(bf->location_type, LOCATION_SEEK, LOCATION_DISCRETE));
 
         /* If contents and timestamps match, these entries are
          * identical, even if the seqnum does not match */
@@ -3046,6 +3673,10 @@ void journal_file_dump(JournalFile *f) {
                                le64toh(o->tag.epoch));
                         break;
 
+                case OBJECT_BLOOM_FILTER:
+                        printf("Type: OBJECT_BLOOM_FILTER\n");
+                        break;
+
                 default:
                         printf("Type: unknown (%i)\n", o->object.type);
                         break;
@@ -3091,7 +3722,7 @@ void journal_file_print_header(JournalFile *f) {
                "Sequential Number ID: %s\n"
                "State: %s\n"
                "Compatible Flags:%s%s\n"
-               "Incompatible Flags:%s%s%s\n"
+               "Incompatible Flags:%s%s%s%s%s%s%s\n"
                "Header size: %"PRIu64"\n"
                "Arena size: %"PRIu64"\n"
                "Data Hash Table Size: %"PRIu64"\n"
@@ -3116,6 +3747,10 @@ void journal_file_print_header(JournalFile *f) {
                (le32toh(f->header->compatible_flags) & ~HEADER_COMPATIBLE_ANY) ? " ???" : "",
                JOURNAL_HEADER_COMPRESSED_XZ(f->header) ? " COMPRESSED-XZ" : "",
                JOURNAL_HEADER_COMPRESSED_LZ4(f->header) ? " COMPRESSED-LZ4" : "",
+               JOURNAL_HEADER_COMPRESSED_ZSTD(f->header) ? " COMPRESSED-ZSTD" : "",
+               JOURNAL_HEADER_KEYED_HASH(f->header) ? " KEYED-HASH" : "",
+               JOURNAL_HEADER_COMPACT(f->header) ? " COMPACT" : "",
+               JOURNAL_HEADER_BLOOM_FILTER(f->header) ? " BLOOM-FILTER" : "",
                (le32toh(f->header->incompatible_flags) & ~HEADER_INCOMPATIBLE_ANY) ? " ???" : "",
                le64toh(f->header->header_size),
                le64toh(f->header->arena_size),
@@ -3148,6 +3783,9 @@ void journal_file_print_header(JournalFile *f) {
         if (JOURNAL_HEADER_CONTAINS(f->header, n_entry_arrays))
                 printf("Entry Array Objects: %"PRIu64"\n",
                        le64toh(f->header->n_entry_arrays));
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                printf("Bloom Filter: %s\n",
+                       yes_no(f->header->bloom_filter_offset != 0));
 
         if (fstat(f->fd, &st) >= 0)
                 printf("Disk usage: %s\n", format_bytes(bytes, sizeof(bytes), (uint64_t) st.st_blocks * 512ULL));
@@ -3229,7 +3867,9 @@ int journal_file_open(
                 .prot = prot_from_flags(flags),
                 .writable = (flags & O_ACCMODE) != O_RDONLY,
 
-#if HAVE_LZ4
+#if HAVE_ZSTD
+                .compress_zstd = compress,
+#elif HAVE_LZ4
                 .compress_lz4 = compress,
 #elif HAVE_XZ
                 .compress_xz = compress,
@@ -3242,6 +3882,26 @@ int journal_file_open(
 #endif
         };
 
+        /* We turn on keyed hashes by default, but provide an environment variable to turn them off, for
+         * example to create files readable by older versions. */
+        r = getenv_bool("SYSTEMD_JOURNAL_KEYED_HASH");
+        if (r < 0) {
+                if (r != -ENXIO)
+                        log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_KEYED_HASH environment variable, ignoring.");
+                f->keyed_hash = true;
+        } else
+                f->keyed_hash = r;
+
+        /* Similar, compact mode is the default, i.e. we store 32bit offsets in entries and entry arrays,
+         * and limit the file to 4G. */
+        r = getenv_bool("SYSTEMD_JOURNAL_COMPACT");
+        if (r < 0) {
+                if (r != -ENXIO)
+                        log_debug_errno(r, "Failed to parse $SYSTEMD_JOURNAL_COMPACT environment variable, ignoring.");
+                f->compact = true;
+        } else
+                f->compact = r;
+
         log_debug("Journal effective settings seal=%s compress=%s compress_threshold_bytes=%s",
                   yes_no(f->seal), yes_no(JOURNAL_FILE_COMPRESS(f)),
                   format_bytes(bytes, sizeof(bytes), f->compress_threshold_bytes));
@@ -3278,6 +3938,12 @@ int journal_file_open(
                 goto fail;
         }
 
+        f->chain_index = ordered_hashmap_new(&uint64_hash_ops);
+        if (!f->chain_index) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
         if (f->fd < 0) {
                 /* We pass O_NONBLOCK here, so that in case somebody pointed us to some character device node or FIFO
                  * or so, we likely fail quickly than block for long. For regular files O_NONBLOCK has no effect, hence
@@ -3307,6 +3973,9 @@ int journal_file_open(
         if (r < 0)
                 goto fail;
 
+        if (f->writable)
+                f->on_tmpfs = fd_is_temporary_fs(f->fd) > 0;
+
         if (f->last_stat.st_size == 0 && f->writable) {
 
                 (void) journal_file_warn_btrfs(f);
@@ -3430,8 +4099,82 @@ fail:
         return r;
 }
 
+static int journal_file_append_bloom_filter(JournalFile *f) {
+        _cleanup_free_ uint8_t *bits = NULL;
+        uint64_t n_data, n_blocks, n_items, i, q, k = 0;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(f->header);
+
+        /* Writes a bloom filter over the hashes of all data objects in the file. This is done only once the
+         * file is archived, as only then the set of data objects is final. */
+
+        if (!JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset))
+                return 0;
+
+        n_data = le64toh(f->header->n_data);
+        if (n_data <= 0)
+                return 0;
+
+        r = journal_file_map_data_hash_table(f);
+        if (r < 0)
+                return r;
+
+        n_blocks = (bloom_filter_object_size(n_data) - offsetof(Object, bloom_filter.bits)) / BLOOM_FILTER_BLOCK_SIZE;
+
+        bits = malloc0(n_blocks * BLOOM_FILTER_BLOCK_SIZE);
+        if (!bits)
+                return -ENOMEM;
+
+        n_items = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
+        for (i = 0; i < n_items; i++) {
+                q = le64toh(f->data_hash_table[i].head_hash_offset);
+
+                while (q > 0) {
+                        /* Don't let a corrupted hash chain make us loop forever */
+                        if (++k > n_data)
+                                return -EBADMSG;
+
+                        r = journal_file_move_to_object(f, OBJECT_DATA, q, &o);
+                        if (r < 0)
+                                return r;
+
+                        bloom_filter_add(bits, n_blocks, BLOOM_FILTER_N_FUNCTIONS, le64toh(o->data.hash));
+                        q = le64toh(o->data.next_hash_offset);
+                }
+        }
+
+        /* Older readers don't know this object type, and would consider the file corrupted. Hence mark the
+         * file as incompatible with them before adding the object. The flag stays set even if the filter is
+         * invalidated later, since the object remains part of the file. */
+        f->header->incompatible_flags |= htole32(HEADER_INCOMPATIBLE_BLOOM_FILTER);
+
+        r = journal_file_append_object(f, OBJECT_BLOOM_FILTER, bloom_filter_object_size(n_data), &o, &q);
+        if (r < 0)
+                return r;
+
+        o->bloom_filter.n_functions = htole64(BLOOM_FILTER_N_FUNCTIONS);
+        memcpy(o->bloom_filter.bits, bits, n_blocks * BLOOM_FILTER_BLOCK_SIZE);
+
+#if HAVE_GCRYPT
+        r = journal_file_hmac_put_object(f, OBJECT_BLOOM_FILTER, o, q);
+        if (r < 0)
+                return r;
+#endif
+
+        /* Make sure the filter is complete before readers may look at it */
+        __sync_synchronize();
+
+        f->header->bloom_filter_offset = htole64(q);
+
+        return 0;
+}
+
 int journal_file_archive(JournalFile *f) {
         _cleanup_free_ char *p = NULL;
+        int r;
 
         assert(f);
 
@@ -3446,6 +4189,11 @@ int journal_file_archive(JournalFile *f) {
         if (!endswith(f->path, ".journal"))
                 return -EINVAL;
 
+        /* The bloom filter is only an optimization for readers, hence don't fail archiving without it */
+        r = journal_file_append_bloom_filter(f);
+        if (r < 0)
+                log_warning_errno(r, "Failed to write bloom filter to %s, ignoring: %m", f->path);
+
         if (asprintf(&p, "%.*s@" SD_ID128_FORMAT_STR "-%016"PRIx64"-%016"PRIx64".journal",
                      (int) strlen(f->path) - 8, f->path,
                      SD_ID128_FORMAT_VAL(f->header->seqnum_id),
@@ -3461,6 +4209,9 @@ int journal_file_archive(JournalFile *f) {
         /* Sync the rename to disk */
         (void) fsync_directory_of_file(f->fd);
 
+        /* From now on refer to the file by its new name */
+        free_and_replace(f->path, p);
+
         /* Set as archive so offlining commits w/state=STATE_ARCHIVED. Previously we would set old_file->header->state
          * to STATE_ARCHIVED directly here, but journal_file_set_offline() short-circuits when state != STATE_ONLINE,
          * which would result in the rotated journal never getting fsync() called before closing.  Now we simply queue
@@ -3504,19 +4255,25 @@ int journal_file_rotate(
                 bool seal,
                 Set *deferred_closes) {
 
+        _cleanup_free_ char *path = NULL;
         JournalFile *new_file = NULL;
         int r;
 
         assert(f);
         assert(*f);
 
+        /* Archiving renames the file, but we want to create the new one under the old name */
+        path = strdup((*f)->path);
+        if (!path)
+                return -ENOMEM;
+
         r = journal_file_archive(*f);
         if (r < 0)
                 return r;
 
         r = journal_file_open(
                         -1,
-                        (*f)->path,
+                        path,
                         (*f)->flags,
                         (*f)->mode,
                         compress,
@@ -3534,6 +4291,122 @@ int journal_file_rotate(
         return r;
 }
 
+int journal_file_rewrite_archived(const char *fname, bool compress, uint64_t compress_threshold_bytes) {
+        _cleanup_(journal_file_closep) JournalFile *from = NULL;
+        _cleanup_free_ char *t = NULL;
+        _cleanup_close_ int fd = -1;
+        JournalFile *to = NULL;
+        struct stat st;
+        int r;
+
+        assert(fname);
+
+        /* Replaces an archived journal file by a copy of it rewritten with journal_file_rewrite(), i.e.
+         * laid out contiguously for reading, and compressed with the given settings. The copy is
+         * written to a temporary file next to the original first, and then atomically renamed over
+         * it, so that readers will always see either version in full. */
+
+        r = journal_file_open(-1, fname, O_RDONLY, 0, false, 0, false, NULL, NULL, NULL, NULL, &from);
+        if (r < 0)
+                return r;
+
+        /* Only archived files are guaranteed to not change anymore */
+        if (from->header->state != STATE_ARCHIVED)
+                return -EBUSY;
+
+        /* The tags of sealed files are bound to the entries' position in the file */
+        if (JOURNAL_HEADER_SEALED(from->header))
+                return -EOPNOTSUPP;
+
+        r = tempfn_random(fname, NULL, &t);
+        if (r < 0)
+                return r;
+
+        fd = open(t, O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW, from->last_stat.st_mode & 07777);
+        if (fd < 0)
+                return -errno;
+
+        /* Keep the temporary file locked while we work on it, so that vacuuming can tell it apart from one left
+         * behind by a worker that died */
+        if (flock(fd, LOCK_EX) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        /* Keep ownership, ACLs and the creation time the vacuuming logic looks at */
+        if (fchown(fd, from->last_stat.st_uid, from->last_stat.st_gid) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        r = journal_file_open(fd, t, O_RDWR, 0, compress, compress_threshold_bytes, false, NULL, NULL, NULL, NULL, &to);
+        if (r < 0)
+                goto fail;
+
+        /* We still need the fd after closing the file */
+        to->close_fd = false;
+
+        r = copy_xattr(from->fd, to->fd);
+        if (r < 0)
+                log_debug_errno(r, "Failed to copy extended attributes of %s, ignoring: %m", fname);
+
+        r = journal_file_rewrite(from, to);
+        if (r < 0)
+                goto fail;
+
+        r = journal_file_append_bloom_filter(to);
+        if (r < 0)
+                log_warning_errno(r, "Failed to write bloom filter to %s, ignoring: %m", t);
+
+        /* Closing the file syncs it and marks it as archived */
+        to->archive = true;
+        to = journal_file_close(to);
+
+        /* If the original got vacuumed away in the meantime, don't resurrect it */
+        if (stat(fname, &st) < 0) {
+                r = -errno;
+                goto fail;
+        }
+        if (st.st_dev != from->last_stat.st_dev || st.st_ino != from->last_stat.st_ino) {
+                r = -ESTALE;
+                goto fail;
+        }
+
+        if (rename(t, fname) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        (void) fsync_directory_of_file(fd);
+
+        return 0;
+
+fail:
+        if (to)
+                (void) journal_file_close(to);
+        (void) unlink(t);
+        return r;
+}
+
+bool journal_file_is_rewrite_temporary(const char *fn) {
+        size_t n;
+
+        assert(fn);
+
+        /* Checks whether the file name is one of the temporary files journal_file_rewrite_archived() creates,
+         * i.e. ".#" followed by the name of the journal file and 16 random hex digits, see tempfn_random(). */
+
+        if (!startswith(fn, ".#"))
+                return false;
+
+        n = strlen(fn);
+        if (n < STRLEN(".#") + STRLEN(".journal") + 16)
+                return false;
+
+        return memcmp(fn + n - 16 - STRLEN(".journal"), ".journal", STRLEN(".journal")) == 0 &&
+                in_charset(fn + n - 16, HEXDIGITS);
+}
+
 int journal_file_dispose(int dir_fd, const char *fname) {
         _cleanup_free_ char *p = NULL;
         _cleanup_close_ int fd = -1;
@@ -3618,7 +4491,82 @@ int journal_file_open_reliably(
                                  deferred_closes, template, ret);
 }
 
-int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p) {
+static int journal_file_data_payload(JournalFile *f, Object *o, const void **ret_data, uint64_t *ret_size) {
+        uint64_t l;
+        size_t t;
+
+        assert(f);
+        assert(o);
+        assert(o->object.type == OBJECT_DATA);
+        assert(ret_data);
+        assert(ret_size);
+
+        /* Returns the payload of a data object, decompressing it into the compression buffer if needed */
+
+        l = le64toh(o->object.size) - offsetof(Object, data.payload);
+        t = (size_t) l;
+
+        /* We hit the limit on 32bit machines */
+        if ((uint64_t) t != l)
+                return -E2BIG;
+
+        if (o->object.flags & OBJECT_COMPRESSION_MASK) {
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
+                size_t rsize = 0;
+                int r;
+
+                r = decompress_blob(o->object.flags & OBJECT_COMPRESSION_MASK,
+                                    o->data.payload, l, &f->compress_buffer, &f->compress_buffer_size, &rsize, 0);
+                if (r < 0)
+                        return r;
+
+                *ret_data = f->compress_buffer;
+                *ret_size = rsize;
+#else
+                return -EPROTONOSUPPORT;
+#endif
+        } else {
+                *ret_data = o->data.payload;
+                *ret_size = l;
+        }
+
+        return 0;
+}
+
+typedef struct CopyOffset {
+        uint64_t from_offset;
+        uint64_t to_offset;
+        le64_t hash;
+        uint64_t xor_hash;
+} CopyOffset;
+
+static void copy_offsets_put(JournalFile *from, uint64_t from_offset, uint64_t to_offset, le64_t hash, uint64_t xor_hash) {
+        CopyOffset *c;
+
+        assert(from);
+
+        if (hashmap_size(from->copy_offsets) >= COPY_OFFSETS_MAX)
+                return;
+
+        if (hashmap_ensure_allocated(&from->copy_offsets, &uint64_hash_ops) < 0)
+                return;
+
+        c = new(CopyOffset, 1);
+        if (!c)
+                return;
+
+        *c = (CopyOffset) {
+                .from_offset = from_offset,
+                .to_offset = to_offset,
+                .hash = hash,
+                .xor_hash = xor_hash,
+        };
+
+        if (hashmap_put(from->copy_offsets, &c->from_offset, c) < 0)
+                free(c);
+}
+
+static int journal_file_copy_entry_internal(JournalFile *from, JournalFile *to, Object *o, uint64_t p, uint64_t *seqnum) {
         uint64_t i, n;
         uint64_t q, xor_hash = 0;
         int r;
@@ -3634,70 +4582,71 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
         if (!to->writable)
                 return -EPERM;
 
+        /* When copying many entries from one file into another, most of them refer to the same few data
+         * objects. Hence remember where each data object ended up in the target, so that we neither have
+         * to read, decompress and hash its payload nor look it up in the target's hash table again. Data
+         * objects never move, hence the table stays valid as long as the target is the same file. */
+        if (!sd_id128_equal(from->copy_offsets_target, to->header->file_id)) {
+                hashmap_clear_free(from->copy_offsets);
+                from->copy_offsets_target = to->header->file_id;
+        }
+
         ts.monotonic = le64toh(o->entry.monotonic);
         ts.realtime = le64toh(o->entry.realtime);
         boot_id = &o->entry.boot_id;
 
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(from, o);
         /* alloca() can't take 0, hence let's allocate at least one */
         items = newa(EntryItem, MAX(1u, n));
 
         for (i = 0; i < n; i++) {
-                uint64_t l, h;
-                le64_t le_hash;
-                size_t t;
-                void *data;
+                uint64_t l, h, x = 0;
+                le64_t le_hash = 0;
+                const void *data;
+                CopyOffset *c;
                 Object *u;
 
-                q = le64toh(o->entry.items[i].object_offset);
-                le_hash = o->entry.items[i].hash;
+                q = journal_file_entry_item_object_offset(from, o, i);
+
+                c = hashmap_get(from->copy_offsets, &q);
+                if (c) {
+                        xor_hash ^= c->xor_hash;
+                        items[i].object_offset = htole64(c->to_offset);
+                        items[i].hash = c->hash;
+                        continue;
+                }
+
+                if (!JOURNAL_HEADER_COMPACT(from->header))
+                        le_hash = o->entry.items.regular[i].hash;
 
                 r = journal_file_move_to_object(from, OBJECT_DATA, q, &o);
                 if (r < 0)
                         return r;
 
-                if (le_hash != o->data.hash)
+                if (!JOURNAL_HEADER_COMPACT(from->header) && le_hash != o->data.hash)
                         return -EBADMSG;
 
-                l = le64toh(o->object.size) - offsetof(Object, data.payload);
-                t = (size_t) l;
-
-                /* We hit the limit on 32bit machines */
-                if ((uint64_t) t != l)
-                        return -E2BIG;
-
-                if (o->object.flags & OBJECT_COMPRESSION_MASK) {
-#if HAVE_XZ || HAVE_LZ4
-                        size_t rsize = 0;
-
-                        r = decompress_blob(o->object.flags & OBJECT_COMPRESSION_MASK,
-                                            o->data.payload, l, &from->compress_buffer, &from->compress_buffer_size, &rsize, 0);
-                        if (r < 0)
-                                return r;
-
-                        data = from->compress_buffer;
-                        l = rsize;
-#else
-                        return -EPROTONOSUPPORT;
-#endif
-                } else
-                        data = o->data.payload;
+                r = journal_file_data_payload(from, o, &data, &l);
+                if (r < 0)
+                        return r;
 
-                r = journal_file_append_data(to, data, l, &u, &h);
+                r = journal_file_append_data(to, data, l, &u, &h, &x);
                 if (r < 0)
                         return r;
 
-                xor_hash ^= le64toh(u->data.hash);
+                xor_hash ^= x;
                 items[i].object_offset = htole64(h);
                 items[i].hash = u->data.hash;
 
+                copy_offsets_put(from, q, h, u->data.hash, x);
+
                 r = journal_file_move_to_object(from, OBJECT_ENTRY, p, &o);
                 if (r < 0)
                         return r;
         }
 
         r = journal_file_append_entry_internal(to, &ts, boot_id, xor_hash, items, n,
-                                               NULL, NULL, NULL);
+                                               seqnum, NULL, NULL);
 
         if (mmap_cache_got_sigbus(to->mmap, to->cache_fd))
                 return -EIO;
@@ -3705,6 +4654,130 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
         return r;
 }
 
+int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p) {
+        return journal_file_copy_entry_internal(from, to, o, p, NULL);
+}
+
+int journal_file_rewrite(JournalFile *from, JournalFile *to) {
+        uint64_t n_items, i, p, fp;
+        Object *o;
+        int r;
+
+        assert(from);
+        assert(from->header);
+        assert(to);
+        assert(to->header);
+
+        /* Copies all entries of 'from' into the empty file 'to', in a layout optimized for reading rather
+         * than appending: all data objects come first, grouped by field, each followed directly by an
+         * entry array large enough for all its entries, then the main entry array sized for all entries,
+         * and finally the entries themselves in order. Sequence numbers are retained, so that cursors
+         * pointing into 'from' stay valid for 'to'. Data objects no entry refers to are dropped. */
+
+        if (!to->writable)
+                return -EPERM;
+
+        if (le64toh(to->header->n_entries) > 0 ||
+            (JOURNAL_HEADER_CONTAINS(to->header, n_data) && le64toh(to->header->n_data) > 0))
+                return -EBUSY;
+
+        to->header->seqnum_id = from->header->seqnum_id;
+
+        if (le64toh(from->header->field_hash_table_size) > 0) {
+                r = journal_file_map_field_hash_table(from);
+                if (r < 0)
+                        return r;
+        }
+
+        n_items = le64toh(from->header->field_hash_table_size) / sizeof(HashItem);
+        for (i = 0; i < n_items; i++) {
+                fp = le64toh(from->field_hash_table[i].head_hash_offset);
+
+                while (fp > 0) {
+                        r = journal_file_move_to_object(from, OBJECT_FIELD, fp, &o);
+                        if (r < 0)
+                                return r;
+
+                        p = le64toh(o->field.head_data_offset);
+
+                        while (p > 0) {
+                                const void *data;
+                                uint64_t l, n, q, a;
+                                Object *u;
+
+                                r = journal_file_move_to_object(from, OBJECT_DATA, p, &o);
+                                if (r < 0)
+                                        return r;
+
+                                n = le64toh(o->data.n_entries);
+                                if (n > 0) {
+                                        r = journal_file_data_payload(from, o, &data, &l);
+                                        if (r < 0)
+                                                return r;
+
+                                        r = journal_file_append_data(to, data, l, &u, &q, NULL);
+                                        if (r < 0)
+                                                return r;
+
+                                        /* Allocate the entry array for all entries at once, the first
+                                         * entry is stored in the data object itself */
+                                        if (n > 1 && u->data.entry_array_offset == 0) {
+                                                r = journal_file_append_entry_array(to, n - 1, NULL, &a);
+                                                if (r < 0)
+                                                        return r;
+
+                                                r = journal_file_move_to_object(to, OBJECT_DATA, q, &u);
+                                                if (r < 0)
+                                                        return r;
+
+                                                u->data.entry_array_offset = htole64(a);
+                                        }
+
+                                        /* Appending might have moved the window 'o' points to */
+                                        r = journal_file_move_to_object(from, OBJECT_DATA, p, &o);
+                                        if (r < 0)
+                                                return r;
+                                }
+
+                                p = le64toh(o->data.next_field_offset);
+                        }
+
+                        r = journal_file_move_to_object(from, OBJECT_FIELD, fp, &o);
+                        if (r < 0)
+                                return r;
+
+                        fp = le64toh(o->field.next_hash_offset);
+                }
+        }
+
+        if (le64toh(from->header->n_entries) > 0) {
+                r = journal_file_append_entry_array(to, le64toh(from->header->n_entries), NULL, &p);
+                if (r < 0)
+                        return r;
+
+                to->header->entry_array_offset = htole64(p);
+        }
+
+        for (p = 0;;) {
+                uint64_t seqnum;
+
+                r = journal_file_next_entry(from, p, DIRECTION_DOWN, &o, &p);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                /* Keep the sequence number, the seqnum counter is bumped to the maximum of both */
+                seqnum = le64toh(o->entry.seqnum) - 1;
+
+                r = journal_file_copy_entry_internal(from, to, o, p, &seqnum);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 void journal_reset_metrics(JournalMetrics *m) {
         assert(m);
 
@@ -66,14 +66,19 @@ typedef struct JournalFile {
         bool writable:1;
         bool compress_xz:1;
         bool compress_lz4:1;
+        bool compress_zstd:1;
+        bool keyed_hash:1;
+        bool compact:1;
         bool seal:1;
         bool defrag_on_close:1;
         bool close_fd:1;
         bool archive:1;
+        bool on_tmpfs:1;
 
         direction_t last_direction;
         LocationType location_type;
         uint64_t last_n_entries;
+        unsigned location_prioq_idx;
 
         char *path;
         struct stat last_stat;
@@ -93,10 +98,22 @@ typedef struct JournalFile {
         JournalMetrics metrics;
         MMapCache *mmap;
 
+        usec_t last_allocation_usec;
+        uint64_t allocation_increase;
+        uint64_t n_allocations;         /* how often the file was grown ... */
+        usec_t allocation_usec;         /* ... and how long that took in total */
+
         sd_event_source *post_change_timer;
         usec_t post_change_timer_period;
+        usec_t post_change_last_usec;
 
         OrderedHashmap *chain_cache;
+        OrderedHashmap *chain_index;
+        OrderedHashmap *chain_tails;
+        OrderedHashmap *data_cache;
+
+        Hashmap *copy_offsets;
+        sd_id128_t copy_offsets_target;
 
         pthread_t offline_thread;
         volatile OfflineState offline_state;
@@ -104,7 +121,7 @@ typedef struct JournalFile {
         unsigned last_seen_generation;
 
         uint64_t compress_threshold_bytes;
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
         void *compress_buffer;
         size_t compress_buffer_size;
 #endif
@@ -144,6 +161,7 @@ int journal_file_open(
 int journal_file_set_offline(JournalFile *f, bool wait);
 bool journal_file_is_offlining(JournalFile *f);
 JournalFile* journal_file_close(JournalFile *j);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalFile*, journal_file_close);
 
 int journal_file_open_reliably(
                 const char *fname,
@@ -192,12 +210,53 @@ static inline bool VALID_EPOCH(uint64_t u) {
 #define JOURNAL_HEADER_COMPRESSED_LZ4(h) \
         (!!(le32toh((h)->incompatible_flags) & HEADER_INCOMPATIBLE_COMPRESSED_LZ4))
 
+#define JOURNAL_HEADER_COMPRESSED_ZSTD(h) \
+        (!!(le32toh((h)->incompatible_flags) & HEADER_INCOMPATIBLE_COMPRESSED_ZSTD))
+
+#define JOURNAL_HEADER_KEYED_HASH(h) \
+        (!!(le32toh((h)->incompatible_flags) & HEADER_INCOMPATIBLE_KEYED_HASH))
+
+#define JOURNAL_HEADER_COMPACT(h) \
+        (!!(le32toh((h)->incompatible_flags) & HEADER_INCOMPATIBLE_COMPACT))
+
+#define JOURNAL_HEADER_BLOOM_FILTER(h) \
+        (!!(le32toh((h)->incompatible_flags) & HEADER_INCOMPATIBLE_BLOOM_FILTER))
+
+/* Compact journal files store 32bit offsets, hence they cannot grow beyond this */
+#define JOURNAL_COMPACT_SIZE_MAX ((uint64_t) UINT32_MAX)
+
 int journal_file_move_to_object(JournalFile *f, ObjectType type, uint64_t offset, Object **ret);
 
-uint64_t journal_file_entry_n_items(Object *o) _pure_;
-uint64_t journal_file_entry_array_n_items(Object *o) _pure_;
+uint64_t journal_file_entry_n_items(JournalFile *f, Object *o) _pure_;
+uint64_t journal_file_entry_array_n_items(JournalFile *f, Object *o) _pure_;
 uint64_t journal_file_hash_table_n_items(Object *o) _pure_;
 
+static inline uint64_t journal_file_entry_item_size(JournalFile *f) {
+        assert(f);
+        return JOURNAL_HEADER_COMPACT(f->header) ? sizeof(le32_t) : sizeof(EntryItem);
+}
+
+static inline uint64_t journal_file_entry_array_item_size(JournalFile *f) {
+        assert(f);
+        return JOURNAL_HEADER_COMPACT(f->header) ? sizeof(le32_t) : sizeof(le64_t);
+}
+
+static inline uint64_t journal_file_entry_item_object_offset(JournalFile *f, Object *o, uint64_t i) {
+        assert(f);
+        assert(o);
+        return JOURNAL_HEADER_COMPACT(f->header) ?
+                le32toh(o->entry.items.compact[i].object_offset) :
+                le64toh(o->entry.items.regular[i].object_offset);
+}
+
+static inline uint64_t journal_file_entry_array_item(JournalFile *f, Object *o, uint64_t i) {
+        assert(f);
+        assert(o);
+        return JOURNAL_HEADER_COMPACT(f->header) ?
+                le32toh(o->entry_array.items.compact[i]) :
+                le64toh(o->entry_array.items.regular[i]);
+}
+
 int journal_file_append_object(JournalFile *f, ObjectType type, uint64_t size, Object **ret, uint64_t *offset);
 int journal_file_append_entry(
                 JournalFile *f,
@@ -231,6 +290,9 @@ int journal_file_move_to_entry_by_realtime_for_data(JournalFile *f, uint64_t dat
 int journal_file_move_to_entry_by_monotonic_for_data(JournalFile *f, uint64_t data_offset, sd_id128_t boot_id, uint64_t monotonic, direction_t direction, Object **ret, uint64_t *offset);
 
 int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p);
+int journal_file_rewrite(JournalFile *from, JournalFile *to);
+int journal_file_rewrite_archived(const char *fname, bool compress, uint64_t compress_threshold_bytes);
+bool journal_file_is_rewrite_temporary(const char *fn);
 
 void journal_file_dump(JournalFile *f);
 void journal_file_print_header(JournalFile *f);
@@ -253,9 +315,26 @@ int journal_file_get_cutoff_monotonic_usec(JournalFile *f, sd_id128_t boot, usec
 bool journal_file_rotate_suggested(JournalFile *f, usec_t max_file_usec);
 
 int journal_file_map_data_hash_table(JournalFile *f);
+int journal_file_bloom_filter_test(JournalFile *f, uint64_t hash);
 int journal_file_map_field_hash_table(JournalFile *f);
 
+uint64_t journal_file_hash_data(JournalFile *f, const void *data, size_t sz);
+
 static inline bool JOURNAL_FILE_COMPRESS(JournalFile *f) {
         assert(f);
-        return f->compress_xz || f->compress_lz4;
+        return f->compress_xz || f->compress_lz4 || f->compress_zstd;
+}
+
+static inline int journal_file_compression(JournalFile *f) {
+        assert(f);
+
+        /* Pick an algorithm the file's header announces, so that readers of the file know to expect it */
+        if (f->compress_zstd)
+                return OBJECT_COMPRESSED_ZSTD;
+        if (f->compress_lz4)
+                return OBJECT_COMPRESSED_LZ4;
+        if (f->compress_xz)
+                return OBJECT_COMPRESSED_XZ;
+
+        return 0;
 }
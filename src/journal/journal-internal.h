@@ -8,10 +8,12 @@
 #include "sd-id128.h"
 #include "sd-journal.h"
 
+#include "catalog.h"
 #include "hashmap.h"
 #include "journal-def.h"
 #include "journal-file.h"
 #include "list.h"
+#include "prioq.h"
 #include "set.h"
 
 typedef struct Match Match;
@@ -32,7 +34,8 @@ struct Match {
         /* For concrete matches */
         char *data;
         size_t size;
-        le64_t le_hash;
+        le64_t le_hash; /* Jenkins hash of the data, as used by files without the keyed hash flag */
+        Hashmap *keyed_hashes; /* file ID → MatchKeyedHash, for files with the keyed hash flag */
 
         /* For terms */
         LIST_HEAD(Match, matches);
@@ -74,6 +77,12 @@ struct sd_journal {
         IteratedCache *files_cache;
         MMapCache *mmap;
 
+        /* Files that have a candidate entry beyond the current location, ordered by that entry in the
+         * direction we are iterating in. Only valid as long as nothing else moved the files' locations. */
+        Prioq *files_by_location;
+        direction_t files_by_location_direction;
+        bool files_by_location_valid;
+
         Location current_location;
 
         JournalFile *current_file;
@@ -93,6 +102,12 @@ struct sd_journal {
         JournalFile *unique_file;
         uint64_t unique_offset;
 
+        /* The values sd_journal_enumerate_unique() returned so far, as long as they fit in
+         * UNIQUE_VALUES_SIZE_MAX. Once they don't, or one of them couldn't be stored, this is incomplete. */
+        Set *unique_values;
+        size_t unique_values_size;
+        bool unique_values_incomplete;
+
         /* Iterating through known fields */
         JournalFile *fields_file;
         uint64_t fields_offset;
@@ -100,6 +115,13 @@ struct sd_journal {
         char *fields_buffer;
         size_t fields_buffer_allocated;
 
+        /* Data returned by sd_journal_get_data_batch() */
+        uint8_t *batch_buffer;
+        size_t batch_buffer_allocated;
+
+        /* The catalog database, kept mapped for sd_journal_get_catalog() */
+        CatalogMap *catalog_map;
+
         int flags;
 
         bool on_network:1;
@@ -192,30 +192,12 @@ finish:
         return r;
 }
 
-_public_ int sd_journal_sendv(const struct iovec *iov, int n) {
-        PROTECT_ERRNO;
-        int fd, r;
-        _cleanup_close_ int buffer_fd = -1;
-        struct iovec *w;
-        uint64_t *l;
-        int i, j = 0;
-        static const union sockaddr_union sa = {
-                .un.sun_family = AF_UNIX,
-                .un.sun_path = "/run/systemd/journal/socket",
-        };
-        struct msghdr mh = {
-                .msg_name = (struct sockaddr*) &sa.sa,
-                .msg_namelen = SOCKADDR_UN_LEN(sa.un),
-        };
-        ssize_t k;
+static int journal_fill_iovec(const struct iovec *iov, int n, struct iovec *w, size_t *j, uint64_t *l) {
         bool have_syslog_identifier = false;
-        bool seal = true;
+        int i;
 
-        assert_return(iov, -EINVAL);
-        assert_return(n > 0, -EINVAL);
-
-        w = newa(struct iovec, n * 5 + 3);
-        l = newa(uint64_t, n);
+        /* Serializes a single entry in the native protocol into w, which needs to have room for 5 entries per
+         * field plus 3. l needs to have room for n entries, and needs to stay around as long as w is used. */
 
         for (i = 0; i < n; i++) {
                 char *c, *nl;
@@ -241,19 +223,19 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
                          * newline, then the size (64bit LE), followed
                          * by the data and a final newline */
 
-                        w[j++] = IOVEC_MAKE(iov[i].iov_base, c - (char*) iov[i].iov_base);
-                        w[j++] = IOVEC_MAKE_STRING("\n");
+                        w[(*j)++] = IOVEC_MAKE(iov[i].iov_base, c - (char*) iov[i].iov_base);
+                        w[(*j)++] = IOVEC_MAKE_STRING("\n");
 
                         l[i] = htole64(iov[i].iov_len - (c - (char*) iov[i].iov_base) - 1);
-                        w[j++] = IOVEC_MAKE(&l[i], sizeof(uint64_t));
+                        w[(*j)++] = IOVEC_MAKE(&l[i], sizeof(uint64_t));
 
-                        w[j++] = IOVEC_MAKE(c + 1, iov[i].iov_len - (c - (char*) iov[i].iov_base) - 1);
+                        w[(*j)++] = IOVEC_MAKE(c + 1, iov[i].iov_len - (c - (char*) iov[i].iov_base) - 1);
                 } else
                         /* Nothing special? Then just add the line and
                          * append a newline */
-                        w[j++] = iov[i];
+                        w[(*j)++] = iov[i];
 
-                w[j++] = IOVEC_MAKE_STRING("\n");
+                w[(*j)++] = IOVEC_MAKE_STRING("\n");
         }
 
         if (!have_syslog_identifier &&
@@ -265,11 +247,28 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
                  * since everything else is much nicer to retrieve
                  * from the outside. */
 
-                w[j++] = IOVEC_MAKE_STRING("SYSLOG_IDENTIFIER=");
-                w[j++] = IOVEC_MAKE_STRING(program_invocation_short_name);
-                w[j++] = IOVEC_MAKE_STRING("\n");
+                w[(*j)++] = IOVEC_MAKE_STRING("SYSLOG_IDENTIFIER=");
+                w[(*j)++] = IOVEC_MAKE_STRING(program_invocation_short_name);
+                w[(*j)++] = IOVEC_MAKE_STRING("\n");
         }
 
+        return 0;
+}
+
+static int journal_send_iovec(struct iovec *w, size_t j) {
+        int fd, r;
+        _cleanup_close_ int buffer_fd = -1;
+        static const union sockaddr_union sa = {
+                .un.sun_family = AF_UNIX,
+                .un.sun_path = "/run/systemd/journal/socket",
+        };
+        struct msghdr mh = {
+                .msg_name = (struct sockaddr*) &sa.sa,
+                .msg_namelen = SOCKADDR_UN_LEN(sa.un),
+        };
+        ssize_t k;
+        bool seal = true;
+
         fd = journal_fd();
         if (_unlikely_(fd < 0))
                 return fd;
@@ -308,8 +307,8 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
                         return buffer_fd;
         }
 
-        n = writev(buffer_fd, w, j);
-        if (n < 0)
+        k = writev(buffer_fd, w, j);
+        if (k < 0)
                 return -errno;
 
         if (seal) {
@@ -325,6 +324,76 @@ _public_ int sd_journal_sendv(const struct iovec *iov, int n) {
         return r;
 }
 
+_public_ int sd_journal_sendv(const struct iovec *iov, int n) {
+        PROTECT_ERRNO;
+        struct iovec *w;
+        uint64_t *l;
+        size_t j = 0;
+        int r;
+
+        assert_return(iov, -EINVAL);
+        assert_return(n > 0, -EINVAL);
+
+        w = newa(struct iovec, n * 5 + 3);
+        l = newa(uint64_t, n);
+
+        r = journal_fill_iovec(iov, n, w, &j, l);
+        if (r < 0)
+                return r;
+
+        return journal_send_iovec(w, j);
+}
+
+_public_ int sd_journal_sendv_batch(const struct iovec *iov, const int *n, size_t n_entries) {
+        PROTECT_ERRNO;
+        _cleanup_free_ struct iovec *w = NULL;
+        _cleanup_free_ uint64_t *l = NULL;
+        _cleanup_free_ char *buffer = NULL;
+        size_t i, j = 0, n_fields = 0, offset = 0, size;
+        char *p;
+        int r;
+
+        assert_return(n_entries == 0 || (iov && n), -EINVAL);
+
+        if (n_entries == 0)
+                return 0;
+
+        for (i = 0; i < n_entries; i++) {
+                assert_return(n[i] > 0, -EINVAL);
+                n_fields += n[i];
+        }
+
+        /* 5 iovecs per field, 3 for the implicit SYSLOG_IDENTIFIER= and one for the entry separator */
+        w = new(struct iovec, n_fields * 5 + n_entries * 4);
+        l = new(uint64_t, n_fields);
+        if (!w || !l)
+                return -ENOMEM;
+
+        for (i = 0; i < n_entries; i++) {
+                /* Entries are separated by an empty line, journald knows how to split them up again */
+                if (i > 0)
+                        w[j++] = IOVEC_MAKE_STRING("\n");
+
+                r = journal_fill_iovec(iov + offset, n[i], w, &j, l + offset);
+                if (r < 0)
+                        return r;
+
+                offset += n[i];
+        }
+
+        /* The number of iovecs might easily exceed IOV_MAX for a large batch, hence send it as a single flat
+         * buffer. Copying the data is still a lot cheaper than a syscall and a journald wakeup per entry. */
+        size = IOVEC_TOTAL_SIZE(w, j);
+        buffer = malloc(size);
+        if (!buffer)
+                return -ENOMEM;
+
+        for (i = 0, p = buffer; i < j; i++)
+                p = mempcpy(p, w[i].iov_base, w[i].iov_len);
+
+        return journal_send_iovec(&IOVEC_MAKE(buffer, size), 1);
+}
+
 static int fill_iovec_perror_and_send(const char *message, int skip, struct iovec iov[]) {
         PROTECT_ERRNO;
         size_t n, k;
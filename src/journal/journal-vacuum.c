@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <fcntl.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -10,6 +11,7 @@
 #include "dirent-util.h"
 #include "fd-util.h"
 #include "fs-util.h"
+#include "hashmap.h"
 #include "journal-def.h"
 #include "journal-file.h"
 #include "journal-vacuum.h"
@@ -30,6 +32,54 @@ struct vacuum_info {
         bool have_seqnum;
 };
 
+/* What we learnt about an archived file in a previous run, so that we don't have to open it again. Archived
+ * files are never modified, hence as long as the inode is the same, so is the information. */
+typedef struct VacuumCacheEntry {
+        char *filename;
+        dev_t dev;
+        ino_t ino;
+        uint64_t realtime;
+} VacuumCacheEntry;
+
+static VacuumCacheEntry* vacuum_cache_entry_free(VacuumCacheEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->filename);
+        return mfree(e);
+}
+
+Hashmap* journal_vacuum_cache_free(Hashmap *cache) {
+        return hashmap_free_with_destructor(cache, vacuum_cache_entry_free);
+}
+
+static void vacuum_cache_add(Hashmap **cache, const char *filename, const struct stat *st, uint64_t realtime) {
+        VacuumCacheEntry *e;
+
+        assert(cache);
+        assert(filename);
+        assert(st);
+
+        /* Failing to cache something is not fatal, we'll just have to look at the file again next time */
+
+        if (hashmap_ensure_allocated(cache, &string_hash_ops) < 0)
+                return;
+
+        e = new(VacuumCacheEntry, 1);
+        if (!e)
+                return;
+
+        *e = (VacuumCacheEntry) {
+                .filename = strdup(filename),
+                .dev = st->st_dev,
+                .ino = st->st_ino,
+                .realtime = realtime,
+        };
+
+        if (!e->filename || hashmap_put(*cache, e->filename, e) < 0)
+                vacuum_cache_entry_free(e);
+}
+
 static int vacuum_compare(const struct vacuum_info *a, const struct vacuum_info *b) {
         int r;
 
@@ -118,7 +168,27 @@ static int journal_file_empty(int dir_fd, const char *name) {
         return le64toh(n_entries) <= 0;
 }
 
-int journal_directory_vacuum(
+static int vacuum_rewrite_temporary(int dir_fd, const char *fn) {
+        _cleanup_close_ int fd = -1;
+
+        /* The worker rewriting an archived file keeps its temporary file locked. If we can take the lock, the
+         * worker is gone and the file is left over from an interrupted rewrite. */
+
+        fd = openat(dir_fd, fn, O_RDONLY|O_CLOEXEC|O_NOCTTY|O_NOFOLLOW|O_NONBLOCK);
+        if (fd < 0)
+                return -errno;
+
+        if (flock(fd, LOCK_EX|LOCK_NB) < 0)
+                return -errno;
+
+        if (unlinkat(dir_fd, fn, 0) < 0)
+                return -errno;
+
+        return 0;
+}
+
+int journal_directory_vacuum_cached(
+                Hashmap **cache,
                 const char *directory,
                 uint64_t max_use,
                 uint64_t n_max_files,
@@ -128,6 +198,7 @@ int journal_directory_vacuum(
 
         uint64_t sum = 0, freed = 0, n_active_files = 0;
         size_t n_list = 0, n_allocated = 0, i;
+        Hashmap *new_cache = NULL;
         _cleanup_closedir_ DIR *d = NULL;
         struct vacuum_info *list = NULL;
         usec_t retention_limit = 0;
@@ -152,6 +223,7 @@ int journal_directory_vacuum(
                 unsigned long long seqnum = 0, realtime;
                 _cleanup_free_ char *p = NULL;
                 sd_id128_t seqnum_id;
+                VacuumCacheEntry *e = NULL;
                 bool have_seqnum;
                 uint64_t size;
                 struct stat st;
@@ -231,6 +303,22 @@ int journal_directory_vacuum(
                         }
 
                         have_seqnum = false;
+                } else if (journal_file_is_rewrite_temporary(de->d_name)) {
+
+                        /* Remove what an interrupted rewrite left behind, but count a rewrite in progress */
+
+                        size = 512UL * (uint64_t) st.st_blocks;
+
+                        r = vacuum_rewrite_temporary(dirfd(d), de->d_name);
+                        if (r >= 0) {
+                                log_full(verbose ? LOG_INFO : LOG_DEBUG, "Deleted stale temporary journal %s/%s (%s).", directory, de->d_name, format_bytes(sbytes, sizeof(sbytes), size));
+                                freed += size;
+                        } else if (r == -EWOULDBLOCK)
+                                sum += size;
+                        else if (r != -ENOENT)
+                                log_warning_errno(r, "Failed to delete stale temporary journal %s/%s: %m", directory, de->d_name);
+
+                        continue;
                 } else {
                         /* We do not vacuum unknown files! */
                         log_debug("Not vacuuming unknown file %s.", de->d_name);
@@ -239,28 +327,47 @@ int journal_directory_vacuum(
 
                 size = 512UL * (uint64_t) st.st_blocks;
 
-                r = journal_file_empty(dirfd(d), p);
-                if (r < 0) {
-                        log_debug_errno(r, "Failed check if %s is empty, ignoring: %m", p);
-                        continue;
+                if (cache) {
+                        /* Move what we still know about into the new cache, which only contains files that still
+                         * exist once we are done. */
+                        e = hashmap_remove(*cache, p);
+                        if (e && (e->dev != st.st_dev || e->ino != st.st_ino))
+                                e = vacuum_cache_entry_free(e);
                 }
-                if (r > 0) {
-                        /* Always vacuum empty non-online files. */
 
-                        r = unlinkat_deallocate(dirfd(d), p, 0);
-                        if (r >= 0) {
+                if (e) {
+                        realtime = e->realtime;
+
+                        if (hashmap_ensure_allocated(&new_cache, &string_hash_ops) < 0 ||
+                            hashmap_put(new_cache, e->filename, e) < 0)
+                                vacuum_cache_entry_free(e);
+                } else {
+                        r = journal_file_empty(dirfd(d), p);
+                        if (r < 0) {
+                                log_debug_errno(r, "Failed check if %s is empty, ignoring: %m", p);
+                                continue;
+                        }
+                        if (r > 0) {
+                                /* Always vacuum empty non-online files. */
 
-                                log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                         "Deleted empty archived journal %s/%s (%s).", directory, p, format_bytes(sbytes, sizeof(sbytes), size));
+                                r = unlinkat_deallocate(dirfd(d), p, 0);
+                                if (r >= 0) {
 
-                                freed += size;
-                        } else if (r != -ENOENT)
-                                log_warning_errno(r, "Failed to delete empty archived journal %s/%s: %m", directory, p);
+                                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
+                                                 "Deleted empty archived journal %s/%s (%s).", directory, p, format_bytes(sbytes, sizeof(sbytes), size));
 
-                        continue;
-                }
+                                        freed += size;
+                                } else if (r != -ENOENT)
+                                        log_warning_errno(r, "Failed to delete empty archived journal %s/%s: %m", directory, p);
+
+                                continue;
+                        }
 
-                patch_realtime(dirfd(d), p, &st, &realtime);
+                        patch_realtime(dirfd(d), p, &st, &realtime);
+
+                        if (cache)
+                                vacuum_cache_add(&new_cache, p, &st, realtime);
+                }
 
                 if (!GREEDY_REALLOC(list, n_allocated, n_list + 1)) {
                         r = -ENOMEM;
@@ -296,6 +403,8 @@ int journal_directory_vacuum(
                         log_full(verbose ? LOG_INFO : LOG_DEBUG, "Deleted archived journal %s/%s (%s).", directory, list[i].filename, format_bytes(sbytes, sizeof(sbytes), list[i].usage));
                         freed += list[i].usage;
 
+                        vacuum_cache_entry_free(hashmap_remove(new_cache, list[i].filename));
+
                         if (list[i].usage < sum)
                                 sum -= list[i].usage;
                         else
@@ -315,7 +424,24 @@ finish:
                 free(list[i].filename);
         free(list);
 
+        /* Whatever is left in the old cache refers to files that are gone */
+        if (cache) {
+                journal_vacuum_cache_free(*cache);
+                *cache = new_cache;
+        }
+
         log_full(verbose ? LOG_INFO : LOG_DEBUG, "Vacuuming done, freed %s of archived journals from %s.", format_bytes(sbytes, sizeof(sbytes), freed), directory);
 
         return r;
 }
+
+int journal_directory_vacuum(
+                const char *directory,
+                uint64_t max_use,
+                uint64_t n_max_files,
+                usec_t max_retention_usec,
+                usec_t *oldest_usec,
+                bool verbose) {
+
+        return journal_directory_vacuum_cached(NULL, directory, max_use, n_max_files, max_retention_usec, oldest_usec, verbose);
+}
@@ -4,6 +4,12 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include "hashmap.h"
 #include "time-util.h"
 
 int journal_directory_vacuum(const char *directory, uint64_t max_use, uint64_t n_max_files, usec_t max_retention_usec, usec_t *oldest_usec, bool verbose);
+
+/* Same, but remembers what it learnt about the archived files in *cache, so that subsequent runs don't need to open
+ * them again. */
+int journal_directory_vacuum_cached(Hashmap **cache, const char *directory, uint64_t max_use, uint64_t n_max_files, usec_t max_retention_usec, usec_t *oldest_usec, bool verbose);
+Hashmap* journal_vacuum_cache_free(Hashmap *cache);
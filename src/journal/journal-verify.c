@@ -118,7 +118,7 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
          * possible field values. It does not follow any references to
          * other objects. */
 
-        if ((o->object.flags & OBJECT_COMPRESSED_XZ) &&
+        if ((o->object.flags & OBJECT_COMPRESSION_MASK) &&
             o->object.type != OBJECT_DATA) {
                 error(offset, "Found compressed object that isn't of type DATA, which is not allowed.");
                 return -EBADMSG;
@@ -162,9 +162,9 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                                 return r;
                         }
 
-                        h2 = hash64(b, b_size);
+                        h2 = journal_file_hash_data(f, b, b_size);
                 } else
-                        h2 = hash64(o->data.payload, le64toh(o->object.size) - offsetof(Object, data.payload));
+                        h2 = journal_file_hash_data(f, o->data.payload, le64toh(o->object.size) - offsetof(Object, data.payload));
 
                 if (h1 != h2) {
                         error(offset, "Invalid hash (%08"PRIx64" vs. %08"PRIx64, h1, h2);
@@ -206,7 +206,7 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                 break;
 
         case OBJECT_ENTRY:
-                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) % sizeof(EntryItem) != 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) % journal_file_entry_item_size(f) != 0) {
                         error(offset,
                               "Bad entry size (<= %zu): %"PRIu64,
                               offsetof(EntryObject, items),
@@ -214,10 +214,10 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
-                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) / sizeof(EntryItem) <= 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryObject, items)) / journal_file_entry_item_size(f) <= 0) {
                         error(offset,
                               "Invalid number items in entry: %"PRIu64,
-                              (le64toh(o->object.size) - offsetof(EntryObject, items)) / sizeof(EntryItem));
+                              (le64toh(o->object.size) - offsetof(EntryObject, items)) / journal_file_entry_item_size(f));
                         return -EBADMSG;
                 }
 
@@ -242,13 +242,13 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
-                for (i = 0; i < journal_file_entry_n_items(o); i++) {
-                        if (le64toh(o->entry.items[i].object_offset) == 0 ||
-                            !VALID64(le64toh(o->entry.items[i].object_offset))) {
+                for (i = 0; i < journal_file_entry_n_items(f, o); i++) {
+                        if (journal_file_entry_item_object_offset(f, o, i) == 0 ||
+                            !VALID64(journal_file_entry_item_object_offset(f, o, i))) {
                                 error(offset,
                                       "Invalid entry item (%"PRIu64"/%"PRIu64" offset: "OFSfmt,
-                                      i, journal_file_entry_n_items(o),
-                                      le64toh(o->entry.items[i].object_offset));
+                                      i, journal_file_entry_n_items(f, o),
+                                      journal_file_entry_item_object_offset(f, o, i));
                                 return -EBADMSG;
                         }
                 }
@@ -301,8 +301,8 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                 break;
 
         case OBJECT_ENTRY_ARRAY:
-                if ((le64toh(o->object.size) - offsetof(EntryArrayObject, items)) % sizeof(le64_t) != 0 ||
-                    (le64toh(o->object.size) - offsetof(EntryArrayObject, items)) / sizeof(le64_t) <= 0) {
+                if ((le64toh(o->object.size) - offsetof(EntryArrayObject, items)) % journal_file_entry_array_item_size(f) != 0 ||
+                    (le64toh(o->object.size) - offsetof(EntryArrayObject, items)) / journal_file_entry_array_item_size(f) <= 0) {
                         error(offset,
                               "Invalid object entry array size: %"PRIu64,
                               le64toh(o->object.size));
@@ -316,13 +316,13 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
-                for (i = 0; i < journal_file_entry_array_n_items(o); i++)
-                        if (le64toh(o->entry_array.items[i]) != 0 &&
-                            !VALID64(le64toh(o->entry_array.items[i]))) {
+                for (i = 0; i < journal_file_entry_array_n_items(f, o); i++)
+                        if (journal_file_entry_array_item(f, o, i) != 0 &&
+                            !VALID64(journal_file_entry_array_item(f, o, i))) {
                                 error(offset,
                                       "Invalid object entry array item (%"PRIu64"/%"PRIu64"): "OFSfmt,
-                                      i, journal_file_entry_array_n_items(o),
-                                      le64toh(o->entry_array.items[i]));
+                                      i, journal_file_entry_array_n_items(f, o),
+                                      journal_file_entry_array_item(f, o, i));
                                 return -EBADMSG;
                         }
 
@@ -343,6 +343,30 @@ static int journal_file_object_verify(JournalFile *f, uint64_t offset, Object *o
                         return -EBADMSG;
                 }
 
+                break;
+
+        case OBJECT_BLOOM_FILTER:
+                if (!JOURNAL_HEADER_BLOOM_FILTER(f->header)) {
+                        error(offset, "Bloom filter object in file without bloom filter flag");
+                        return -EBADMSG;
+                }
+
+                if ((le64toh(o->object.size) - offsetof(BloomFilterObject, bits)) % BLOOM_FILTER_BLOCK_SIZE != 0 ||
+                    (le64toh(o->object.size) - offsetof(BloomFilterObject, bits)) / BLOOM_FILTER_BLOCK_SIZE <= 0) {
+                        error(offset,
+                              "Invalid object bloom filter size: %"PRIu64,
+                              le64toh(o->object.size));
+                        return -EBADMSG;
+                }
+
+                if (le64toh(o->bloom_filter.n_functions) <= 0 ||
+                    le64toh(o->bloom_filter.n_functions) > BLOOM_FILTER_BLOCK_SIZE * 8) {
+                        error(offset,
+                              "Invalid object bloom filter number of functions: %"PRIu64,
+                              le64toh(o->bloom_filter.n_functions));
+                        return -EBADMSG;
+                }
+
                 break;
         }
 
@@ -419,9 +443,9 @@ static int entry_points_to_data(
         if (r < 0)
                 return r;
 
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(f, o);
         for (i = 0; i < n; i++)
-                if (le64toh(o->entry.items[i].object_offset) == data_p) {
+                if (journal_file_entry_item_object_offset(f, o, i) == data_p) {
                         found = true;
                         break;
                 }
@@ -446,10 +470,10 @@ static int entry_points_to_data(
                 if (r < 0)
                         return r;
 
-                m = journal_file_entry_array_n_items(o);
+                m = journal_file_entry_array_n_items(f, o);
                 u = MIN(n - i, m);
 
-                if (entry_p <= le64toh(o->entry_array.items[u-1])) {
+                if (entry_p <= journal_file_entry_array_item(f, o, u-1)) {
                         uint64_t x, y, z;
 
                         x = 0;
@@ -458,13 +482,13 @@ static int entry_points_to_data(
                         while (x < y) {
                                 z = (x + y) / 2;
 
-                                if (le64toh(o->entry_array.items[z]) == entry_p)
+                                if (journal_file_entry_array_item(f, o, z) == entry_p)
                                         return 0;
 
                                 if (x + 1 >= y)
                                         break;
 
-                                if (entry_p < le64toh(o->entry_array.items[z]))
+                                if (entry_p < journal_file_entry_array_item(f, o, z))
                                         y = z;
                                 else
                                         x = z;
@@ -539,10 +563,10 @@ static int verify_data(
                         return -EBADMSG;
                 }
 
-                m = journal_file_entry_array_n_items(o);
+                m = journal_file_entry_array_n_items(f, o);
                 for (j = 0; i < n && j < m; i++, j++) {
 
-                        q = le64toh(o->entry_array.items[j]);
+                        q = journal_file_entry_array_item(f, o, j);
                         if (q <= last) {
                                 error(p, "Data object's entry array not sorted");
                                 return -EBADMSG;
@@ -682,13 +706,13 @@ static int verify_entry(
         assert(o);
         assert(cache_data_fd);
 
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(f, o);
         for (i = 0; i < n; i++) {
                 uint64_t q, h;
                 Object *u;
 
-                q = le64toh(o->entry.items[i].object_offset);
-                h = le64toh(o->entry.items[i].hash);
+                q = journal_file_entry_item_object_offset(f, o, i);
+                h = JOURNAL_HEADER_COMPACT(f->header) ? 0 : le64toh(o->entry.items.regular[i].hash);
 
                 if (!contains_uint64(f->mmap, cache_data_fd, n_data, q)) {
                         error(p, "Invalid data object of entry");
@@ -699,7 +723,9 @@ static int verify_entry(
                 if (r < 0)
                         return r;
 
-                if (le64toh(u->data.hash) != h) {
+                if (JOURNAL_HEADER_COMPACT(f->header))
+                        h = le64toh(u->data.hash);
+                else if (le64toh(u->data.hash) != h) {
                         error(p, "Hash mismatch for data object of entry");
                         return -EBADMSG;
                 }
@@ -762,11 +788,11 @@ static int verify_entry_array(
                         return -EBADMSG;
                 }
 
-                m = journal_file_entry_array_n_items(o);
+                m = journal_file_entry_array_n_items(f, o);
                 for (j = 0; i < n && j < m; i++, j++) {
                         uint64_t p;
 
-                        p = le64toh(o->entry_array.items[j]);
+                        p = journal_file_entry_array_item(f, o, j);
                         if (p <= last) {
                                 error(a, "Entry array not sorted at %"PRIu64" of %"PRIu64, i, n);
                                 return -EBADMSG;
@@ -809,7 +835,7 @@ int journal_file_verify(
 
         uint64_t entry_seqnum = 0, entry_monotonic = 0, entry_realtime = 0;
         sd_id128_t entry_boot_id;
-        bool entry_seqnum_set = false, entry_monotonic_set = false, entry_realtime_set = false, found_main_entry_array = false;
+        bool entry_seqnum_set = false, entry_monotonic_set = false, entry_realtime_set = false, found_main_entry_array = false, found_bloom_filter = false;
         uint64_t n_weird = 0, n_objects = 0, n_entries = 0, n_data = 0, n_fields = 0, n_data_hash_tables = 0, n_field_hash_tables = 0, n_entry_arrays = 0, n_tags = 0;
         usec_t last_usec = 0;
         int data_fd = -1, entry_fd = -1, entry_array_fd = -1;
@@ -897,6 +923,8 @@ int journal_file_verify(
 
         p = le64toh(f->header->header_size);
         for (;;) {
+                int c;
+
                 /* Early exit if there are no objects in the file, at all */
                 if (le64toh(f->header->tail_object_offset) == 0)
                         break;
@@ -924,8 +952,8 @@ int journal_file_verify(
                         goto fail;
                 }
 
-                if ((o->object.flags & OBJECT_COMPRESSED_XZ) &&
-                    (o->object.flags & OBJECT_COMPRESSED_LZ4)) {
+                c = o->object.flags & OBJECT_COMPRESSION_MASK;
+                if (c & (c - 1)) {
                         error(p, "Objected with double compression");
                         r = -EINVAL;
                         goto fail;
@@ -943,6 +971,12 @@ int journal_file_verify(
                         goto fail;
                 }
 
+                if ((o->object.flags & OBJECT_COMPRESSED_ZSTD) && !JOURNAL_HEADER_COMPRESSED_ZSTD(f->header)) {
+                        error(p, "ZSTD compressed object in file without ZSTD compression");
+                        r = -EBADMSG;
+                        goto fail;
+                }
+
                 switch (o->object.type) {
 
                 case OBJECT_DATA:
@@ -950,6 +984,15 @@ int journal_file_verify(
                         if (r < 0)
                                 goto fail;
 
+                        r = journal_file_bloom_filter_test(f, le64toh(o->data.hash));
+                        if (r < 0)
+                                goto fail;
+                        if (r == 0) {
+                                error(p, "Data object missing in bloom filter");
+                                r = -EBADMSG;
+                                goto fail;
+                        }
+
                         n_data++;
                         break;
 
@@ -1156,6 +1199,14 @@ int journal_file_verify(
                         n_tags++;
                         break;
 
+                case OBJECT_BLOOM_FILTER:
+                        /* Stale bloom filters are left behind if data objects are added after they were
+                         * written, hence only look at the one the header points to */
+                        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+                            p == le64toh(f->header->bloom_filter_offset))
+                                found_bloom_filter = true;
+                        break;
+
                 default:
                         n_weird++;
                 }
@@ -1174,6 +1225,14 @@ int journal_file_verify(
                 goto fail;
         }
 
+        if (JOURNAL_HEADER_CONTAINS(f->header, bloom_filter_offset) &&
+            le64toh(f->header->bloom_filter_offset) != 0 &&
+            !found_bloom_filter) {
+                error(le64toh(f->header->bloom_filter_offset), "Bloom filter pointer dead");
+                r = -EBADMSG;
+                goto fail;
+        }
+
         if (n_objects != le64toh(f->header->n_objects)) {
                 error(offsetof(Header, n_objects), "Object number mismatch");
                 r = -EBADMSG;
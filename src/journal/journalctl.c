@@ -7,9 +7,11 @@
 #include <linux/fs.h>
 #include <locale.h>
 #include <poll.h>
+#include <sched.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdio_ext.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/inotify.h>
@@ -54,6 +56,7 @@
 #include "pager.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "process-util.h"
 #include "rlimit-util.h"
 #include "set.h"
 #include "sigbus.h"
@@ -148,6 +151,8 @@ static char **arg_output_fields = NULL;
 #if HAVE_PCRE2
 static const char *arg_pattern = NULL;
 static pcre2_code *arg_compiled_pattern = NULL;
+static pcre2_match_data *arg_compiled_pattern_md = NULL;
+static bool arg_pattern_literal = false; /* pattern is a case sensitive plain string */
 static int arg_case_sensitive = -1; /* -1 means be smart */
 #endif
 
@@ -1003,6 +1008,18 @@ static int parse_argv(int argc, char *argv[]) {
                 r = pattern_compile(arg_pattern, flags, &arg_compiled_pattern);
                 if (r < 0)
                         return r;
+
+                /* The pattern is matched against every single entry, hence it's worth compiling it to
+                 * machine code. If JIT is not available, pcre2_match() interprets the pattern as before. */
+                (void) pcre2_jit_compile(arg_compiled_pattern, PCRE2_JIT_COMPLETE);
+
+                arg_compiled_pattern_md = pcre2_match_data_create(1, NULL);
+                if (!arg_compiled_pattern_md)
+                        return log_oom();
+
+                /* Plain strings can be looked for with memmem() first, so that only matching messages need
+                 * to go through the pattern matching. */
+                arg_pattern_literal = !(flags & PCRE2_CASELESS) && !strpbrk(arg_pattern, "\\^$.[]|()?*+{}");
         }
 #endif
 
@@ -1192,6 +1209,138 @@ static int discover_next_boot(sd_journal *j,
         return 0;
 }
 
+static int boot_id_compare_id(const BootId *a, const BootId *b) {
+        return memcmp(&a->id, &b->id, sizeof(a->id));
+}
+
+static int boot_id_compare_first(const BootId *a, const BootId *b) {
+        if (a->first < b->first)
+                return -1;
+        if (a->first > b->first)
+                return 1;
+        return 0;
+}
+
+static int collect_boots_in_file(JournalFile *f, BootId **boots, size_t *n_boots, size_t *n_allocated) {
+        uint64_t q;
+        Object *o;
+        int r;
+
+        assert(f);
+        assert(boots);
+        assert(n_boots);
+        assert(n_allocated);
+
+        r = journal_file_find_field_object(f, "_BOOT_ID", STRLEN("_BOOT_ID"), &o, NULL);
+        if (r <= 0)
+                return r;
+
+        /* All data objects of a field are chained up, and each of them links to the entries referencing it,
+         * hence we can look up the first and last entry of every boot directly. */
+
+        for (q = le64toh(o->field.head_data_offset); q > 0; ) {
+                char s[SD_ID128_STRING_MAX];
+                sd_id128_t id;
+                uint64_t l, next, first;
+
+                r = journal_file_move_to_object(f, OBJECT_DATA, q, &o);
+                if (r < 0)
+                        return r;
+
+                /* Give up on the unlikely case someone lowered the compression threshold that much */
+                if (o->object.flags & OBJECT_COMPRESSION_MASK)
+                        return -EOPNOTSUPP;
+
+                l = le64toh(o->object.size) - offsetof(Object, data.payload);
+                if (l != STRLEN("_BOOT_ID=") + 32 || !memory_startswith(o->data.payload, l, "_BOOT_ID="))
+                        return -EBADMSG;
+
+                memcpy(s, o->data.payload + STRLEN("_BOOT_ID="), 32);
+                s[32] = 0;
+
+                r = sd_id128_from_string(s, &id);
+                if (r < 0)
+                        return r;
+
+                next = le64toh(o->data.next_field_offset);
+
+                r = journal_file_next_entry_for_data(f, NULL, 0, q, DIRECTION_DOWN, &o, NULL);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        first = le64toh(o->entry.realtime);
+
+                        r = journal_file_next_entry_for_data(f, NULL, 0, q, DIRECTION_UP, &o, NULL);
+                        if (r < 0)
+                                return r;
+
+                        if (!GREEDY_REALLOC(*boots, *n_allocated, *n_boots + 1))
+                                return -ENOMEM;
+
+                        (*boots)[(*n_boots)++] = (BootId) {
+                                .id = id,
+                                .first = first,
+                                .last = le64toh(o->entry.realtime),
+                        };
+                }
+
+                q = next;
+        }
+
+        return 0;
+}
+
+static int get_boots_from_files(sd_journal *j, BootId **ret) {
+        _cleanup_free_ BootId *boots = NULL;
+        size_t n_boots = 0, n_allocated = 0, i, k;
+        BootId *head = NULL, *tail = NULL;
+        JournalFile *f;
+        Iterator it;
+        int r;
+
+        assert(j);
+        assert(ret);
+
+        /* Determines the list of boots from the entry arrays journald maintains for each _BOOT_ID= value
+         * anyway, without iterating through the journal. Boots covered by more than one file are merged. */
+
+        ORDERED_HASHMAP_FOREACH(f, j->files, it) {
+                r = collect_boots_in_file(f, &boots, &n_boots, &n_allocated);
+                if (r < 0)
+                        return r;
+        }
+
+        typesafe_qsort(boots, n_boots, boot_id_compare_id);
+
+        for (i = 0, k = 0; i < n_boots; i++) {
+                if (k > 0 && sd_id128_equal(boots[k-1].id, boots[i].id)) {
+                        boots[k-1].first = MIN(boots[k-1].first, boots[i].first);
+                        boots[k-1].last = MAX(boots[k-1].last, boots[i].last);
+                } else
+                        boots[k++] = boots[i];
+        }
+        n_boots = k;
+
+        typesafe_qsort(boots, n_boots, boot_id_compare_first);
+
+        for (i = 0; i < n_boots; i++) {
+                BootId *id;
+
+                id = newdup(BootId, boots + i, 1);
+                if (!id) {
+                        boot_id_free_all(head);
+                        return -ENOMEM;
+                }
+
+                LIST_INIT(boot_list, id);
+                LIST_INSERT_AFTER(boot_list, head, tail, id);
+                tail = id;
+        }
+
+        *ret = head;
+        return (int) n_boots;
+}
+
 static int get_boots(
                 sd_journal *j,
                 BootId **boots,
@@ -1206,6 +1355,52 @@ static int get_boots(
 
         assert(j);
 
+        r = get_boots_from_files(j, &head);
+        if (r >= 0) {
+                int n = r, k = -1;
+
+                if (!boot_id) {
+                        if (boots)
+                                *boots = head;
+                        else
+                                boot_id_free_all(head);
+
+                        return n;
+                }
+
+                /* Offset 0 is the last boot, 1 the first one, and negative offsets count back from the last
+                 * one, unless a reference boot ID is given, which offsets are then relative to. */
+                if (sd_id128_is_null(*boot_id))
+                        k = offset <= 0 ? n - 1 + offset : offset - 1;
+                else {
+                        int i = 0;
+
+                        LIST_FOREACH(boot_list, id, head) {
+                                if (sd_id128_equal(id->id, *boot_id)) {
+                                        k = i + offset;
+                                        break;
+                                }
+                                i++;
+                        }
+                }
+
+                count = 0;
+                if (k >= 0 && k < n) {
+                        id = head;
+                        for (; k > 0; k--)
+                                id = id->boot_list_next;
+
+                        *boot_id = id->id;
+                        count = 1;
+                }
+
+                boot_id_free_all(head);
+                return count;
+        }
+
+        log_debug_errno(r, "Failed to determine boots from _BOOT_ID= fields, iterating through journal instead: %m");
+        head = NULL;
+
         /* Adjust for the asymmetry that offset 0 is
          * the last (and current) boot, while 1 is considered the
          * (chronological) first boot in the journal. */
@@ -1837,48 +2032,125 @@ finish:
 #endif
 }
 
+static int verify_one(JournalFile *f, bool show_progress) {
+        usec_t first = 0, validated = 0, last = 0;
+        int k;
+
+        assert(f);
+
+#if HAVE_GCRYPT
+        if (!arg_verify_key && JOURNAL_HEADER_SEALED(f->header))
+                log_notice("Journal file %s has sealing enabled but verification key has not been passed using --verify-key=.", f->path);
+#endif
+
+        k = journal_file_verify(f, arg_verify_key, &first, &validated, &last, show_progress);
+        if (k == -EINVAL)
+                /* If the key was invalid give up right-away. */
+                return k;
+        else if (k < 0)
+                log_warning_errno(k, "FAIL: %s (%m)", f->path);
+        else {
+                char a[FORMAT_TIMESTAMP_MAX], b[FORMAT_TIMESTAMP_MAX], c[FORMAT_TIMESPAN_MAX];
+                log_info("PASS: %s", f->path);
+
+                if (arg_verify_key && JOURNAL_HEADER_SEALED(f->header)) {
+                        if (validated > 0) {
+                                log_info("=> Validated from %s to %s, final %s entries not sealed.",
+                                         format_timestamp_maybe_utc(a, sizeof(a), first),
+                                         format_timestamp_maybe_utc(b, sizeof(b), validated),
+                                         format_timespan(c, sizeof(c), last > validated ? last - validated : 0, 0));
+                        } else if (last > 0)
+                                log_info("=> No sealing yet, %s of entries not sealed.",
+                                         format_timespan(c, sizeof(c), last - first, 0));
+                        else
+                                log_info("=> No sealing yet, no entries in file.");
+                }
+        }
+
+        return k;
+}
+
+static int verify_wait(pid_t pid) {
+        int r;
+
+        /* Workers exit with the negated return value of verify_one() */
+        r = wait_for_terminate_and_check("(journal-verify)", pid, WAIT_LOG_ABNORMAL);
+        if (r < 0)
+                return r;
+
+        return -r;
+}
+
 static int verify(sd_journal *j) {
-        int r = 0;
-        Iterator i;
+        _cleanup_free_ pid_t *pids = NULL;
+        unsigned n_workers, n_running = 0, head = 0;
+        cpu_set_t cpu_set;
         JournalFile *f;
+        Iterator i;
+        int r = 0, k;
 
         assert(j);
 
         log_show_color(true);
 
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) >= 0)
+                n_workers = CPU_COUNT(&cpu_set);
+        else
+                n_workers = 1;
+        n_workers = MIN(n_workers, ordered_hashmap_size(j->files));
+
+        if (n_workers <= 1) {
+                ORDERED_HASHMAP_FOREACH(f, j->files, i) {
+                        k = verify_one(f, true);
+                        if (k == -EINVAL)
+                                return k;
+                        if (k < 0)
+                                r = k;
+                }
+
+                return r;
+        }
+
+        /* Files are verified independently of each other, hence do so in parallel, one worker process per
+         * file and at most as many at a time as we may use CPUs. The progress bar is turned off, as the
+         * workers would draw over each other's. */
+
+        pids = new(pid_t, n_workers);
+        if (!pids)
+                return log_oom();
+
         ORDERED_HASHMAP_FOREACH(f, j->files, i) {
-                int k;
-                usec_t first = 0, validated = 0, last = 0;
+                pid_t pid;
 
-#if HAVE_GCRYPT
-                if (!arg_verify_key && JOURNAL_HEADER_SEALED(f->header))
-                        log_notice("Journal file %s has sealing enabled but verification key has not been passed using --verify-key=.", f->path);
-#endif
+                if (n_running >= n_workers) {
+                        k = verify_wait(pids[head]);
+                        head = (head + 1) % n_workers;
+                        n_running--;
+
+                        if (k < 0)
+                                r = k;
+                        if (k == -EINVAL)
+                                break;
+                }
 
-                k = journal_file_verify(f, arg_verify_key, &first, &validated, &last, true);
-                if (k == -EINVAL) {
-                        /* If the key was invalid give up right-away. */
-                        return k;
-                } else if (k < 0) {
-                        log_warning_errno(k, "FAIL: %s (%m)", f->path);
+                k = safe_fork("(journal-verify)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_LOG, &pid);
+                if (k < 0) {
                         r = k;
-                } else {
-                        char a[FORMAT_TIMESTAMP_MAX], b[FORMAT_TIMESTAMP_MAX], c[FORMAT_TIMESPAN_MAX];
-                        log_info("PASS: %s", f->path);
-
-                        if (arg_verify_key && JOURNAL_HEADER_SEALED(f->header)) {
-                                if (validated > 0) {
-                                        log_info("=> Validated from %s to %s, final %s entries not sealed.",
-                                                 format_timestamp_maybe_utc(a, sizeof(a), first),
-                                                 format_timestamp_maybe_utc(b, sizeof(b), validated),
-                                                 format_timespan(c, sizeof(c), last > validated ? last - validated : 0, 0));
-                                } else if (last > 0)
-                                        log_info("=> No sealing yet, %s of entries not sealed.",
-                                                 format_timespan(c, sizeof(c), last - first, 0));
-                                else
-                                        log_info("=> No sealing yet, no entries in file.");
-                        }
+                        break;
                 }
+                if (k == 0)
+                        _exit((uint8_t) -verify_one(f, false));
+
+                pids[(head + n_running) % n_workers] = pid;
+                n_running++;
+        }
+
+        for (; n_running > 0; n_running--) {
+                k = verify_wait(pids[head]);
+                head = (head + 1) % n_workers;
+
+                if (k < 0 && r != -EINVAL)
+                        r = k;
         }
 
         return r;
@@ -2098,6 +2370,10 @@ int main(int argc, char *argv[]) {
         signal(SIGWINCH, columns_lines_cache_reset);
         sigbus_install();
 
+        /* We are single-threaded, hence don't bother with taking the stdio lock for each of the many small writes
+         * the output modes do per entry */
+        (void) __fsetlocking(stdout, FSETLOCKING_BYCALLER);
+
         switch (arg_action) {
 
         case ACTION_NEW_ID128:
@@ -2576,15 +2852,10 @@ int main(int argc, char *argv[]) {
 
 #if HAVE_PCRE2
                         if (arg_compiled_pattern) {
-                                _cleanup_(pcre2_match_data_freep) pcre2_match_data *md = NULL;
                                 const void *message;
                                 size_t len;
                                 PCRE2_SIZE *ovec;
 
-                                md = pcre2_match_data_create(1, NULL);
-                                if (!md)
-                                        return log_oom();
-
                                 r = sd_journal_get_data(j, "MESSAGE", &message, &len);
                                 if (r < 0) {
                                         if (r == -ENOENT) {
@@ -2598,12 +2869,18 @@ int main(int argc, char *argv[]) {
 
                                 assert_se(message = startswith(message, "MESSAGE="));
 
+                                if (arg_pattern_literal &&
+                                    !memmem(message, len - strlen("MESSAGE="), arg_pattern, strlen(arg_pattern))) {
+                                        need_seek = true;
+                                        continue;
+                                }
+
                                 r = pcre2_match(arg_compiled_pattern,
                                                 message,
                                                 len - strlen("MESSAGE="),
                                                 0,      /* start at offset 0 in the subject */
                                                 0,      /* default options */
-                                                md,
+                                                arg_compiled_pattern_md,
                                                 NULL);
                                 if (r == PCRE2_ERROR_NOMATCH) {
                                         need_seek = true;
@@ -2620,7 +2897,7 @@ int main(int argc, char *argv[]) {
                                         goto finish;
                                 }
 
-                                ovec = pcre2_get_ovector_pointer(md);
+                                ovec = pcre2_get_ovector_pointer(arg_compiled_pattern_md);
                                 highlight[0] = ovec[0];
                                 highlight[1] = ovec[1];
                         }
@@ -2700,6 +2977,8 @@ finish:
         free(arg_verify_key);
 
 #if HAVE_PCRE2
+        if (arg_compiled_pattern_md)
+                pcre2_match_data_free(arg_compiled_pattern_md);
         if (arg_compiled_pattern)
                 pcre2_code_free(arg_compiled_pattern);
 #endif
@@ -9,58 +9,131 @@
 #include "missing.h"
 #include "string-util.h"
 
+/* All the fields we decode from a single audit record. The strings are appended to a single buffer that is reused
+ * between records, and since that buffer might move while we are still adding fields, the iovecs beyond
+ * n_iov_fixed only carry their lengths until audit_record_fixup() is called. */
+typedef struct AuditRecord {
+        struct iovec *iov;
+        size_t n_iov_allocated, n_iov, n_iov_fixed;
+
+        char *buffer;
+        size_t buffer_allocated, buffer_size, field_start;
+} AuditRecord;
+
 typedef struct MapField {
         const char *audit_field;
         const char *journal_field;
-        int (*map)(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov);
+        int (*map)(const char *field, const char **p, AuditRecord *r);
 } MapField;
 
-static int map_simple_field(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov) {
-        _cleanup_free_ char *c = NULL;
-        size_t l = 0, allocated = 0;
-        const char *e;
+static int field_begin(AuditRecord *r, const char *field) {
+        size_t l;
 
+        assert(r);
         assert(field);
-        assert(p);
-        assert(iov);
-        assert(n_iov);
 
         l = strlen(field);
-        allocated = l + 1;
-        c = malloc(allocated);
-        if (!c)
+        if (!GREEDY_REALLOC(r->buffer, r->buffer_allocated, r->buffer_size + l + 1))
                 return -ENOMEM;
 
-        memcpy(c, field, l);
-        for (e = *p; !IN_SET(*e, 0, ' '); e++) {
-                if (!GREEDY_REALLOC(c, allocated, l+2))
-                        return -ENOMEM;
+        r->field_start = r->buffer_size;
+        r->buffer_size += l;
+        memcpy(r->buffer + r->field_start, field, l);
 
-                c[l++] = *e;
-        }
+        return 0;
+}
 
-        c[l] = 0;
+static int field_append(AuditRecord *r, char c) {
+        assert(r);
 
-        if (!GREEDY_REALLOC(*iov, *n_iov_allocated, *n_iov + 1))
+        if (!GREEDY_REALLOC(r->buffer, r->buffer_allocated, r->buffer_size + 2))
                 return -ENOMEM;
 
-        (*iov)[(*n_iov)++] = IOVEC_MAKE(c, l);
+        r->buffer[r->buffer_size++] = c;
+        return 0;
+}
 
-        *p = e;
-        c = NULL;
+static int field_append_many(AuditRecord *r, const char *s, size_t n) {
+        assert(r);
+        assert(s || n == 0);
+
+        if (!GREEDY_REALLOC(r->buffer, r->buffer_allocated, r->buffer_size + n + 1))
+                return -ENOMEM;
+
+        memcpy(r->buffer + r->buffer_size, s, n);
+        r->buffer_size += n;
+        return 0;
+}
+
+static void field_abort(AuditRecord *r) {
+        assert(r);
+
+        r->buffer_size = r->field_start;
+}
+
+static int field_end(AuditRecord *r) {
+        size_t l;
+
+        assert(r);
+
+        if (!GREEDY_REALLOC(r->iov, r->n_iov_allocated, r->n_iov + 1))
+                return -ENOMEM;
+
+        /* There's always room for the trailing NUL, see above */
+        l = r->buffer_size - r->field_start;
+        r->buffer[r->buffer_size++] = 0;
+
+        r->iov[r->n_iov++] = IOVEC_MAKE(NULL, l);
+        return 0;
+}
+
+static void audit_record_fixup(AuditRecord *r) {
+        size_t i, offset = 0;
+
+        assert(r);
+
+        /* Now that the buffer doesn't move anymore, let the iovecs point to their fields */
+        for (i = r->n_iov_fixed; i < r->n_iov; i++) {
+                r->iov[i].iov_base = r->buffer + offset;
+                offset += r->iov[i].iov_len + 1;
+        }
 
+        r->n_iov_fixed = r->n_iov;
+}
+
+static int map_simple_field(const char *field, const char **p, AuditRecord *r) {
+        const char *e;
+        int k;
+
+        assert(field);
+        assert(p);
+        assert(r);
+
+        k = field_begin(r, field);
+        if (k < 0)
+                return k;
+
+        e = *p + strcspn(*p, " ");
+
+        k = field_append_many(r, *p, e - *p);
+        if (k < 0)
+                return k;
+
+        k = field_end(r);
+        if (k < 0)
+                return k;
+
+        *p = e;
         return 1;
 }
 
-static int map_string_field_internal(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov, bool filter_printable) {
-        _cleanup_free_ char *c = NULL;
+static int map_string_field_internal(const char *field, const char **p, AuditRecord *r, bool filter_printable) {
         const char *s, *e;
-        size_t l;
+        int k;
 
         assert(field);
         assert(p);
-        assert(iov);
-        assert(n_iov);
+        assert(r);
 
         /* The kernel formats string fields in one of two formats. */
 
@@ -71,76 +144,71 @@ static int map_string_field_internal(const char *field, const char **p, struct i
                 if (!e)
                         return 0;
 
-                l = strlen(field) + (e - s);
-                c = malloc(l+1);
-                if (!c)
-                        return -ENOMEM;
+                k = field_begin(r, field);
+                if (k < 0)
+                        return k;
 
-                *((char*) mempcpy(stpcpy(c, field), s, e - s)) = 0;
+                k = field_append_many(r, s, e - s);
+                if (k < 0)
+                        return k;
 
                 e += 1;
 
         } else if (unhexchar(**p) >= 0) {
                 /* Hexadecimal escaping */
-                size_t allocated = 0;
 
-                l = strlen(field);
-                allocated = l + 2;
-                c = malloc(allocated);
-                if (!c)
-                        return -ENOMEM;
+                k = field_begin(r, field);
+                if (k < 0)
+                        return k;
 
-                memcpy(c, field, l);
                 for (e = *p; !IN_SET(*e, 0, ' '); e += 2) {
                         int a, b;
                         uint8_t x;
 
                         a = unhexchar(e[0]);
-                        if (a < 0)
+                        if (a < 0) {
+                                field_abort(r);
                                 return 0;
+                        }
 
                         b = unhexchar(e[1]);
-                        if (b < 0)
+                        if (b < 0) {
+                                field_abort(r);
                                 return 0;
+                        }
 
                         x = ((uint8_t) a << 4 | (uint8_t) b);
 
                         if (filter_printable && x < (uint8_t) ' ')
                                 x = (uint8_t) ' ';
 
-                        if (!GREEDY_REALLOC(c, allocated, l+2))
-                                return -ENOMEM;
-
-                        c[l++] = (char) x;
+                        k = field_append(r, (char) x);
+                        if (k < 0)
+                                return k;
                 }
-
-                c[l] = 0;
         } else
                 return 0;
 
-        if (!GREEDY_REALLOC(*iov, *n_iov_allocated, *n_iov + 1))
-                return -ENOMEM;
-
-        (*iov)[(*n_iov)++] = IOVEC_MAKE(c, l);
+        k = field_end(r);
+        if (k < 0)
+                return k;
 
         *p = e;
-        c = NULL;
-
         return 1;
 }
 
-static int map_string_field(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov) {
-        return map_string_field_internal(field, p, iov, n_iov_allocated, n_iov, false);
+static int map_string_field(const char *field, const char **p, AuditRecord *r) {
+        return map_string_field_internal(field, p, r, false);
 }
 
-static int map_string_field_printable(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov) {
-        return map_string_field_internal(field, p, iov, n_iov_allocated, n_iov, true);
+static int map_string_field_printable(const char *field, const char **p, AuditRecord *r) {
+        return map_string_field_internal(field, p, r, true);
 }
 
-static int map_generic_field(const char *prefix, const char **p, struct iovec **iov, size_t *n_iov_allocated, size_t *n_iov) {
+static int map_generic_field(const char *prefix, const char **p, AuditRecord *r) {
         const char *e, *f;
         char *c, *t;
-        int r;
+        int k;
 
         /* Implements fallback mappings for all fields we don't know */
 
@@ -181,12 +249,12 @@ static int map_generic_field(const char *prefix, const char **p, struct iovec **
 
         e++;
 
-        r = map_simple_field(c, &e, iov, n_iov_allocated, n_iov);
-        if (r < 0)
-                return r;
+        k = map_simple_field(c, &e, r);
+        if (k < 0)
+                return k;
 
         *p = e;
-        return r;
+        return k;
 }
 
 /* Kernel fields are those occurring in the audit string before
@@ -240,16 +308,12 @@ static int map_all_fields(
                 const MapField map_fields[],
                 const char *prefix,
                 bool handle_msg,
-                struct iovec **iov,
-                size_t *n_iov_allocated,
-                size_t *n_iov) {
+                AuditRecord *r) {
 
-        int r;
+        int k;
 
         assert(p);
-        assert(iov);
-        assert(n_iov_allocated);
-        assert(n_iov);
+        assert(r);
 
         for (;;) {
                 bool mapped = false;
@@ -280,7 +344,7 @@ static int map_all_fields(
                                         return 0; /* don't continue splitting up if the final quotation mark is missing */
 
                                 c = strndupa(v, e - v);
-                                return map_all_fields(c, map_fields_userspace, "AUDIT_FIELD_", false, iov, n_iov_allocated, n_iov);
+                                return map_all_fields(c, map_fields_userspace, "AUDIT_FIELD_", false, r);
                         }
                 }
 
@@ -290,11 +354,11 @@ static int map_all_fields(
                         if (!v)
                                 continue;
 
-                        r = m->map(m->journal_field, &v, iov, n_iov_allocated, n_iov);
-                        if (r < 0)
-                                return log_debug_errno(r, "Failed to parse audit array: %m");
+                        k = m->map(m->journal_field, &v, r);
+                        if (k < 0)
+                                return log_debug_errno(k, "Failed to parse audit array: %m");
 
-                        if (r > 0) {
+                        if (k > 0) {
                                 mapped = true;
                                 p = v;
                                 break;
@@ -302,11 +366,11 @@ static int map_all_fields(
                 }
 
                 if (!mapped) {
-                        r = map_generic_field(prefix, &p, iov, n_iov_allocated, n_iov);
-                        if (r < 0)
-                                return log_debug_errno(r, "Failed to parse audit array: %m");
+                        k = map_generic_field(prefix, &p, r);
+                        if (k < 0)
+                                return log_debug_errno(k, "Failed to parse audit array: %m");
 
-                        if (r == 0)
+                        if (k == 0)
                                 /* Couldn't process as generic field, let's just skip over it */
                                 p += strcspn(p, WHITESPACE);
                 }
@@ -314,8 +378,7 @@ static int map_all_fields(
 }
 
 void process_audit_string(Server *s, int type, const char *data, size_t size) {
-        size_t n_iov_allocated = 0, n_iov = 0, z;
-        _cleanup_free_ struct iovec *iov = NULL;
+        AuditRecord r;
         uint64_t seconds, msec, id;
         const char *p, *type_name;
         char id_field[sizeof("_AUDIT_ID=") + DECIMAL_STR_MAX(uint64_t)],
@@ -355,54 +418,61 @@ void process_audit_string(Server *s, int type, const char *data, size_t size) {
         if (isempty(p))
                 return;
 
-        n_iov_allocated = N_IOVEC_META_FIELDS + 8;
-        iov = new(struct iovec, n_iov_allocated);
-        if (!iov) {
+        /* Reuse the arrays from the previous record */
+        r = (AuditRecord) {
+                .iov = TAKE_PTR(s->audit_iovec),
+                .n_iov_allocated = s->audit_iovec_allocated,
+                .buffer = TAKE_PTR(s->audit_buffer),
+                .buffer_allocated = s->audit_buffer_allocated,
+        };
+
+        if (!GREEDY_REALLOC(r.iov, r.n_iov_allocated, N_IOVEC_META_FIELDS + 8)) {
                 log_oom();
-                return;
+                goto finish;
         }
 
-        iov[n_iov++] = IOVEC_MAKE_STRING("_TRANSPORT=audit");
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING("_TRANSPORT=audit");
 
         sprintf(source_time_field, "_SOURCE_REALTIME_TIMESTAMP=%" PRIu64,
                 (usec_t) seconds * USEC_PER_SEC + (usec_t) msec * USEC_PER_MSEC);
-        iov[n_iov++] = IOVEC_MAKE_STRING(source_time_field);
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING(source_time_field);
 
         sprintf(type_field, "_AUDIT_TYPE=%i", type);
-        iov[n_iov++] = IOVEC_MAKE_STRING(type_field);
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING(type_field);
 
         sprintf(id_field, "_AUDIT_ID=%" PRIu64, id);
-        iov[n_iov++] = IOVEC_MAKE_STRING(id_field);
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING(id_field);
 
         assert_cc(4 == LOG_FAC(LOG_AUTH));
-        iov[n_iov++] = IOVEC_MAKE_STRING("SYSLOG_FACILITY=4");
-        iov[n_iov++] = IOVEC_MAKE_STRING("SYSLOG_IDENTIFIER=audit");
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING("SYSLOG_FACILITY=4");
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING("SYSLOG_IDENTIFIER=audit");
 
         type_name = audit_type_name_alloca(type);
 
         type_field_name = strjoina("_AUDIT_TYPE_NAME=", type_name);
-        iov[n_iov++] = IOVEC_MAKE_STRING(type_field_name);
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING(type_field_name);
 
         m = strjoina("MESSAGE=", type_name, " ", p);
-        iov[n_iov++] = IOVEC_MAKE_STRING(m);
+        r.iov[r.n_iov++] = IOVEC_MAKE_STRING(m);
 
-        z = n_iov;
+        r.n_iov_fixed = r.n_iov;
 
-        map_all_fields(p, map_fields_kernel, "_AUDIT_FIELD_", true, &iov, &n_iov_allocated, &n_iov);
+        map_all_fields(p, map_fields_kernel, "_AUDIT_FIELD_", true, &r);
+        audit_record_fixup(&r);
 
-        if (!GREEDY_REALLOC(iov, n_iov_allocated, n_iov + N_IOVEC_META_FIELDS)) {
+        if (!GREEDY_REALLOC(r.iov, r.n_iov_allocated, r.n_iov + N_IOVEC_META_FIELDS)) {
                 log_oom();
                 goto finish;
         }
 
-        server_dispatch_message(s, iov, n_iov, n_iov_allocated, NULL, NULL, LOG_NOTICE, 0);
+        server_dispatch_message(s, SERVER_SOURCE_AUDIT, r.iov, r.n_iov, r.n_iov_allocated, NULL, NULL, LOG_NOTICE, 0);
 
 finish:
-        /* free() all entries that map_all_fields() added. All others
-         * are allocated on the stack or are constant. */
-
-        for (; z < n_iov; z++)
-                free(iov[z].iov_base);
+        /* Nothing in the arrays refers to anything we own beyond this point, hand them back for the next record */
+        s->audit_iovec = r.iov;
+        s->audit_iovec_allocated = r.n_iov_allocated;
+        s->audit_buffer = r.buffer;
+        s->audit_buffer_allocated = r.buffer_allocated;
 }
 
 void server_process_audit_message(
@@ -15,6 +15,7 @@
 #include "journald-context.h"
 #include "parse-util.h"
 #include "process-util.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "syslog-util.h"
 #include "unaligned.h"
@@ -56,16 +57,43 @@
 /* Data older than 5s we flush out */
 #define MAX_USEC (5*USEC_PER_SEC)
 
-/* Keep at most 16K entries in the cache. (Note though that this limit may be violated if enough streams pin entries in
- * the cache, in which case we *do* permit this limit to be breached. That's safe however, as the number of stream
- * clients itself is limited.) */
-#define CACHE_MAX (16*1024)
+/* Keep the settings of at most 1K units cached */
+#define UNIT_CACHE_MAX 1024
+
+typedef struct UnitContext {
+        usec_t timestamp;
+
+        int log_level_max;
+        usec_t log_rate_limit_interval;
+        unsigned log_rate_limit_burst;
+} UnitContext;
+
+/* The cache size is configurable with MetadataCacheMax=. (Note though that this limit may be violated if enough streams
+ * pin entries in the cache, in which case we *do* permit this limit to be breached. That's safe however, as the number of
+ * stream clients itself is limited.) */
+
+/* Clients we got this many messages from are considered frequent loggers */
+#define FREQUENT_HITS 8U
+
+static usec_t client_context_eviction_key(const ClientContext *c) {
+        assert(c);
+
+        /* Unpinned entries are evicted oldest first, but frequent loggers are treated as if they were refreshed
+         * MAX_USEC later, i.e. they are only evicted after all entries that are not used anymore anyway. This
+         * protects long-running clients which log a lot against being pushed out by a flood of short-lived
+         * processes that log only once or twice. */
+
+        if (c->n_hits >= FREQUENT_HITS)
+                return usec_add(c->timestamp, MAX_USEC);
+
+        return c->timestamp;
+}
 
 static int client_context_compare(const void *a, const void *b) {
         const ClientContext *x = a, *y = b;
         int r;
 
-        r = CMP(x->timestamp, y->timestamp);
+        r = CMP(client_context_eviction_key(x), client_context_eviction_key(y));
         if (r != 0)
                 return r;
 
@@ -116,11 +144,25 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
         return 0;
 }
 
+static void client_context_free_meta(ClientContext *c) {
+        size_t i;
+
+        assert(c);
+
+        for (i = 0; i < c->meta_n_iovec; i++)
+                free(c->meta_iovec[i].iov_base);
+
+        c->meta_n_iovec = 0;
+}
+
 static void client_context_reset(Server *s, ClientContext *c) {
         assert(s);
         assert(c);
 
+        client_context_free_meta(c);
+
         c->timestamp = USEC_INFINITY;
+        c->n_hits = 0;
 
         c->uid = UID_INVALID;
         c->gid = GID_INVALID;
@@ -317,30 +359,6 @@ static int client_context_read_invocation_id(
         return sd_id128_from_string(value, &c->invocation_id);
 }
 
-static int client_context_read_log_level_max(
-                Server *s,
-                ClientContext *c) {
-
-        _cleanup_free_ char *value = NULL;
-        const char *p;
-        int r, ll;
-
-        if (!c->unit)
-                return 0;
-
-        p = strjoina("/run/systemd/units/log-level-max:", c->unit);
-        r = readlink_malloc(p, &value);
-        if (r < 0)
-                return r;
-
-        ll = log_level_from_string(value);
-        if (ll < 0)
-                return -EINVAL;
-
-        c->log_level_max = ll;
-        return 0;
-}
-
 static int client_context_read_extra_fields(
                 Server *s,
                 ClientContext *c) {
@@ -431,40 +449,193 @@ static int client_context_read_extra_fields(
         return 0;
 }
 
-static int client_context_read_log_rate_limit_interval(ClientContext *c) {
+static void unit_contexts_flush(Server *s) {
+        UnitContext *u;
+        char *k;
+
+        assert(s);
+
+        while ((u = hashmap_steal_first_key_and_value(s->unit_contexts, (void**) &k))) {
+                free(k);
+                free(u);
+        }
+}
+
+static void unit_context_read(const char *unit, UnitContext *u) {
         _cleanup_free_ char *value = NULL;
         const char *p;
-        int r;
+        int ll;
+
+        assert(unit);
+        assert(u);
+
+        /* PID 1 stores the per-unit settings relevant for us as symlinks in /run/systemd/units/. Settings we
+         * fail to read are left unset, so that the values cached in the client contexts are kept. Note that the
+         * invocation ID is not among them, as it changes whenever the unit is restarted, see
+         * client_context_read_invocation_id(). */
+
+        *u = (UnitContext) {
+                .log_level_max = -1,
+                .log_rate_limit_interval = USEC_INFINITY,
+                .log_rate_limit_burst = UINT_MAX,
+        };
+
+        p = strjoina("/run/systemd/units/log-level-max:", unit);
+        if (readlink_malloc(p, &value) >= 0) {
+                ll = log_level_from_string(value);
+                if (ll >= 0)
+                        u->log_level_max = ll;
+        }
+        value = mfree(value);
+
+        p = strjoina("/run/systemd/units/log-rate-limit-interval:", unit);
+        if (readlink_malloc(p, &value) >= 0)
+                (void) safe_atou64(value, &u->log_rate_limit_interval);
+        value = mfree(value);
+
+        p = strjoina("/run/systemd/units/log-rate-limit-burst:", unit);
+        if (readlink_malloc(p, &value) >= 0)
+                (void) safe_atou(value, &u->log_rate_limit_burst);
+}
+
+static const UnitContext* unit_context_get(Server *s, const char *unit, usec_t timestamp, UnitContext *buffer) {
+        UnitContext *u;
+        char *k;
+
+        assert(s);
+        assert(unit);
+        assert(buffer);
+
+        /* The per-unit settings are the same for all processes of a unit and only change when the unit is
+         * reconfigured, hence cache them for the refresh interval, so that a fork storm in a unit doesn't result in
+         * reading them again for each new process. This covers three of the four symlinks in /run/systemd/units/
+         * we look at for each unit. The fourth, the invocation ID, is still read on every refresh. */
 
+        u = hashmap_get(s->unit_contexts, unit);
+        if (u && u->timestamp + REFRESH_USEC >= timestamp)
+                return u;
+
+        if (!u) {
+                if (hashmap_size(s->unit_contexts) >= UNIT_CACHE_MAX)
+                        unit_contexts_flush(s);
+
+                if (hashmap_ensure_allocated(&s->unit_contexts, &string_hash_ops) < 0)
+                        goto uncached;
+
+                u = new(UnitContext, 1);
+                if (!u)
+                        goto uncached;
+
+                k = strdup(unit);
+                if (!k) {
+                        free(u);
+                        goto uncached;
+                }
+
+                if (hashmap_put(s->unit_contexts, k, u) < 0) {
+                        free(k);
+                        free(u);
+                        goto uncached;
+                }
+        }
+
+        unit_context_read(unit, u);
+        u->timestamp = timestamp;
+
+        return u;
+
+uncached:
+        unit_context_read(unit, buffer);
+        return buffer;
+}
+
+static void client_context_read_unit_settings(Server *s, ClientContext *c, usec_t timestamp) {
+        const UnitContext *u;
+        UnitContext buffer;
+
+        assert(s);
         assert(c);
 
         if (!c->unit)
-                return 0;
+                return;
 
-        p = strjoina("/run/systemd/units/log-rate-limit-interval:", c->unit);
-        r = readlink_malloc(p, &value);
-        if (r < 0)
-                return r;
+        u = unit_context_get(s, c->unit, timestamp, &buffer);
 
-        return safe_atou64(value, &c->log_rate_limit_interval);
+        if (u->log_level_max >= 0)
+                c->log_level_max = u->log_level_max;
+        if (u->log_rate_limit_interval != USEC_INFINITY)
+                c->log_rate_limit_interval = u->log_rate_limit_interval;
+        if (u->log_rate_limit_burst != UINT_MAX)
+                c->log_rate_limit_burst = u->log_rate_limit_burst;
 }
 
-static int client_context_read_log_rate_limit_burst(ClientContext *c) {
-        _cleanup_free_ char *value = NULL;
-        const char *p;
-        int r;
+static int client_context_add_meta(ClientContext *c, const char *field, const void *value, size_t size) {
+        size_t l;
+        char *k;
 
         assert(c);
+        assert(field);
+        assert(c->meta_n_iovec < ELEMENTSOF(c->meta_iovec));
 
-        if (!c->unit)
-                return 0;
+        l = strlen(field);
 
-        p = strjoina("/run/systemd/units/log-rate-limit-burst:", c->unit);
-        r = readlink_malloc(p, &value);
-        if (r < 0)
-                return r;
+        k = malloc(l + 1 + size + 1);
+        if (!k)
+                return -ENOMEM;
+
+        *((char*) mempcpy(mempcpy(stpcpy(k, field), "=", 1), value, size)) = 0;
 
-        return safe_atou(value, &c->log_rate_limit_burst);
+        c->meta_iovec[c->meta_n_iovec++] = IOVEC_MAKE(k, l + 1 + size);
+        return 0;
+}
+
+#define META_ADD_NUMERIC(c, value, type, isset, format, field)          \
+        if (isset(value)) {                                             \
+                char _b[DECIMAL_STR_MAX(type)];                         \
+                xsprintf(_b, format, value);                            \
+                (void) client_context_add_meta(c, field, _b, strlen(_b)); \
+        }
+
+#define META_ADD_STRING(c, value, field)                                \
+        if (!isempty(value))                                            \
+                (void) client_context_add_meta(c, field, value, strlen(value))
+
+static void client_context_build_meta(ClientContext *c) {
+        assert(c);
+
+        /* Format the fields we add to every log message of this client once, instead of doing so for each
+         * message. Fields we fail to allocate are simply left out, as with all the metadata we collect. */
+
+        client_context_free_meta(c);
+
+        META_ADD_NUMERIC(c, c->pid, pid_t, pid_is_valid, PID_FMT, "_PID");
+        META_ADD_NUMERIC(c, c->uid, uid_t, uid_is_valid, UID_FMT, "_UID");
+        META_ADD_NUMERIC(c, c->gid, gid_t, gid_is_valid, GID_FMT, "_GID");
+
+        META_ADD_STRING(c, c->comm, "_COMM");
+        META_ADD_STRING(c, c->exe, "_EXE");
+        META_ADD_STRING(c, c->cmdline, "_CMDLINE");
+        META_ADD_STRING(c, c->capeff, "_CAP_EFFECTIVE");
+
+        if (c->label_size > 0)
+                (void) client_context_add_meta(c, "_SELINUX_CONTEXT", c->label, strnlen(c->label, c->label_size));
+
+        META_ADD_NUMERIC(c, c->auditid, uint32_t, audit_session_is_valid, "%" PRIu32, "_AUDIT_SESSION");
+        META_ADD_NUMERIC(c, c->loginuid, uid_t, uid_is_valid, UID_FMT, "_AUDIT_LOGINUID");
+
+        META_ADD_STRING(c, c->cgroup, "_SYSTEMD_CGROUP");
+        META_ADD_STRING(c, c->session, "_SYSTEMD_SESSION");
+        META_ADD_NUMERIC(c, c->owner_uid, uid_t, uid_is_valid, UID_FMT, "_SYSTEMD_OWNER_UID");
+        META_ADD_STRING(c, c->unit, "_SYSTEMD_UNIT");
+        META_ADD_STRING(c, c->user_unit, "_SYSTEMD_USER_UNIT");
+        META_ADD_STRING(c, c->slice, "_SYSTEMD_SLICE");
+        META_ADD_STRING(c, c->user_slice, "_SYSTEMD_USER_SLICE");
+
+        if (!sd_id128_is_null(c->invocation_id)) {
+                char t[SD_ID128_STRING_MAX];
+
+                (void) client_context_add_meta(c, "_SYSTEMD_INVOCATION_ID", sd_id128_to_string(c->invocation_id, t), SD_ID128_STRING_MAX - 1);
+        }
 }
 
 static void client_context_really_refresh(
@@ -491,10 +662,10 @@ static void client_context_really_refresh(
 
         (void) client_context_read_cgroup(s, c, unit_id);
         (void) client_context_read_invocation_id(s, c);
-        (void) client_context_read_log_level_max(s, c);
+        client_context_read_unit_settings(s, c, timestamp);
         (void) client_context_read_extra_fields(s, c);
-        (void) client_context_read_log_rate_limit_interval(c);
-        (void) client_context_read_log_rate_limit_burst(c);
+
+        client_context_build_meta(c);
 
         c->timestamp = timestamp;
 
@@ -587,6 +758,9 @@ void client_context_flush_all(Server *s) {
 
         s->client_contexts_lru = prioq_free(s->client_contexts_lru);
         s->client_contexts = hashmap_free(s->client_contexts);
+
+        unit_contexts_flush(s);
+        s->unit_contexts = hashmap_free(s->unit_contexts);
 }
 
 static int client_context_get_internal(
@@ -623,11 +797,18 @@ static int client_context_get_internal(
 
                 client_context_maybe_refresh(s, c, ucred, label, label_len, unit_id, USEC_INFINITY);
 
+                if (c->n_hits < UINT_MAX)
+                        c->n_hits++;
+
+                /* Reaching the threshold changes the position of the entry in the LRU */
+                if (c->n_hits == FREQUENT_HITS && c->in_lru)
+                        assert_se(prioq_reshuffle(s->client_contexts_lru, c, &c->lru_index) >= 0);
+
                 *ret = c;
                 return 0;
         }
 
-        client_context_try_shrink_to(s, CACHE_MAX-1);
+        client_context_try_shrink_to(s, s->client_contexts_max - 1);
 
         r = client_context_new(s, pid, &c);
         if (r < 0)
@@ -10,10 +10,14 @@ typedef struct ClientContext ClientContext;
 
 #include "journald-server.h"
 
+/* The number of metadata fields we derive from the cached data of a client */
+#define N_IOVEC_CONTEXT_FIELDS 18
+
 struct ClientContext {
         unsigned n_ref;
         unsigned lru_index;
         usec_t timestamp;
+        unsigned n_hits;
         bool in_lru;
 
         pid_t pid;
@@ -52,6 +56,10 @@ struct ClientContext {
 
         usec_t log_rate_limit_interval;
         unsigned log_rate_limit_burst;
+
+        /* The fields above, formatted as _PID=, _COMM=, ... for adding them to log entries */
+        struct iovec meta_iovec[N_IOVEC_CONTEXT_FIELDS];
+        size_t meta_n_iovec;
 };
 
 int client_context_get(
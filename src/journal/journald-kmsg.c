@@ -22,6 +22,19 @@
 #include "process-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "strv.h"
+
+/* How many records to read from /dev/kmsg at max before letting other event sources run */
+#define KMSG_BATCH_MAX 64U
+
+/* Keep the udev fields of at most this many devices cached, and refresh them after this long */
+#define KMSG_DEVICE_CACHE_MAX 256U
+#define KMSG_DEVICE_REFRESH_USEC (1*USEC_PER_SEC)
+
+typedef struct KmsgDevice {
+        usec_t timestamp;
+        char **fields;
+} KmsgDevice;
 
 void server_forward_kmsg(
         Server *s,
@@ -94,9 +107,120 @@ static bool is_us(const char *identifier, const char *pid) {
                streq(identifier, program_invocation_short_name);
 }
 
+static char **kmsg_device_read(const char *device_id) {
+        _cleanup_(sd_device_unrefp) sd_device *d = NULL;
+        _cleanup_strv_free_ char **l = NULL;
+        const char *g;
+        size_t j = 0;
+        char *b;
+
+        assert(device_id);
+
+        if (sd_device_new_from_device_id(&d, device_id) < 0)
+                return strv_new(NULL, NULL);
+
+        if (sd_device_get_devname(d, &g) >= 0) {
+                b = strappend("_UDEV_DEVNODE=", g);
+                if (!b || strv_consume(&l, b) < 0)
+                        return NULL;
+        }
+
+        if (sd_device_get_sysname(d, &g) >= 0) {
+                b = strappend("_UDEV_SYSNAME=", g);
+                if (!b || strv_consume(&l, b) < 0)
+                        return NULL;
+        }
+
+        FOREACH_DEVICE_DEVLINK(d, g) {
+
+                if (j >= N_IOVEC_UDEV_FIELDS)
+                        break;
+
+                b = strappend("_UDEV_DEVLINK=", g);
+                if (!b || strv_consume(&l, b) < 0)
+                        return NULL;
+
+                j++;
+        }
+
+        if (!l)
+                return strv_new(NULL, NULL);
+
+        return TAKE_PTR(l);
+}
+
+void kmsg_devices_flush(Server *s) {
+        KmsgDevice *d;
+        char *k;
+
+        assert(s);
+
+        while ((d = hashmap_steal_first_key_and_value(s->kmsg_devices, (void**) &k))) {
+                free(k);
+                strv_free(d->fields);
+                free(d);
+        }
+}
+
+static char **kmsg_device_get(Server *s, const char *device_id, char ***uncached) {
+        KmsgDevice *d;
+        usec_t ts;
+        char *k;
+
+        assert(s);
+        assert(device_id);
+        assert(uncached);
+
+        /* Drivers tend to log many messages in a row about the same device, in particular during early boot,
+         * hence cache what udev knows about a device for a short while, instead of looking it up in the udev
+         * database for every single record. The returned fields are owned by the cache, or by *uncached if we
+         * couldn't add them to the cache. */
+
+        ts = now(CLOCK_MONOTONIC);
+
+        d = hashmap_get(s->kmsg_devices, device_id);
+        if (d && d->timestamp + KMSG_DEVICE_REFRESH_USEC >= ts)
+                return d->fields;
+
+        if (!d) {
+                if (hashmap_size(s->kmsg_devices) >= KMSG_DEVICE_CACHE_MAX)
+                        kmsg_devices_flush(s);
+
+                if (hashmap_ensure_allocated(&s->kmsg_devices, &string_hash_ops) < 0)
+                        goto uncached;
+
+                d = new0(KmsgDevice, 1);
+                if (!d)
+                        goto uncached;
+
+                k = strdup(device_id);
+                if (!k) {
+                        free(d);
+                        goto uncached;
+                }
+
+                if (hashmap_put(s->kmsg_devices, k, d) < 0) {
+                        free(k);
+                        free(d);
+                        goto uncached;
+                }
+        }
+
+        strv_free(d->fields);
+        d->fields = kmsg_device_read(device_id);
+        d->timestamp = d->fields ? ts : 0;
+
+        return d->fields;
+
+uncached:
+        *uncached = kmsg_device_read(device_id);
+        return *uncached;
+}
+
 void dev_kmsg_record(Server *s, char *p, size_t l) {
 
         _cleanup_free_ char *message = NULL, *syslog_priority = NULL, *syslog_pid = NULL, *syslog_facility = NULL, *syslog_identifier = NULL, *source_time = NULL, *identifier = NULL, *pid = NULL;
+        _cleanup_strv_free_ char **uncached_udev_fields = NULL;
         struct iovec iovec[N_IOVEC_META_FIELDS + 7 + N_IOVEC_KERNEL_FIELDS + 2 + N_IOVEC_UDEV_FIELDS];
         char *kernel_device = NULL;
         unsigned long long usec;
@@ -210,43 +334,11 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
         }
 
         if (kernel_device) {
-                _cleanup_(sd_device_unrefp) sd_device *d = NULL;
-
-                if (sd_device_new_from_device_id(&d, kernel_device) >= 0) {
-                        const char *g;
-                        char *b;
-
-                        if (sd_device_get_devname(d, &g) >= 0) {
-                                b = strappend("_UDEV_DEVNODE=", g);
-                                if (b) {
-                                        iovec[n++] = IOVEC_MAKE_STRING(b);
-                                        z++;
-                                }
-                        }
-
-                        if (sd_device_get_sysname(d, &g) >= 0) {
-                                b = strappend("_UDEV_SYSNAME=", g);
-                                if (b) {
-                                        iovec[n++] = IOVEC_MAKE_STRING(b);
-                                        z++;
-                                }
-                        }
-
-                        j = 0;
-                        FOREACH_DEVICE_DEVLINK(d, g) {
-
-                                if (j >= N_IOVEC_UDEV_FIELDS)
-                                        break;
-
-                                b = strappend("_UDEV_DEVLINK=", g);
-                                if (b) {
-                                        iovec[n++] = IOVEC_MAKE_STRING(b);
-                                        z++;
-                                }
-
-                                j++;
-                        }
-                }
+                char **udev_fields, **g;
+
+                udev_fields = kmsg_device_get(s, kernel_device, &uncached_udev_fields);
+                STRV_FOREACH(g, udev_fields)
+                        iovec[n++] = IOVEC_MAKE_STRING(*g);
         }
 
         if (asprintf(&source_time, "_SOURCE_MONOTONIC_TIMESTAMP=%llu", usec) >= 0)
@@ -286,7 +378,7 @@ void dev_kmsg_record(Server *s, char *p, size_t l) {
         if (cunescape_length_with_prefix(p, pl, "MESSAGE=", UNESCAPE_RELAX, &message) >= 0)
                 iovec[n++] = IOVEC_MAKE_STRING(message);
 
-        server_dispatch_message(s, iovec, n, ELEMENTSOF(iovec), NULL, NULL, priority, 0);
+        server_dispatch_message(s, SERVER_SOURCE_KERNEL, iovec, n, ELEMENTSOF(iovec), NULL, NULL, priority, 0);
 
 finish:
         for (j = 0; j < z; j++)
@@ -349,6 +441,8 @@ int server_flush_dev_kmsg(Server *s) {
 
 static int dispatch_dev_kmsg(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
         Server *s = userdata;
+        unsigned i;
+        int r;
 
         assert(es);
         assert(fd == s->dev_kmsg_fd);
@@ -360,7 +454,15 @@ static int dispatch_dev_kmsg(sd_event_source *es, int fd, uint32_t revents, void
         if (!(revents & EPOLLIN))
                 log_error("Got invalid event from epoll for /dev/kmsg: %"PRIx32, revents);
 
-        return server_read_dev_kmsg(s);
+        /* The kernel returns a single record per read(), hence read a couple of them in one go, but not
+         * everything, so that a chatty kernel doesn't keep us from processing userspace messages. */
+        for (i = 0; i < KMSG_BATCH_MAX; i++) {
+                r = server_read_dev_kmsg(s);
+                if (r <= 0)
+                        return r;
+        }
+
+        return 1;
 }
 
 int server_open_dev_kmsg(Server *s) {
@@ -398,7 +500,7 @@ int server_open_dev_kmsg(Server *s) {
                 goto fail;
         }
 
-        r = sd_event_source_set_priority(s->dev_kmsg_event_source, SD_EVENT_PRIORITY_IMPORTANT+10);
+        r = sd_event_source_set_priority(s->dev_kmsg_event_source, DATAGRAM_EVENT_PRIORITY);
         if (r < 0) {
                 log_error_errno(r, "Failed to adjust priority of kmsg event source: %m");
                 goto fail;
@@ -11,3 +11,5 @@ void server_forward_kmsg(Server *s, int priority, const char *identifier, const
 int server_open_kernel_seqnum(Server *s);
 
 void dev_kmsg_record(Server *s, char *p, size_t l);
+
+void kmsg_devices_flush(Server *s);
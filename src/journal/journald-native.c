@@ -256,7 +256,7 @@ static int server_process_entry(
                         server_forward_wall(s, priority, identifier, message, ucred);
         }
 
-        server_dispatch_message(s, iovec, n, m, context, tv, priority, object_pid);
+        server_dispatch_message(s, SERVER_SOURCE_NATIVE, iovec, n, m, context, tv, priority, object_pid);
 
 finish:
         for (j = 0; j < n; j++)  {
@@ -478,11 +478,16 @@ int server_open_native_socket(Server*s) {
         if (r < 0)
                 return log_error_errno(r, "SO_TIMESTAMP failed: %m");
 
+        /* The socket unit sets this already, but not if we opened the socket ourselves. */
+        r = fd_inc_rcvbuf(s->native_fd, DATAGRAM_RECEIVE_BUFFER_SIZE);
+        if (r < 0)
+                log_warning_errno(r, "Failed to increase receive buffer size, ignoring: %m");
+
         r = sd_event_add_io(s->event, &s->native_event_source, s->native_fd, EPOLLIN, server_process_datagram, s);
         if (r < 0)
                 return log_error_errno(r, "Failed to add native server fd to event loop: %m");
 
-        r = sd_event_source_set_priority(s->native_event_source, SD_EVENT_PRIORITY_NORMAL+5);
+        r = sd_event_source_set_priority(s->native_event_source, DATAGRAM_EVENT_PRIORITY);
         if (r < 0)
                 return log_error_errno(r, "Failed to adjust native event source priority: %m");
 
@@ -253,3 +253,33 @@ int journal_rate_limit_test(JournalRateLimit *r, const char *id, usec_t rl_inter
         p->suppressed++;
         return 0;
 }
+
+usec_t journal_rate_limit_suppressed_until(JournalRateLimit *r, const char *id, usec_t rl_interval, int priority) {
+        JournalRateLimitGroup *g;
+        JournalRateLimitPool *p;
+        uint64_t h;
+
+        assert(id);
+
+        /* Returns the end of the current interval, if messages of the specified priority from the specified id are
+         * currently being suppressed, 0 otherwise. */
+
+        if (!r)
+                return 0;
+
+        h = siphash24_string(id, r->hash_key);
+        g = r->buckets[h % BUCKETS_MAX];
+
+        LIST_FOREACH(bucket, g, g)
+                if (streq(g->id, id))
+                        break;
+
+        if (!g)
+                return 0;
+
+        p = &g->pools[priority_map[priority]];
+        if (p->begin <= 0 || p->suppressed <= 0)
+                return 0;
+
+        return usec_add(p->begin, rl_interval);
+}
@@ -8,3 +8,4 @@ typedef struct JournalRateLimit JournalRateLimit;
 JournalRateLimit *journal_rate_limit_new(void);
 void journal_rate_limit_free(JournalRateLimit *r);
 int journal_rate_limit_test(JournalRateLimit *r, const char *id, usec_t rl_interval, unsigned rl_burst, int priority, uint64_t available);
+usec_t journal_rate_limit_suppressed_until(JournalRateLimit *r, const char *id, usec_t rl_interval, int priority);
@@ -5,6 +5,7 @@
 #endif
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/signalfd.h>
 #include <sys/statvfs.h>
 #include <linux/sockios.h>
@@ -28,6 +29,7 @@
 #include "hostname-util.h"
 #include "id128-util.h"
 #include "io-util.h"
+#include "ioprio.h"
 #include "journal-authenticate.h"
 #include "journal-file.h"
 #include "journal-internal.h"
@@ -44,6 +46,7 @@
 #include "missing.h"
 #include "mkdir.h"
 #include "parse-util.h"
+#include "path-util.h"
 #include "proc-cmdline.h"
 #include "process-util.h"
 #include "rm-rf.h"
@@ -54,9 +57,14 @@
 #include "string-table.h"
 #include "string-util.h"
 #include "syslog-util.h"
+#include "unit-name.h"
 #include "user-util.h"
 
 #define USER_JOURNALS_MAX 1024
+#define UNIT_JOURNALS_MAX 1024
+
+/* Leave room for the "@<seqnum id>-<seqnum>-<realtime>" suffix of archived files */
+#define UNIT_JOURNAL_NAME_MAX (NAME_MAX - STRLEN("unit-") - (1 + 32 + 1 + 16 + 1 + 16) - STRLEN(".journal"))
 
 #define DEFAULT_SYNC_INTERVAL_USEC (5*USEC_PER_MINUTE)
 #define DEFAULT_RATE_LIMIT_INTERVAL (30*USEC_PER_SEC)
@@ -74,6 +82,9 @@
  * for a bit of additional metadata. */
 #define DEFAULT_LINE_MAX (48*1024)
 
+/* Keep at most 16K entries in the client metadata cache by default */
+#define DEFAULT_CLIENT_CONTEXTS_MAX (16U*1024U)
+
 #define DEFERRED_CLOSES_MAX (4096)
 
 static int determine_path_usage(Server *s, const char *path, uint64_t *ret_used, uint64_t *ret_free) {
@@ -98,7 +109,8 @@ static int determine_path_usage(Server *s, const char *path, uint64_t *ret_used,
                 struct stat st;
 
                 if (!endswith(de->d_name, ".journal") &&
-                    !endswith(de->d_name, ".journal~"))
+                    !endswith(de->d_name, ".journal~") &&
+                    !journal_file_is_rewrite_temporary(de->d_name))
                         continue;
 
                 if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
@@ -372,7 +384,73 @@ static int system_journal_open(Server *s, bool flush_requested) {
         return r;
 }
 
-static JournalFile* find_journal(Server *s, uid_t uid) {
+static bool unit_for_unit_journal(const char *unit) {
+
+        /* Returns true if the specified unit shall get its data stored in a journal file of its own. We only do
+         * this for services, since scopes and the like are usually short-lived and too many. */
+
+        return unit &&
+               strlen(unit) <= UNIT_JOURNAL_NAME_MAX &&
+               unit_name_is_valid(unit, UNIT_NAME_PLAIN|UNIT_NAME_INSTANCE) &&
+               endswith(unit, ".service");
+}
+
+static JournalFile* find_unit_journal(Server *s, const char *unit) {
+        _cleanup_free_ char *p = NULL, *k = NULL;
+        JournalFile *f;
+        sd_id128_t machine;
+        int r;
+
+        assert(s);
+        assert(unit);
+
+        f = ordered_hashmap_get(s->unit_journals, unit);
+        if (f)
+                return f;
+
+        r = sd_id128_get_machine(&machine);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to determine machine ID, using system log: %m");
+                return s->system_journal;
+        }
+
+        if (asprintf(&p, "/var/log/journal/" SD_ID128_FORMAT_STR "/unit-%s.journal",
+                     SD_ID128_FORMAT_VAL(machine), unit) < 0) {
+                log_oom();
+                return s->system_journal;
+        }
+
+        k = strdup(unit);
+        if (!k) {
+                log_oom();
+                return s->system_journal;
+        }
+
+        while (ordered_hashmap_size(s->unit_journals) >= UNIT_JOURNALS_MAX) {
+                _cleanup_free_ char *old = NULL;
+
+                /* Too many open? Then let's close one */
+                f = ordered_hashmap_steal_first_key_and_value(s->unit_journals, (void**) &old);
+                assert(f);
+                (void) journal_file_close(f);
+        }
+
+        r = open_journal(s, true, p, O_RDWR|O_CREAT, s->seal, &s->system_storage.metrics, &f);
+        if (r < 0)
+                return s->system_journal;
+
+        r = ordered_hashmap_put(s->unit_journals, k, f);
+        if (r < 0) {
+                (void) journal_file_close(f);
+                return s->system_journal;
+        }
+
+        TAKE_PTR(k);
+
+        return f;
+}
+
+static JournalFile* find_journal(Server *s, uid_t uid, const char *unit) {
         _cleanup_free_ char *p = NULL;
         int r;
         JournalFile *f;
@@ -399,6 +477,9 @@ static JournalFile* find_journal(Server *s, uid_t uid) {
         if (s->runtime_journal)
                 return s->runtime_journal;
 
+        if (unit)
+                return find_unit_journal(s, unit);
+
         if (uid_for_system_journal(uid))
                 return s->system_journal;
 
@@ -466,6 +547,99 @@ static int do_rotate(
         return r;
 }
 
+static void server_start_rewrite(Server *s);
+
+static int dispatch_rewrite_done(sd_event_source *es, const siginfo_t *si, void *userdata) {
+        Server *s = userdata;
+
+        assert(s);
+        assert(si);
+
+        if (si->si_code != CLD_EXITED || si->si_status != EXIT_SUCCESS)
+                log_debug("Journal file rewrite worker " PID_FMT " failed.", si->si_pid);
+
+        s->rewrite_event_source = sd_event_source_unref(s->rewrite_event_source);
+
+        /* Continue with the next file, if there is any */
+        server_start_rewrite(s);
+
+        return 0;
+}
+
+static void server_start_rewrite(Server *s) {
+        _cleanup_free_ char *path = NULL;
+        pid_t pid;
+        int r;
+
+        assert(s);
+
+        /* Only run one worker at a time */
+        if (s->rewrite_event_source)
+                return;
+
+        path = set_steal_first(s->rewrite_queue);
+        if (!path)
+                return;
+
+        r = safe_fork("(sd-rewrite)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_CLOSE_ALL_FDS|FORK_REOPEN_LOG|FORK_LOG, &pid);
+        if (r < 0)
+                return;
+        if (r == 0) {
+                /* Child */
+
+                /* This is just an optimization for later reads, so stay out of the way of everything else */
+                (void) setpriority(PRIO_PROCESS, 0, 19);
+                (void) ioprio_set(IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
+
+                r = journal_file_rewrite_archived(path, s->compress.enabled, s->compress.threshold_bytes);
+                if (r < 0) {
+                        log_full_errno(IN_SET(r, -ENOENT, -ESTALE, -EOPNOTSUPP) ? LOG_DEBUG : LOG_WARNING, r,
+                                       "Failed to rewrite archived journal file %s, ignoring: %m", path);
+                        _exit(EXIT_FAILURE);
+                }
+
+                log_debug("Rewrote archived journal file %s.", path);
+                _exit(EXIT_SUCCESS);
+        }
+
+        r = sd_event_add_child(s->event, &s->rewrite_event_source, pid, WEXITED, dispatch_rewrite_done, s);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to watch journal file rewrite worker, killing it: %m");
+                sigkill_wait(pid);
+        }
+}
+
+static void server_queue_rewrite(Server *s, JournalFile *f) {
+        char *p;
+        int r;
+
+        assert(s);
+        assert(f);
+
+        if (!s->rewrite_archived || !f->archive)
+                return;
+
+        /* Rewriting files on volatile storage would only cost memory */
+        if (!s->system_storage.path || !path_startswith(f->path, s->system_storage.path))
+                return;
+
+        r = set_ensure_allocated(&s->rewrite_queue, &string_hash_ops);
+        if (r < 0) {
+                log_oom();
+                return;
+        }
+
+        p = strdup(f->path);
+        if (!p) {
+                log_oom();
+                return;
+        }
+
+        r = set_consume(s->rewrite_queue, p);
+        if (r < 0)
+                log_debug_errno(r, "Failed to queue %s for rewriting, ignoring: %m", f->path);
+}
+
 static void server_process_deferred_closes(Server *s) {
         JournalFile *f;
         Iterator i;
@@ -476,8 +650,11 @@ static void server_process_deferred_closes(Server *s) {
                         continue;
 
                 (void) set_remove(s->deferred_closes, f);
+                server_queue_rewrite(s, f);
                 (void) journal_file_close(f);
         }
+
+        server_start_rewrite(s);
 }
 
 static void server_vacuum_deferred_closes(Server *s) {
@@ -495,8 +672,11 @@ static void server_vacuum_deferred_closes(Server *s) {
                 JournalFile *f;
 
                 assert_se(f = set_steal_first(s->deferred_closes));
+                server_queue_rewrite(s, f);
                 journal_file_close(f);
         }
+
+        server_start_rewrite(s);
 }
 
 static int open_user_journal_directory(Server *s, DIR **ret_dir, char **ret_path) {
@@ -550,7 +730,18 @@ void server_rotate(Server *s) {
                         ordered_hashmap_remove(s->user_journals, k);
         }
 
-        /* Finally, also rotate all user journals we currently do not have open. */
+        /* Then, the same for all unit journals */
+        ORDERED_HASHMAP_FOREACH_KEY(f, k, s->unit_journals, i) {
+                r = do_rotate(s, &f, "unit", s->seal, 0);
+                if (r >= 0)
+                        ordered_hashmap_replace(s->unit_journals, k, f);
+                else if (!f) {
+                        ordered_hashmap_remove(s->unit_journals, k);
+                        free(k);
+                }
+        }
+
+        /* Finally, also rotate all user and unit journals we currently do not have open. */
         r = open_user_journal_directory(s, &d, &path);
         if (r >= 0) {
                 struct dirent *de;
@@ -561,29 +752,46 @@ void server_rotate(Server *s) {
                         const char *a, *b;
                         uid_t uid;
 
-                        a = startswith(de->d_name, "user-");
-                        if (!a)
-                                continue;
                         b = endswith(de->d_name, ".journal");
                         if (!b)
                                 continue;
 
-                        u = strndup(a, b-a);
-                        if (!u) {
-                                log_oom();
-                                break;
-                        }
-
-                        r = parse_uid(u, &uid);
-                        if (r < 0) {
-                                log_debug_errno(r, "Failed to parse UID from file name '%s', ignoring: %m", de->d_name);
-                                continue;
+                        a = startswith(de->d_name, "user-");
+                        if (a) {
+                                u = strndup(a, b-a);
+                                if (!u) {
+                                        log_oom();
+                                        break;
+                                }
+
+                                r = parse_uid(u, &uid);
+                                if (r < 0) {
+                                        log_debug_errno(r, "Failed to parse UID from file name '%s', ignoring: %m", de->d_name);
+                                        continue;
+                                }
+
+                                /* Already rotated in the above loop? i.e. is it an open user journal? */
+                                if (ordered_hashmap_contains(s->user_journals, UID_TO_PTR(uid)))
+                                        continue;
+                        } else {
+                                a = startswith(de->d_name, "unit-");
+                                if (!a)
+                                        continue;
+
+                                u = strndup(a, b-a);
+                                if (!u) {
+                                        log_oom();
+                                        break;
+                                }
+
+                                /* Archived files carry an '@' suffix that makes them invalid unit names */
+                                if (!unit_for_unit_journal(u))
+                                        continue;
+
+                                if (ordered_hashmap_contains(s->unit_journals, u))
+                                        continue;
                         }
 
-                        /* Already rotated in the above loop? i.e. is it an open user journal? */
-                        if (ordered_hashmap_contains(s->user_journals, UID_TO_PTR(uid)))
-                                continue;
-
                         full = strjoin(path, de->d_name);
                         if (!full) {
                                 log_oom();
@@ -641,8 +849,11 @@ void server_rotate(Server *s) {
 void server_sync(Server *s) {
         JournalFile *f;
         Iterator i;
+        usec_t start;
         int r;
 
+        start = now(CLOCK_MONOTONIC);
+
         if (s->system_journal) {
                 r = journal_file_set_offline(s->system_journal, false);
                 if (r < 0)
@@ -655,6 +866,12 @@ void server_sync(Server *s) {
                         log_warning_errno(r, "Failed to sync user journal, ignoring: %m");
         }
 
+        ORDERED_HASHMAP_FOREACH(f, s->unit_journals, i) {
+                r = journal_file_set_offline(f, false);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to sync unit journal, ignoring: %m");
+        }
+
         if (s->sync_event_source) {
                 r = sd_event_source_set_enabled(s->sync_event_source, SD_EVENT_OFF);
                 if (r < 0)
@@ -662,6 +879,11 @@ void server_sync(Server *s) {
         }
 
         s->sync_scheduled = false;
+
+        /* Note that the actual fsync() happens in the offline threads, hence this is only the time the event loop
+         * was blocked for */
+        server_stats_sync(&s->stats, now(CLOCK_MONOTONIC) - start);
+        server_stats_schedule_write(s);
 }
 
 static void do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
@@ -676,9 +898,9 @@ static void do_vacuum(Server *s, JournalStorage *storage, bool verbose) {
         if (verbose)
                 server_space_usage_message(s, storage);
 
-        r = journal_directory_vacuum(storage->path, storage->space.limit,
-                                     storage->metrics.n_max_files, s->max_retention_usec,
-                                     &s->oldest_file_usec, verbose);
+        r = journal_directory_vacuum_cached(&storage->vacuum_cache, storage->path, storage->space.limit,
+                                            storage->metrics.n_max_files, s->max_retention_usec,
+                                            &s->oldest_file_usec, verbose);
         if (r < 0 && r != -ENOENT)
                 log_warning_errno(r, "Failed to vacuum %s, ignoring: %m", storage->path);
 
@@ -789,10 +1011,65 @@ static bool shall_try_append_again(JournalFile *f, int r) {
         }
 }
 
-static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n, int priority) {
+static bool rotate_unit_journal(Server *s, JournalFile *f) {
+        JournalFile *g;
+        Iterator i;
+        void *k;
+        int r;
+
+        assert(s);
+        assert(f);
+
+        /* If a unit journal reached its limits we rotate only that file, so that a chatty service cannot cause
+         * everybody else's journal files to be archived (and eventually vacuumed) along with it. Returns false if
+         * the file is not a unit journal. */
+
+        ORDERED_HASHMAP_FOREACH_KEY(g, k, s->unit_journals, i) {
+                if (g != f)
+                        continue;
+
+                r = do_rotate(s, &g, "unit", s->seal, 0);
+                if (r >= 0)
+                        ordered_hashmap_replace(s->unit_journals, k, g);
+                else if (!g) {
+                        ordered_hashmap_remove(s->unit_journals, k);
+                        free(k);
+                }
+
+                server_process_deferred_closes(s);
+                return true;
+        }
+
+        return false;
+}
+
+static int append_entry(Server *s, JournalFile *f, const struct dual_timestamp *ts, struct iovec *iovec, size_t n) {
+        uint64_t n_allocations;
+        usec_t start, allocation_usec;
+        int r;
+
+        assert(s);
+        assert(f);
+
+        /* Growing the file happens synchronously while appending, account for it separately, so that it can be
+         * told apart from other append latency. */
+        n_allocations = f->n_allocations;
+        allocation_usec = f->allocation_usec;
+
+        start = now(CLOCK_MONOTONIC);
+        r = journal_file_append_entry(f, ts, NULL, iovec, n, &s->seqnum, NULL, NULL);
+        server_stats_append(&s->stats, now(CLOCK_MONOTONIC) - start, r);
+
+        if (f->n_allocations > n_allocations)
+                server_stats_allocate(&s->stats, f->n_allocations - n_allocations, f->allocation_usec - allocation_usec);
+
+        return r;
+}
+
+static void write_to_journal(Server *s, uid_t uid, const char *unit, struct iovec *iovec, size_t n, int priority) {
         bool vacuumed = false, rotate = false;
         struct dual_timestamp ts;
-        JournalFile *f;
+        JournalFile *f = NULL;
         int r;
 
         assert(s);
@@ -815,7 +1092,7 @@ static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n
                 rotate = true;
         } else {
 
-                f = find_journal(s, uid);
+                f = find_journal(s, uid, unit);
                 if (!f)
                         return;
 
@@ -826,18 +1103,19 @@ static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n
         }
 
         if (rotate) {
-                server_rotate(s);
+                if (!(f && unit && rotate_unit_journal(s, f)))
+                        server_rotate(s);
                 server_vacuum(s, false);
                 vacuumed = true;
 
-                f = find_journal(s, uid);
+                f = find_journal(s, uid, unit);
                 if (!f)
                         return;
         }
 
         s->last_realtime_clock = ts.realtime;
 
-        r = journal_file_append_entry(f, &ts, NULL, iovec, n, &s->seqnum, NULL, NULL);
+        r = append_entry(s, f, &ts, iovec, n);
         if (r >= 0) {
                 server_schedule_sync(s, priority);
                 return;
@@ -848,15 +1126,16 @@ static void write_to_journal(Server *s, uid_t uid, struct iovec *iovec, size_t n
                 return;
         }
 
-        server_rotate(s);
+        if (!(unit && rotate_unit_journal(s, f)))
+                server_rotate(s);
         server_vacuum(s, false);
 
-        f = find_journal(s, uid);
+        f = find_journal(s, uid, unit);
         if (!f)
                 return;
 
         log_debug("Retrying write.");
-        r = journal_file_append_entry(f, &ts, NULL, iovec, n, &s->seqnum, NULL, NULL);
+        r = append_entry(s, f, &ts, iovec, n);
         if (r < 0)
                 log_error_errno(r, "Failed to write entry (%zu items, %zu bytes) despite vacuuming, ignoring: %m", n, IOVEC_TOTAL_SIZE(iovec, n));
         else
@@ -903,8 +1182,9 @@ static void dispatch_message_real(
                 pid_t object_pid) {
 
         char source_time[sizeof("_SOURCE_REALTIME_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t)];
+        const char *journal_unit;
         uid_t journal_uid;
-        ClientContext *o;
+        ClientContext *o = NULL;
 
         assert(s);
         assert(iovec);
@@ -914,30 +1194,15 @@ static void dispatch_message_real(
                (pid_is_valid(object_pid) ? N_IOVEC_OBJECT_FIELDS : 0) +
                client_context_extra_fields_n_iovec(c) <= m);
 
-        if (c) {
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->pid, pid_t, pid_is_valid, PID_FMT, "_PID");
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->uid, uid_t, uid_is_valid, UID_FMT, "_UID");
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->gid, gid_t, gid_is_valid, GID_FMT, "_GID");
-
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->comm, "_COMM");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->exe, "_EXE");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->cmdline, "_CMDLINE");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->capeff, "_CAP_EFFECTIVE");
-
-                IOVEC_ADD_SIZED_FIELD(iovec, n, c->label, c->label_size, "_SELINUX_CONTEXT");
-
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->auditid, uint32_t, audit_session_is_valid, "%" PRIu32, "_AUDIT_SESSION");
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->loginuid, uid_t, uid_is_valid, UID_FMT, "_AUDIT_LOGINUID");
-
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->cgroup, "_SYSTEMD_CGROUP");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->session, "_SYSTEMD_SESSION");
-                IOVEC_ADD_NUMERIC_FIELD(iovec, n, c->owner_uid, uid_t, uid_is_valid, UID_FMT, "_SYSTEMD_OWNER_UID");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->unit, "_SYSTEMD_UNIT");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->user_unit, "_SYSTEMD_USER_UNIT");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->slice, "_SYSTEMD_SLICE");
-                IOVEC_ADD_STRING_FIELD(iovec, n, c->user_slice, "_SYSTEMD_USER_SLICE");
+        /* Look up the object's context first, as this might refresh the client's context too if both are the same,
+         * and we reference the fields cached in the client's context below. */
+        if (pid_is_valid(object_pid) && client_context_get(s, object_pid, NULL, NULL, 0, NULL, &o) < 0)
+                o = NULL;
 
-                IOVEC_ADD_ID128_FIELD(iovec, n, c->invocation_id, "_SYSTEMD_INVOCATION_ID");
+        if (c) {
+                /* The client's metadata is formatted when the cache entry is refreshed, just copy it */
+                memcpy(iovec + n, c->meta_iovec, c->meta_n_iovec * sizeof(struct iovec));
+                n += c->meta_n_iovec;
 
                 if (c->extra_fields_n_iovec > 0) {
                         memcpy(iovec + n, c->extra_fields_iovec, c->extra_fields_n_iovec * sizeof(struct iovec));
@@ -947,7 +1212,7 @@ static void dispatch_message_real(
 
         assert(n <= m);
 
-        if (pid_is_valid(object_pid) && client_context_get(s, object_pid, NULL, NULL, 0, NULL, &o) >= 0) {
+        if (o) {
 
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, o->pid, pid_t, pid_is_valid, PID_FMT, "OBJECT_PID");
                 IOVEC_ADD_NUMERIC_FIELD(iovec, n, o->uid, uid_t, uid_is_valid, UID_FMT, "OBJECT_UID");
@@ -1008,7 +1273,13 @@ static void dispatch_message_real(
         else
                 journal_uid = 0;
 
-        write_to_journal(s, journal_uid, iovec, n, priority);
+        if (s->split_mode == SPLIT_UNIT && c && unit_for_unit_journal(c->unit))
+                /* Split up by service, so that noisy services only rotate their own files */
+                journal_unit = c->unit;
+        else
+                journal_unit = NULL;
+
+        write_to_journal(s, journal_uid, journal_unit, iovec, n, priority);
 }
 
 void server_driver_message(Server *s, pid_t object_pid, const char *message_id, const char *format, ...) {
@@ -1041,8 +1312,10 @@ void server_driver_message(Server *s, pid_t object_pid, const char *message_id,
         /* Error handling below */
         va_end(ap);
 
-        if (r >= 0)
+        if (r >= 0) {
+                server_stats_message(&s->stats, SERVER_SOURCE_DRIVER, iovec, n);
                 dispatch_message_real(s, iovec, n, m, s->my_context, NULL, LOG_INFO, object_pid);
+        }
 
         while (k < n)
                 free(iovec[k++].iov_base);
@@ -1060,8 +1333,9 @@ void server_driver_message(Server *s, pid_t object_pid, const char *message_id,
         }
 }
 
-void server_dispatch_message(
+int server_dispatch_message(
                 Server *s,
+                ServerSource source,
                 struct iovec *iovec, size_t n, size_t m,
                 ClientContext *c,
                 const struct timeval *tv,
@@ -1074,23 +1348,29 @@ void server_dispatch_message(
         assert(s);
         assert(iovec || n == 0);
 
+        /* Returns -EAGAIN if the message was dropped due to rate limiting, 0 otherwise */
+
         if (n == 0)
-                return;
+                return 0;
+
+        server_stats_message(&s->stats, source, iovec, n);
 
         if (LOG_PRI(priority) > s->max_level_store)
-                return;
+                return 0;
 
         /* Stop early in case the information will not be stored
          * in a journal. */
         if (s->storage == STORAGE_NONE)
-                return;
+                return 0;
 
         if (c && c->unit) {
                 (void) determine_space(s, &available, NULL);
 
                 rl = journal_rate_limit_test(s->rate_limit, c->unit, c->log_rate_limit_interval, c->log_rate_limit_burst, priority & LOG_PRIMASK, available);
-                if (rl == 0)
-                        return;
+                if (rl == 0) {
+                        server_stats_dropped(&s->stats, source, c->unit);
+                        return -EAGAIN;
+                }
 
                 /* Write a suppression message if we suppressed something */
                 if (rl > 1)
@@ -1102,6 +1382,7 @@ void server_dispatch_message(
         }
 
         dispatch_message_real(s, iovec, n, m, c, tv, priority, object_pid);
+        return 0;
 }
 
 int server_flush_to_var(Server *s, bool require_flag_file) {
@@ -1205,77 +1486,54 @@ finish:
         return r;
 }
 
-int server_process_datagram(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
-        Server *s = userdata;
+/* How many datagrams to receive with a single recvmmsg() call at max */
+#define DATAGRAM_BATCH_MAX 16U
+
+/* The minimum buffer size for all but the first datagram of a batch. The first one is sized according to
+ * SIOCINQ, but we can't know the size of the ones after it, hence make room for the largest datagram an
+ * unprivileged client can send with the default limits: twice net.core.wmem_max, as the kernel doubles
+ * SO_SNDBUF. Privileged clients may raise their limits further, and once we saw a datagram of such a size
+ * the slots grow to fit it, for as long as the whole batch stays within DATAGRAM_BATCH_BUFFER_MAX. Beyond
+ * that we receive one datagram at a time, sized according to SIOCINQ, hence never truncate it. */
+#define DATAGRAM_BATCH_SLOT_SIZE (2U * 212992U)
+#define DATAGRAM_BATCH_BUFFER_MAX (DATAGRAM_BATCH_MAX * DATAGRAM_BATCH_SLOT_SIZE)
+
+typedef union DatagramControl {
+        struct cmsghdr cmsghdr;
+
+        /* We use NAME_MAX space for the SELinux label
+         * here. The kernel currently enforces no
+         * limit, but according to suggestions from
+         * the SELinux people this will change and it
+         * will probably be identical to NAME_MAX. For
+         * now we use that, but this should be updated
+         * one day when the final limit is known. */
+        uint8_t buf[CMSG_SPACE(sizeof(struct ucred)) +
+                    CMSG_SPACE(sizeof(struct timeval)) +
+                    CMSG_SPACE(sizeof(int)) + /* fd */
+                    CMSG_SPACE(NAME_MAX)]; /* selinux label */
+} DatagramControl;
+
+static void server_process_one_datagram(
+                Server *s,
+                int fd,
+                char *buffer,
+                size_t n,
+                struct msghdr *msghdr) {
+
         struct ucred *ucred = NULL;
         struct timeval *tv = NULL;
         struct cmsghdr *cmsg;
         char *label = NULL;
-        size_t label_len = 0, m;
-        struct iovec iovec;
-        ssize_t n;
-        int *fds = NULL, v = 0;
+        size_t label_len = 0;
+        int *fds = NULL;
         size_t n_fds = 0;
 
-        union {
-                struct cmsghdr cmsghdr;
-
-                /* We use NAME_MAX space for the SELinux label
-                 * here. The kernel currently enforces no
-                 * limit, but according to suggestions from
-                 * the SELinux people this will change and it
-                 * will probably be identical to NAME_MAX. For
-                 * now we use that, but this should be updated
-                 * one day when the final limit is known. */
-                uint8_t buf[CMSG_SPACE(sizeof(struct ucred)) +
-                            CMSG_SPACE(sizeof(struct timeval)) +
-                            CMSG_SPACE(sizeof(int)) + /* fd */
-                            CMSG_SPACE(NAME_MAX)]; /* selinux label */
-        } control = {};
-
-        union sockaddr_union sa = {};
-
-        struct msghdr msghdr = {
-                .msg_iov = &iovec,
-                .msg_iovlen = 1,
-                .msg_control = &control,
-                .msg_controllen = sizeof(control),
-                .msg_name = &sa,
-                .msg_namelen = sizeof(sa),
-        };
-
         assert(s);
-        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
-
-        if (revents != EPOLLIN) {
-                log_error("Got invalid event from epoll for datagram fd: %"PRIx32, revents);
-                return -EIO;
-        }
-
-        /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
-         * it.) */
-        (void) ioctl(fd, SIOCINQ, &v);
-
-        /* Fix it up, if it is too small. We use the same fixed value as auditd here. Awful! */
-        m = PAGE_ALIGN(MAX3((size_t) v + 1,
-                            (size_t) LINE_MAX,
-                            ALIGN(sizeof(struct nlmsghdr)) + ALIGN((size_t) MAX_AUDIT_MESSAGE_LENGTH)) + 1);
-
-        if (!GREEDY_REALLOC(s->buffer, s->buffer_size, m))
-                return log_oom();
-
-        iovec.iov_base = s->buffer;
-        iovec.iov_len = s->buffer_size - 1; /* Leave room for trailing NUL we add later */
-
-        n = recvmsg(fd, &msghdr, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
-        if (n < 0) {
-                if (IN_SET(errno, EINTR, EAGAIN))
-                        return 0;
-
-                return log_error_errno(errno, "recvmsg() failed: %m");
-        }
+        assert(buffer);
+        assert(msghdr);
 
-        CMSG_FOREACH(cmsg, &msghdr) {
+        CMSG_FOREACH(cmsg, msghdr) {
 
                 if (cmsg->cmsg_level == SOL_SOCKET &&
                     cmsg->cmsg_type == SCM_CREDENTIALS &&
@@ -1296,18 +1554,26 @@ int server_process_datagram(sd_event_source *es, int fd, uint32_t revents, void
                 }
         }
 
+        if (msghdr->msg_flags & MSG_TRUNC) {
+                /* Make sure the next batch has room for a datagram of this size */
+                s->datagram_size_max = MAX(s->datagram_size_max, n);
+
+                log_warning("Got datagram of %zu bytes, larger than our receive buffer, ignoring.", n);
+                goto finish;
+        }
+
         /* And a trailing NUL, just in case */
-        s->buffer[n] = 0;
+        buffer[n] = 0;
 
         if (fd == s->syslog_fd) {
                 if (n > 0 && n_fds == 0)
-                        server_process_syslog_message(s, s->buffer, n, ucred, tv, label, label_len);
+                        server_process_syslog_message(s, buffer, n, ucred, tv, label, label_len);
                 else if (n_fds > 0)
                         log_warning("Got file descriptors via syslog socket. Ignoring.");
 
         } else if (fd == s->native_fd) {
                 if (n > 0 && n_fds == 0)
-                        server_process_native_message(s, s->buffer, n, ucred, tv, label, label_len);
+                        server_process_native_message(s, buffer, n, ucred, tv, label, label_len);
                 else if (n == 0 && n_fds == 1)
                         server_process_native_file(s, fds[0], ucred, tv, label, label_len);
                 else if (n_fds > 0)
@@ -1317,12 +1583,80 @@ int server_process_datagram(sd_event_source *es, int fd, uint32_t revents, void
                 assert(fd == s->audit_fd);
 
                 if (n > 0 && n_fds == 0)
-                        server_process_audit_message(s, s->buffer, n, ucred, &sa, msghdr.msg_namelen);
+                        server_process_audit_message(s, buffer, n, ucred, msghdr->msg_name, msghdr->msg_namelen);
                 else if (n_fds > 0)
                         log_warning("Got file descriptors via audit socket. Ignoring.");
         }
 
+finish:
         close_many(fds, n_fds);
+}
+
+int server_process_datagram(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
+        Server *s = userdata;
+        DatagramControl control[DATAGRAM_BATCH_MAX] = {};
+        union sockaddr_union sa[DATAGRAM_BATCH_MAX] = {};
+        struct mmsghdr mmsghdr[DATAGRAM_BATCH_MAX] = {};
+        struct iovec iovec[DATAGRAM_BATCH_MAX];
+        size_t m, i, slot_size, n_batch;
+        int n, v = 0;
+
+        assert(s);
+        assert(fd == s->native_fd || fd == s->syslog_fd || fd == s->audit_fd);
+
+        if (revents != EPOLLIN) {
+                log_error("Got invalid event from epoll for datagram fd: %"PRIx32, revents);
+                return -EIO;
+        }
+
+        /* Try to get the right size, if we can. (Not all sockets support SIOCINQ, hence we just try, but don't rely on
+         * it.) */
+        (void) ioctl(fd, SIOCINQ, &v);
+
+        /* Fix it up, if it is too small. We use the same fixed value as auditd here. Awful! */
+        m = PAGE_ALIGN(MAX3((size_t) v + 1,
+                            (size_t) LINE_MAX,
+                            ALIGN(sizeof(struct nlmsghdr)) + ALIGN((size_t) MAX_AUDIT_MESSAGE_LENGTH)) + 1);
+
+        s->datagram_size_max = MAX(s->datagram_size_max, (size_t) v);
+
+        /* During log storms reading one datagram per wakeup is a major cost, hence receive a batch of them at once,
+         * the first one into a buffer sized for it, the others into slots following it, large enough for any
+         * datagram we saw so far. Pages of the slots are only populated as large datagrams actually arrive. */
+        slot_size = PAGE_ALIGN(MAX((size_t) DATAGRAM_BATCH_SLOT_SIZE, s->datagram_size_max + 1));
+        n_batch = CLAMP(DATAGRAM_BATCH_BUFFER_MAX / slot_size, 1U, DATAGRAM_BATCH_MAX);
+
+        if (!GREEDY_REALLOC(s->buffer, s->buffer_size, m + (n_batch - 1) * slot_size))
+                return log_oom();
+
+        for (i = 0; i < n_batch; i++) {
+                if (i == 0)
+                        iovec[i] = IOVEC_MAKE(s->buffer, m - 1); /* Leave room for trailing NUL we add later */
+                else
+                        iovec[i] = IOVEC_MAKE(s->buffer + m + (i - 1) * slot_size, slot_size - 1);
+
+                mmsghdr[i].msg_hdr = (struct msghdr) {
+                        .msg_iov = iovec + i,
+                        .msg_iovlen = 1,
+                        .msg_control = control + i,
+                        .msg_controllen = sizeof(control[i]),
+                        .msg_name = sa + i,
+                        .msg_namelen = sizeof(sa[i]),
+                };
+        }
+
+        /* With MSG_TRUNC the real size of truncated datagrams is reported, so that we can make room for them */
+        n = recvmmsg(fd, mmsghdr, n_batch, MSG_DONTWAIT|MSG_CMSG_CLOEXEC|MSG_TRUNC, NULL);
+        if (n < 0) {
+                if (IN_SET(errno, EINTR, EAGAIN))
+                        return 0;
+
+                return log_error_errno(errno, "recvmmsg() failed: %m");
+        }
+
+        for (i = 0; i < (size_t) n; i++)
+                server_process_one_datagram(s, fd, iovec[i].iov_base, mmsghdr[i].msg_len, &mmsghdr[i].msg_hdr);
+
         return 0;
 }
 
@@ -1390,6 +1724,9 @@ static int dispatch_sigrtmin1(sd_event_source *es, const struct signalfd_siginfo
 
         server_sync(s);
 
+        /* Write the stats right away on an explicit request, including the expensive parts */
+        (void) server_stats_write(s, true);
+
         /* Let clients know when the most recent sync happened. */
         r = write_timestamp_file_atomic("/run/systemd/journal/synced", now(CLOCK_MONOTONIC));
         if (r < 0)
@@ -1403,7 +1740,7 @@ static int setup_signals(Server *s) {
 
         assert(s);
 
-        assert_se(sigprocmask_many(SIG_SETMASK, NULL, SIGINT, SIGTERM, SIGUSR1, SIGUSR2, SIGRTMIN+1, -1) >= 0);
+        assert_se(sigprocmask_many(SIG_SETMASK, NULL, SIGINT, SIGTERM, SIGUSR1, SIGUSR2, SIGRTMIN+1, SIGCHLD, -1) >= 0);
 
         r = sd_event_add_signal(s->event, &s->sigusr1_event_source, SIGUSR1, dispatch_sigusr1, s);
         if (r < 0)
@@ -1569,27 +1906,47 @@ static int server_dispatch_sync(sd_event_source *es, usec_t t, void *userdata) {
 }
 
 int server_schedule_sync(Server *s, int priority) {
+        usec_t delay;
         int r;
 
         assert(s);
 
         if (priority <= LOG_CRIT) {
-                /* Immediately sync to disk when this is of priority CRIT, ALERT, EMERG */
-                server_sync(s);
-                return 0;
-        }
+                /* Sync to disk when this is of priority CRIT, ALERT, EMERG: immediately, or, if configured, after a
+                 * short delay, so that a burst of such messages results in a single sync of all files. */
+                if (s->sync_critical_usec <= 0) {
+                        server_sync(s);
+                        return 0;
+                }
 
-        if (s->sync_scheduled)
-                return 0;
+                delay = s->sync_critical_usec;
+        } else {
+                if (s->sync_scheduled)
+                        return 0;
+
+                delay = s->sync_interval_usec;
+        }
 
-        if (s->sync_interval_usec > 0) {
+        if (delay > 0) {
                 usec_t when;
 
                 r = sd_event_now(s->event, CLOCK_MONOTONIC, &when);
                 if (r < 0)
                         return r;
 
-                when += s->sync_interval_usec;
+                when = usec_add(when, delay);
+
+                /* Never postpone an already scheduled sync */
+                if (s->sync_scheduled) {
+                        usec_t scheduled;
+
+                        r = sd_event_source_get_time(s->sync_event_source, &scheduled);
+                        if (r < 0)
+                                return r;
+
+                        if (scheduled <= when)
+                                return 0;
+                }
 
                 if (!s->sync_event_source) {
                         r = sd_event_add_time(
@@ -1821,6 +2178,7 @@ int server_init(Server *s) {
         s->compress.enabled = true;
         s->compress.threshold_bytes = (uint64_t) -1;
         s->seal = true;
+
         s->read_kmsg = true;
 
         s->watchdog_usec = USEC_INFINITY;
@@ -1842,6 +2200,7 @@ int server_init(Server *s) {
         s->max_level_wall = LOG_EMERG;
 
         s->line_max = DEFAULT_LINE_MAX;
+        s->client_contexts_max = DEFAULT_CLIENT_CONTEXTS_MAX;
 
         journal_reset_metrics(&s->system_storage.metrics);
         journal_reset_metrics(&s->runtime_storage.metrics);
@@ -1858,12 +2217,21 @@ int server_init(Server *s) {
                 s->rate_limit_interval = s->rate_limit_burst = 0;
         }
 
+        if (s->client_contexts_max < 1) {
+                log_debug("Bumping metadata cache size to 1.");
+                s->client_contexts_max = 1;
+        }
+
         (void) mkdir_p("/run/systemd/journal", 0755);
 
         s->user_journals = ordered_hashmap_new(NULL);
         if (!s->user_journals)
                 return log_oom();
 
+        s->unit_journals = ordered_hashmap_new(&string_hash_ops);
+        if (!s->unit_journals)
+                return log_oom();
+
         s->mmap = mmap_cache_new();
         if (!s->mmap)
                 return log_oom();
@@ -1988,6 +2356,8 @@ int server_init(Server *s) {
         if (!s->rate_limit)
                 return -ENOMEM;
 
+        server_stats_init(&s->stats);
+
         r = cg_get_root_path(&s->cgroup_root);
         if (r < 0)
                 return r;
@@ -2024,13 +2394,20 @@ void server_maybe_append_tags(Server *s) {
 
         ORDERED_HASHMAP_FOREACH(f, s->user_journals, i)
                 journal_file_maybe_append_tag(f, n);
+
+        ORDERED_HASHMAP_FOREACH(f, s->unit_journals, i)
+                journal_file_maybe_append_tag(f, n);
 #endif
 }
 
 void server_done(Server *s) {
+        JournalFile *f;
+        char *unit;
+
         assert(s);
 
         set_free_with_destructor(s->deferred_closes, journal_file_close);
+        set_free_free(s->rewrite_queue);
 
         while (s->stdout_streams)
                 stdout_stream_free(s->stdout_streams);
@@ -2045,6 +2422,12 @@ void server_done(Server *s) {
 
         ordered_hashmap_free_with_destructor(s->user_journals, journal_file_close);
 
+        while ((f = ordered_hashmap_steal_first_key_and_value(s->unit_journals, (void**) &unit))) {
+                (void) journal_file_close(f);
+                free(unit);
+        }
+        ordered_hashmap_free(s->unit_journals);
+
         sd_event_source_unref(s->syslog_event_source);
         sd_event_source_unref(s->native_event_source);
         sd_event_source_unref(s->stdout_event_source);
@@ -2059,6 +2442,7 @@ void server_done(Server *s) {
         sd_event_source_unref(s->hostname_event_source);
         sd_event_source_unref(s->notify_event_source);
         sd_event_source_unref(s->watchdog_event_source);
+        sd_event_source_unref(s->rewrite_event_source);
         sd_event_unref(s->event);
 
         safe_close(s->syslog_fd);
@@ -2075,12 +2459,21 @@ void server_done(Server *s) {
         if (s->kernel_seqnum)
                 munmap(s->kernel_seqnum, sizeof(uint64_t));
 
+        kmsg_devices_flush(s);
+        hashmap_free(s->kmsg_devices);
+
+        server_stats_done(&s->stats);
+
         free(s->buffer);
+        free(s->audit_iovec);
+        free(s->audit_buffer);
         free(s->tty_path);
         free(s->cgroup_root);
         free(s->hostname_field);
         free(s->runtime_storage.path);
         free(s->system_storage.path);
+        journal_vacuum_cache_free(s->runtime_storage.vacuum_cache);
+        journal_vacuum_cache_free(s->system_storage.vacuum_cache);
 
         if (s->mmap)
                 mmap_cache_unref(s->mmap);
@@ -2100,6 +2493,7 @@ static const char* const split_mode_table[_SPLIT_MAX] = {
         [SPLIT_LOGIN] = "login",
         [SPLIT_UID] = "uid",
         [SPLIT_NONE] = "none",
+        [SPLIT_UNIT] = "unit",
 };
 
 DEFINE_STRING_TABLE_LOOKUP(split_mode, SplitMode);
@@ -13,6 +13,7 @@ typedef struct Server Server;
 #include "journal-file.h"
 #include "journald-context.h"
 #include "journald-rate-limit.h"
+#include "journald-stats.h"
 #include "journald-stream.h"
 #include "list.h"
 #include "prioq.h"
@@ -30,6 +31,7 @@ typedef enum SplitMode {
         SPLIT_UID,
         SPLIT_LOGIN, /* deprecated */
         SPLIT_NONE,
+        SPLIT_UNIT,
         _SPLIT_MAX,
         _SPLIT_INVALID = -1
 } SplitMode;
@@ -55,6 +57,9 @@ typedef struct JournalStorage {
 
         JournalMetrics metrics;
         JournalStorageSpace space;
+
+        /* Archived files we already looked at while vacuuming */
+        Hashmap *vacuum_cache;
 } JournalStorage;
 
 struct Server {
@@ -82,20 +87,33 @@ struct Server {
         sd_event_source *hostname_event_source;
         sd_event_source *notify_event_source;
         sd_event_source *watchdog_event_source;
+        sd_event_source *rewrite_event_source;
 
         JournalFile *runtime_journal;
         JournalFile *system_journal;
         OrderedHashmap *user_journals;
+        OrderedHashmap *unit_journals;
 
         uint64_t seqnum;
 
         char *buffer;
         size_t buffer_size;
 
+        /* The largest datagram seen so far, which the receive slots of a batch are sized for */
+        size_t datagram_size_max;
+
+        /* Reused between audit records */
+        struct iovec *audit_iovec;
+        size_t audit_iovec_allocated;
+        char *audit_buffer;
+        size_t audit_buffer_allocated;
+
         JournalRateLimit *rate_limit;
         usec_t sync_interval_usec;
+        usec_t sync_critical_usec;
         usec_t rate_limit_interval;
         unsigned rate_limit_burst;
+        bool rate_limit_backpressure;
 
         JournalStorage runtime_storage;
         JournalStorage system_storage;
@@ -103,6 +121,7 @@ struct Server {
         JournalCompressOptions compress;
         bool seal;
         bool read_kmsg;
+        bool rewrite_archived;
 
         bool forward_to_kmsg;
         bool forward_to_syslog;
@@ -137,6 +156,9 @@ struct Server {
 
         Set *deferred_closes;
 
+        /* Archived files waiting to be rewritten in the background */
+        Set *rewrite_queue;
+
         uint64_t *kernel_seqnum;
         bool dev_kmsg_readable:1;
 
@@ -160,6 +182,15 @@ struct Server {
         /* Caching of client metadata */
         Hashmap *client_contexts;
         Prioq *client_contexts_lru;
+        unsigned client_contexts_max;
+
+        /* Caching of per-unit settings */
+        Hashmap *unit_contexts;
+
+        /* Caching of udev device properties for kernel messages */
+        Hashmap *kmsg_devices;
+
+        ServerStats stats;
 
         ClientContext *my_context; /* the context of journald itself */
         ClientContext *pid1_context; /* the context of PID 1 */
@@ -182,7 +213,14 @@ struct Server {
 /* kmsg: Maximum number of extra fields we'll import from udev's devices */
 #define N_IOVEC_UDEV_FIELDS 32
 
-void server_dispatch_message(Server *s, struct iovec *iovec, size_t n, size_t m, ClientContext *c, const struct timeval *tv, int priority, pid_t object_pid);
+/* The receive buffer size for the datagram sockets, matching what the socket units configure */
+#define DATAGRAM_RECEIVE_BUFFER_SIZE (8U*1024U*1024U)
+
+/* Datagram sources, and /dev/kmsg, are processed before stream sources: datagrams and kernel messages are
+ * dropped when the receive buffer overflows, while stream clients are merely blocked until we get to them. */
+#define DATAGRAM_EVENT_PRIORITY (SD_EVENT_PRIORITY_NORMAL+4)
+
+int server_dispatch_message(Server *s, ServerSource source, struct iovec *iovec, size_t n, size_t m, ClientContext *c, const struct timeval *tv, int priority, pid_t object_pid);
 void server_driver_message(Server *s, pid_t object_pid, const char *message_id, const char *format, ...) _sentinel_ _printf_(4,0);
 
 /* gperf lookup function */
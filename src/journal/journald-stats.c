@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "alloc-util.h"
+#include "event-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "journald-server.h"
+#include "journald-stats.h"
+#include "mmap-cache.h"
+#include "string-table.h"
+#include "util.h"
+
+/* Keep the rate limiting drop counters of at most this many units, so that a flood of short-lived units can't make
+ * us use unbounded memory. The drops of units beyond that are still counted per source. */
+#define STATS_UNITS_MAX 1024U
+
+#define STATS_PATH "/run/systemd/journal/stats"
+
+/* Rewrite the stats file at most this often, since every sync would otherwise create and rename a file */
+#define STATS_WRITE_INTERVAL_USEC (5*USEC_PER_SEC)
+
+void server_stats_init(ServerStats *st) {
+        assert(st);
+
+        *st = (ServerStats) {
+                .start_usec = now(CLOCK_MONOTONIC),
+        };
+}
+
+void server_stats_done(ServerStats *st) {
+        assert(st);
+
+        st->dropped_per_unit = hashmap_free_free_free(st->dropped_per_unit);
+        st->write_event_source = sd_event_source_unref(st->write_event_source);
+}
+
+void server_stats_message(ServerStats *st, ServerSource source, const struct iovec *iovec, size_t n) {
+        assert(st);
+        assert(source >= 0 && source < _SERVER_SOURCE_MAX);
+
+        st->sources[source].n_messages++;
+        st->sources[source].n_bytes += IOVEC_TOTAL_SIZE(iovec, n);
+}
+
+void server_stats_dropped(ServerStats *st, ServerSource source, const char *unit) {
+        _cleanup_free_ uint64_t *c = NULL;
+        _cleanup_free_ char *k = NULL;
+        uint64_t *p;
+
+        assert(st);
+        assert(source >= 0 && source < _SERVER_SOURCE_MAX);
+
+        st->sources[source].n_dropped++;
+
+        if (!unit)
+                return;
+
+        p = hashmap_get(st->dropped_per_unit, unit);
+        if (p) {
+                (*p)++;
+                return;
+        }
+
+        if (hashmap_size(st->dropped_per_unit) >= STATS_UNITS_MAX)
+                return;
+
+        if (hashmap_ensure_allocated(&st->dropped_per_unit, &string_hash_ops) < 0)
+                return;
+
+        k = strdup(unit);
+        c = new(uint64_t, 1);
+        if (!k || !c)
+                return;
+
+        *c = 1;
+
+        if (hashmap_put(st->dropped_per_unit, k, c) < 0)
+                return;
+
+        k = NULL;
+        c = NULL;
+}
+
+void server_stats_append(ServerStats *st, usec_t latency, int r) {
+        unsigned i;
+
+        assert(st);
+
+        if (r < 0) {
+                st->n_append_failed++;
+                return;
+        }
+
+        for (i = 0; i < STATS_LATENCY_BUCKETS - 1; i++)
+                if (latency < (UINT64_C(1) << i))
+                        break;
+
+        st->append_latency[i]++;
+}
+
+void server_stats_sync(ServerStats *st, usec_t duration) {
+        assert(st);
+
+        st->n_syncs++;
+        st->sync_usec += duration;
+        st->sync_usec_max = MAX(st->sync_usec_max, duration);
+}
+
+void server_stats_allocate(ServerStats *st, uint64_t n, usec_t duration) {
+        assert(st);
+
+        st->n_allocations += n;
+        st->allocation_usec += duration;
+        st->allocation_usec_max = MAX(st->allocation_usec_max, duration);
+}
+
+static const char* const server_source_table[_SERVER_SOURCE_MAX] = {
+        [SERVER_SOURCE_NATIVE] = "journal",
+        [SERVER_SOURCE_SYSLOG] = "syslog",
+        [SERVER_SOURCE_STDOUT] = "stdout",
+        [SERVER_SOURCE_KERNEL] = "kernel",
+        [SERVER_SOURCE_AUDIT] = "audit",
+        [SERVER_SOURCE_DRIVER] = "driver",
+};
+
+DEFINE_PRIVATE_STRING_TABLE_LOOKUP_TO_STRING(server_source, ServerSource);
+
+static void stats_write_source(FILE *f, ServerSource source, const SourceStats *ss) {
+        const char *name;
+
+        name = server_source_to_string(source);
+
+        fprintf(f,
+                "%s.messages %" PRIu64 "\n"
+                "%s.bytes %" PRIu64 "\n"
+                "%s.dropped %" PRIu64 "\n",
+                name, ss->n_messages,
+                name, ss->n_bytes,
+                name, ss->n_dropped);
+}
+
+int server_stats_write(Server *s, bool with_event_sources) {
+        _cleanup_free_ char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        ServerStats *st;
+        ServerSource source;
+        Iterator i;
+        unsigned k;
+        uint64_t *p;
+        char *unit;
+        int r;
+
+        assert(s);
+
+        /* Writes the counters to /run/systemd/journal/stats, one "key value" pair per line. All of them are
+         * cumulative since journald was started, and "uptime_usec" is included, so that rates can be calculated by
+         * comparing two snapshots. The per event source statistics are only included on explicit request, since
+         * collecting them walks all event sources. */
+
+        st = &s->stats;
+
+        /* A full write supersedes the one scheduled after the sync that preceded it */
+        if (with_event_sources && st->write_event_source)
+                (void) sd_event_source_set_enabled(st->write_event_source, SD_EVENT_OFF);
+
+        r = fopen_temporary(STATS_PATH, &f, &temp_path);
+        if (r < 0)
+                goto fail;
+
+        (void) fchmod(fileno(f), 0644);
+
+        fprintf(f, "uptime_usec " USEC_FMT "\n", now(CLOCK_MONOTONIC) - st->start_usec);
+
+        for (source = 0; source < _SERVER_SOURCE_MAX; source++)
+                stats_write_source(f, source, st->sources + source);
+
+        for (k = 0; k < STATS_LATENCY_BUCKETS - 1; k++)
+                fprintf(f, "append.latency.lt_%" PRIu64 "us %" PRIu64 "\n", UINT64_C(1) << k, st->append_latency[k]);
+        fprintf(f, "append.latency.ge_%" PRIu64 "us %" PRIu64 "\n", UINT64_C(1) << (STATS_LATENCY_BUCKETS - 2), st->append_latency[k]);
+        fprintf(f, "append.failed %" PRIu64 "\n", st->n_append_failed);
+
+        fprintf(f,
+                "sync.count %" PRIu64 "\n"
+                "sync.usec " USEC_FMT "\n"
+                "sync.max_usec " USEC_FMT "\n",
+                st->n_syncs, st->sync_usec, st->sync_usec_max);
+
+        fprintf(f,
+                "allocate.count %" PRIu64 "\n"
+                "allocate.usec " USEC_FMT "\n"
+                "allocate.max_usec " USEC_FMT "\n",
+                st->n_allocations, st->allocation_usec, st->allocation_usec_max);
+
+        if (s->mmap)
+                fprintf(f,
+                        "mmap_cache.hit %u\n"
+                        "mmap_cache.missed %u\n",
+                        mmap_cache_get_hit(s->mmap),
+                        mmap_cache_get_missed(s->mmap));
+
+        HASHMAP_FOREACH_KEY(p, unit, st->dropped_per_unit, i)
+                fprintf(f, "unit.%s.dropped %" PRIu64 "\n", unit, *p);
+
+        if (with_event_sources)
+                (void) event_dump_source_stats(s->event, f, "event.");
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                goto fail;
+
+        if (rename(temp_path, STATS_PATH) < 0) {
+                r = -errno;
+                goto fail;
+        }
+
+        temp_path = mfree(temp_path);
+        return 0;
+
+fail:
+        if (temp_path)
+                (void) unlink(temp_path);
+
+        return log_warning_errno(r, "Failed to write " STATS_PATH ", ignoring: %m");
+}
+
+static int dispatch_stats_write(sd_event_source *es, usec_t usec, void *userdata) {
+        Server *s = userdata;
+
+        assert(s);
+
+        (void) server_stats_write(s, false);
+        return 0;
+}
+
+void server_stats_schedule_write(Server *s) {
+        ServerStats *st;
+        usec_t when;
+        int r;
+
+        assert(s);
+
+        st = &s->stats;
+
+        /* Called after every sync. Write the file once the interval has passed rather than right away, so that
+         * a busy journald doesn't rewrite it many times a second. */
+
+        if (st->write_event_source) {
+                r = sd_event_source_get_enabled(st->write_event_source, NULL);
+                if (r < 0)
+                        goto fail;
+                if (r > 0) /* Already scheduled */
+                        return;
+        }
+
+        r = sd_event_now(s->event, CLOCK_MONOTONIC, &when);
+        if (r < 0)
+                goto fail;
+
+        when = usec_add(when, STATS_WRITE_INTERVAL_USEC);
+
+        if (st->write_event_source) {
+                r = sd_event_source_set_time(st->write_event_source, when);
+                if (r < 0)
+                        goto fail;
+
+                r = sd_event_source_set_enabled(st->write_event_source, SD_EVENT_ONESHOT);
+        } else
+                r = sd_event_add_time(s->event, &st->write_event_source, CLOCK_MONOTONIC, when, USEC_PER_SEC, dispatch_stats_write, s);
+        if (r < 0)
+                goto fail;
+
+        return;
+
+fail:
+        log_debug_errno(r, "Failed to schedule writing " STATS_PATH ", ignoring: %m");
+}
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <inttypes.h>
+#include <sys/uio.h>
+
+#include "sd-event.h"
+
+#include "hashmap.h"
+#include "macro.h"
+#include "time-util.h"
+
+typedef struct Server Server;
+
+typedef enum ServerSource {
+        SERVER_SOURCE_NATIVE,
+        SERVER_SOURCE_SYSLOG,
+        SERVER_SOURCE_STDOUT,
+        SERVER_SOURCE_KERNEL,
+        SERVER_SOURCE_AUDIT,
+        SERVER_SOURCE_DRIVER,
+        _SERVER_SOURCE_MAX,
+        _SERVER_SOURCE_INVALID = -1
+} ServerSource;
+
+/* The append latency histogram has power-of-two buckets, starting at 1µs, the last one catches the rest */
+#define STATS_LATENCY_BUCKETS 20
+
+typedef struct SourceStats {
+        uint64_t n_messages;
+        uint64_t n_bytes;
+        uint64_t n_dropped;
+} SourceStats;
+
+typedef struct ServerStats {
+        usec_t start_usec;
+
+        SourceStats sources[_SERVER_SOURCE_MAX];
+
+        uint64_t append_latency[STATS_LATENCY_BUCKETS];
+        uint64_t n_append_failed;
+
+        uint64_t n_syncs;
+        usec_t sync_usec;
+        usec_t sync_usec_max;
+
+        /* Journal files growing while appending */
+        uint64_t n_allocations;
+        usec_t allocation_usec;
+        usec_t allocation_usec_max;
+
+        /* Messages dropped due to rate limiting, per unit, as allocated uint64_t counters */
+        Hashmap *dropped_per_unit;
+
+        /* Writes the stats file, at most once per interval */
+        sd_event_source *write_event_source;
+} ServerStats;
+
+void server_stats_init(ServerStats *st);
+void server_stats_done(ServerStats *st);
+
+void server_stats_message(ServerStats *st, ServerSource source, const struct iovec *iovec, size_t n);
+void server_stats_dropped(ServerStats *st, ServerSource source, const char *unit);
+void server_stats_append(ServerStats *st, usec_t latency, int r);
+void server_stats_sync(ServerStats *st, usec_t duration);
+void server_stats_allocate(ServerStats *st, uint64_t n, usec_t duration);
+
+int server_stats_write(Server *s, bool with_event_sources);
+void server_stats_schedule_write(Server *s);
@@ -65,6 +65,7 @@ struct StdoutStream {
         struct ucred ucred;
         char *label;
         char *identifier;
+        char *identifier_field;
         char *unit_id;
         int priority;
         bool level_prefix:1;
@@ -74,12 +75,15 @@ struct StdoutStream {
 
         bool fdstore:1;
         bool in_notify_queue:1;
+        bool read_full:1;
+        bool paused:1;
 
         char *buffer;
         size_t length;
         size_t allocated;
 
         sd_event_source *event_source;
+        sd_event_source *resume_event_source;
 
         char *state_file;
 
@@ -113,9 +117,12 @@ void stdout_stream_free(StdoutStream *s) {
                 s->event_source = sd_event_source_unref(s->event_source);
         }
 
+        sd_event_source_unref(s->resume_event_source);
+
         safe_close(s->fd);
         free(s->label);
         free(s->identifier);
+        free(s->identifier_field);
         free(s->unit_id);
         free(s->state_file);
         free(s->buffer);
@@ -233,12 +240,75 @@ fail:
         return log_error_errno(r, "Failed to save stream data %s: %m", s->state_file);
 }
 
+static int stdout_stream_scan(StdoutStream *s, bool force_flush);
+
+static int stdout_stream_resume(sd_event_source *es, usec_t usec, void *userdata) {
+        StdoutStream *s = userdata;
+        int r;
+
+        assert(s);
+
+        s->paused = false;
+
+        /* First process what we already read, this might pause us again right away */
+        r = stdout_stream_scan(s, false);
+        if (r < 0) {
+                stdout_stream_destroy(s);
+                return 0;
+        }
+
+        if (!s->paused) {
+                r = sd_event_source_set_enabled(s->event_source, SD_EVENT_ON);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to resume stream, closing: %m");
+                        stdout_stream_destroy(s);
+                }
+        }
+
+        return 0;
+}
+
+static int stdout_stream_pause(StdoutStream *s, int priority) {
+        usec_t until;
+        int r;
+
+        assert(s);
+        assert(s->context);
+        assert(s->context->unit);
+
+        /* Instead of dropping everything the client writes while it is rate limited, stop reading from the stream
+         * until the rate limit interval is over, so that the client blocks on writing. Only whatever we read already
+         * is lost. */
+
+        until = journal_rate_limit_suppressed_until(s->server->rate_limit, s->context->unit, s->context->log_rate_limit_interval, LOG_PRI(priority));
+        if (until == 0)
+                return 0;
+
+        if (s->resume_event_source) {
+                r = sd_event_source_set_time(s->resume_event_source, until);
+                if (r < 0)
+                        return r;
+
+                r = sd_event_source_set_enabled(s->resume_event_source, SD_EVENT_ONESHOT);
+        } else
+                r = sd_event_add_time(s->server->event, &s->resume_event_source, CLOCK_MONOTONIC, until, 0, stdout_stream_resume, s);
+        if (r < 0)
+                return r;
+
+        r = sd_event_source_set_enabled(s->event_source, SD_EVENT_OFF);
+        if (r < 0)
+                return r;
+
+        s->paused = true;
+        return 0;
+}
+
 static int stdout_stream_log(StdoutStream *s, const char *p, LineBreak line_break) {
         struct iovec *iovec;
         int priority;
         char syslog_priority[] = "PRIORITY=\0";
         char syslog_facility[STRLEN("SYSLOG_FACILITY=") + DECIMAL_STR_MAX(int) + 1];
-        _cleanup_free_ char *message = NULL, *syslog_identifier = NULL;
+        _cleanup_free_ char *message = NULL;
         size_t n = 0, m;
         int r;
 
@@ -291,9 +361,11 @@ static int stdout_stream_log(StdoutStream *s, const char *p, LineBreak line_brea
         }
 
         if (s->identifier) {
-                syslog_identifier = strappend("SYSLOG_IDENTIFIER=", s->identifier);
-                if (syslog_identifier)
-                        iovec[n++] = IOVEC_MAKE_STRING(syslog_identifier);
+                /* The identifier never changes once the stream is running, hence format the field only once */
+                if (!s->identifier_field)
+                        s->identifier_field = strappend("SYSLOG_IDENTIFIER=", s->identifier);
+                if (s->identifier_field)
+                        iovec[n++] = IOVEC_MAKE_STRING(s->identifier_field);
         }
 
         if (line_break != LINE_BREAK_NEWLINE) {
@@ -312,7 +384,13 @@ static int stdout_stream_log(StdoutStream *s, const char *p, LineBreak line_brea
         if (message)
                 iovec[n++] = IOVEC_MAKE_STRING(message);
 
-        server_dispatch_message(s->server, iovec, n, m, s->context, NULL, priority, 0);
+        r = server_dispatch_message(s->server, SERVER_SOURCE_STDOUT, iovec, n, m, s->context, NULL, priority, 0);
+        if (r == -EAGAIN && s->server->rate_limit_backpressure && s->context && s->context->unit) {
+                r = stdout_stream_pause(s, priority);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to pause rate limited stream, ignoring: %m");
+        }
+
         return 0;
 }
 
@@ -463,9 +541,13 @@ static int stdout_stream_scan(StdoutStream *s, bool force_flush) {
 
                 remaining -= skip;
                 p += skip;
+
+                /* Leave the rest in the buffer if we got rate limited, we'll continue when resuming */
+                if (s->paused)
+                        break;
         }
 
-        if (force_flush && remaining > 0) {
+        if (force_flush && remaining > 0 && !s->paused) {
                 p[remaining] = 0;
                 r = stdout_stream_line(s, p, LINE_BREAK_EOF);
                 if (r < 0)
@@ -496,9 +578,12 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
                 goto terminate;
         }
 
-        /* If the buffer is full already (discounting the extra NUL we need), add room for another 1K */
-        if (s->length + 1 >= s->allocated) {
-                if (!GREEDY_REALLOC(s->buffer, s->allocated, s->length + 1 + 1024)) {
+        /* If the buffer is full already (discounting the extra NUL we need), add room for another 1K. Also grow it if
+         * the last read filled it completely, as the client is then likely writing faster than we read, and larger
+         * reads mean fewer of them. */
+        if (s->length + 1 >= s->allocated ||
+            (s->read_full && s->allocated <= s->server->line_max)) {
+                if (!GREEDY_REALLOC(s->buffer, s->allocated, MAX(s->length + 1, s->allocated) + 1024)) {
                         log_oom();
                         goto terminate;
                 }
@@ -522,6 +607,7 @@ static int stdout_stream_process(sd_event_source *es, int fd, uint32_t revents,
                 goto terminate;
         }
 
+        s->read_full = (size_t) l == limit - s->length;
         s->length += l;
         r = stdout_stream_scan(s, false);
         if (r < 0)
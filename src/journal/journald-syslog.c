@@ -438,7 +438,7 @@ void server_process_syslog_message(
                 iovec[n++] = IOVEC_MAKE(msg_raw, hlen + raw_len);
         }
 
-        server_dispatch_message(s, iovec, n, m, context, tv, priority, 0);
+        server_dispatch_message(s, SERVER_SOURCE_SYSLOG, iovec, n, m, context, tv, priority, 0);
 }
 
 int server_open_syslog_socket(Server *s) {
@@ -482,11 +482,16 @@ int server_open_syslog_socket(Server *s) {
         if (r < 0)
                 return log_error_errno(r, "SO_TIMESTAMP failed: %m");
 
+        /* The socket unit sets this already, but not if we opened the socket ourselves. */
+        r = fd_inc_rcvbuf(s->syslog_fd, DATAGRAM_RECEIVE_BUFFER_SIZE);
+        if (r < 0)
+                log_warning_errno(r, "Failed to increase receive buffer size, ignoring: %m");
+
         r = sd_event_add_io(s->event, &s->syslog_event_source, s->syslog_fd, EPOLLIN, server_process_datagram, s);
         if (r < 0)
                 return log_error_errno(r, "Failed to add syslog server fd to event loop: %m");
 
-        r = sd_event_source_set_priority(s->syslog_event_source, SD_EVENT_PRIORITY_NORMAL+5);
+        r = sd_event_source_set_priority(s->syslog_event_source, DATAGRAM_EVENT_PRIORITY);
         if (r < 0)
                 return log_error_errno(r, "Failed to adjust syslog event source priority: %m");
 
@@ -42,6 +42,12 @@ struct Context {
         unsigned id;
         Window *window;
 
+        /* The last window we had to map for this context, and for how many mappings in a row the next window
+         * directly followed or preceded the previous one, to detect sequential access */
+        uint64_t last_offset;
+        size_t last_size;
+        unsigned n_forward, n_backward;
+
         LIST_FIELDS(Context, by_window);
 };
 
@@ -67,6 +73,9 @@ struct MMapCache {
 
 #define WINDOWS_MIN 64
 
+/* Windows of contexts that are accessed sequentially grow up to WINDOW_SIZE << WINDOW_SCALE_MAX */
+#define WINDOW_SCALE_MAX 2
+
 #if ENABLE_DEBUG_MMAP_CACHE
 /* Tiny windows increase mmap activity and the chance of exposing unsafe use. */
 # define WINDOW_SIZE (page_size())
@@ -428,7 +437,8 @@ static int add_mmap(
                 void **ret,
                 size_t *ret_size) {
 
-        uint64_t woffset, wsize;
+        uint64_t woffset, wsize, target;
+        bool sequential;
         Context *c;
         Window *w;
         void *d;
@@ -440,21 +450,44 @@ static int add_mmap(
         assert(size > 0);
         assert(ret);
 
+        c = context_add(m, context);
+        if (!c)
+                return -ENOMEM;
+
+        /* Did we just run off either end of the window we mapped last for this context? */
+        if (c->last_size > 0 && offset >= c->last_offset + c->last_size && offset < c->last_offset + 2 * c->last_size) {
+                c->n_forward++;
+                c->n_backward = 0;
+        } else if (c->last_size > 0 && offset < c->last_offset && offset + size + c->last_size > c->last_offset) {
+                c->n_backward++;
+                c->n_forward = 0;
+        } else
+                c->n_forward = c->n_backward = 0;
+
+        sequential = c->n_forward > 0 || c->n_backward > 0;
+        target = WINDOW_SIZE << MIN(MAX(c->n_forward, c->n_backward), (unsigned) WINDOW_SCALE_MAX);
+
         woffset = offset & ~((uint64_t) page_size() - 1ULL);
         wsize = size + (offset - woffset);
         wsize = PAGE_ALIGN(wsize);
 
-        if (wsize < WINDOW_SIZE) {
+        if (wsize < target) {
                 uint64_t delta;
 
-                delta = PAGE_ALIGN((WINDOW_SIZE - wsize) / 2);
+                /* Put the window ahead of us when scanning, and around the requested range otherwise */
+                if (c->n_forward > 0)
+                        delta = 0;
+                else if (c->n_backward > 0)
+                        delta = target - wsize;
+                else
+                        delta = PAGE_ALIGN((target - wsize) / 2);
 
-                if (delta > offset)
+                if (delta > woffset)
                         woffset = 0;
                 else
                         woffset -= delta;
 
-                wsize = WINDOW_SIZE;
+                wsize = target;
         }
 
         if (st) {
@@ -473,9 +506,12 @@ static int add_mmap(
         if (r < 0)
                 return r;
 
-        c = context_add(m, context);
-        if (!c)
-                goto outofmem;
+        /* When scanning, let the kernel read ahead the window we are about to walk. Don't use
+         * MADV_SEQUENTIAL here: it makes the kernel drop pages behind us, but the same file is typically
+         * read again and again, from other contexts of this cache, by other readers or by journald itself,
+         * which would then have to fault them in again. */
+        if (sequential)
+                (void) madvise(d, wsize, MADV_WILLNEED);
 
         w = window_add(m, f, prot, keep_always, woffset, wsize, d);
         if (!w)
@@ -483,6 +519,9 @@ static int add_mmap(
 
         context_attach_window(c, w);
 
+        c->last_offset = woffset;
+        c->last_size = wsize;
+
         *ret = (uint8_t*) w->ptr + (offset - w->offset);
         if (ret_size)
                 *ret_size = w->size - (offset - w->offset);
@@ -48,6 +48,8 @@
 
 #define DEFAULT_DATA_THRESHOLD (64*1024)
 
+#define UNIQUE_VALUES_SIZE_MAX (16U*1024U*1024U)
+
 static void remove_file_real(sd_journal *j, JournalFile *f);
 
 static bool journal_pid_changed(sd_journal *j) {
@@ -110,8 +112,15 @@ static void detach_location(sd_journal *j) {
         j->current_file = NULL;
         j->current_field = 0;
 
-        ORDERED_HASHMAP_FOREACH(f, j->files, i)
+        /* The files lose their candidate entries, hence the queue can't be reordered anymore, not even to
+         * empty it. Drop it as a whole. */
+        j->files_by_location = prioq_free(j->files_by_location);
+        j->files_by_location_valid = false;
+
+        ORDERED_HASHMAP_FOREACH(f, j->files, i) {
+                f->location_prioq_idx = PRIOQ_IDX_NULL;
                 journal_file_reset_location(f);
+        }
 }
 
 static void reset_location(sd_journal *j) {
@@ -227,6 +236,7 @@ static void match_free(Match *m) {
         if (m->parent)
                 LIST_REMOVE(matches, m->parent->matches, m);
 
+        hashmap_free_free(m->keyed_hashes);
         free(m->data);
         free(m);
 }
@@ -279,7 +289,7 @@ _public_ int sd_journal_add_match(sd_journal *j, const void *data, size_t size)
         assert(j->level1->type == MATCH_OR_TERM);
         assert(j->level2->type == MATCH_AND_TERM);
 
-        le_hash = htole64(hash64(data, size));
+        le_hash = htole64(jenkins_hash64(data, size));
 
         LIST_FOREACH(matches, l3, j->level2->matches) {
                 assert(l3->type == MATCH_OR_TERM);
@@ -482,6 +492,55 @@ _pure_ static int compare_with_location(JournalFile *f, Location *l) {
         return 0;
 }
 
+typedef struct MatchKeyedHash {
+        sd_id128_t file_id;
+        uint64_t hash;
+} MatchKeyedHash;
+
+static int match_hash_for_file(Match *m, JournalFile *f, uint64_t *ret) {
+        MatchKeyedHash *k;
+        int r;
+
+        assert(m);
+        assert(m->type == MATCH_DISCRETE);
+        assert(f);
+        assert(ret);
+
+        if (!JOURNAL_HEADER_KEYED_HASH(f->header)) {
+                *ret = le64toh(m->le_hash);
+                return 0;
+        }
+
+        /* The keyed hash depends on the file ID, so it has to be calculated once per file. Remember it,
+         * since we get here for every step of every file while iterating. */
+
+        k = hashmap_get(m->keyed_hashes, &f->header->file_id);
+        if (k) {
+                *ret = k->hash;
+                return 0;
+        }
+
+        r = hashmap_ensure_allocated(&m->keyed_hashes, &id128_hash_ops);
+        if (r < 0)
+                return r;
+
+        k = new(MatchKeyedHash, 1);
+        if (!k)
+                return -ENOMEM;
+
+        k->file_id = f->header->file_id;
+        k->hash = journal_file_hash_data(f, m->data, m->size);
+
+        r = hashmap_put(m->keyed_hashes, &k->file_id, k);
+        if (r < 0) {
+                free(k);
+                return r;
+        }
+
+        *ret = k->hash;
+        return 0;
+}
+
 static int next_for_match(
                 sd_journal *j,
                 Match *m,
@@ -500,9 +559,13 @@ static int next_for_match(
         assert(f);
 
         if (m->type == MATCH_DISCRETE) {
-                uint64_t dp;
+                uint64_t dp, hash;
+
+                r = match_hash_for_file(m, f, &hash);
+                if (r < 0)
+                        return r;
 
-                r = journal_file_find_data_object_with_hash(f, m->data, m->size, le64toh(m->le_hash), NULL, &dp);
+                r = journal_file_find_data_object_with_hash(f, m->data, m->size, hash, NULL, &dp);
                 if (r <= 0)
                         return r;
 
@@ -589,9 +652,13 @@ static int find_location_for_match(
         assert(f);
 
         if (m->type == MATCH_DISCRETE) {
-                uint64_t dp;
+                uint64_t dp, hash;
 
-                r = journal_file_find_data_object_with_hash(f, m->data, m->size, le64toh(m->le_hash), NULL, &dp);
+                r = match_hash_for_file(m, f, &hash);
+                if (r < 0)
+                        return r;
+
+                r = journal_file_find_data_object_with_hash(f, m->data, m->size, hash, NULL, &dp);
                 if (r <= 0)
                         return r;
 
@@ -673,6 +740,23 @@ static int find_location_for_match(
         }
 }
 
+static bool file_may_contain_realtime(JournalFile *f, uint64_t realtime, direction_t direction) {
+        assert(f);
+        assert(f->header);
+
+        /* The head and tail timestamps are kept in the header, which we have mapped anyway, hence check them
+         * before bisecting the file's entry arrays and looking up data objects for the matches, which would
+         * otherwise fault in pages of files which cannot contain anything we are looking for. */
+
+        if (f->header->head_entry_realtime == 0)
+                return false;
+
+        if (direction == DIRECTION_DOWN)
+                return le64toh(f->header->tail_entry_realtime) >= realtime;
+        else
+                return le64toh(f->header->head_entry_realtime) <= realtime;
+}
+
 static int find_location_with_matches(
                 sd_journal *j,
                 JournalFile *f,
@@ -687,6 +771,15 @@ static int find_location_with_matches(
         assert(ret);
         assert(offset);
 
+        /* When seeking purely by wallclock time, we can tell from the header alone whether this file needs
+         * to be looked at all */
+        if (j->current_location.type == LOCATION_SEEK &&
+            j->current_location.realtime_set &&
+            !j->current_location.seqnum_set &&
+            !j->current_location.monotonic_set &&
+            !file_may_contain_realtime(f, j->current_location.realtime, direction))
+                return 0;
+
         if (!j->level0) {
                 /* No matches is simple */
 
@@ -802,15 +895,35 @@ static int next_beyond_location(sd_journal *j, JournalFile *f, direction_t direc
         }
 }
 
-static int real_journal_next(sd_journal *j, direction_t direction) {
-        JournalFile *new_file = NULL;
+static int files_by_location_compare_down(const void *a, const void *b) {
+        return journal_file_compare_locations((JournalFile*) a, (JournalFile*) b);
+}
+
+static int files_by_location_compare_up(const void *a, const void *b) {
+        return journal_file_compare_locations((JournalFile*) b, (JournalFile*) a);
+}
+
+static int rebuild_files_by_location(sd_journal *j, direction_t direction) {
         unsigned i, n_files;
         const void **files;
-        Object *o;
         int r;
 
-        assert_return(j, -EINVAL);
-        assert_return(!journal_pid_changed(j), -ECHILD);
+        assert(j);
+
+        j->files_by_location_valid = false;
+
+        if (j->files_by_location && j->files_by_location_direction != direction)
+                j->files_by_location = prioq_free(j->files_by_location);
+        else
+                while (prioq_pop(j->files_by_location))
+                        ;
+
+        r = prioq_ensure_allocated(&j->files_by_location,
+                                   direction == DIRECTION_DOWN ? files_by_location_compare_down : files_by_location_compare_up);
+        if (r < 0)
+                return r;
+
+        j->files_by_location_direction = direction;
 
         r = iterated_cache_get(j->files_cache, NULL, &files, &n_files);
         if (r < 0)
@@ -818,7 +931,8 @@ static int real_journal_next(sd_journal *j, direction_t direction) {
 
         for (i = 0; i < n_files; i++) {
                 JournalFile *f = (JournalFile *)files[i];
-                bool found;
+
+                f->location_prioq_idx = PRIOQ_IDX_NULL;
 
                 r = next_beyond_location(j, f, direction);
                 if (r < 0) {
@@ -830,22 +944,79 @@ static int real_journal_next(sd_journal *j, direction_t direction) {
                         continue;
                 }
 
-                if (!new_file)
-                        found = true;
-                else {
-                        int k;
+                r = prioq_put(j->files_by_location, f, &f->location_prioq_idx);
+                if (r < 0)
+                        return r;
+        }
 
-                        k = journal_file_compare_locations(f, new_file);
+        j->files_by_location_valid = true;
+        return 0;
+}
 
-                        found = direction == DIRECTION_DOWN ? k < 0 : k > 0;
-                }
+static int real_journal_next(sd_journal *j, direction_t direction) {
+        JournalFile *new_file;
+        bool rebuilt = false;
+        Object *o;
+        int r;
 
-                if (found)
-                        new_file = f;
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+
+        /* Rather than asking every file for its next entry on each step, keep the files ordered by their
+         * candidate entry. Only the file we picked last moved since, so it is enough to advance the files at
+         * the front of the queue until the first one has an entry beyond the current location. Entries that
+         * are contained in multiple files are skipped that way too, as they sort right at the front. Files
+         * that reached their end are only looked at again when we rebuild the queue, which happens whenever
+         * the set of files, the matches, the location or the direction changed, and when we ran out of
+         * entries, so that entries appended in the meantime are picked up. */
+
+        if (!j->files_by_location_valid || j->files_by_location_direction != direction) {
+                r = rebuild_files_by_location(j, direction);
+                if (r < 0)
+                        return r;
+
+                rebuilt = true;
         }
 
-        if (!new_file)
-                return 0;
+        for (;;) {
+                LocationType type;
+                uint64_t offset;
+
+                new_file = prioq_peek(j->files_by_location);
+                if (!new_file) {
+                        if (rebuilt)
+                                return 0;
+
+                        /* Only treat this as EOF if no new entries showed up in any of the files. */
+                        r = rebuild_files_by_location(j, direction);
+                        if (r < 0)
+                                return r;
+
+                        rebuilt = true;
+                        continue;
+                }
+
+                type = new_file->location_type;
+                offset = new_file->current_offset;
+
+                r = next_beyond_location(j, new_file, direction);
+                if (r < 0) {
+                        log_debug_errno(r, "Can't iterate through %s, ignoring: %m", new_file->path);
+                        remove_file_real(j, new_file);
+                        continue;
+                } else if (r == 0) {
+                        assert_se(prioq_remove(j->files_by_location, new_file, &new_file->location_prioq_idx) > 0);
+                        new_file->location_prioq_idx = PRIOQ_IDX_NULL;
+                        new_file->location_type = LOCATION_TAIL;
+                        continue;
+                }
+
+                /* If the candidate at the front did not change, it is the next entry */
+                if (type == LOCATION_SEEK && offset == new_file->current_offset)
+                        break;
+
+                assert_se(prioq_reshuffle(j->files_by_location, new_file, &new_file->location_prioq_idx) >= 0);
+        }
 
         r = journal_file_move_to_object(new_file, OBJECT_ENTRY, new_file->current_offset, &o);
         if (r < 0)
@@ -1198,7 +1369,8 @@ static bool file_type_wanted(int flags, const char *filename) {
         if (!(flags & (SD_JOURNAL_SYSTEM | SD_JOURNAL_CURRENT_USER)))
                 return true;
 
-        if (flags & SD_JOURNAL_SYSTEM && file_has_type_prefix("system", filename))
+        if (flags & SD_JOURNAL_SYSTEM &&
+            (file_has_type_prefix("system", filename) || startswith(filename, "unit-")))
                 return true;
 
         if (flags & SD_JOURNAL_CURRENT_USER) {
@@ -1340,6 +1512,7 @@ static int add_any_file(
         track_file_disposition(j, f);
         check_network(j, f->fd);
 
+        j->files_by_location_valid = false;
         j->current_invalidate_counter++;
 
         log_debug("File %s added.", f->path);
@@ -1408,6 +1581,9 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
 
         log_debug("File %s removed.", f->path);
 
+        (void) prioq_remove(j->files_by_location, f, &f->location_prioq_idx);
+        j->files_by_location_valid = false;
+
         if (j->current_file == f) {
                 j->current_file = NULL;
                 j->current_field = 0;
@@ -2062,6 +2238,7 @@ _public_ void sd_journal_close(sd_journal *j) {
 
         ordered_hashmap_free_with_destructor(j->files, journal_file_close);
         iterated_cache_free(j->files_cache);
+        prioq_free(j->files_by_location);
 
         while ((d = hashmap_first(j->directories_by_path)))
                 remove_directory(j, d);
@@ -2084,7 +2261,10 @@ _public_ void sd_journal_close(sd_journal *j) {
         free(j->path);
         free(j->prefix);
         free(j->unique_field);
+        set_free_free(j->unique_values);
         free(j->fields_buffer);
+        free(j->batch_buffer);
+        catalog_map_free(j->catalog_map);
         free(j);
 }
 
@@ -2204,27 +2384,28 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
 
         field_length = strlen(field);
 
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(f, o);
         for (i = 0; i < n; i++) {
                 uint64_t p, l;
-                le64_t le_hash;
+                le64_t le_hash = 0;
                 size_t t;
                 int compression;
 
-                p = le64toh(o->entry.items[i].object_offset);
-                le_hash = o->entry.items[i].hash;
+                p = journal_file_entry_item_object_offset(f, o, i);
+                if (!JOURNAL_HEADER_COMPACT(f->header))
+                        le_hash = o->entry.items.regular[i].hash;
                 r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
                 if (r < 0)
                         return r;
 
-                if (le_hash != o->data.hash)
+                if (!JOURNAL_HEADER_COMPACT(f->header) && le_hash != o->data.hash)
                         return -EBADMSG;
 
                 l = le64toh(o->object.size) - offsetof(Object, data.payload);
 
                 compression = o->object.flags & OBJECT_COMPRESSION_MASK;
                 if (compression) {
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
                         r = decompress_startswith(compression,
                                                   o->data.payload, l,
                                                   &f->compress_buffer, &f->compress_buffer_size,
@@ -2274,6 +2455,138 @@ _public_ int sd_journal_get_data(sd_journal *j, const char *field, const void **
         return -ENOENT;
 }
 
+_public_ int sd_journal_get_data_batch(sd_journal *j, const char * const *fields, size_t n_fields, const void **data, size_t *size) {
+        size_t k, n_found = 0, *offsets, *field_lengths, field_length_max = 0, used = 0;
+        JournalFile *f;
+        uint64_t i, n;
+        Object *o;
+        int r;
+
+        assert_return(j, -EINVAL);
+        assert_return(!journal_pid_changed(j), -ECHILD);
+        assert_return(fields || n_fields == 0, -EINVAL);
+        assert_return(n_fields <= 1024, -E2BIG);
+        assert_return(data || n_fields == 0, -EINVAL);
+        assert_return(size || n_fields == 0, -EINVAL);
+
+        for (k = 0; k < n_fields; k++)
+                assert_return(field_is_valid(fields[k]), -EINVAL);
+
+        f = j->current_file;
+        if (!f)
+                return -EADDRNOTAVAIL;
+
+        if (f->current_offset <= 0)
+                return -EADDRNOTAVAIL;
+
+        /* Like sd_journal_get_data() for a whole set of fields, in a single pass over the entry's items. Field
+         * names are compared before anything is decompressed, and we stop as soon as all fields were found.
+         * The data is copied into a buffer of our own, so that all of it stays valid at the same time. */
+
+        offsets = newa(size_t, n_fields);
+        field_lengths = newa(size_t, n_fields);
+        for (k = 0; k < n_fields; k++) {
+                offsets[k] = (size_t) -1;
+                field_lengths[k] = strlen(fields[k]);
+                field_length_max = MAX(field_length_max, field_lengths[k]);
+        }
+
+        r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+        if (r < 0)
+                return r;
+
+        n = journal_file_entry_n_items(f, o);
+        for (i = 0; i < n && n_found < n_fields; i++) {
+                const void *payload = NULL;
+                le64_t le_hash = 0;
+                uint64_t p, l;
+                int compression;
+                size_t t;
+
+                p = journal_file_entry_item_object_offset(f, o, i);
+                if (!JOURNAL_HEADER_COMPACT(f->header))
+                        le_hash = o->entry.items.regular[i].hash;
+                r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
+                if (r < 0)
+                        return r;
+
+                if (!JOURNAL_HEADER_COMPACT(f->header) && le_hash != o->data.hash)
+                        return -EBADMSG;
+
+                l = le64toh(o->object.size) - offsetof(Object, data.payload);
+                compression = o->object.flags & OBJECT_COMPRESSION_MASK;
+
+                /* For the comparison of field names only the beginning of compressed objects is decompressed, once
+                 * for all fields */
+                if (compression) {
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
+                        r = decompress_blob(compression,
+                                            o->data.payload, l,
+                                            &f->compress_buffer, &f->compress_buffer_size, &t,
+                                            field_length_max + 1);
+                        if (r < 0)
+                                return log_debug_errno(r, "Cannot decompress %s object of length %"PRIu64" at offset "OFSfmt": %m",
+                                                       object_compressed_to_string(compression), l, p);
+
+                        payload = f->compress_buffer;
+#else
+                        return -EPROTONOSUPPORT;
+#endif
+                } else {
+                        payload = o->data.payload;
+                        t = (size_t) l;
+                        if ((uint64_t) t != l)
+                                return -E2BIG;
+                }
+
+                for (k = 0; k < n_fields; k++)
+                        if (offsets[k] == (size_t) -1 &&
+                            t >= field_lengths[k] + 1 &&
+                            memcmp(payload, fields[k], field_lengths[k]) == 0 &&
+                            ((const uint8_t*) payload)[field_lengths[k]] == '=')
+                                break;
+
+                if (k < n_fields) {
+                        if (compression) {
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
+                                r = decompress_blob(compression,
+                                                    o->data.payload, l,
+                                                    &f->compress_buffer, &f->compress_buffer_size, &t,
+                                                    j->data_threshold);
+                                if (r < 0)
+                                        return r;
+
+                                payload = f->compress_buffer;
+#endif
+                        } else if (j->data_threshold > 0 && t > j->data_threshold)
+                                /* The threshold is only a hint, but applying it saves us the copy */
+                                t = j->data_threshold;
+
+                        if (!GREEDY_REALLOC(j->batch_buffer, j->batch_buffer_allocated, used + t))
+                                return -ENOMEM;
+
+                        memcpy(j->batch_buffer + used, payload, t);
+                        offsets[k] = used;
+                        size[k] = t;
+                        used += t;
+                        n_found++;
+                }
+
+                r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
+                if (r < 0)
+                        return r;
+        }
+
+        for (k = 0; k < n_fields; k++)
+                if (offsets[k] == (size_t) -1) {
+                        data[k] = NULL;
+                        size[k] = 0;
+                } else
+                        data[k] = j->batch_buffer + offsets[k];
+
+        return (int) n_found;
+}
+
 static int return_data(sd_journal *j, JournalFile *f, Object *o, const void **data, size_t *size) {
         size_t t;
         uint64_t l;
@@ -2288,7 +2601,7 @@ static int return_data(sd_journal *j, JournalFile *f, Object *o, const void **da
 
         compression = o->object.flags & OBJECT_COMPRESSION_MASK;
         if (compression) {
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
                 size_t rsize;
                 int r;
 
@@ -2314,7 +2627,7 @@ static int return_data(sd_journal *j, JournalFile *f, Object *o, const void **da
 _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t *size) {
         JournalFile *f;
         uint64_t p, n;
-        le64_t le_hash;
+        le64_t le_hash = 0;
         int r;
         Object *o;
 
@@ -2334,17 +2647,18 @@ _public_ int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t
         if (r < 0)
                 return r;
 
-        n = journal_file_entry_n_items(o);
+        n = journal_file_entry_n_items(f, o);
         if (j->current_field >= n)
                 return 0;
 
-        p = le64toh(o->entry.items[j->current_field].object_offset);
-        le_hash = o->entry.items[j->current_field].hash;
+        p = journal_file_entry_item_object_offset(f, o, j->current_field);
+        if (!JOURNAL_HEADER_COMPACT(f->header))
+                le_hash = o->entry.items.regular[j->current_field].hash;
         r = journal_file_move_to_object(f, OBJECT_DATA, p, &o);
         if (r < 0)
                 return r;
 
-        if (le_hash != o->data.hash)
+        if (!JOURNAL_HEADER_COMPACT(f->header) && le_hash != o->data.hash)
                 return -EBADMSG;
 
         r = return_data(j, f, o, data, size);
@@ -2741,6 +3055,90 @@ _public_ int sd_journal_get_usage(sd_journal *j, uint64_t *bytes) {
         return 0;
 }
 
+typedef struct UniqueValue {
+        const void *data;
+        size_t size;
+} UniqueValue;
+
+static void unique_value_hash_func(const void *p, struct siphash *state) {
+        const UniqueValue *v = p;
+
+        siphash24_compress(&v->size, sizeof(v->size), state);
+        siphash24_compress(v->data, v->size, state);
+}
+
+static int unique_value_compare_func(const void *a, const void *b) {
+        const UniqueValue *x = a, *y = b;
+
+        if (x->size != y->size)
+                return x->size < y->size ? -1 : 1;
+
+        return memcmp(x->data, y->data, x->size);
+}
+
+static const struct hash_ops unique_value_hash_ops = {
+        .hash = unique_value_hash_func,
+        .compare = unique_value_compare_func,
+};
+
+static void unique_values_reset(sd_journal *j) {
+        assert(j);
+
+        j->unique_values = set_free_free(j->unique_values);
+        j->unique_values_size = 0;
+        j->unique_values_incomplete = false;
+}
+
+static int unique_values_test(sd_journal *j, const void *data, size_t size) {
+        UniqueValue key = {
+                .data = data,
+                .size = size,
+        };
+
+        assert(j);
+
+        /* Returns > 0 if the value was returned before, 0 if it wasn't, and -ENOENT if we can't tell. */
+
+        if (set_get(j->unique_values, &key))
+                return 1;
+
+        return j->unique_values_incomplete ? -ENOENT : 0;
+}
+
+static void unique_values_add(sd_journal *j, const void *data, size_t size) {
+        UniqueValue *v;
+
+        assert(j);
+
+        if (j->unique_values_incomplete)
+                return;
+
+        if (j->unique_values_size + size > UNIQUE_VALUES_SIZE_MAX)
+                goto incomplete;
+
+        if (set_ensure_allocated(&j->unique_values, &unique_value_hash_ops) < 0)
+                goto incomplete;
+
+        v = malloc(sizeof(UniqueValue) + size);
+        if (!v)
+                goto incomplete;
+
+        v->data = memcpy((uint8_t*) v + sizeof(UniqueValue), data, size);
+        v->size = size;
+
+        if (set_put(j->unique_values, v) < 0) {
+                free(v);
+                goto incomplete;
+        }
+
+        j->unique_values_size += size;
+        return;
+
+incomplete:
+        /* From now on we'll have to look for values in the other files again */
+        j->unique_values_incomplete = true;
+}
+
 _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         char *f;
 
@@ -2758,6 +3156,7 @@ _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        unique_values_reset(j);
 
         return 0;
 }
@@ -2851,29 +3250,44 @@ _public_ int sd_journal_enumerate_unique(sd_journal *j, const void **data, size_
                         return -EBADMSG;
                 }
 
-                /* OK, now let's see if we already returned this data
-                 * object by checking if it exists in the earlier
-                 * traversed files. */
-                found = false;
-                ORDERED_HASHMAP_FOREACH(of, j->files, i) {
-                        if (of == j->unique_file)
-                                break;
+                /* OK, now let's see if we already returned this data object. Usually we remember all values
+                 * we returned, otherwise check if it exists in the earlier traversed files. */
+                r = unique_values_test(j, odata, ol);
+                if (r > 0)
+                        continue;
+                if (r < 0) {
+                        found = false;
+                        ORDERED_HASHMAP_FOREACH(of, j->files, i) {
+                                if (of == j->unique_file)
+                                        break;
 
-                        /* Skip this file it didn't have any fields indexed */
-                        if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
-                                continue;
+                                /* Skip this file it didn't have any fields indexed */
+                                if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
+                                        continue;
 
-                        r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), NULL, NULL);
-                        if (r < 0)
-                                return r;
-                        if (r > 0) {
-                                found = true;
-                                break;
+                                /* The hash may only be reused if neither file uses a keyed hash */
+                                if (!JOURNAL_HEADER_KEYED_HASH(j->unique_file->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
+                                        r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), NULL, NULL);
+                                else
+                                        r = journal_file_find_data_object(of, odata, ol, NULL, NULL);
+                                if (r < 0)
+                                        return r;
+                                if (r > 0) {
+                                        found = true;
+                                        break;
+                                }
                         }
+
+                        if (found)
+                                continue;
                 }
 
-                if (found)
-                        continue;
+                /* Decompressed values might have been truncated to the data threshold, hence we can't
+                 * remember those. */
+                if (o->object.flags & OBJECT_COMPRESSION_MASK)
+                        j->unique_values_incomplete = true;
+                else
+                        unique_values_add(j, odata, ol);
 
                 r = return_data(j, j->unique_file, o, data, l);
                 if (r < 0)
@@ -2890,6 +3304,7 @@ _public_ void sd_journal_restart_unique(sd_journal *j) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        unique_values_reset(j);
 }
 
 _public_ int sd_journal_enumerate_fields(sd_journal *j, const char **field) {
@@ -2997,7 +3412,10 @@ _public_ int sd_journal_enumerate_fields(sd_journal *j, const char **field) {
                         if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
                                 continue;
 
-                        r = journal_file_find_field_object_with_hash(of, o->field.payload, sz, le64toh(o->field.hash), NULL, NULL);
+                        if (!JOURNAL_HEADER_KEYED_HASH(f->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
+                                r = journal_file_find_field_object_with_hash(of, o->field.payload, sz, le64toh(o->field.hash), NULL, NULL);
+                        else
+                                r = journal_file_find_field_object(of, o->field.payload, sz, NULL, NULL);
                         if (r < 0)
                                 return r;
                         if (r > 0) {
@@ -3090,7 +3508,7 @@ _public_ int sd_journal_get_catalog(sd_journal *j, char **ret) {
         if (r < 0)
                 return r;
 
-        r = catalog_get(CATALOG_DATABASE, id, &text);
+        r = catalog_get_mapped(&j->catalog_map, CATALOG_DATABASE, id, &text);
         if (r < 0)
                 return r;
 
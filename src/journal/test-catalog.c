@@ -171,6 +171,23 @@ static void test_catalog_update(const char *database) {
         assert_se(r == 0);
 }
 
+static void test_catalog_get_mapped(const char *database) {
+        _cleanup_(catalog_map_freep) CatalogMap *m = NULL;
+        _cleanup_free_ char *a = NULL, *b = NULL;
+        void *p;
+
+        assert_se(catalog_get_mapped(&m, database, SD_MESSAGE_COREDUMP, &a) >= 0);
+        assert_se(m);
+        p = m->p;
+
+        /* The database didn't change, hence the mapping should be reused */
+        assert_se(catalog_get_mapped(&m, database, SD_MESSAGE_COREDUMP, &b) >= 0);
+        assert_se(m->p == p);
+        assert_se(streq(a, b));
+
+        assert_se(catalog_get_mapped(&m, database, SD_ID128_MAKE(00,00,00,00,00,00,00,00,00,00,00,00,00,00,00,00), &b) == -ENOENT);
+}
+
 static void test_catalog_file_lang(void) {
         _cleanup_free_ char *lang = NULL, *lang2 = NULL, *lang3 = NULL, *lang4 = NULL;
 
@@ -236,5 +253,7 @@ int main(int argc, char *argv[]) {
         assert_se(catalog_get(database, SD_MESSAGE_COREDUMP, &text) >= 0);
         printf(">>>%s<<<\n", text);
 
+        test_catalog_get_mapped(database);
+
         return 0;
 }
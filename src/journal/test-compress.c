@@ -27,6 +27,12 @@
 # define LZ4_OK -EPROTONOSUPPORT
 #endif
 
+#if HAVE_ZSTD
+# define ZSTD_OK 0
+#else
+# define ZSTD_OK -EPROTONOSUPPORT
+#endif
+
 typedef int (compress_blob_t)(const void *src, uint64_t src_size,
                               void *dst, size_t dst_alloc_size, size_t *dst_size);
 typedef int (decompress_blob_t)(const void *src, uint64_t src_size,
@@ -40,7 +46,7 @@ typedef int (decompress_sw_t)(const void *src, uint64_t src_size,
 typedef int (compress_stream_t)(int fdf, int fdt, uint64_t max_bytes);
 typedef int (decompress_stream_t)(int fdf, int fdt, uint64_t max_size);
 
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
 static void test_compress_decompress(int compression,
                                      compress_blob_t compress,
                                      decompress_blob_t decompress,
@@ -261,8 +267,34 @@ static void test_lz4_decompress_partial(void) {
 }
 #endif
 
+#if HAVE_ZSTD
+static void test_zstd_decompress_after_error(void) {
+        const char text[] = "MESSAGE=foobar foobar foobar foobar foobar foobar foobar foobar";
+        char compressed[512];
+        _cleanup_free_ char *decompressed = NULL;
+        size_t csize, usize = 0, size;
+
+        /* The decompression context is reused between calls, make sure a frame that was cut off doesn't
+         * confuse the next, complete one */
+
+        assert_se(compress_blob_zstd(text, sizeof(text), compressed, sizeof(compressed), &csize) == 0);
+        assert_se(csize > 8);
+
+        assert_se(decompress_blob_zstd(compressed, csize - 4, (void **) &decompressed, &usize, &size, 0) < 0);
+
+        assert_se(decompress_blob_zstd(compressed, csize, (void **) &decompressed, &usize, &size, 0) == 0);
+        assert_se(size == sizeof(text));
+        assert_se(memcmp(decompressed, text, sizeof(text)) == 0);
+
+        assert_se(decompress_startswith_zstd(compressed, csize - 4, (void **) &decompressed, &usize,
+                                             "MESSAGE", strlen("MESSAGE"), '=') <= 0);
+        assert_se(decompress_startswith_zstd(compressed, csize, (void **) &decompressed, &usize,
+                                             "MESSAGE", strlen("MESSAGE"), '=') > 0);
+}
+#endif
+
 int main(int argc, char *argv[]) {
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
         const char text[] =
                 "text\0foofoofoofoo AAAA aaaaaaaaa ghost busters barbarbar FFF"
                 "foofoofoofoo AAAA aaaaaaaaa ghost busters barbarbar FFF";
@@ -333,9 +365,32 @@ int main(int argc, char *argv[]) {
         log_info("/* LZ4 test skipped */");
 #endif
 
+#if HAVE_ZSTD
+        test_compress_decompress(OBJECT_COMPRESSED_ZSTD, compress_blob_zstd, decompress_blob_zstd,
+                                 text, sizeof(text), false);
+        test_compress_decompress(OBJECT_COMPRESSED_ZSTD, compress_blob_zstd, decompress_blob_zstd,
+                                 data, sizeof(data), true);
+
+        test_decompress_startswith(OBJECT_COMPRESSED_ZSTD,
+                                   compress_blob_zstd, decompress_startswith_zstd,
+                                   text, sizeof(text), false);
+        test_decompress_startswith(OBJECT_COMPRESSED_ZSTD,
+                                   compress_blob_zstd, decompress_startswith_zstd,
+                                   data, sizeof(data), true);
+        test_decompress_startswith(OBJECT_COMPRESSED_ZSTD,
+                                   compress_blob_zstd, decompress_startswith_zstd,
+                                   huge, sizeof(huge), true);
+
+        test_decompress_startswith_short(OBJECT_COMPRESSED_ZSTD, compress_blob_zstd, decompress_startswith_zstd);
+
+        test_zstd_decompress_after_error();
+#else
+        log_info("/* ZSTD test skipped */");
+#endif
+
         return 0;
 #else
-        log_info("/* XZ and LZ4 tests skipped */");
+        log_info("/* XZ, LZ4 and ZSTD tests skipped */");
         return EXIT_TEST_SKIP;
 #endif
 }
@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "journal-file.h"
+#include "journal-internal.h"
+#include "journal-verify.h"
+#include "log.h"
+#include "mmap-cache.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "random-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "time-util.h"
+#include "util.h"
+
+/* A manual benchmark for the journal file format and sd-journal: generates a set of journal files with a
+ * synthetic, but journald-like, field distribution, and then measures appending, iterating (all and
+ * matched), seeking by time, enumerating unique field values and verifying. Invoke with --help for the
+ * knobs, and compare the numbers between builds to catch regressions. Use --directory= to put multi-GB
+ * journals somewhere else than /var/tmp. */
+
+#define N_SEEKS 1000U
+
+static uint64_t arg_entries = 100000;
+static unsigned arg_units = 50;
+static unsigned arg_cardinality = 1000;
+static unsigned arg_files = 4;
+static bool arg_compress = true;
+static const char *arg_directory = NULL;
+static bool arg_keep = false;
+
+static void report(const char *what, uint64_t n, usec_t duration) {
+        char buf[FORMAT_TIMESPAN_MAX];
+
+        log_info("%-24s %10" PRIu64 " in %-10s %12.0f/s",
+                 what, n, format_timespan(buf, sizeof(buf), duration, 1),
+                 duration > 0 ? (double) n * USEC_PER_SEC / duration : 0.0);
+}
+
+static void report_mmap_cache(MMapCache *m) {
+        unsigned hit, missed;
+
+        hit = mmap_cache_get_hit(m);
+        missed = mmap_cache_get_missed(m);
+
+        log_info("%-24s %10u hit, %u missed (%.1f%%)",
+                 "  mmap cache:", hit, missed,
+                 hit + missed > 0 ? 100.0 * hit / (hit + missed) : 0.0);
+}
+
+static void append_entries(const char *dir, usec_t *ret_first_realtime, usec_t *ret_last_realtime) {
+        MMapCache *m;
+        dual_timestamp ts;
+        uint64_t i, bytes = 0;
+        usec_t start, duration = 0;
+        unsigned k;
+
+        assert_se(m = mmap_cache_new());
+
+        /* One entry every millisecond, ending now */
+        dual_timestamp_get(&ts);
+        ts.realtime -= arg_entries * USEC_PER_MSEC;
+        ts.monotonic = LESS_BY(ts.monotonic, arg_entries * USEC_PER_MSEC) + 1;
+        *ret_first_realtime = ts.realtime;
+
+        for (k = 0, i = 0; k < arg_files; k++) {
+                _cleanup_free_ char *path = NULL;
+                JournalFile *f;
+                uint64_t end;
+                char name[STRLEN("bench-") + DECIMAL_STR_MAX(unsigned) + STRLEN(".journal")];
+
+                xsprintf(name, "bench-%u.journal", k);
+                assert_se(path = path_join(NULL, dir, name));
+
+                assert_se(journal_file_open(-1, path, O_RDWR|O_CREAT, 0644, arg_compress, (uint64_t) -1, false, NULL, m, NULL, NULL, &f) == 0);
+
+                /* Like after rotation, each file covers a consecutive part of the entries */
+                end = arg_entries * (k + 1) / arg_files;
+
+                for (; i < end; i++) {
+                        char message[STRLEN("MESSAGE=Benchmark message ") + DECIMAL_STR_MAX(uint64_t)],
+                             line[STRLEN("CODE_LINE=") + DECIMAL_STR_MAX(unsigned)],
+                             unit[STRLEN("_SYSTEMD_UNIT=bench-.service") + DECIMAL_STR_MAX(unsigned)],
+                             pid[STRLEN("_PID=") + DECIMAL_STR_MAX(unsigned)],
+                             priority[STRLEN("PRIORITY=") + DECIMAL_STR_MAX(unsigned)];
+                        struct iovec iovec[7];
+                        unsigned u;
+
+                        /* The message is mostly unique, the source line has the configured cardinality, and
+                         * each unit logs with its own PID, as for regular services. */
+                        u = random_u32() % arg_units;
+                        xsprintf(message, "MESSAGE=Benchmark message %" PRIu64, i);
+                        xsprintf(line, "CODE_LINE=%u", (unsigned) (random_u32() % arg_cardinality));
+                        xsprintf(unit, "_SYSTEMD_UNIT=bench-%u.service", u);
+                        xsprintf(pid, "_PID=%u", 1000 + u);
+                        xsprintf(priority, "PRIORITY=%u", (unsigned) (i % 8));
+
+                        iovec[0] = IOVEC_MAKE_STRING(message);
+                        iovec[1] = IOVEC_MAKE_STRING(priority);
+                        iovec[2] = IOVEC_MAKE_STRING(line);
+                        iovec[3] = IOVEC_MAKE_STRING("CODE_FILE=src/bench/bench.c");
+                        iovec[4] = IOVEC_MAKE_STRING(unit);
+                        iovec[5] = IOVEC_MAKE_STRING(pid);
+                        iovec[6] = IOVEC_MAKE_STRING("_HOSTNAME=benchmark");
+
+                        ts.realtime += USEC_PER_MSEC;
+                        ts.monotonic += USEC_PER_MSEC;
+
+                        start = now(CLOCK_MONOTONIC);
+                        assert_se(journal_file_append_entry(f, &ts, NULL, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL) == 0);
+                        duration += now(CLOCK_MONOTONIC) - start;
+
+                        bytes += IOVEC_TOTAL_SIZE(iovec, ELEMENTSOF(iovec));
+                }
+
+                (void) journal_file_close(f);
+        }
+
+        *ret_last_realtime = ts.realtime;
+
+        report("Appending:", arg_entries, duration);
+        log_info("%-24s %10.1f MiB/s", "", duration > 0 ? (double) bytes * USEC_PER_SEC / duration / 1024 / 1024 : 0.0);
+        report_mmap_cache(m);
+        mmap_cache_unref(m);
+}
+
+static void iterate(const char *dir, const char *match) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        uint64_t n = 0;
+        usec_t start;
+
+        assert_se(sd_journal_open_directory(&j, dir, 0) >= 0);
+
+        if (match)
+                assert_se(sd_journal_add_match(j, match, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        SD_JOURNAL_FOREACH(j) {
+                const void *d;
+                size_t l;
+
+                assert_se(sd_journal_get_data(j, "MESSAGE", &d, &l) >= 0);
+                n++;
+        }
+
+        report(match ? "Matched iteration:" : "Sequential iteration:", n, now(CLOCK_MONOTONIC) - start);
+        report_mmap_cache(j->mmap);
+}
+
+static void seek_realtime(const char *dir, usec_t first, usec_t last) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        usec_t start;
+        unsigned i;
+
+        assert_se(sd_journal_open_directory(&j, dir, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        for (i = 0; i < N_SEEKS; i++) {
+                assert_se(sd_journal_seek_realtime_usec(j, first + random_u64() % (last - first + 1)) >= 0);
+                assert_se(sd_journal_next(j) >= 0);
+        }
+
+        report("Seeking by realtime:", N_SEEKS, now(CLOCK_MONOTONIC) - start);
+        report_mmap_cache(j->mmap);
+}
+
+static void enumerate_unique(const char *dir) {
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        const void *d;
+        uint64_t n = 0;
+        usec_t start;
+        size_t l;
+
+        assert_se(sd_journal_open_directory(&j, dir, 0) >= 0);
+
+        start = now(CLOCK_MONOTONIC);
+        assert_se(sd_journal_query_unique(j, "CODE_LINE") >= 0);
+        SD_JOURNAL_FOREACH_UNIQUE(j, d, l)
+                n++;
+
+        report("Unique enumeration:", n, now(CLOCK_MONOTONIC) - start);
+        report_mmap_cache(j->mmap);
+}
+
+static void verify(const char *dir) {
+        MMapCache *m;
+        usec_t start;
+        unsigned k;
+
+        assert_se(m = mmap_cache_new());
+
+        start = now(CLOCK_MONOTONIC);
+        for (k = 0; k < arg_files; k++) {
+                _cleanup_free_ char *path = NULL;
+                JournalFile *f;
+                char name[STRLEN("bench-") + DECIMAL_STR_MAX(unsigned) + STRLEN(".journal")];
+
+                xsprintf(name, "bench-%u.journal", k);
+                assert_se(path = path_join(NULL, dir, name));
+
+                assert_se(journal_file_open(-1, path, O_RDONLY, 0, false, 0, false, NULL, m, NULL, NULL, &f) == 0);
+                assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+                (void) journal_file_close(f);
+        }
+
+        report("Verifying (files):", arg_files, now(CLOCK_MONOTONIC) - start);
+        report_mmap_cache(m);
+        mmap_cache_unref(m);
+}
+
+static void help(void) {
+        printf("%s [OPTIONS...]\n\n"
+               "Benchmarks the journal file format and sd-journal on synthetic journals.\n\n"
+               "  -h --help               Show this help\n"
+               "     --entries=N          Number of entries to generate in total\n"
+               "     --units=N            Number of distinct units logging\n"
+               "     --cardinality=N      Number of distinct CODE_LINE= values\n"
+               "     --files=N            Number of journal files to spread entries over\n"
+               "     --compress=BOOL      Whether to compress large fields\n"
+               "     --directory=PATH     Where to generate the journals\n"
+               "     --keep               Don't remove the journals afterwards\n",
+               program_invocation_short_name);
+}
+
+static int parse_argv(int argc, char *argv[]) {
+        enum {
+                ARG_ENTRIES = 0x100,
+                ARG_UNITS,
+                ARG_CARDINALITY,
+                ARG_FILES,
+                ARG_COMPRESS,
+                ARG_DIRECTORY,
+                ARG_KEEP,
+        };
+
+        static const struct option options[] = {
+                { "help",        no_argument,       NULL, 'h'             },
+                { "entries",     required_argument, NULL, ARG_ENTRIES     },
+                { "units",       required_argument, NULL, ARG_UNITS       },
+                { "cardinality", required_argument, NULL, ARG_CARDINALITY },
+                { "files",       required_argument, NULL, ARG_FILES       },
+                { "compress",    required_argument, NULL, ARG_COMPRESS    },
+                { "directory",   required_argument, NULL, ARG_DIRECTORY   },
+                { "keep",        no_argument,       NULL, ARG_KEEP        },
+                {}
+        };
+
+        int c, r;
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0)
+                switch (c) {
+
+                case 'h':
+                        help();
+                        return 0;
+
+                case ARG_ENTRIES:
+                        r = safe_atou64(optarg, &arg_entries);
+                        if (r < 0 || arg_entries <= 0)
+                                return log_error_errno(r < 0 ? r : -EINVAL, "Failed to parse --entries=: %s", optarg);
+                        break;
+
+                case ARG_UNITS:
+                        r = safe_atou(optarg, &arg_units);
+                        if (r < 0 || arg_units <= 0)
+                                return log_error_errno(r < 0 ? r : -EINVAL, "Failed to parse --units=: %s", optarg);
+                        break;
+
+                case ARG_CARDINALITY:
+                        r = safe_atou(optarg, &arg_cardinality);
+                        if (r < 0 || arg_cardinality <= 0)
+                                return log_error_errno(r < 0 ? r : -EINVAL, "Failed to parse --cardinality=: %s", optarg);
+                        break;
+
+                case ARG_FILES:
+                        r = safe_atou(optarg, &arg_files);
+                        if (r < 0 || arg_files <= 0)
+                                return log_error_errno(r < 0 ? r : -EINVAL, "Failed to parse --files=: %s", optarg);
+                        break;
+
+                case ARG_COMPRESS:
+                        r = parse_boolean(optarg);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to parse --compress=: %s", optarg);
+                        arg_compress = r;
+                        break;
+
+                case ARG_DIRECTORY:
+                        arg_directory = optarg;
+                        break;
+
+                case ARG_KEEP:
+                        arg_keep = true;
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        assert_not_reached("Unhandled option");
+                }
+
+        return 1;
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_free_ char *dir = NULL;
+        usec_t first, last;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        /* journal_file_open requires a valid machine id */
+        if (access("/etc/machine-id", F_OK) != 0)
+                return log_tests_skipped("/etc/machine-id not found");
+
+        assert_se(dir = path_join(NULL, arg_directory ?: "/var/tmp", "journal-benchmark-XXXXXX"));
+        assert_se(mkdtemp(dir));
+
+        log_info("Benchmarking with %" PRIu64 " entries from %u units in %u files, %scompressed, in %s:",
+                 arg_entries, arg_units, arg_files, arg_compress ? "" : "un", dir);
+
+        append_entries(dir, &first, &last);
+        iterate(dir, NULL);
+        iterate(dir, "_SYSTEMD_UNIT=bench-0.service");
+        seek_realtime(dir, first, last);
+        enumerate_unique(dir);
+        verify(dir);
+
+        if (!arg_keep)
+                (void) rm_rf(dir, REMOVE_ROOT|REMOVE_PHYSICAL);
+
+        return EXIT_SUCCESS;
+}
@@ -187,6 +187,71 @@ static void test_skip(void (*setup)(void)) {
         puts("------------------------------------------------------------");
 }
 
+static void test_seek_realtime(void (*setup)(void)) {
+        char t[] = "/tmp/journal-realtime-XXXXXX";
+        uint64_t realtime[4];
+        sd_journal *j;
+        int i, r;
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        setup();
+
+        assert_ret(sd_journal_open_directory(&j, t, 0));
+
+        /* Remember the timestamps of all entries first
+         */
+        assert_ret(sd_journal_seek_head(j));
+        for (i = 0; i < 4; i++) {
+                assert_se(sd_journal_next(j) == 1);
+                test_check_number(j, i + 1);
+                assert_ret(sd_journal_get_realtime_usec(j, &realtime[i]));
+        }
+
+        /* Seek to each of them, in both directions.
+         */
+        for (i = 0; i < 4; i++) {
+                assert_ret(sd_journal_seek_realtime_usec(j, realtime[i]));
+                assert_se(sd_journal_next(j) == 1);
+                test_check_number(j, i + 1);
+
+                assert_ret(sd_journal_seek_realtime_usec(j, realtime[i]));
+                assert_se(sd_journal_previous(j) == 1);
+                test_check_number(j, i + 1);
+        }
+
+        /* Seek beyond either end.
+         */
+        assert_ret(sd_journal_seek_realtime_usec(j, realtime[3] + 1));
+        assert_ret(r = sd_journal_next(j));
+        assert_se(r == 0);
+        assert_ret(sd_journal_seek_realtime_usec(j, realtime[3] + 1));
+        assert_se(sd_journal_previous(j) == 1);
+        test_check_number(j, 4);
+
+        assert_ret(sd_journal_seek_realtime_usec(j, realtime[0] - 1));
+        assert_ret(r = sd_journal_previous(j));
+        assert_se(r == 0);
+        assert_ret(sd_journal_seek_realtime_usec(j, realtime[0] - 1));
+        assert_se(sd_journal_next(j) == 1);
+        test_check_number(j, 1);
+
+        sd_journal_close(j);
+
+        log_info("Done...");
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else {
+                journal_directory_vacuum(".", 3000000, 0, 0, NULL, true);
+
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+        }
+
+        puts("------------------------------------------------------------");
+}
+
 static void test_sequence_numbers(void) {
 
         char t[] = "/tmp/journal-seq-XXXXXX";
@@ -282,6 +347,9 @@ int main(int argc, char *argv[]) {
         test_skip(setup_sequential);
         test_skip(setup_interleaved);
 
+        test_seek_realtime(setup_sequential);
+        test_seek_realtime(setup_interleaved);
+
         test_sequence_numbers();
 
         return 0;
@@ -79,6 +79,20 @@ int main(int argc, char *argv[]) {
         assert_se(sd_journal_sendv(message1, 1) == 0);
         assert_se(sd_journal_sendv(message2, 1) == 0);
 
+        /* test batched submission, with an entry of two fields in the middle */
+        {
+                struct iovec batch[] = {
+                        {(char*) "MESSAGE=first", STRLEN("MESSAGE=first")},
+                        {(char*) "MESSAGE=second\n", STRLEN("MESSAGE=second\n")},
+                        {(char*) "PRIORITY=5", STRLEN("PRIORITY=5")},
+                        {(char*) "MESSAGE=third", STRLEN("MESSAGE=third")},
+                };
+                int n_batch[] = { 1, 2, 1 };
+
+                assert_se(sd_journal_sendv_batch(batch, n_batch, ELEMENTSOF(n_batch)) == 0);
+                assert_se(sd_journal_sendv_batch(NULL, NULL, 0) == 0);
+        }
+
         sleep(1);
 
         return 0;
@@ -12,10 +12,12 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "rm-rf.h"
+#include "strv.h"
 #include "tests.h"
 #include "util.h"
 
 #define N_ENTRIES 200
+#define LARGE_PADDING 1024
 
 static void verify_contents(sd_journal *j, unsigned skip) {
         unsigned i;
@@ -24,9 +26,9 @@ static void verify_contents(sd_journal *j, unsigned skip) {
 
         i = 0;
         SD_JOURNAL_FOREACH(j) {
-                const void *d;
+                const void *d, *batch_data[4];
                 char *k, *c;
-                size_t l;
+                size_t l, batch_l[4];
                 unsigned u = 0;
 
                 assert_se(sd_journal_get_cursor(j, &k) >= 0);
@@ -40,6 +42,15 @@ static void verify_contents(sd_journal *j, unsigned skip) {
                 assert_se(k = strndup(d, l));
                 printf("\t%s\n", k);
 
+                assert_se(sd_journal_get_data_batch(j, (const char * const *) STRV_MAKE("NONEXISTENT", "NUMBER", "MAGIC", "LARGE"), 4, batch_data, batch_l) == 3);
+                assert_se(!batch_data[0] && batch_l[0] == 0);
+                assert_se(batch_l[1] == strlen(k) && memcmp(batch_data[1], k, batch_l[1]) == 0);
+                assert_se(batch_l[2] > STRLEN("MAGIC=") && memcmp(batch_data[2], "MAGIC=", STRLEN("MAGIC=")) == 0);
+                /* Large enough to be compressed, if compression is available */
+                assert_se(batch_l[3] == STRLEN("LARGE=") + LARGE_PADDING + strlen(k) - STRLEN("NUMBER="));
+                assert_se(memcmp(batch_data[3], "LARGE=", STRLEN("LARGE=")) == 0);
+                assert_se(memcmp((const char*) batch_data[3] + STRLEN("LARGE=") + LARGE_PADDING, k + STRLEN("NUMBER="), strlen(k) - STRLEN("NUMBER=")) == 0);
+
                 if (skip > 0) {
                         assert_se(safe_atou(k + 7, &u) >= 0);
                         assert_se(i == u);
@@ -81,9 +92,9 @@ int main(int argc, char *argv[]) {
         assert_se(journal_file_open(-1, "three.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &three) == 0);
 
         for (i = 0; i < N_ENTRIES; i++) {
-                char *p, *q;
+                char *p, *q, *large;
                 dual_timestamp ts;
-                struct iovec iovec[2];
+                struct iovec iovec[3];
 
                 dual_timestamp_get(&ts);
 
@@ -104,17 +115,22 @@ int main(int argc, char *argv[]) {
                 iovec[1].iov_base = q;
                 iovec[1].iov_len = strlen(q);
 
+                assert_se(asprintf(&large, "LARGE=%0*u", LARGE_PADDING + (int) strlen(p + STRLEN("NUMBER=")), i) >= 0);
+                iovec[2].iov_base = large;
+                iovec[2].iov_len = strlen(large);
+
                 if (i % 10 == 0)
-                        assert_se(journal_file_append_entry(three, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+                        assert_se(journal_file_append_entry(three, &ts, NULL, iovec, 3, NULL, NULL, NULL) == 0);
                 else {
                         if (i % 3 == 0)
-                                assert_se(journal_file_append_entry(two, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+                                assert_se(journal_file_append_entry(two, &ts, NULL, iovec, 3, NULL, NULL, NULL) == 0);
 
-                        assert_se(journal_file_append_entry(one, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+                        assert_se(journal_file_append_entry(one, &ts, NULL, iovec, 3, NULL, NULL, NULL) == 0);
                 }
 
                 free(p);
                 free(q);
+                free(large);
         }
 
         (void) journal_file_close(one);
@@ -171,8 +187,19 @@ int main(int argc, char *argv[]) {
         verify_contents(j, 0);
 
         assert_se(sd_journal_query_unique(j, "NUMBER") >= 0);
-        SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
+        i = 0;
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, l) {
                 printf("%.*s\n", (int) l, (const char*) data);
+                i++;
+        }
+        assert_se(i == N_ENTRIES);
+
+        /* Values contained in several files are returned once */
+        assert_se(sd_journal_query_unique(j, "MAGIC") >= 0);
+        i = 0;
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
+                i++;
+        assert_se(i == 2);
 
         assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
 
@@ -1,13 +1,20 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <fcntl.h>
+#include <sys/file.h>
 #include <unistd.h>
 
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "io-util.h"
 #include "journal-authenticate.h"
 #include "journal-file.h"
 #include "journal-vacuum.h"
+#include "journal-verify.h"
 #include "log.h"
 #include "rm-rf.h"
+#include "stdio-util.h"
 #include "tests.h"
 
 static bool arg_keep = false;
@@ -109,6 +116,448 @@ static void test_non_empty(void) {
         puts("------------------------------------------------------------");
 }
 
+static void test_seek_long_chain(void) {
+        dual_timestamp ts;
+        JournalFile *f;
+        struct iovec iovec;
+        static const char test[] = "TEST1=1";
+        Object *o;
+        uint64_t i, n = 1000;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        /* Enough entries to spread the entry array chain across a couple of arrays, so that seeking makes
+         * use of the chain skip index */
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &f) == 0);
+
+        iovec.iov_base = (void*) test;
+        iovec.iov_len = strlen(test);
+
+        for (i = 0; i < n; i++) {
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+        }
+
+        /* Jump around, both forwards and backwards in the chain */
+        for (i = 0; i < n; i++) {
+                uint64_t seqnum = (i * 7919) % n + 1;
+
+                assert_se(journal_file_move_to_entry_by_seqnum(f, seqnum, DIRECTION_DOWN, &o, NULL) == 1);
+                assert_se(le64toh(o->entry.seqnum) == seqnum);
+
+                assert_se(journal_file_move_to_entry_by_seqnum(f, seqnum, DIRECTION_UP, &o, NULL) == 1);
+                assert_se(le64toh(o->entry.seqnum) == seqnum);
+        }
+
+        assert_se(journal_file_move_to_entry_by_seqnum(f, n + 1, DIRECTION_DOWN, &o, NULL) == 0);
+        assert_se(journal_file_move_to_entry_by_seqnum(f, n + 1, DIRECTION_UP, &o, NULL) == 1);
+        assert_se(le64toh(o->entry.seqnum) == n);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_bloom_filter(void) {
+        dual_timestamp ts;
+        JournalFile *f;
+        struct iovec iovec;
+        Object *o;
+        uint64_t p;
+        unsigned i, n_positive = 0;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &f) == 0);
+
+        for (i = 0; i < 500; i++) {
+                char data[sizeof("TEST=") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(data, "TEST=%u", i);
+                iovec.iov_base = data;
+                iovec.iov_len = strlen(data);
+
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(f->header->bloom_filter_offset == 0);
+        assert_se(!JOURNAL_HEADER_BLOOM_FILTER(f->header));
+        assert_se(journal_file_archive(f) == 0);
+        assert_se(f->header->bloom_filter_offset != 0);
+        assert_se(JOURNAL_HEADER_BLOOM_FILTER(f->header));
+
+        for (i = 0; i < 1000; i++) {
+                char data[sizeof("TEST=") + DECIMAL_STR_MAX(unsigned)];
+                int r;
+
+                xsprintf(data, "TEST=%u", i);
+
+                r = journal_file_find_data_object(f, data, strlen(data), &o, &p);
+                assert_se(r >= 0);
+                assert_se((r > 0) == (i < 500));
+
+                r = journal_file_bloom_filter_test(f, journal_file_hash_data(f, data, strlen(data)));
+                assert_se(r >= 0);
+                if (i < 500)
+                        assert_se(r > 0);
+                else if (r > 0)
+                        n_positive++;
+        }
+
+        /* The filter is sized for a false positive rate of about 1%, leave some leeway */
+        log_info("Bloom filter false positives: %u/500", n_positive);
+        assert_se(n_positive < 50);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_bloom_filter_full(void) {
+        JournalMetrics metrics;
+        dual_timestamp ts;
+        JournalFile *f;
+        struct iovec iovec;
+        unsigned i;
+        int r = 0;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        /* Fill a file up to its size limit, the way journald does before rotating, and make sure the
+         * bloom filter still fits when the file is archived afterwards. */
+        journal_reset_metrics(&metrics);
+        metrics.max_size = 512 * 1024;
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, &metrics, NULL, NULL, NULL, &f) == 0);
+
+        for (i = 0; r == 0; i++) {
+                char data[sizeof("TEST=") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(data, "TEST=%u", i);
+                iovec.iov_base = data;
+                iovec.iov_len = strlen(data);
+
+                assert_se(dual_timestamp_get(&ts));
+                r = journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL);
+        }
+
+        assert_se(r == -E2BIG);
+        assert_se(i > 1);
+
+        assert_se(journal_file_archive(f) == 0);
+        assert_se(f->header->bloom_filter_offset != 0);
+        assert_se(journal_file_bloom_filter_test(f, journal_file_hash_data(f, "TEST=0", strlen("TEST=0"))) > 0);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_data_cache(void) {
+        dual_timestamp ts;
+        JournalFile *f;
+        struct iovec iovec[2];
+        unsigned i;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &f) == 0);
+
+        /* Cycle through more values than the data object cache holds, so that both hits and evictions are
+         * exercised, and make sure every value is still only stored once. */
+        for (i = 0; i < 6000; i++) {
+                char data[sizeof("TEST=") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(data, "TEST=%u", i % 2000);
+                iovec[0] = IOVEC_MAKE_STRING("HOSTNAME=test");
+                iovec[1] = IOVEC_MAKE_STRING(data);
+
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(le64toh(f->header->n_entries) == 6000);
+        assert_se(le64toh(f->header->n_data) == 2001);
+
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_copy_entry(void) {
+        dual_timestamp ts;
+        JournalFile *f, *g, *h;
+        struct iovec iovec[2];
+        Object *o, *d;
+        uint64_t p;
+        unsigned i;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &f) == 0);
+
+        for (i = 0; i < 1000; i++) {
+                char data[sizeof("TEST=") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(data, "TEST=%u", i % 10);
+                iovec[0] = IOVEC_MAKE_STRING("HOSTNAME=test");
+                iovec[1] = IOVEC_MAKE_STRING(data);
+
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(journal_file_open(-1, "copy1.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &g) == 0);
+        assert_se(journal_file_open(-1, "copy2.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &h) == 0);
+
+        /* Alternate between two targets, so that the data offsets remembered for one of them must never be
+         * used for the other one */
+        for (p = 0;;) {
+                int r;
+
+                r = journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p);
+                assert_se(r >= 0);
+                if (r == 0)
+                        break;
+
+                assert_se(journal_file_copy_entry(f, le64toh(o->entry.seqnum) % 100 == 0 ? h : g, o, p) == 0);
+        }
+
+        assert_se(le64toh(g->header->n_entries) == 990);
+        assert_se(le64toh(g->header->n_data) == 11);
+        assert_se(le64toh(h->header->n_entries) == 10);
+        assert_se(le64toh(h->header->n_data) == 2);
+
+        assert_se(journal_file_find_data_object(g, "HOSTNAME=test", strlen("HOSTNAME=test"), &d, NULL) == 1);
+        assert_se(le64toh(d->data.n_entries) == 990);
+        assert_se(journal_file_find_data_object(h, "TEST=9", strlen("TEST=9"), &d, NULL) == 1);
+        assert_se(le64toh(d->data.n_entries) == 10);
+
+        assert_se(journal_file_verify(g, NULL, NULL, NULL, NULL, false) >= 0);
+        assert_se(journal_file_verify(h, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(h);
+        (void) journal_file_close(g);
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_rewrite(void) {
+        dual_timestamp ts;
+        JournalFile *f, *g;
+        struct iovec iovec[2];
+        Object *o, *d;
+        uint64_t p, q;
+        unsigned i;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &f) == 0);
+
+        for (i = 0; i < 100; i++) {
+                char a[sizeof("NUMBER=") + DECIMAL_STR_MAX(unsigned)], b[sizeof("PARITY=") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(a, "NUMBER=%u", i);
+                xsprintf(b, "PARITY=%u", i % 2);
+                iovec[0] = IOVEC_MAKE_STRING(a);
+                iovec[1] = IOVEC_MAKE_STRING(b);
+
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, iovec, 2, NULL, NULL, NULL) == 0);
+        }
+
+        assert_se(journal_file_open(-1, "rewritten.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, true, NULL, NULL, NULL, NULL, &g) == 0);
+        assert_se(journal_file_rewrite(f, g) == 0);
+
+        /* Refuse to rewrite into a file that already has entries */
+        assert_se(journal_file_rewrite(f, g) == -EBUSY);
+
+        assert_se(sd_id128_equal(f->header->seqnum_id, g->header->seqnum_id));
+        assert_se(le64toh(g->header->n_entries) == 100);
+        assert_se(le64toh(g->header->n_data) == 102);
+
+        /* One array for each parity, plus the main entry array */
+        assert_se(le64toh(g->header->n_entry_arrays) == 3);
+
+        for (p = q = 0;;) {
+                uint64_t k, n;
+                int r;
+
+                r = journal_file_next_entry(f, p, DIRECTION_DOWN, &o, &p);
+                assert_se(r >= 0);
+                if (r == 0)
+                        break;
+
+                k = le64toh(o->entry.seqnum);
+                n = le64toh(o->entry.realtime);
+
+                assert_se(journal_file_next_entry(g, q, DIRECTION_DOWN, &o, &q) == 1);
+                assert_se(le64toh(o->entry.seqnum) == k);
+                assert_se(le64toh(o->entry.realtime) == n);
+                assert_se(journal_file_entry_n_items(g, o) == 2);
+
+                assert_se(journal_file_move_to_object(g, OBJECT_DATA, journal_file_entry_item_object_offset(g, o, 0), &d) == 0);
+                assert_se(le64toh(d->data.n_entries) > 0);
+        }
+
+        assert_se(journal_file_next_entry(g, q, DIRECTION_DOWN, &o, &q) == 0);
+
+        assert_se(journal_file_find_data_object(g, "PARITY=1", strlen("PARITY=1"), &d, NULL) == 1);
+        assert_se(le64toh(d->data.n_entries) == 50);
+
+        assert_se(journal_file_verify(g, NULL, NULL, NULL, NULL, false) >= 0);
+
+        (void) journal_file_close(g);
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_rewrite_archived(void) {
+        _cleanup_free_ char *fn = NULL;
+        dual_timestamp ts;
+        JournalFile *f;
+        struct iovec iovec;
+        static const char test[] = "TEST1=1";
+        unsigned i;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_open(-1, "test.journal", O_RDWR|O_CREAT, 0666, true, (uint64_t) -1, false, NULL, NULL, NULL, NULL, &f) == 0);
+
+        iovec = IOVEC_MAKE_STRING(test);
+        for (i = 0; i < 10; i++) {
+                assert_se(dual_timestamp_get(&ts));
+                assert_se(journal_file_append_entry(f, &ts, NULL, &iovec, 1, NULL, NULL, NULL) == 0);
+        }
+
+        /* Files which are still online are refused */
+        assert_se(journal_file_rewrite_archived("test.journal", true, (uint64_t) -1) == -EBUSY);
+
+        assert_se(journal_file_archive(f) == 0);
+        assert_se(fn = strdup(f->path));
+        assert_se(access("test.journal", F_OK) < 0 && errno == ENOENT);
+        (void) journal_file_close(f);
+
+        assert_se(journal_file_rewrite_archived(fn, true, (uint64_t) -1) == 0);
+
+        assert_se(journal_file_open(-1, fn, O_RDONLY, 0, false, 0, false, NULL, NULL, NULL, NULL, &f) == 0);
+        assert_se(f->header->state == STATE_ARCHIVED);
+        assert_se(le64toh(f->header->n_entries) == 10);
+        assert_se(le64toh(f->header->head_entry_seqnum) == 1);
+        assert_se(f->header->bloom_filter_offset != 0);
+        assert_se(journal_file_find_data_object(f, test, strlen(test), NULL, NULL) == 1);
+        assert_se(journal_file_verify(f, NULL, NULL, NULL, NULL, false) >= 0);
+        (void) journal_file_close(f);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
+static void test_rewrite_temporary(void) {
+        _cleanup_close_ int fd = -1;
+        char t[] = "/tmp/journal-XXXXXX";
+
+        test_setup_logging(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        assert_se(journal_file_is_rewrite_temporary(".#system@0-1-2.journal0123456789abcdef"));
+        assert_se(!journal_file_is_rewrite_temporary("system@0-1-2.journal"));
+        assert_se(!journal_file_is_rewrite_temporary(".#system@0-1-2.journal"));
+        assert_se(!journal_file_is_rewrite_temporary(".#system.journal~0123456789abcdef"));
+
+        /* A temporary file that is still locked belongs to a running rewrite, an unlocked one is stale */
+        assert_se(write_string_file(".#stale.journal0123456789abcdef", "x", WRITE_STRING_FILE_CREATE) >= 0);
+        fd = open(".#busy.journalfedcba9876543210", O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC, 0644);
+        assert_se(fd >= 0);
+        assert_se(flock(fd, LOCK_EX) >= 0);
+
+        assert_se(journal_directory_vacuum(".", 3000000, 0, 0, NULL, true) >= 0);
+
+        assert_se(access(".#stale.journal0123456789abcdef", F_OK) < 0 && errno == ENOENT);
+        assert_se(access(".#busy.journalfedcba9876543210", F_OK) >= 0);
+
+        if (arg_keep)
+                log_info("Not removing %s", t);
+        else
+                assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
+
+        puts("------------------------------------------------------------");
+}
+
 static void test_empty(void) {
         JournalFile *f1, *f2, *f3, *f4;
         char t[] = "/tmp/journal-XXXXXX";
@@ -151,7 +600,7 @@ static void test_empty(void) {
         (void) journal_file_close(f4);
 }
 
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
 static bool check_compressed(uint64_t compress_threshold, uint64_t data_size) {
         dual_timestamp ts;
         JournalFile *f;
@@ -245,9 +694,36 @@ int main(int argc, char *argv[]) {
         if (access("/etc/machine-id", F_OK) != 0)
                 return log_tests_skipped("/etc/machine-id not found");
 
+        /* Run the tests once with the keyed hash function and compact items, and once in the classic format */
+        assert_se(setenv("SYSTEMD_JOURNAL_KEYED_HASH", "1", 1) >= 0);
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "1", 1) >= 0);
+        test_non_empty();
+        test_seek_long_chain();
+        test_bloom_filter();
+        test_bloom_filter_full();
+        test_data_cache();
+        test_copy_entry();
+        test_rewrite();
+        test_rewrite_archived();
+        test_rewrite_temporary();
+        test_empty();
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
+        test_min_compress_size();
+#endif
+
+        assert_se(setenv("SYSTEMD_JOURNAL_KEYED_HASH", "0", 1) >= 0);
+        assert_se(setenv("SYSTEMD_JOURNAL_COMPACT", "0", 1) >= 0);
         test_non_empty();
+        test_seek_long_chain();
+        test_bloom_filter();
+        test_bloom_filter_full();
+        test_data_cache();
+        test_copy_entry();
+        test_rewrite();
+        test_rewrite_archived();
+        test_rewrite_temporary();
         test_empty();
-#if HAVE_XZ || HAVE_LZ4
+#if HAVE_XZ || HAVE_LZ4 || HAVE_ZSTD
         test_min_compress_size();
 #endif
 
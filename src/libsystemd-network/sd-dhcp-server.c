@@ -80,13 +80,16 @@ int sd_dhcp_server_configure_pool(sd_dhcp_server *server, struct in_addr *addres
 
                 server->pool_offset = offset;
                 server->pool_size = size;
+                server->bound_leases_count = 0;
 
                 server->address = address->s_addr;
                 server->netmask = netmask;
                 server->subnet = address->s_addr & netmask;
 
-                if (server_off >= offset && server_off - offset < size)
+                if (server_off >= offset && server_off - offset < size) {
                         server->bound_leases[server_off - offset] = &server->invalid_lease;
+                        server->bound_leases_count++;
+                }
 
                 /* Drop any leases associated with the old address range */
                 hashmap_clear_with_destructor(server->leases_by_client_id, dhcp_lease_free);
@@ -725,7 +728,7 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                 /* for now pick a random free address from the pool */
                 if (existing_lease)
                         address = existing_lease->address;
-                else {
+                else if (server->bound_leases_count < server->pool_size) {
                         struct siphash state;
                         uint64_t hash;
                         uint32_t next_offer;
@@ -869,6 +872,9 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
                                 log_dhcp_server(server, "ACK (0x%x)",
                                                 be32toh(req->message->xid));
 
+                                if (!existing_lease)
+                                        server->bound_leases_count++;
+
                                 server->bound_leases[pool_offset] = lease;
                                 hashmap_put(server->leases_by_client_id,
                                             &lease->client_id, lease);
@@ -907,6 +913,7 @@ int dhcp_server_handle_message(sd_dhcp_server *server, DHCPMessage *message,
 
                 if (server->bound_leases[pool_offset] == existing_lease) {
                         server->bound_leases[pool_offset] = NULL;
+                        server->bound_leases_count--;
                         hashmap_remove(server->leases_by_client_id, existing_lease);
                         dhcp_lease_free(existing_lease);
                 }
@@ -241,6 +241,9 @@ struct sd_bus {
         Hashmap *vtable_methods;
         Hashmap *vtable_properties;
 
+        Hashmap *property_cache;
+        size_t property_cache_size;
+
         union sockaddr_union sockaddr;
         socklen_t sockaddr_size;
 
@@ -315,11 +318,17 @@ struct sd_bus {
         LIST_HEAD(sd_bus_slot, slots);
         LIST_HEAD(sd_bus_track, tracks);
 
+        /* NameOwnerChanged subscriptions of all track objects, shared per name */
+        Hashmap *track_names;
+
         int *inotify_watches;
         size_t n_inotify_watches;
 
         /* zero means use value specified by $SYSTEMD_BUS_TIMEOUT= environment variable or built-in default */
         usec_t method_call_timeout;
+
+        /* How many times to call sd_bus_process() per event loop wakeup */
+        unsigned process_batch;
 };
 
 /* For method calls we time-out at 25s, like in the D-Bus reference implementation */
@@ -332,6 +341,14 @@ struct sd_bus {
 #define BUS_WQUEUE_MAX (192*1024)
 #define BUS_RQUEUE_MAX (192*1024)
 
+/* When reading from a socket, read at least this much at once, so that bursts of small messages are picked up with
+ * few syscalls */
+#define BUS_READ_BUFFER_MIN (64U*1024U)
+
+/* Upper bounds for the serialized property fragments kept around for GetAll() */
+#define BUS_PROPERTY_CACHE_PATHS_MAX 16384U
+#define BUS_PROPERTY_CACHE_SIZE_MAX (16U*1024U*1024U)
+
 #define BUS_MESSAGE_SIZE_MAX (128*1024*1024)
 #define BUS_AUTH_SIZE_MAX (64*1024)
 
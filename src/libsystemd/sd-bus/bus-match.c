@@ -53,10 +53,19 @@ static inline bool BUS_MATCH_IS_COMPARE(enum bus_match_node_type t) {
         return t >= BUS_MATCH_SENDER && t <= BUS_MATCH_ARG_HAS_LAST;
 }
 
+/* Namespace matches are "simple" prefix matches, hence all values that can match a given string are prefixes of it,
+ * ending at a separator. Instead of testing every value node we can look up each of those prefixes in a hash table,
+ * which makes the cost depend on the depth of the tested string rather than on the number of matches installed. */
+static inline bool BUS_MATCH_IS_PREFIX(enum bus_match_node_type t) {
+        return t == BUS_MATCH_PATH_NAMESPACE ||
+                (t >= BUS_MATCH_ARG_NAMESPACE && t <= BUS_MATCH_ARG_NAMESPACE_LAST);
+}
+
 static inline bool BUS_MATCH_CAN_HASH(enum bus_match_node_type t) {
         return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH) ||
                 (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_LAST) ||
-                (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST);
+                (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST) ||
+                BUS_MATCH_IS_PREFIX(t);
 }
 
 static void bus_match_node_free(struct bus_match_node *node) {
@@ -240,6 +249,79 @@ static bool value_node_same(
         }
 }
 
+static int bus_match_run_prefix(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                sd_bus_message *m,
+                char *p,
+                size_t n) {
+
+        struct bus_match_node *found;
+        char c;
+
+        assert(node);
+        assert(p);
+
+        /* Looks up the first n characters of p in the hash table of node, and runs the match if there is one */
+
+        c = p[n];
+        p[n] = 0;
+        found = hashmap_get(node->compare.children, p);
+        p[n] = c;
+
+        if (!found)
+                return 0;
+
+        return bus_match_run(bus, found, m);
+}
+
+static int bus_match_run_prefixes(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                sd_bus_message *m,
+                const char *value) {
+
+        _cleanup_free_ char *p = NULL;
+        char separator;
+        size_t i, l;
+        int r;
+
+        assert(node);
+        assert(BUS_MATCH_IS_PREFIX(node->type));
+        assert(value);
+
+        /* Runs all value nodes matching according to simple_pattern_check(), i.e. those equal to the value, or
+         * equal to a prefix of it that is followed by a separator, with or without that separator */
+
+        separator = node->type == BUS_MATCH_PATH_NAMESPACE ? '/' : '.';
+
+        l = strlen(value);
+        p = memdup(value, l + 1);
+        if (!p)
+                return -ENOMEM;
+
+        for (i = 0; i < l; i++) {
+                if (p[i] != separator)
+                        continue;
+
+                r = bus_match_run_prefix(bus, node, m, p, i);
+                if (r != 0)
+                        return r;
+                if (bus && bus->match_callbacks_modified)
+                        return 0;
+
+                if (i + 1 < l) {
+                        r = bus_match_run_prefix(bus, node, m, p, i + 1);
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
+        }
+
+        return bus_match_run_prefix(bus, node, m, p, l);
+}
+
 int bus_match_run(
                 sd_bus *bus,
                 struct bus_match_node *node,
@@ -377,7 +459,13 @@ int bus_match_run(
 
                 /* Lookup via hash table, nice! So let's jump directly. */
 
-                if (test_str)
+                if (test_str && BUS_MATCH_IS_PREFIX(node->type)) {
+                        r = bus_match_run_prefixes(bus, node, m, test_str);
+                        if (r != 0)
+                                return r;
+
+                        found = NULL;
+                } else if (test_str)
                         found = hashmap_get(node->compare.children, test_str);
                 else if (test_strv) {
                         char **i;
@@ -52,6 +52,9 @@ static void message_free_part(sd_bus_message *m, struct bus_body_part *part) {
         else if (part->free_this)
                 free(part->data);
 
+        if (part->destroy)
+                part->destroy(part->destroy_userdata);
+
         if (part != &m->body)
                 free(part);
 }
@@ -85,6 +88,29 @@ static struct bus_container *message_get_last_container(sd_bus_message *m) {
         return m->containers + m->n_containers - 1;
 }
 
+static bool container_is_array_of(struct bus_container *c, char begin, const char *contents, char end) {
+        size_t l;
+
+        assert(c);
+        assert(contents);
+
+        /* Checks whether the container is an array whose element signature is exactly the struct or dict entry
+         * specified. The element signature has been validated when the array was opened or entered, hence in
+         * that case the contents of each element need not be verified again. */
+
+        if (c->enclosing != SD_BUS_TYPE_ARRAY || !c->signature)
+                return false;
+
+        if (c->signature[0] != begin)
+                return false;
+
+        l = strlen(contents);
+
+        return strneq(c->signature + 1, contents, l) &&
+                c->signature[1 + l] == end &&
+                c->signature[2 + l] == 0;
+}
+
 static void message_free_last_container(sd_bus_message *m) {
         struct bus_container *c;
 
@@ -1811,7 +1837,8 @@ static int bus_message_open_struct(
         assert(begin);
         assert(need_offsets);
 
-        if (!signature_is_valid(contents, false))
+        if (!container_is_array_of(c, SD_BUS_TYPE_STRUCT_BEGIN, contents, SD_BUS_TYPE_STRUCT_END) &&
+            !signature_is_valid(contents, false))
                 return -EINVAL;
 
         if (c->signature && c->signature[c->index]) {
@@ -1883,7 +1910,8 @@ static int bus_message_open_dict_entry(
         assert(begin);
         assert(need_offsets);
 
-        if (!signature_is_pair(contents))
+        if (!container_is_array_of(c, SD_BUS_TYPE_DICT_ENTRY_BEGIN, contents, SD_BUS_TYPE_DICT_ENTRY_END) &&
+            !signature_is_pair(contents))
                 return -EINVAL;
 
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
@@ -2630,6 +2658,80 @@ _public_ int sd_bus_message_append_array_memfd(
         return sd_bus_message_close_container(m);
 }
 
+static bool message_can_reference(sd_bus_message *m, size_t size) {
+        assert(m);
+
+        /* Referencing caller memory costs an extra body part, and hence an extra iovec on the wire. For small
+         * items copying is cheaper, and we don't want to run into IOV_MAX either. */
+        return size >= BUS_BODY_PART_REF_MIN && m->n_body_parts < BUS_BODY_PARTS_REF_MAX;
+}
+
+_public_ int sd_bus_message_append_array_ref(
+                sd_bus_message *m,
+                char type,
+                const void *ptr,
+                size_t size,
+                sd_bus_destroy_t destroy,
+                void *userdata) {
+
+        struct bus_body_part *part;
+        ssize_t align, sz;
+        void *a;
+        int r;
+
+        assert_return(m, -EINVAL);
+        assert_return(bus_type_is_trivial(type), -EINVAL);
+        assert_return(ptr || size == 0, -EINVAL);
+        assert_return(!m->sealed, -EPERM);
+        assert_return(!m->poisoned, -ESTALE);
+
+        if (!message_can_reference(m, size)) {
+                r = sd_bus_message_append_array(m, type, ptr, size);
+                if (r < 0)
+                        return r;
+
+                if (destroy)
+                        destroy(userdata);
+
+                return 0;
+        }
+
+        align = bus_type_get_alignment(type);
+        sz = bus_type_get_size(type);
+
+        assert_se(align > 0);
+        assert_se(sz > 0);
+
+        if (size % sz != 0)
+                return -EINVAL;
+
+        if (size > (uint32_t) -1)
+                return -EINVAL;
+
+        r = sd_bus_message_open_container(m, SD_BUS_TYPE_ARRAY, CHAR_TO_STR(type));
+        if (r < 0)
+                return r;
+
+        a = message_extend_body(m, align, 0, false, false);
+        if (!a)
+                return -ENOMEM;
+
+        part = message_append_part(m);
+        if (!part)
+                return -ENOMEM;
+
+        part->data = (void*) ptr;
+        part->sealed = true;
+        part->size = size;
+        part->destroy = destroy;
+        part->destroy_userdata = userdata;
+
+        m->body_size += size;
+        message_extend_containers(m, size);
+
+        return sd_bus_message_close_container(m);
+}
+
 _public_ int sd_bus_message_append_string_memfd(
                 sd_bus_message *m,
                 int memfd,
@@ -2728,6 +2830,95 @@ _public_ int sd_bus_message_append_string_memfd(
         return 0;
 }
 
+_public_ int sd_bus_message_append_string_ref(
+                sd_bus_message *m,
+                const char *s,
+                sd_bus_destroy_t destroy,
+                void *userdata) {
+
+        struct bus_body_part *part;
+        struct bus_container *c;
+        size_t size;
+        void *a;
+        int r;
+
+        assert_return(m, -EINVAL);
+        assert_return(s, -EINVAL);
+        assert_return(!m->sealed, -EPERM);
+        assert_return(!m->poisoned, -ESTALE);
+
+        /* The trailing NUL byte is referenced too, so that the string can go out as a single part */
+        size = strlen(s) + 1;
+
+        if (!message_can_reference(m, size)) {
+                r = sd_bus_message_append_basic(m, SD_BUS_TYPE_STRING, s);
+                if (r < 0)
+                        return r;
+
+                if (destroy)
+                        destroy(userdata);
+
+                return 0;
+        }
+
+        if (size > (uint32_t) -1)
+                return -EINVAL;
+
+        c = message_get_last_container(m);
+        if (c->signature && c->signature[c->index]) {
+                /* Container signature is already set */
+
+                if (c->signature[c->index] != SD_BUS_TYPE_STRING)
+                        return -ENXIO;
+        } else {
+                char *e;
+
+                /* Maybe we can append to the signature? But only if this is the top-level container */
+                if (c->enclosing != 0)
+                        return -ENXIO;
+
+                e = strextend(&c->signature, CHAR_TO_STR(SD_BUS_TYPE_STRING), NULL);
+                if (!e) {
+                        m->poisoned = true;
+                        return -ENOMEM;
+                }
+        }
+
+        if (!BUS_MESSAGE_IS_GVARIANT(m)) {
+                a = message_extend_body(m, 4, 4, false, false);
+                if (!a)
+                        return -ENOMEM;
+
+                *(uint32_t*) a = size - 1;
+        }
+
+        part = message_append_part(m);
+        if (!part)
+                return -ENOMEM;
+
+        part->data = (void*) s;
+        part->sealed = true;
+        part->size = size;
+        part->destroy = destroy;
+        part->destroy_userdata = userdata;
+
+        m->body_size += size;
+        message_extend_containers(m, size);
+
+        if (BUS_MESSAGE_IS_GVARIANT(m)) {
+                r = message_add_offset(m, m->body_size);
+                if (r < 0) {
+                        m->poisoned = true;
+                        return -ENOMEM;
+                }
+        }
+
+        if (c->enclosing != SD_BUS_TYPE_ARRAY)
+                c->index++;
+
+        return 0;
+}
+
 _public_ int sd_bus_message_append_strv(sd_bus_message *m, char **l) {
         char **i;
         int r;
@@ -2877,7 +3068,12 @@ _public_ int sd_bus_message_seal(sd_bus_message *m, uint64_t cookie, uint64_t ti
 
         /* If this is something we can send as memfd, then let's seal
         the memfd now. Note that we can send memfds as payload only
-        for directed messages, and not for broadcasts. */
+        for directed messages, and not for broadcasts.
+
+        Note that the AF_UNIX transport never sets use_memfd: the D-Bus
+        wire format has no way to carry a body part out of band, and so
+        memfd parts are mapped and written inline there, see
+        bus_message_setup_iovec(). */
         if (m->destination && m->bus->use_memfd) {
                 MESSAGE_FOREACH_PART(part, i, m)
                         if (part->memfd >= 0 &&
@@ -3902,7 +4098,8 @@ static int bus_message_enter_struct(
         assert(offsets);
         assert(n_offsets);
 
-        if (!signature_is_valid(contents, false))
+        if (!container_is_array_of(c, SD_BUS_TYPE_STRUCT_BEGIN, contents, SD_BUS_TYPE_STRUCT_END) &&
+            !signature_is_valid(contents, false))
                 return -EINVAL;
 
         if (!c->signature || c->signature[c->index] == 0)
@@ -3940,7 +4137,8 @@ static int bus_message_enter_dict_entry(
         assert(c);
         assert(contents);
 
-        if (!signature_is_pair(contents))
+        if (!container_is_array_of(c, SD_BUS_TYPE_DICT_ENTRY_BEGIN, contents, SD_BUS_TYPE_DICT_ENTRY_END) &&
+            !signature_is_pair(contents))
                 return -EINVAL;
 
         if (c->enclosing != SD_BUS_TYPE_ARRAY)
@@ -5479,6 +5677,88 @@ int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz) {
         return 0;
 }
 
+int bus_message_get_body_range(sd_bus_message *m, size_t offset, size_t sz, void *ret) {
+        struct bus_body_part *part;
+        size_t i, begin = 0;
+        uint8_t *q = ret;
+
+        assert(m);
+        assert(ret || sz == 0);
+
+        /* Copies a range of the (possibly still unsealed) body out of
+         * the body parts it is spread over. */
+
+        if (offset + sz < offset || offset + sz > m->body_size)
+                return -ERANGE;
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                size_t a, b;
+
+                if (sz == 0)
+                        break;
+
+                if (offset >= begin + part->size) {
+                        begin += part->size;
+                        continue;
+                }
+
+                a = offset - begin;
+                b = MIN(part->size - a, sz);
+
+                if (part->is_zero)
+                        memzero(q, b);
+                else {
+                        int r;
+
+                        r = bus_body_part_map(part);
+                        if (r < 0)
+                                return r;
+
+                        memcpy(q, (uint8_t*) part->data + a, b);
+                }
+
+                q += b;
+                offset += b;
+                sz -= b;
+                begin += part->size;
+        }
+
+        return 0;
+}
+
+int bus_message_append_raw(sd_bus_message *m, const void *p, size_t sz) {
+        struct bus_container *c;
+        void *a;
+
+        assert(m);
+        assert(p || sz == 0);
+
+        /* Appends a fragment previously taken out of another message
+         * with bus_message_get_body_range(). The fragment must start
+         * 8-byte aligned and consist of complete elements of the array
+         * that is currently open, so that alignment and signature stay
+         * valid without having to look at it. Only dbus1 marshalling
+         * has position-independent fragments like this. */
+
+        if (m->sealed)
+                return -EPERM;
+        if (m->poisoned)
+                return -ESTALE;
+        if (BUS_MESSAGE_IS_GVARIANT(m))
+                return -EOPNOTSUPP;
+
+        c = message_get_last_container(m);
+        if (c->enclosing != SD_BUS_TYPE_ARRAY)
+                return -ENXIO;
+
+        a = message_extend_body(m, 8, sz, false, false);
+        if (!a)
+                return -ENOMEM;
+
+        memcpy_safe(a, p, sz);
+        return 0;
+}
+
 int bus_message_read_strv_extend(sd_bus_message *m, char ***l) {
         const char *s;
         int r;
@@ -32,6 +32,11 @@ struct bus_container {
         char *peeked_signature;
 };
 
+/* Items smaller than this are copied into the message even when a reference was requested, and so are all items
+ * once a message has this many body parts, to stay well below IOV_MAX when writing it out. */
+#define BUS_BODY_PART_REF_MIN 256U
+#define BUS_BODY_PARTS_REF_MAX 512U
+
 struct bus_body_part {
         struct bus_body_part *next;
         void *data;
@@ -41,6 +46,8 @@ struct bus_body_part {
         size_t allocated;
         uint64_t memfd_offset;
         int memfd;
+        sd_bus_destroy_t destroy;
+        void *destroy_userdata;
         bool free_this:1;
         bool munmap_this:1;
         bool sealed:1;
@@ -167,6 +174,8 @@ static inline bool BUS_MESSAGE_IS_GVARIANT(sd_bus_message *m) {
 
 int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz);
 int bus_message_read_strv_extend(sd_bus_message *m, char ***l);
+int bus_message_get_body_range(sd_bus_message *m, size_t offset, size_t sz, void *ret);
+int bus_message_append_raw(sd_bus_message *m, const void *p, size_t sz);
 
 int bus_message_from_header(
                 sd_bus *bus,
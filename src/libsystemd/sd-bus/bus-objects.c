@@ -652,6 +652,8 @@ static int property_get_set_callbacks_run(
                 if (r < 0)
                         return bus_maybe_reply_error(m, r, &error);
 
+                bus_property_cache_flush(bus, m->path, c->interface);
+
                 if (bus->nodes_modified)
                         return 0;
 
@@ -667,6 +669,257 @@ static int property_get_set_callbacks_run(
         return 1;
 }
 
+struct property_cache_slot {
+        size_t offset;
+        size_t size;
+};
+
+struct property_cache {
+        struct node_vtable *node_vtable;
+        void *userdata;
+
+        uint8_t *data;
+        size_t size, allocated;
+
+        /* Indexed by the position of the property in the vtable */
+        struct property_cache_slot *slots;
+        size_t n_slots;
+
+        LIST_FIELDS(struct property_cache, caches);
+};
+
+struct property_cache_path {
+        char *path;
+        LIST_HEAD(struct property_cache, caches);
+};
+
+static void property_cache_free(sd_bus *bus, struct property_cache *c) {
+        assert(bus);
+
+        if (!c)
+                return;
+
+        assert(bus->property_cache_size >= c->size);
+        bus->property_cache_size -= c->size;
+
+        free(c->data);
+        free(c->slots);
+        free(c);
+}
+
+static void property_cache_path_free(sd_bus *bus, struct property_cache_path *p) {
+        struct property_cache *c;
+
+        assert(bus);
+
+        if (!p)
+                return;
+
+        while ((c = p->caches)) {
+                LIST_REMOVE(caches, p->caches, c);
+                property_cache_free(bus, c);
+        }
+
+        free(p->path);
+        free(p);
+}
+
+void bus_property_cache_flush(sd_bus *bus, const char *path, const char *interface) {
+        struct property_cache_path *p;
+        struct property_cache *c, *n;
+
+        assert(bus);
+
+        if (!path) {
+                while ((p = hashmap_steal_first(bus->property_cache)))
+                        property_cache_path_free(bus, p);
+
+                assert(bus->property_cache_size == 0);
+                return;
+        }
+
+        p = hashmap_get(bus->property_cache, path);
+        if (!p)
+                return;
+
+        LIST_FOREACH_SAFE(caches, c, n, p->caches) {
+                if (interface && !streq(c->node_vtable->interface, interface))
+                        continue;
+
+                LIST_REMOVE(caches, p->caches, c);
+                property_cache_free(bus, c);
+        }
+
+        if (!p->caches) {
+                hashmap_remove(bus->property_cache, p->path);
+                property_cache_path_free(bus, p);
+        }
+}
+
+static struct property_cache *property_cache_find(
+                sd_bus *bus,
+                const char *path,
+                struct node_vtable *node_vtable,
+                void *userdata) {
+
+        struct property_cache_path *p;
+        struct property_cache *c;
+
+        assert(bus);
+        assert(path);
+        assert(node_vtable);
+
+        p = hashmap_get(bus->property_cache, path);
+        if (!p)
+                return NULL;
+
+        LIST_FOREACH(caches, c, p->caches)
+                if (c->node_vtable == node_vtable) {
+                        /* The object behind the path changed (different result of the find
+                         * callback), the fragments we have stored belong to another object. */
+                        if (c->userdata != userdata) {
+                                LIST_REMOVE(caches, p->caches, c);
+                                property_cache_free(bus, c);
+                                return NULL;
+                        }
+
+                        return c;
+                }
+
+        return NULL;
+}
+
+static struct property_cache *property_cache_add(
+                sd_bus *bus,
+                const char *path,
+                struct node_vtable *node_vtable,
+                void *userdata) {
+
+        _cleanup_free_ struct property_cache_path *np = NULL;
+        _cleanup_free_ char *npath = NULL;
+        struct property_cache_path *p;
+        struct property_cache *c;
+        const sd_bus_vtable *v;
+        size_t n = 0;
+        int r;
+
+        assert(bus);
+        assert(path);
+        assert(node_vtable);
+
+        p = hashmap_get(bus->property_cache, path);
+        if (!p) {
+                if (hashmap_size(bus->property_cache) >= BUS_PROPERTY_CACHE_PATHS_MAX)
+                        return NULL;
+
+                r = hashmap_ensure_allocated(&bus->property_cache, &string_hash_ops);
+                if (r < 0)
+                        return NULL;
+
+                npath = strdup(path);
+                if (!npath)
+                        return NULL;
+
+                np = new0(struct property_cache_path, 1);
+                if (!np)
+                        return NULL;
+
+                np->path = npath;
+
+                r = hashmap_put(bus->property_cache, np->path, np);
+                if (r < 0)
+                        return NULL;
+
+                npath = NULL;
+                p = TAKE_PTR(np);
+        }
+
+        for (v = node_vtable->vtable; v->type != _SD_BUS_VTABLE_END; v++)
+                n++;
+
+        c = new0(struct property_cache, 1);
+        if (!c)
+                goto fail;
+
+        c->slots = new0(struct property_cache_slot, n);
+        if (!c->slots) {
+                free(c);
+                goto fail;
+        }
+
+        c->n_slots = n;
+        c->node_vtable = node_vtable;
+        c->userdata = userdata;
+
+        LIST_PREPEND(caches, p->caches, c);
+        return c;
+
+fail:
+        if (!p->caches) {
+                hashmap_remove(bus->property_cache, p->path);
+                property_cache_path_free(bus, p);
+        }
+
+        return NULL;
+}
+
+static void property_cache_store(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                struct node_vtable *c,
+                const sd_bus_vtable *v,
+                void *userdata,
+                size_t start) {
+
+        struct property_cache *pc;
+        size_t idx, sz;
+
+        assert(bus);
+        assert(reply);
+        assert(c);
+        assert(v);
+
+        /* Remember the dict entry we just serialized. Failing to do so
+         * is never fatal, the property will simply be generated again
+         * the next time. */
+
+        assert(reply->body_size >= start);
+        sz = reply->body_size - start;
+        if (sz == 0)
+                return;
+
+        if (bus->property_cache_size + sz > BUS_PROPERTY_CACHE_SIZE_MAX)
+                return;
+
+        pc = property_cache_find(bus, path, c, userdata);
+        if (!pc) {
+                pc = property_cache_add(bus, path, c, userdata);
+                if (!pc)
+                        return;
+        }
+
+        idx = v - c->vtable;
+        assert(idx < pc->n_slots);
+
+        if (pc->slots[idx].size > 0)
+                return;
+
+        if (!GREEDY_REALLOC(pc->data, pc->allocated, pc->size + sz))
+                return;
+
+        if (bus_message_get_body_range(reply, start, sz, pc->data + pc->size) < 0)
+                return;
+
+        pc->slots[idx] = (struct property_cache_slot) {
+                .offset = pc->size,
+                .size = sz,
+        };
+
+        pc->size += sz;
+        bus->property_cache_size += sz;
+}
+
 static int vtable_append_one_property(
                 sd_bus *bus,
                 sd_bus_message *reply,
@@ -716,14 +969,57 @@ static int vtable_append_one_property(
         return 0;
 }
 
-static int vtable_append_all_properties(
+static int vtable_append_one_property_cached(
                 sd_bus *bus,
                 sd_bus_message *reply,
                 const char *path,
                 struct node_vtable *c,
+                const sd_bus_vtable *v,
                 void *userdata,
                 sd_bus_error *error) {
 
+        struct property_cache *pc;
+        size_t start;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(c);
+        assert(v);
+
+        pc = property_cache_find(bus, path, c, userdata);
+        if (pc) {
+                const struct property_cache_slot *slot = pc->slots + (v - c->vtable);
+
+                if (slot->size > 0)
+                        return bus_message_append_raw(reply, pc->data + slot->offset, slot->size);
+        }
+
+        /* Dict entries are 8-byte aligned, hence the fragment we store
+         * starts at the properly aligned end of the body. Note that the
+         * getter might invalidate the cache, hence look it up again
+         * afterwards. */
+        start = ALIGN8(reply->body_size);
+
+        r = vtable_append_one_property(bus, reply, path, c, v, userdata, error);
+        if (r < 0)
+                return r;
+        if (bus->nodes_modified)
+                return 0;
+
+        property_cache_store(bus, reply, path, c, v, userdata, start);
+        return 0;
+}
+
+static int vtable_append_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                struct node_vtable *c,
+                void *userdata,
+                char **names,
+                sd_bus_error *error) {
+
         const sd_bus_vtable *v;
         int r;
 
@@ -732,20 +1028,27 @@ static int vtable_append_all_properties(
         assert(path);
         assert(c);
 
-        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+        /* Properties that are listed explicitly are included even if they are hidden
+         * or excluded from GetAll(), the same way Get() returns them. */
+
+        if (!names && (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN))
                 return 1;
 
         for (v = c->vtable+1; v->type != _SD_BUS_VTABLE_END; v++) {
                 if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
                         continue;
 
-                if (v->flags & SD_BUS_VTABLE_HIDDEN)
-                        continue;
+                if (names) {
+                        if (!strv_contains(names, v->x.property.member))
+                                continue;
 
-                if (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)
+                } else if (v->flags & (SD_BUS_VTABLE_HIDDEN|SD_BUS_VTABLE_PROPERTY_EXPLICIT))
                         continue;
 
-                r = vtable_append_one_property(bus, reply, path, c, v, userdata, error);
+                if ((v->flags & SD_BUS_VTABLE_PROPERTY_CACHEABLE) && !BUS_MESSAGE_IS_GVARIANT(reply))
+                        r = vtable_append_one_property_cached(bus, reply, path, c, v, userdata, error);
+                else
+                        r = vtable_append_one_property(bus, reply, path, c, v, userdata, error);
                 if (r < 0)
                         return r;
                 if (bus->nodes_modified)
@@ -755,6 +1058,17 @@ static int vtable_append_all_properties(
         return 1;
 }
 
+static int vtable_append_all_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                struct node_vtable *c,
+                void *userdata,
+                sd_bus_error *error) {
+
+        return vtable_append_properties(bus, reply, path, c, userdata, NULL, error);
+}
+
 static int property_get_all_callbacks_run(
                 sd_bus *bus,
                 sd_bus_message *m,
@@ -1126,6 +1440,152 @@ static int object_manager_serialize_path(
         return 1;
 }
 
+static int object_append_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *prefix,
+                const char *path,
+                bool require_fallback,
+                char **names,
+                Set **interfaces,
+                sd_bus_error *error) {
+
+        const char *previous_interface = NULL;
+        struct node_vtable *i;
+        struct node *n;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(prefix);
+        assert(path);
+        assert(interfaces);
+
+        n = hashmap_get(bus->nodes, prefix);
+        if (!n)
+                return 0;
+
+        LIST_FOREACH(vtables, i, n->vtables) {
+                void *u;
+
+                if (require_fallback && !i->is_fallback)
+                        continue;
+
+                r = node_vtable_get_userdata(bus, path, i, &u, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return -EAGAIN;
+                if (r == 0)
+                        continue;
+
+                if (!streq_ptr(previous_interface, i->interface)) {
+
+                        /* Maybe close the previous interface part */
+
+                        if (previous_interface) {
+                                r = sd_bus_message_close_container(reply);
+                                if (r < 0)
+                                        return r;
+
+                                r = sd_bus_message_close_container(reply);
+                                if (r < 0)
+                                        return r;
+
+                                previous_interface = NULL;
+                        }
+
+                        /* Vtables of the same interface are kept next to each other. If an interface shows up
+                         * again, it was already found on the object itself or on a longer prefix, which take
+                         * precedence, the same way Get() resolves properties. */
+                        if (set_contains(*interfaces, i->interface))
+                                continue;
+
+                        r = set_ensure_allocated(interfaces, &string_hash_ops);
+                        if (r < 0)
+                                return r;
+
+                        r = set_put(*interfaces, i->interface);
+                        if (r < 0)
+                                return r;
+
+                        /* Open the new interface part */
+
+                        r = sd_bus_message_open_container(reply, 'e', "sa{sv}");
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_append(reply, "s", i->interface);
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_open_container(reply, 'a', "{sv}");
+                        if (r < 0)
+                                return r;
+
+                        previous_interface = i->interface;
+                }
+
+                r = vtable_append_properties(bus, reply, path, i, u, names, error);
+                if (r < 0)
+                        return r;
+                if (bus->nodes_modified)
+                        return -EAGAIN;
+        }
+
+        if (previous_interface) {
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+int bus_object_append_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                char **names,
+                sd_bus_error *error) {
+
+        _cleanup_set_free_ Set *interfaces = NULL;
+        char *prefix;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(path);
+
+        /* Appends an a{sa{sv}} array with the properties of the local object at the specified path, keyed by
+         * interface, like a GetAll() call for each of its interfaces would return them, and in the same format
+         * as GetManagedObjects() uses. This allows services to return the properties of many objects in one
+         * method reply. If names is non-NULL, only the listed properties are included. As this is called from
+         * within a method handler, the processing can't be restarted if the object tree changes in the property
+         * getters, hence this is refused with -EAGAIN. */
+
+        r = sd_bus_message_open_container(reply, 'a', "{sa{sv}}");
+        if (r < 0)
+                return r;
+
+        r = object_append_properties(bus, reply, path, path, false, names, &interfaces, error);
+        if (r < 0)
+                return r;
+
+        prefix = alloca(strlen(path) + 1);
+        OBJECT_PATH_FOREACH_PREFIX(prefix, path) {
+                r = object_append_properties(bus, reply, prefix, path, true, names, &interfaces, error);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
 static int object_manager_serialize_path_and_fallbacks(
                 sd_bus *bus,
                 sd_bus_message *reply,
@@ -1700,7 +2160,7 @@ static int add_object_vtable_internal(
                             !signature_is_valid(strempty(v->x.method.signature), false) ||
                             !signature_is_valid(strempty(v->x.method.result), false) ||
                             !(v->x.method.handler || (isempty(v->x.method.signature) && isempty(v->x.method.result))) ||
-                            v->flags & (SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE|SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION)) {
+                            v->flags & (SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE|SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION|SD_BUS_VTABLE_PROPERTY_CACHEABLE)) {
                                 r = -EINVAL;
                                 goto fail;
                         }
@@ -1748,6 +2208,8 @@ static int add_object_vtable_internal(
                             (v->flags & SD_BUS_VTABLE_METHOD_NO_REPLY) ||
                             (!!(v->flags & SD_BUS_VTABLE_PROPERTY_CONST) + !!(v->flags & SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE) + !!(v->flags & SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION)) > 1 ||
                             ((v->flags & SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE) && (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)) ||
+                            ((v->flags & SD_BUS_VTABLE_PROPERTY_CACHEABLE) && (v->flags & SD_BUS_VTABLE_PROPERTY_EXPLICIT)) ||
+                            ((v->flags & SD_BUS_VTABLE_PROPERTY_CACHEABLE) && strchr(v->x.property.signature, SD_BUS_TYPE_UNIX_FD)) ||
                             (v->flags & SD_BUS_VTABLE_UNPRIVILEGED && v->type == _SD_BUS_VTABLE_PROPERTY)) {
                                 r = -EINVAL;
                                 goto fail;
@@ -2098,6 +2560,10 @@ _public_ int sd_bus_emit_properties_changed_strv(
         assert_return(interface_name_is_valid(interface), -EINVAL);
         assert_return(!bus_pid_changed(bus), -ECHILD);
 
+        /* Any change of the interface's properties makes the fragments
+         * cached for GetAll() stale, regardless of which were listed. */
+        bus_property_cache_flush(bus, path, interface);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2500,6 +2966,8 @@ _public_ int sd_bus_emit_object_removed(sd_bus *bus, const char *path) {
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_pid_changed(bus), -ECHILD);
 
+        bus_property_cache_flush(bus, path, NULL);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2734,6 +3202,7 @@ _public_ int sd_bus_emit_interfaces_added(sd_bus *bus, const char *path, const c
 _public_ int sd_bus_emit_interfaces_removed_strv(sd_bus *bus, const char *path, char **interfaces) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         struct node *object_manager;
+        char **i;
         int r;
 
         assert_return(bus, -EINVAL);
@@ -2741,6 +3210,9 @@ _public_ int sd_bus_emit_interfaces_removed_strv(sd_bus *bus, const char *path,
         assert_return(object_path_is_valid(path), -EINVAL);
         assert_return(!bus_pid_changed(bus), -ECHILD);
 
+        STRV_FOREACH(i, interfaces)
+                bus_property_cache_flush(bus, path, *i);
+
         if (!BUS_IS_OPEN(bus->state))
                 return -ENOTCONN;
 
@@ -2819,3 +3291,16 @@ fail:
 
         return r;
 }
+
+_public_ int sd_bus_invalidate_property_cache(sd_bus *bus, const char *path, const char *interface) {
+
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(!path || object_path_is_valid(path), -EINVAL);
+        assert_return(!interface || interface_name_is_valid(interface), -EINVAL);
+        assert_return(path || !interface, -EINVAL);
+        assert_return(!bus_pid_changed(bus), -ECHILD);
+
+        bus_property_cache_flush(bus, path, interface);
+        return 0;
+}
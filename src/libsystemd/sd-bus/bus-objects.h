@@ -5,3 +5,6 @@
 
 int bus_process_object(sd_bus *bus, sd_bus_message *m);
 void bus_node_gc(sd_bus *b, struct node *n);
+
+void bus_property_cache_flush(sd_bus *bus, const char *path, const char *interface);
+int bus_object_append_properties(sd_bus *bus, sd_bus_message *reply, const char *path, char **names, sd_bus_error *error);
@@ -149,6 +149,10 @@ void bus_slot_disconnect(sd_bus_slot *slot, bool unref) {
                         }
                 }
 
+                /* Cached property fragments refer to the vtable by pointer, and fallback vtables might have
+                 * filled them for any number of paths below the node, hence drop everything. */
+                bus_property_cache_flush(slot->bus, NULL, NULL);
+
                 slot->node_vtable.interface = mfree(slot->node_vtable.interface);
 
                 if (slot->node_vtable.node) {
@@ -25,6 +25,7 @@
 #include "signal-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
+#include "unaligned.h"
 #include "user-util.h"
 #include "utf8.h"
 #include "util.h"
@@ -975,7 +976,7 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         assert(bus);
         assert(m);
         assert(idx);
-        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
+        assert(IN_SET(bus->state, BUS_AUTHENTICATING, BUS_RUNNING, BUS_HELLO));
 
         if (*idx >= BUS_MESSAGE_SIZE(m))
                 return 0;
@@ -1023,16 +1024,17 @@ int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         return 1;
 }
 
-static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
+static int bus_socket_read_message_need(sd_bus *bus, size_t offset, size_t *need) {
+        const uint8_t *p;
         uint32_t a, b;
-        uint8_t e;
         uint64_t sum;
 
         assert(bus);
         assert(need);
+        assert(offset <= bus->rbuffer_size);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (bus->rbuffer_size < sizeof(struct bus_header)) {
+        if (bus->rbuffer_size - offset < sizeof(struct bus_header)) {
                 *need = sizeof(struct bus_header) + 8;
 
                 /* Minimum message size:
@@ -1054,16 +1056,15 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
                 return 0;
         }
 
-        a = ((const uint32_t*) bus->rbuffer)[1];
-        b = ((const uint32_t*) bus->rbuffer)[3];
+        /* Later messages in a batch are not necessarily aligned in the buffer */
+        p = (const uint8_t*) bus->rbuffer + offset;
 
-        e = ((const uint8_t*) bus->rbuffer)[0];
-        if (e == BUS_LITTLE_ENDIAN) {
-                a = le32toh(a);
-                b = le32toh(b);
-        } else if (e == BUS_BIG_ENDIAN) {
-                a = be32toh(a);
-                b = be32toh(b);
+        if (p[0] == BUS_LITTLE_ENDIAN) {
+                a = unaligned_read_le32(p + 4);
+                b = unaligned_read_le32(p + 12);
+        } else if (p[0] == BUS_BIG_ENDIAN) {
+                a = unaligned_read_be32(p + 4);
+                b = unaligned_read_be32(p + 12);
         } else
                 return -EBADMSG;
 
@@ -1075,53 +1076,264 @@ static int bus_socket_read_message_need(sd_bus *bus, size_t *need) {
         return 0;
 }
 
-static int bus_socket_make_message(sd_bus *bus, size_t size) {
+static int bus_socket_peek_unix_fds(const uint8_t *p, size_t size, unsigned *ret) {
+        size_t i, end;
+        bool le;
+
+        assert(p);
+        assert(size >= sizeof(struct bus_header));
+        assert(ret);
+
+        /* Determines the number of fds a dbus1 message expects, by looking for the UNIX_FDS header field. This
+         * only understands fields of basic types, which is all the spec defines. If we can't find out, we
+         * return -EOPNOTSUPP and let the caller make do without, bus_message_parse_fields() will complain about
+         * anything that is actually broken. */
+
+        if (p[3] != 1)
+                return -EOPNOTSUPP;
+
+        le = p[0] == BUS_LITTLE_ENDIAN;
+
+#define READ32(x) (le ? unaligned_read_le32(x) : unaligned_read_be32(x))
+
+        end = sizeof(struct bus_header) + READ32(p + 12);
+        if (end > size)
+                return -EOPNOTSUPP;
+
+        for (i = sizeof(struct bus_header); i < end; ) {
+                uint8_t code, n, type;
+                size_t l;
+
+                i = ALIGN8(i);
+                if (i + 4 > end)
+                        return -EOPNOTSUPP;
+
+                code = p[i];
+                n = p[i + 1];
+                type = p[i + 2];
+
+                /* All fields we know of carry a single basic type */
+                if (n != 1 || p[i + 3] != 0)
+                        return -EOPNOTSUPP;
+
+                switch (type) {
+
+                case SD_BUS_TYPE_BYTE:
+                        i += 4 + 1;
+                        break;
+
+                case SD_BUS_TYPE_INT16:
+                case SD_BUS_TYPE_UINT16:
+                        i = ALIGN_TO(i + 4, 2) + 2;
+                        break;
+
+                case SD_BUS_TYPE_BOOLEAN:
+                case SD_BUS_TYPE_INT32:
+                case SD_BUS_TYPE_UINT32:
+                case SD_BUS_TYPE_UNIX_FD:
+                        i = ALIGN4(i + 4);
+                        if (i + 4 > end)
+                                return -EOPNOTSUPP;
+
+                        if (code == BUS_MESSAGE_HEADER_UNIX_FDS && type == SD_BUS_TYPE_UINT32) {
+                                *ret = READ32(p + i);
+                                return 0;
+                        }
+
+                        i += 4;
+                        break;
+
+                case SD_BUS_TYPE_INT64:
+                case SD_BUS_TYPE_UINT64:
+                case SD_BUS_TYPE_DOUBLE:
+                        i = ALIGN8(i + 4) + 8;
+                        break;
+
+                case SD_BUS_TYPE_STRING:
+                case SD_BUS_TYPE_OBJECT_PATH:
+                        i = ALIGN4(i + 4);
+                        if (i + 4 > end)
+                                return -EOPNOTSUPP;
+
+                        l = READ32(p + i);
+                        i += 4 + l + 1;
+                        break;
+
+                case SD_BUS_TYPE_SIGNATURE:
+                        i += 4;
+                        if (i >= end)
+                                return -EOPNOTSUPP;
+
+                        i += 1 + p[i] + 1;
+                        break;
+
+                default:
+                        return -EOPNOTSUPP;
+                }
+        }
+
+#undef READ32
+
+        *ret = 0;
+        return 0;
+}
+
+static int bus_socket_take_fds(sd_bus *bus, size_t offset, size_t size, int **ret, size_t *ret_n) {
+        unsigned n;
+        int *f;
+
+        assert(bus);
+        assert(ret);
+        assert(ret_n);
+
+        /* Received fds are queued in the order they arrived, and every message takes as many of them as its
+         * header asks for. If this is the last complete message in the buffer, or we can't tell, it gets all
+         * of them, as before. */
+
+        if (bus->n_fds == 0 ||
+            offset + size >= bus->rbuffer_size ||
+            bus_socket_peek_unix_fds((const uint8_t*) bus->rbuffer + offset, size, &n) < 0 ||
+            n >= bus->n_fds) {
+                *ret = TAKE_PTR(bus->fds);
+                *ret_n = bus->n_fds;
+                bus->n_fds = 0;
+                return 0;
+        }
+
+        if (n == 0)
+                f = NULL;
+        else {
+                f = newdup(int, bus->fds, n);
+                if (!f)
+                        return -ENOMEM;
+
+                memmove(bus->fds, bus->fds + n, sizeof(int) * (bus->n_fds - n));
+                bus->n_fds -= n;
+        }
+
+        *ret = f;
+        *ret_n = n;
+        return 0;
+}
+
+static int bus_socket_make_message(sd_bus *bus, size_t offset, size_t size) {
         sd_bus_message *t;
+        size_t n_fds;
+        int *fds;
         void *b;
         int r;
 
         assert(bus);
-        assert(bus->rbuffer_size >= size);
+        assert(bus->rbuffer_size >= offset + size);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
         r = bus_rqueue_make_room(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size > size) {
-                b = memdup((const uint8_t*) bus->rbuffer + size,
-                           bus->rbuffer_size - size);
-                if (!b)
-                        return -ENOMEM;
-        } else
-                b = NULL;
+        r = bus_socket_take_fds(bus, offset, size, &fds, &n_fds);
+        if (r < 0)
+                return r;
+
+        if (offset == 0 && bus->rbuffer_size == size) {
+                /* The message is all we have, hand over the buffer. It might have been allocated for reading
+                 * a whole batch, hence give back what we don't need. */
+                b = realloc(bus->rbuffer, size) ?: bus->rbuffer;
+                bus->rbuffer = NULL;
+        } else {
+                b = memdup((const uint8_t*) bus->rbuffer + offset, size);
+                if (!b) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+        }
 
         r = bus_message_from_malloc(bus,
-                                    bus->rbuffer, size,
-                                    bus->fds, bus->n_fds,
+                                    b, size,
+                                    fds, n_fds,
                                     NULL,
                                     &t);
         if (r < 0) {
-                free(b);
-                return r;
+                if (bus->rbuffer)
+                        free(b);
+                else
+                        /* Put the buffer back, the connection is going to be torn down anyway, but let's
+                         * keep things consistent */
+                        bus->rbuffer = b;
+                goto fail;
         }
 
-        bus->rbuffer = b;
-        bus->rbuffer_size -= size;
-
-        bus->fds = NULL;
-        bus->n_fds = 0;
+        if (!bus->rbuffer)
+                bus->rbuffer_size = 0;
 
         bus->rqueue[bus->rqueue_size++] = t;
 
         return 1;
+
+fail:
+        close_many(fds, n_fds);
+        free(fds);
+        return r;
+}
+
+static int bus_socket_make_messages(sd_bus *bus) {
+        size_t offset = 0, need;
+        unsigned n = 0;
+        int r;
+
+        assert(bus);
+
+        /* Turns all complete messages in the read buffer into message objects, and moves whatever is left to
+         * the front of the buffer */
+
+        for (;;) {
+                r = bus_socket_read_message_need(bus, offset, &need);
+                if (r < 0)
+                        break;
+
+                if (bus->rbuffer_size - offset < need)
+                        break;
+
+                /* If the read queue is full, leave the rest in the buffer for later, unless we haven't
+                 * made any progress at all */
+                if (n > 0 && bus->rqueue_size >= BUS_RQUEUE_MAX)
+                        break;
+
+                r = bus_socket_make_message(bus, offset, need);
+                if (r < 0)
+                        break;
+
+                n++;
+
+                if (!bus->rbuffer) {
+                        /* The buffer was handed over */
+                        assert(offset == 0);
+                        break;
+                }
+
+                offset += need;
+        }
+
+        if (offset > 0) {
+                memmove(bus->rbuffer, (uint8_t*) bus->rbuffer + offset, bus->rbuffer_size - offset);
+                bus->rbuffer_size -= offset;
+        }
+
+        /* Don't keep the BUS_READ_BUFFER_MIN sized buffer around on idle connections */
+        if (bus->rbuffer && bus->rbuffer_size == 0)
+                bus->rbuffer = mfree(bus->rbuffer);
+
+        if (r < 0 && n == 0)
+                return r;
+
+        return n > 0;
 }
 
 int bus_socket_read_message(sd_bus *bus) {
         struct msghdr mh;
         struct iovec iov = {};
         ssize_t k;
-        size_t need;
+        size_t need, want;
         int r;
         void *b;
         union {
@@ -1133,21 +1345,27 @@ int bus_socket_read_message(sd_bus *bus) {
         assert(bus);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        r = bus_socket_read_message_need(bus, &need);
+        /* Maybe there are complete messages left in the buffer from an earlier batch? */
+        r = bus_socket_make_messages(bus);
+        if (r != 0)
+                return r;
+
+        r = bus_socket_read_message_need(bus, 0, &need);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
+        /* Read as much as fits into a reasonably sized buffer, so that a burst of small messages can be
+         * picked up with a single syscall, but at least the remainder of the current message */
+        want = MAX(need, BUS_READ_BUFFER_MIN);
 
-        b = realloc(bus->rbuffer, need);
+        b = realloc(bus->rbuffer, want);
         if (!b)
                 return -ENOMEM;
 
         bus->rbuffer = b;
 
         iov.iov_base = (uint8_t*) bus->rbuffer + bus->rbuffer_size;
-        iov.iov_len = need - bus->rbuffer_size;
+        iov.iov_len = want - bus->rbuffer_size;
 
         if (bus->prefer_readv)
                 k = readv(bus->input_fd, &iov, 1);
@@ -1205,13 +1423,10 @@ int bus_socket_read_message(sd_bus *bus) {
                                           cmsg->cmsg_level, cmsg->cmsg_type);
         }
 
-        r = bus_socket_read_message_need(bus, &need);
+        r = bus_socket_make_messages(bus);
         if (r < 0)
                 return r;
 
-        if (bus->rbuffer_size >= need)
-                return bus_socket_make_message(bus, need);
-
         return 1;
 }
 
@@ -7,10 +7,19 @@
 #include "bus-track.h"
 #include "bus-util.h"
 
-struct track_item {
-        unsigned n_ref;
+/* The NameOwnerChanged subscription for a name, shared by all track objects on a bus connection that track it,
+ * so that each name costs one match on the broker, however many track objects there are. */
+struct track_name {
         char *name;
         sd_bus_slot *slot;
+        LIST_HEAD(struct track_item, items);
+};
+
+struct track_item {
+        unsigned n_ref;
+        sd_bus_track *track;
+        struct track_name *shared;
+        LIST_FIELDS(struct track_item, items);
 };
 
 struct sd_bus_track {
@@ -40,12 +49,24 @@ struct sd_bus_track {
                  "arg0='", name, "'")
 
 static struct track_item* track_item_free(struct track_item *i) {
+        struct track_name *shared;
 
         if (!i)
                 return NULL;
 
-        sd_bus_slot_unref(i->slot);
-        free(i->name);
+        shared = i->shared;
+        if (shared) {
+                LIST_REMOVE(items, shared->items, i);
+
+                /* Drop the subscription once the last track object lost interest in the name */
+                if (!shared->items) {
+                        hashmap_remove(i->track->bus->track_names, shared->name);
+                        sd_bus_slot_unref(shared->slot);
+                        free(shared->name);
+                        free(shared);
+                }
+        }
+
         return mfree(i);
 }
 
@@ -162,25 +183,78 @@ static sd_bus_track *track_free(sd_bus_track *track) {
 DEFINE_PUBLIC_TRIVIAL_REF_UNREF_FUNC(sd_bus_track, sd_bus_track, track_free);
 
 static int on_name_owner_changed(sd_bus_message *message, void *userdata, sd_bus_error *error) {
-        sd_bus_track *track = userdata;
+        sd_bus *bus = sd_bus_message_get_bus(message);
+        struct track_name *shared;
         const char *name, *old, *new;
         int r;
 
         assert(message);
-        assert(track);
 
         r = sd_bus_message_read(message, "sss", &name, &old, &new);
         if (r < 0)
                 return 0;
 
-        bus_track_remove_name_fully(track, name);
+        /* Removing the last item frees the shared object, hence look it up again each time */
+        while ((shared = hashmap_get(bus->track_names, name)))
+                bus_track_remove_name_fully(shared->items->track, name);
+
         return 0;
 }
 
+static int track_name_subscribe(sd_bus *bus, const char *name, struct track_name **ret) {
+        struct track_name *shared;
+        const char *match;
+        int r;
+
+        assert(bus);
+        assert(name);
+        assert(ret);
+
+        shared = hashmap_get(bus->track_names, name);
+        if (shared) {
+                *ret = shared;
+                return 0;
+        }
+
+        r = hashmap_ensure_allocated(&bus->track_names, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        shared = new0(struct track_name, 1);
+        if (!shared)
+                return -ENOMEM;
+
+        shared->name = strdup(name);
+        if (!shared->name) {
+                free(shared);
+                return -ENOMEM;
+        }
+
+        match = MATCH_FOR_NAME(name);
+
+        r = sd_bus_add_match_async(bus, &shared->slot, match, on_name_owner_changed, NULL, NULL);
+        if (r < 0)
+                goto fail;
+
+        r = hashmap_put(bus->track_names, shared->name, shared);
+        if (r < 0)
+                goto fail;
+
+        *ret = shared;
+        return 1;
+
+fail:
+        sd_bus_slot_unref(shared->slot);
+        free(shared->name);
+        free(shared);
+        return r;
+}
+
 _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
         _cleanup_(track_item_freep) struct track_item *n = NULL;
+        struct track_name *shared;
         struct track_item *i;
-        const char *match;
+        bool subscribed;
         int r;
 
         assert_return(track, -EINVAL);
@@ -208,35 +282,40 @@ _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
         n = new0(struct track_item, 1);
         if (!n)
                 return -ENOMEM;
-        n->name = strdup(name);
-        if (!n->name)
-                return -ENOMEM;
-
-        /* First, subscribe to this name */
-        match = MATCH_FOR_NAME(name);
+        n->track = track;
 
+        /* First, subscribe to this name, unless some other track object on this connection did so already */
         bus_track_remove_from_queue(track); /* don't dispatch this while we work in it */
 
-        r = sd_bus_add_match_async(track->bus, &n->slot, match, on_name_owner_changed, NULL, track);
+        r = track_name_subscribe(track->bus, name, &shared);
         if (r < 0) {
                 bus_track_add_to_queue(track);
                 return r;
         }
 
-        r = hashmap_put(track->names, n->name, n);
+        subscribed = r > 0;
+
+        n->shared = shared;
+        LIST_PREPEND(items, shared->items, n);
+
+        r = hashmap_put(track->names, shared->name, n);
         if (r < 0) {
                 bus_track_add_to_queue(track);
                 return r;
         }
 
-        /* Second, check if it is currently existing, or maybe doesn't, or maybe disappeared already. */
-        track->n_adding++; /* again, make sure this isn't dispatch while we are working in it */
-        r = sd_bus_get_name_creds(track->bus, name, 0, NULL);
-        track->n_adding--;
-        if (r < 0) {
-                hashmap_remove(track->names, name);
-                bus_track_add_to_queue(track);
-                return r;
+        /* Second, check if it is currently existing, or maybe doesn't, or maybe disappeared already. If the
+         * subscription existed before, this was checked when it was created, and if the name went away since, the
+         * signal about it is still queued and will remove this item too. */
+        if (subscribed) {
+                track->n_adding++; /* again, make sure this isn't dispatch while we are working in it */
+                r = sd_bus_get_name_creds(track->bus, name, 0, NULL);
+                track->n_adding--;
+                if (r < 0) {
+                        hashmap_remove(track->names, name);
+                        bus_track_add_to_queue(track);
+                        return r;
+                }
         }
 
         n->n_ref = 1;
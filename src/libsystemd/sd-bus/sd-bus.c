@@ -164,11 +164,14 @@ static sd_bus* bus_free(sd_bus *b) {
         assert(b);
         assert(!b->track_queue);
         assert(!b->tracks);
+        assert(hashmap_isempty(b->track_names));
 
         b->state = BUS_CLOSED;
 
         sd_bus_detach_event(b);
 
+        hashmap_free(b->track_names);
+
         while ((s = b->slots)) {
                 /* At this point only floating slots can still be
                  * around, because the non-floating ones keep a
@@ -215,6 +218,9 @@ static sd_bus* bus_free(sd_bus *b) {
         hashmap_free_free(b->vtable_methods);
         hashmap_free_free(b->vtable_properties);
 
+        bus_property_cache_flush(b, NULL, NULL);
+        hashmap_free(b->property_cache);
+
         assert(hashmap_isempty(b->nodes));
         hashmap_free(b->nodes);
 
@@ -247,6 +253,7 @@ _public_ int sd_bus_new(sd_bus **ret) {
                 .original_pid = getpid_cached(),
                 .n_groups = (size_t) -1,
                 .close_on_exit = true,
+                .process_batch = 1,
         };
 
         assert_se(pthread_mutex_init(&b->memfd_cache_mutex, NULL) == 0);
@@ -1734,14 +1741,33 @@ static int bus_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
         return r;
 }
 
+static bool bus_can_pipeline(sd_bus *bus) {
+        assert(bus);
+
+        /* The D-Bus specification allows clients to send messages right after BEGIN, without waiting for the
+         * server's replies to the SASL exchange. Hence, as soon as we wrote all of it, start writing what is queued,
+         * so that the Hello() call (or the first method call on direct connections) doesn't cost an extra round
+         * trip. Messages with file descriptors have to wait, as we don't know yet whether the server agreed to
+         * passing them. */
+
+        return bus->state == BUS_AUTHENTICATING &&
+                !bus->is_server &&
+                !bus_socket_auth_needs_write(bus) &&
+                bus->wqueue_size > 0 &&
+                bus->wqueue[0]->n_fds == 0;
+}
+
 static int dispatch_wqueue(sd_bus *bus) {
         int r, ret = 0;
 
         assert(bus);
-        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
+        assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO) || bus_can_pipeline(bus));
 
         while (bus->wqueue_size > 0) {
 
+                if (bus->state == BUS_AUTHENTICATING && !bus_can_pipeline(bus))
+                        return ret;
+
                 r = bus_write_message(bus, bus->wqueue[0], &bus->windex);
                 if (r < 0)
                         return r;
@@ -2262,7 +2288,7 @@ _public_ int sd_bus_get_events(sd_bus *bus) {
                 break;
 
         case BUS_AUTHENTICATING:
-                if (bus_socket_auth_needs_write(bus))
+                if (bus_socket_auth_needs_write(bus) || bus_can_pipeline(bus))
                         flags |= POLLOUT;
 
                 flags |= POLLIN;
@@ -2851,6 +2877,25 @@ static int process_closing_reply_callback(sd_bus *bus, struct reply_callback *c)
         return bus_maybe_reply_error(m, r, &error_buffer);
 }
 
+static int process_authenticating(sd_bus *bus) {
+        int r, q;
+
+        assert(bus);
+
+        r = bus_socket_process_authenticating(bus);
+        if (r < 0)
+                return r;
+
+        if (!bus_can_pipeline(bus))
+                return r;
+
+        q = dispatch_wqueue(bus);
+        if (q < 0)
+                return q;
+
+        return r > 0 || q > 0;
+}
+
 static int process_closing(sd_bus *bus, sd_bus_message **ret) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         struct reply_callback *c;
@@ -2949,7 +2994,7 @@ static int bus_process_internal(sd_bus *bus, bool hint_priority, int64_t priorit
                 break;
 
         case BUS_AUTHENTICATING:
-                r = bus_socket_process_authenticating(bus);
+                r = process_authenticating(bus);
                 break;
 
         case BUS_RUNNING:
@@ -3324,35 +3369,54 @@ bool bus_pid_changed(sd_bus *bus) {
         return bus->original_pid != getpid_cached();
 }
 
-static int io_callback(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
-        sd_bus *bus = userdata;
+static void bus_process_batch(sd_bus *bus) {
+        _cleanup_(sd_bus_unrefp) sd_bus *ref = NULL;
+        unsigned i;
         int r;
 
         assert(bus);
 
-        /* Note that this is called both on input_fd, output_fd as well as inotify_fd events */
+        /* Dispatch up to the configured number of messages in one go, so that a burst does not cost an event
+         * loop iteration per message. We stop as soon as there's nothing left to do. Handlers might drop the
+         * last reference to the bus (for example when handling Disconnected), hence keep one ourselves while
+         * we are looping. */
 
-        r = sd_bus_process(bus, NULL);
-        if (r < 0) {
-                log_debug_errno(r, "Processing of bus failed, closing down: %m");
-                bus_enter_closing(bus);
+        ref = sd_bus_ref(bus);
+
+        for (i = 0; i < bus->process_batch; i++) {
+                r = sd_bus_process(bus, NULL);
+                if (r < 0) {
+                        log_debug_errno(r, "Processing of bus failed, closing down: %m");
+                        bus_enter_closing(bus);
+                        break;
+                }
+                if (r == 0)
+                        break;
+
+                /* Once the connection is going down, process the rest of it in later iterations, one step at a
+                 * time, as before */
+                if (IN_SET(bus->state, BUS_CLOSING, BUS_CLOSED))
+                        break;
         }
+}
+
+static int io_callback(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        sd_bus *bus = userdata;
 
+        assert(bus);
+
+        /* Note that this is called both on input_fd, output_fd as well as inotify_fd events */
+
+        bus_process_batch(bus);
         return 1;
 }
 
 static int time_callback(sd_event_source *s, uint64_t usec, void *userdata) {
         sd_bus *bus = userdata;
-        int r;
 
         assert(bus);
 
-        r = sd_bus_process(bus, NULL);
-        if (r < 0) {
-                log_debug_errno(r, "Processing of bus failed, closing down: %m");
-                bus_enter_closing(bus);
-        }
-
+        bus_process_batch(bus);
         return 1;
 }
 
@@ -4156,3 +4220,23 @@ _public_ int sd_bus_get_close_on_exit(sd_bus *bus) {
 
         return bus->close_on_exit;
 }
+
+_public_ int sd_bus_set_process_batch(sd_bus *bus, unsigned n) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(n > 0, -EINVAL);
+        assert_return(!bus_pid_changed(bus), -ECHILD);
+
+        bus->process_batch = n;
+        return 0;
+}
+
+_public_ int sd_bus_get_process_batch(sd_bus *bus, unsigned *ret) {
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(ret, -EINVAL);
+        assert_return(!bus_pid_changed(bus), -ECHILD);
+
+        *ret = bus->process_batch;
+        return 0;
+}
@@ -10,11 +10,18 @@
 #include "bus-util.h"
 #include "def.h"
 #include "fd-util.h"
+#include "stdio-util.h"
 #include "time-util.h"
 #include "util.h"
 
 #define MAX_SIZE (2*1024*1024)
 
+/* Sizes of the workloads modelled after what PID1 sees */
+#define N_UNITS 10000U
+#define N_MATCHES 1000U
+#define N_SIGNALS 1000U
+#define N_SAMPLES_MAX 100000U
+
 static usec_t arg_loop_usec = 100 * USEC_PER_MSEC;
 
 typedef enum Type {
@@ -22,6 +29,100 @@ typedef enum Type {
         TYPE_DIRECT,
 } Type;
 
+typedef struct Properties {
+        uint32_t u;
+        uint64_t t;
+        int b;
+        const char *s;
+} Properties;
+
+static Properties properties = {
+        .u = 4711,
+        .t = UINT64_C(1234567890),
+        .b = true,
+        .s = "/usr/lib/systemd/systemd-benchmark --with-some-arguments",
+};
+
+static int property_get_strv(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        return sd_bus_message_append(reply, "as", 4, "foo.service", "bar.service", "baz.socket", "waldo.target");
+}
+
+static const sd_bus_vtable properties_vtable[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_PROPERTY("Id", "s", NULL, offsetof(Properties, s), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("Description", "s", NULL, offsetof(Properties, s), 0),
+        SD_BUS_PROPERTY("LoadState", "s", NULL, offsetof(Properties, s), 0),
+        SD_BUS_PROPERTY("ActiveState", "s", NULL, offsetof(Properties, s), 0),
+        SD_BUS_PROPERTY("SubState", "s", NULL, offsetof(Properties, s), 0),
+        SD_BUS_PROPERTY("FragmentPath", "s", NULL, offsetof(Properties, s), 0),
+        SD_BUS_PROPERTY("Requires", "as", property_get_strv, 0, 0),
+        SD_BUS_PROPERTY("Wants", "as", property_get_strv, 0, 0),
+        SD_BUS_PROPERTY("After", "as", property_get_strv, 0, 0),
+        SD_BUS_PROPERTY("Before", "as", property_get_strv, 0, 0),
+        SD_BUS_PROPERTY("NRestarts", "u", NULL, offsetof(Properties, u), 0),
+        SD_BUS_PROPERTY("MainPID", "u", NULL, offsetof(Properties, u), 0),
+        SD_BUS_PROPERTY("ControlPID", "u", NULL, offsetof(Properties, u), 0),
+        SD_BUS_PROPERTY("MemoryCurrent", "t", NULL, offsetof(Properties, t), 0),
+        SD_BUS_PROPERTY("CPUUsageNSec", "t", NULL, offsetof(Properties, t), 0),
+        SD_BUS_PROPERTY("TasksCurrent", "t", NULL, offsetof(Properties, t), 0),
+        SD_BUS_PROPERTY("ActiveEnterTimestamp", "t", NULL, offsetof(Properties, t), 0),
+        SD_BUS_PROPERTY("InactiveExitTimestamp", "t", NULL, offsetof(Properties, t), 0),
+        SD_BUS_PROPERTY("CanStart", "b", NULL, offsetof(Properties, b), 0),
+        SD_BUS_PROPERTY("CanStop", "b", NULL, offsetof(Properties, b), 0),
+        SD_BUS_PROPERTY("ExecStart", "s", NULL, offsetof(Properties, s), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("ExecReload", "s", NULL, offsetof(Properties, s), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("CachedExecStart", "s", NULL, offsetof(Properties, s), SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_CACHEABLE),
+        SD_BUS_PROPERTY("CachedRequires", "as", property_get_strv, 0, SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_CACHEABLE),
+        SD_BUS_VTABLE_END
+};
+
+static int reply_list_units(sd_bus_message *m) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        unsigned i;
+
+        assert_se(sd_bus_message_new_method_return(m, &reply) >= 0);
+        assert_se(sd_bus_message_open_container(reply, 'a', "(ssssssouso)") >= 0);
+
+        for (i = 0; i < N_UNITS; i++) {
+                char name[STRLEN("benchmark-") + DECIMAL_STR_MAX(unsigned) + STRLEN(".service")];
+                char path[STRLEN("/org/freedesktop/systemd1/unit/benchmark_2d") + DECIMAL_STR_MAX(unsigned) + STRLEN("_2eservice")];
+
+                xsprintf(name, "benchmark-%u.service", i);
+                xsprintf(path, "/org/freedesktop/systemd1/unit/benchmark_2d%u_2eservice", i);
+
+                assert_se(sd_bus_message_append(
+                                          reply, "(ssssssouso)",
+                                          name, "Benchmark unit", "loaded", "active", "running", "",
+                                          path, (uint32_t) 0, "", "/") >= 0);
+        }
+
+        assert_se(sd_bus_message_close_container(reply) >= 0);
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
+static int emit_signals(sd_bus *b, uint32_t n) {
+        uint32_t i;
+
+        for (i = 0; i < n; i++) {
+                char arg[STRLEN("unit") + DECIMAL_STR_MAX(uint32_t)];
+
+                xsprintf(arg, "unit%" PRIu32, i % N_MATCHES);
+
+                assert_se(sd_bus_emit_signal(b, "/", "benchmark.server", "Changed", "s", arg) >= 0);
+        }
+
+        return 0;
+}
+
 static void server(sd_bus *b, size_t *result) {
         int r;
 
@@ -47,6 +148,15 @@ static void server(sd_bus *b, size_t *result) {
 
                         r = sd_bus_reply_method_return(m, NULL);
                         assert_se(r >= 0);
+                } else if (sd_bus_message_is_method_call(m, "benchmark.server", "ListUnits"))
+                        assert_se(reply_list_units(m) >= 0);
+                else if (sd_bus_message_is_method_call(m, "benchmark.server", "EmitSignals")) {
+                        uint32_t n;
+
+                        assert_se(sd_bus_message_read(m, "u", &n) > 0);
+                        assert_se(emit_signals(b, n) >= 0);
+                        assert_se(sd_bus_reply_method_return(m, NULL) >= 0);
+
                 } else if (sd_bus_message_is_method_call(m, "benchmark.server", "Exit")) {
                         uint64_t res;
                         assert_se(sd_bus_message_read(m, "t", &res) > 0);
@@ -204,10 +314,170 @@ static void client_chart(Type type, const char *address, const char *server_name
         sd_bus_unref(b);
 }
 
+static int usec_compare(const usec_t *a, const usec_t *b) {
+        return CMP(*a, *b);
+}
+
+static void print_rate(const char *name, unsigned n, usec_t elapsed) {
+        printf("%s\t%" PRIu64 " ops/s\n", name, elapsed > 0 ? (uint64_t) n * USEC_PER_SEC / elapsed : 0);
+}
+
+static void workload_latency(sd_bus *b, const char *server_name) {
+        _cleanup_free_ usec_t *samples = NULL;
+        size_t n = 0;
+        usec_t t;
+
+        samples = new(usec_t, N_SAMPLES_MAX);
+        assert_se(samples);
+
+        t = now(CLOCK_MONOTONIC);
+        while (n < N_SAMPLES_MAX) {
+                usec_t k;
+
+                k = now(CLOCK_MONOTONIC);
+                assert_se(sd_bus_call_method(b, server_name, "/", "benchmark.server", "Ping", NULL, NULL, NULL) >= 0);
+                samples[n++] = now(CLOCK_MONOTONIC) - k;
+
+                if (k >= t + arg_loop_usec)
+                        break;
+        }
+
+        typesafe_qsort(samples, n, usec_compare);
+
+        printf("PING\tp50 " USEC_FMT "us\tp90 " USEC_FMT "us\tp99 " USEC_FMT "us\tmax " USEC_FMT "us\n",
+               samples[n * 50 / 100], samples[n * 90 / 100], samples[n * 99 / 100], samples[n - 1]);
+}
+
+static int match_handler(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        unsigned *n_matched = userdata;
+
+        (*n_matched)++;
+        return 0;
+}
+
+static void workload_signals(sd_bus *b, const char *server_name) {
+        unsigned i, n, n_matched = 0;
+        usec_t t;
+        int r;
+
+        /* N matches that differ only in arg0, each signal matches exactly one of them */
+        for (i = 0; i < N_MATCHES; i++) {
+                char match[STRLEN("type='signal',interface='benchmark.server',member='Changed',arg0='unit'") + DECIMAL_STR_MAX(unsigned)];
+
+                xsprintf(match, "type='signal',interface='benchmark.server',member='Changed',arg0='unit%u'", i);
+                assert_se(sd_bus_add_match(b, NULL, match, match_handler, &n_matched) >= 0);
+        }
+
+        t = now(CLOCK_MONOTONIC);
+        for (n = 0;; n++) {
+                assert_se(sd_bus_call_method(b, server_name, "/", "benchmark.server", "EmitSignals", NULL, NULL, "u", N_SIGNALS) >= 0);
+
+                /* The signals arrived before the reply, and are queued now */
+                do {
+                        r = sd_bus_process(b, NULL);
+                        assert_se(r >= 0);
+                } while (r > 0);
+
+                if (now(CLOCK_MONOTONIC) >= t + arg_loop_usec)
+                        break;
+        }
+
+        assert_se(n_matched == (n + 1) * N_SIGNALS);
+        print_rate("SIGNALS", (n + 1) * N_SIGNALS, now(CLOCK_MONOTONIC) - t);
+}
+
+static void workload_get_all(sd_bus *b, const char *server_name) {
+        unsigned n;
+        usec_t t;
+
+        t = now(CLOCK_MONOTONIC);
+        for (n = 0;; n++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+
+                assert_se(sd_bus_call_method(b, server_name, "/bench", "org.freedesktop.DBus.Properties", "GetAll", NULL, &reply, "s", "benchmark.Properties") >= 0);
+
+                if (now(CLOCK_MONOTONIC) >= t + arg_loop_usec)
+                        break;
+        }
+
+        print_rate("GETALL", n + 1, now(CLOCK_MONOTONIC) - t);
+}
+
+static void read_list_units(sd_bus_message *reply) {
+        const char *id, *description, *load_state, *active_state, *sub_state, *following, *unit_path, *job_type, *job_path;
+        unsigned n = 0;
+        uint32_t job_id;
+        int r;
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "(ssssssouso)") > 0);
+
+        while ((r = sd_bus_message_read(reply, "(ssssssouso)", &id, &description, &load_state, &active_state,
+                                        &sub_state, &following, &unit_path, &job_id, &job_type, &job_path)) > 0)
+                n++;
+        assert_se(r == 0);
+        assert_se(n == N_UNITS);
+
+        assert_se(sd_bus_message_exit_container(reply) > 0);
+}
+
+static void workload_list_units(sd_bus *b, const char *server_name) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *last = NULL;
+        unsigned n;
+        usec_t t;
+
+        t = now(CLOCK_MONOTONIC);
+        for (n = 0;; n++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+
+                assert_se(sd_bus_call_method(b, server_name, "/", "benchmark.server", "ListUnits", NULL, &reply, NULL) >= 0);
+                read_list_units(reply);
+
+                if (now(CLOCK_MONOTONIC) >= t + arg_loop_usec) {
+                        last = TAKE_PTR(reply);
+                        break;
+                }
+        }
+
+        print_rate("LISTUNITS", n + 1, now(CLOCK_MONOTONIC) - t);
+
+        /* Now measure only the parsing, on the last reply we got */
+        t = now(CLOCK_MONOTONIC);
+        for (n = 0;; n++) {
+                assert_se(sd_bus_message_rewind(last, true) >= 0);
+                read_list_units(last);
+
+                if (now(CLOCK_MONOTONIC) >= t + arg_loop_usec)
+                        break;
+        }
+
+        print_rate("PARSE", (n + 1) * N_UNITS, now(CLOCK_MONOTONIC) - t);
+}
+
+static void client_workload(int fd) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *x = NULL;
+        sd_bus *b;
+
+        assert_se(sd_bus_new(&b) >= 0);
+        assert_se(sd_bus_set_fd(b, fd, fd) >= 0);
+        assert_se(sd_bus_start(b) >= 0);
+
+        workload_latency(b, NULL);
+        workload_signals(b, NULL);
+        workload_get_all(b, NULL);
+        workload_list_units(b, NULL);
+
+        assert_se(sd_bus_message_new_method_call(b, &x, NULL, "/", "benchmark.server", "Exit") >= 0);
+        assert_se(sd_bus_message_append(x, "t", (uint64_t) 0) >= 0);
+        assert_se(sd_bus_send(b, x, NULL) >= 0);
+
+        sd_bus_unref(b);
+}
+
 int main(int argc, char *argv[]) {
         enum {
                 MODE_BISECT,
                 MODE_CHART,
+                MODE_WORKLOAD,
         } mode = MODE_BISECT;
         Type type = TYPE_LEGACY;
         int i, pair[2] = { -1, -1 };
@@ -224,6 +494,11 @@ int main(int argc, char *argv[]) {
                 if (streq(argv[i], "chart")) {
                         mode = MODE_CHART;
                         continue;
+                } else if (streq(argv[i], "workload")) {
+                        /* PID1-like workloads, always on a direct connection */
+                        mode = MODE_WORKLOAD;
+                        type = TYPE_DIRECT;
+                        continue;
                 } else if (streq(argv[i], "legacy")) {
                         type = TYPE_LEGACY;
                         continue;
@@ -269,6 +544,9 @@ int main(int argc, char *argv[]) {
         r = sd_bus_start(b);
         assert_se(r >= 0);
 
+        r = sd_bus_add_object_vtable(b, NULL, "/bench", "benchmark.Properties", properties_vtable, &properties);
+        assert_se(r >= 0);
+
         if (type != TYPE_DIRECT) {
                 r = sd_bus_get_unique_name(b, &unique);
                 assert_se(r >= 0);
@@ -299,6 +577,10 @@ int main(int argc, char *argv[]) {
                 case MODE_CHART:
                         client_chart(type, address, server_name, pair[1]);
                         break;
+
+                case MODE_WORKLOAD:
+                        client_workload(pair[1]);
+                        break;
                 }
 
                 _exit(EXIT_SUCCESS);
@@ -104,6 +104,54 @@ static void test_bus_label_escape(void) {
         test_bus_label_escape_one(":1", "_3a1");
 }
 
+static void count_destroy(void *userdata) {
+        unsigned *n = userdata;
+
+        (*n)++;
+}
+
+static void test_bus_append_ref(sd_bus *bus) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        _cleanup_free_ char *big = NULL;
+        const char *x, *y;
+        const uint64_t *v;
+        uint64_t array[128];
+        unsigned i, n = 0;
+        void *buffer;
+        size_t sz;
+
+        assert_se(big = malloc(4096));
+        memset(big, 'x', 4095);
+        big[4095] = 0;
+
+        for (i = 0; i < ELEMENTSOF(array); i++)
+                array[i] = i;
+
+        assert_se(sd_bus_message_new_method_call(bus, &m, "foobar.waldo", "/", "foobar.waldo", "Piep") >= 0);
+        assert_se(sd_bus_message_append(m, "y", 7) >= 0);
+        assert_se(sd_bus_message_append_string_ref(m, big, count_destroy, &n) >= 0);
+        assert_se(sd_bus_message_append_string_ref(m, "small", count_destroy, &n) >= 0);
+        assert_se(sd_bus_message_append_array_ref(m, 't', array, sizeof(array), count_destroy, &n) >= 0);
+
+        /* The small string is copied right away, and hence released immediately */
+        assert_se(n == 1);
+
+        assert_se(sd_bus_message_seal(m, 4712, 0) >= 0);
+        assert_se(bus_message_get_blob(m, &buffer, &sz) >= 0);
+
+        m = sd_bus_message_unref(m);
+        assert_se(n == 3);
+
+        assert_se(bus_message_from_malloc(bus, buffer, sz, NULL, 0, NULL, &m) >= 0);
+        assert_se(sd_bus_message_skip(m, "y") >= 0);
+        assert_se(sd_bus_message_read(m, "ss", &x, &y) > 0);
+        assert_se(streq(x, big));
+        assert_se(streq(y, "small"));
+        assert_se(sd_bus_message_read_array(m, 't', (const void**) &v, &sz) > 0);
+        assert_se(sz == sizeof(array));
+        assert_se(memcmp(v, array, sz) == 0);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *copy = NULL;
         int r, boolean;
@@ -411,6 +459,8 @@ int main(int argc, char *argv[]) {
         assert_se(streq(c, "ccc"));
         assert_se(streq(d, "3"));
 
+        test_bus_append_ref(bus);
+
         test_bus_label_escape();
         test_bus_path_encode();
         test_bus_path_encode_unique();
@@ -21,6 +21,7 @@ struct context {
         char *something;
         char *automatic_string_property;
         uint32_t automatic_integer_property;
+        unsigned n_cached_calls;
 };
 
 static int something_handler(sd_bus_message *m, void *userdata, sd_bus_error *error) {
@@ -177,6 +178,27 @@ static int emit_object_removed(sd_bus_message *m, void *userdata, sd_bus_error *
         return 1;
 }
 
+static int cached_handler(sd_bus *bus, const char *path, const char *interface, const char *property, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
+        struct context *c = userdata;
+
+        c->n_cached_calls++;
+        log_info("property get for %s called, returning %u.", property, c->n_cached_calls);
+
+        return sd_bus_message_append(reply, "u", c->n_cached_calls);
+}
+
+static int count_handler(sd_bus *bus, const char *path, const char *interface, const char *property, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
+        struct context *c = userdata;
+
+        return sd_bus_message_append(reply, "u", c->n_cached_calls);
+}
+
+static int invalidate_handler(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        assert_se(sd_bus_invalidate_property_cache(sd_bus_message_get_bus(m), m->path, NULL) >= 0);
+
+        return sd_bus_reply_method_return(m, NULL);
+}
+
 static const sd_bus_vtable vtable[] = {
         SD_BUS_VTABLE_START(0),
         SD_BUS_METHOD("AlterSomething", "s", "s", something_handler, 0),
@@ -204,6 +226,15 @@ static const sd_bus_vtable vtable2[] = {
         SD_BUS_VTABLE_END
 };
 
+static const sd_bus_vtable vtable3[] = {
+        SD_BUS_VTABLE_START(0),
+        SD_BUS_METHOD("Invalidate", NULL, NULL, invalidate_handler, 0),
+        SD_BUS_PROPERTY("Cached", "u", cached_handler, 0, SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_CACHEABLE),
+        SD_BUS_PROPERTY("Count", "u", count_handler, 0, 0),
+        SD_BUS_PROPERTY("CachedString", "s", NULL, offsetof(struct context, automatic_string_property), SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_CACHEABLE),
+        SD_BUS_VTABLE_END
+};
+
 static int enumerator_callback(sd_bus *bus, const char *path, void *userdata, char ***nodes, sd_bus_error *error) {
 
         if (object_path_startswith("/value", path))
@@ -237,6 +268,7 @@ static void *server(void *p) {
         assert_se(sd_bus_add_object_vtable(bus, NULL, "/foo", "org.freedesktop.systemd.test", vtable, c) >= 0);
         assert_se(sd_bus_add_object_vtable(bus, NULL, "/foo", "org.freedesktop.systemd.test2", vtable, c) >= 0);
         assert_se(sd_bus_add_fallback_vtable(bus, NULL, "/value", "org.freedesktop.systemd.ValueTest", vtable2, NULL, UINT_TO_PTR(20)) >= 0);
+        assert_se(sd_bus_add_object_vtable(bus, NULL, "/cache", "org.freedesktop.systemd.CacheTest", vtable3, c) >= 0);
         assert_se(sd_bus_add_node_enumerator(bus, NULL, "/value", enumerator_callback, NULL) >= 0);
         assert_se(sd_bus_add_node_enumerator(bus, NULL, "/value/a", enumerator2_callback, NULL) >= 0);
         assert_se(sd_bus_add_object_manager(bus, NULL, "/value") >= 0);
@@ -277,6 +309,45 @@ fail:
         return INT_TO_PTR(r);
 }
 
+static void check_cached_properties(sd_bus *bus, uint32_t cached, uint32_t count) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        unsigned found = 0;
+        const char *name;
+        int r;
+
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cache", "org.freedesktop.DBus.Properties", "GetAll", &error, &reply, "s", "org.freedesktop.systemd.CacheTest");
+        assert_se(r >= 0);
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "{sv}") > 0);
+
+        while ((r = sd_bus_message_enter_container(reply, 'e', "sv")) > 0) {
+                const char *s;
+                uint32_t u;
+
+                assert_se(sd_bus_message_read(reply, "s", &name) > 0);
+
+                if (streq(name, "Cached")) {
+                        assert_se(sd_bus_message_read(reply, "v", "u", &u) > 0);
+                        assert_se(u == cached);
+                } else if (streq(name, "Count")) {
+                        assert_se(sd_bus_message_read(reply, "v", "u", &u) > 0);
+                        assert_se(u == count);
+                } else {
+                        assert_se(streq(name, "CachedString"));
+                        assert_se(sd_bus_message_read(reply, "v", "s", &s) > 0);
+                        assert_se(streq(s, "dudeldu"));
+                }
+
+                found++;
+                assert_se(sd_bus_message_exit_container(reply) > 0);
+        }
+        assert_se(r == 0);
+        assert_se(found == 3);
+
+        assert_se(sd_bus_message_exit_container(reply) > 0);
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
@@ -494,6 +565,16 @@ static int client(struct context *c) {
         sd_bus_message_unref(reply);
         reply = NULL;
 
+        /* The getter of a cacheable property is only called once, until the cache is invalidated */
+        check_cached_properties(bus, 1, 1);
+        check_cached_properties(bus, 1, 1);
+
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cache", "org.freedesktop.systemd.CacheTest", "Invalidate", &error, NULL, NULL);
+        assert_se(r >= 0);
+
+        check_cached_properties(bus, 2, 2);
+        check_cached_properties(bus, 2, 2);
+
         r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/foo", "org.freedesktop.systemd.test", "Exit", &error, NULL, "");
         assert_se(r >= 0);
 
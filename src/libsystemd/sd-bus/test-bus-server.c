@@ -1,12 +1,17 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 #include "sd-bus.h"
+#include "sd-event.h"
 
 #include "bus-internal.h"
 #include "bus-util.h"
+#include "fd-util.h"
 #include "log.h"
 #include "macro.h"
 #include "util.h"
@@ -170,6 +175,126 @@ static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_f
         return 0;
 }
 
+#define N_BATCH_MESSAGES 2000U
+
+static void test_batched_read(void) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *a = NULL, *b = NULL;
+        _cleanup_close_ int null_fd = -1;
+        int pair[2];
+        sd_id128_t id;
+        unsigned i, n = 0;
+
+        /* Sends a burst of signals, every tenth of them with an fd attached, so that the receiving side reads
+         * many of them at once and needs to hand out the fds to the right messages */
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(sd_id128_randomize(&id) >= 0);
+        assert_se((null_fd = open("/dev/null", O_RDONLY|O_CLOEXEC)) >= 0);
+
+        assert_se(sd_bus_new(&a) >= 0);
+        assert_se(sd_bus_set_fd(a, pair[0], pair[0]) >= 0);
+        assert_se(sd_bus_set_server(a, 1, id) >= 0);
+        assert_se(sd_bus_start(a) >= 0);
+
+        assert_se(sd_bus_new(&b) >= 0);
+        assert_se(sd_bus_set_fd(b, pair[1], pair[1]) >= 0);
+        assert_se(sd_bus_start(b) >= 0);
+
+        /* Sending fds requires the authentication to be complete, and both ends are served from this
+         * thread, hence finish it before queuing anything */
+        while (sd_bus_is_ready(b) <= 0) {
+                int r, q;
+
+                q = sd_bus_process(b, NULL);
+                assert_se(q >= 0);
+
+                r = sd_bus_process(a, NULL);
+                assert_se(r >= 0);
+
+                if (r == 0 && q == 0)
+                        assert_se(sd_bus_wait(a, USEC_PER_SEC) >= 0);
+        }
+
+        for (i = 0; i < N_BATCH_MESSAGES; i++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                assert_se(sd_bus_message_new_signal(b, &m, "/foo", "foo.bar", "Test") >= 0);
+                assert_se(sd_bus_message_append(m, "u", i) >= 0);
+                if (i % 10 == 0)
+                        assert_se(sd_bus_message_append(m, "h", null_fd) >= 0);
+                assert_se(sd_bus_send(b, m, NULL) >= 0);
+        }
+
+        while (n < N_BATCH_MESSAGES) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+                int r, q;
+                uint32_t u;
+
+                q = sd_bus_process(b, NULL);
+                assert_se(q >= 0);
+
+                r = sd_bus_process(a, &m);
+                assert_se(r >= 0);
+
+                if (r == 0 && q == 0) {
+                        assert_se(sd_bus_wait(a, USEC_PER_SEC) >= 0);
+                        continue;
+                }
+
+                if (!m)
+                        continue;
+
+                assert_se(sd_bus_message_is_signal(m, "foo.bar", "Test"));
+                assert_se(sd_bus_message_read(m, "u", &u) > 0);
+                assert_se(u == n);
+
+                if (n % 10 == 0) {
+                        struct stat st;
+                        int fd;
+
+                        assert_se(sd_bus_message_read(m, "h", &fd) > 0);
+                        assert_se(fstat(fd, &st) >= 0);
+                        assert_se(S_ISCHR(st.st_mode));
+                } else
+                        assert_se(sd_bus_message_at_end(m, true) > 0);
+
+                n++;
+        }
+}
+
+static int on_disconnected(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        sd_bus **bus = userdata;
+
+        /* Drop the last reference from within the handler, like PID 1 does for its API bus */
+        *bus = sd_bus_unref(*bus);
+
+        return 0;
+}
+
+static void test_batch_disconnect(void) {
+        _cleanup_(sd_event_unrefp) sd_event *e = NULL;
+        sd_bus *bus = NULL;
+        int pair[2];
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(sd_event_new(&e) >= 0);
+
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_fd(bus, pair[0], pair[0]) >= 0);
+        assert_se(sd_bus_set_process_batch(bus, 16) >= 0);
+        assert_se(sd_bus_start(bus) >= 0);
+        assert_se(sd_bus_match_signal(bus, NULL,
+                                      "org.freedesktop.DBus.Local", "/org/freedesktop/DBus/Local",
+                                      "org.freedesktop.DBus.Local", "Disconnected",
+                                      on_disconnected, &bus) >= 0);
+        assert_se(sd_bus_attach_event(bus, e, 0) >= 0);
+
+        safe_close(pair[1]);
+
+        while (bus)
+                assert_se(sd_event_run(e, USEC_PER_SEC) >= 0);
+}
+
 int main(int argc, char *argv[]) {
         int r;
 
@@ -194,5 +319,8 @@ int main(int argc, char *argv[]) {
         r = test_one(true, true, true, false);
         assert_se(r == -EPERM);
 
+        test_batched_read();
+        test_batch_disconnect();
+
         return EXIT_SUCCESS;
 }
@@ -43,7 +43,7 @@ static int track_cb_y(sd_bus_track *t, void *userdata) {
 
 int main(int argc, char *argv[]) {
         _cleanup_(sd_event_unrefp) sd_event *event = NULL;
-        _cleanup_(sd_bus_track_unrefp) sd_bus_track *x = NULL, *y = NULL;
+        _cleanup_(sd_bus_track_unrefp) sd_bus_track *x = NULL, *y = NULL, *z = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *a = NULL, *b = NULL;
         bool use_system_bus = false;
         const char *unique;
@@ -85,6 +85,14 @@ int main(int argc, char *argv[]) {
         r = sd_bus_track_add_name(x, unique);
         assert_se(r >= 0);
 
+        /* Watch b's name from a a second time, through the same subscription */
+        r = sd_bus_track_new(a, &z, NULL, NULL);
+        assert_se(r >= 0);
+
+        r = sd_bus_track_add_name(z, unique);
+        assert_se(r >= 0);
+        assert_se(sd_bus_track_count(z) == 1);
+
         /* Watch's a's own name from a */
         r = sd_bus_track_new(a, &y, track_cb_y, NULL);
         assert_se(r >= 0);
@@ -103,6 +111,7 @@ int main(int argc, char *argv[]) {
 
         assert_se(track_cb_called_x);
         assert_se(track_cb_called_y);
+        assert_se(sd_bus_track_count(z) == 0);
 
         return 0;
 }
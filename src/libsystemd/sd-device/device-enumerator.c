@@ -458,7 +458,7 @@ static int enumerator_scan_dir_and_add_devices(sd_device_enumerator *enumerator,
         FOREACH_DIRENT_ALL(dent, dir, return -errno) {
                 _cleanup_(sd_device_unrefp) sd_device *device = NULL;
                 char syspath[strlen(path) + 1 + strlen(dent->d_name) + 1];
-                int initialized, k;
+                int k;
 
                 if (dent->d_name[0] == '.')
                         continue;
@@ -477,12 +477,6 @@ static int enumerator_scan_dir_and_add_devices(sd_device_enumerator *enumerator,
                         continue;
                 }
 
-                initialized = sd_device_get_is_initialized(device);
-                if (initialized < 0) {
-                        r = initialized;
-                        continue;
-                }
-
                 /*
                  * All devices with a device node or network interfaces
                  * possibly need udev to adjust the device node permission
@@ -492,12 +486,25 @@ static int enumerator_scan_dir_and_add_devices(sd_device_enumerator *enumerator,
                  * For now, we can only check these types of devices, we
                  * might not store a database, and have no way to find out
                  * for all other types of devices.
+                 *
+                 * Checking this means reading the udev database entry of
+                 * each device, hence skip it if we take uninitialized
+                 * devices anyway.
                  */
-                if (!enumerator->match_allow_uninitialized &&
-                    !initialized &&
-                    (sd_device_get_devnum(device, NULL) >= 0 ||
-                     sd_device_get_ifindex(device, NULL) >= 0))
-                        continue;
+                if (!enumerator->match_allow_uninitialized) {
+                        int initialized;
+
+                        initialized = sd_device_get_is_initialized(device);
+                        if (initialized < 0) {
+                                r = initialized;
+                                continue;
+                        }
+
+                        if (!initialized &&
+                            (sd_device_get_devnum(device, NULL) >= 0 ||
+                             sd_device_get_ifindex(device, NULL) >= 0))
+                                continue;
+                }
 
                 if (!match_parent(enumerator, device))
                         continue;
@@ -1281,21 +1281,10 @@ int device_get_id_filename(sd_device *device, const char **ret) {
 
 int device_read_db_aux(sd_device *device, bool force) {
         _cleanup_free_ char *db = NULL;
-        char *path;
-        const char *id, *value;
-        char key;
-        size_t db_len;
-        unsigned i;
+        char *path, *p;
+        const char *id;
         int r;
 
-        enum {
-                PRE_KEY,
-                KEY,
-                PRE_VALUE,
-                VALUE,
-                INVALID_LINE,
-        } state = PRE_KEY;
-
         if (device->db_loaded || (!force && device->sealed))
                 return 0;
 
@@ -1307,7 +1296,7 @@ int device_read_db_aux(sd_device *device, bool force) {
 
         path = strjoina("/run/udev/data/", id);
 
-        r = read_full_file(path, &db, &db_len);
+        r = read_full_file(path, &db, NULL);
         if (r < 0) {
                 if (r == -ENOENT)
                         return 0;
@@ -1318,53 +1307,29 @@ int device_read_db_aux(sd_device *device, bool force) {
         /* devices with a database entry are initialized */
         device->is_initialized = true;
 
-        for (i = 0; i < db_len; i++) {
-                switch (state) {
-                case PRE_KEY:
-                        if (!strchr(NEWLINE, db[i])) {
-                                key = db[i];
-
-                                state = KEY;
-                        }
-
-                        break;
-                case KEY:
-                        if (db[i] != ':') {
-                                log_device_debug(device, "sd-device: Invalid db entry with key '%c', ignoring", key);
-
-                                state = INVALID_LINE;
-                        } else {
-                                db[i] = '\0';
-
-                                state = PRE_VALUE;
-                        }
-
-                        break;
-                case PRE_VALUE:
-                        value = &db[i];
-
-                        state = VALUE;
+        /* The database is a list of "K:value" lines. This is read for every device looked up by most consumers,
+         * hence split it up line by line rather than looking at each byte individually. A trailing line
+         * without a newline is incomplete and ignored. */
+        for (p = db;;) {
+                char *eol;
 
-                        break;
-                case INVALID_LINE:
-                        if (strchr(NEWLINE, db[i]))
-                                state = PRE_KEY;
+                p += strspn(p, NEWLINE);
 
+                eol = strpbrk(p, NEWLINE);
+                if (!eol)
                         break;
-                case VALUE:
-                        if (strchr(NEWLINE, db[i])) {
-                                db[i] = '\0';
-                                r = handle_db_line(device, key, value);
-                                if (r < 0)
-                                        log_device_debug_errno(device, r, "sd-device: Failed to handle db entry '%c:%s', ignoring: %m", key, value);
 
-                                state = PRE_KEY;
-                        }
+                *eol = '\0';
 
-                        break;
-                default:
-                        assert_not_reached("Invalid state when parsing db");
+                if (p[0] == '\0' || p[1] != ':')
+                        log_device_debug(device, "sd-device: Invalid db entry with key '%c', ignoring", p[0]);
+                else {
+                        r = handle_db_line(device, p[0], p + 2);
+                        if (r < 0)
+                                log_device_debug_errno(device, r, "sd-device: Failed to handle db entry '%c:%s', ignoring: %m", p[0], p + 2);
                 }
+
+                p = eol + 1;
         }
 
         return 0;
@@ -1807,7 +1772,10 @@ _public_ int sd_device_get_sysattr_value(sd_device *device, const char *sysattr,
         if (r < 0)
                 return r;
 
-        *_value = TAKE_PTR(value);
+        /* The cache owns the string now */
+        if (_value)
+                *_value = value;
+        TAKE_PTR(value);
 
         return 0;
 }
@@ -2,6 +2,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/timerfd.h>
 #include <sys/wait.h>
 
@@ -69,6 +70,9 @@ struct sd_event_source {
 
         sd_event_destroy_t destroy_callback;
 
+        sd_event_source_stats stats;
+        usec_t pending_since;
+
         LIST_FIELDS(sd_event_source, sources);
 
         union {
@@ -96,6 +100,9 @@ struct sd_event_source {
                         siginfo_t siginfo;
                         pid_t pid;
                         int options;
+                        int pidfd;
+                        bool registered:1; /* pidfd is added to epoll */
+                        bool exited:1;     /* process was reaped, pidfd stays readable forever */
                 } child;
                 struct {
                         sd_event_handler_t callback;
@@ -112,6 +119,9 @@ struct sd_event_source {
                         uint32_t mask;
                         struct inode_data *inode_data;
                         LIST_FIELDS(sd_event_source, by_inode_data);
+                        bool coalesce:1;
+                        /* In coalescing mode: the masks of all events merged since the last dispatch */
+                        struct inotify_event coalesced;
                 } inotify;
         };
 };
@@ -1,8 +1,12 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/timerfd.h>
 #include <sys/wait.h>
+#if HAVE_PIDFD_OPEN
+#include <sys/pidfd.h>
+#endif
 
 #include "sd-daemon.h"
 #include "sd-event.h"
@@ -10,6 +14,7 @@
 
 #include "alloc-util.h"
 #include "event-source.h"
+#include "event-util.h"
 #include "fd-util.h"
 #include "fs-util.h"
 #include "hashmap.h"
@@ -20,6 +25,7 @@
 #include "process-util.h"
 #include "set.h"
 #include "signal-util.h"
+#include "stdio-util.h"
 #include "string-table.h"
 #include "string-util.h"
 #include "time-util.h"
@@ -27,6 +33,13 @@
 
 #define DEFAULT_ACCURACY_USEC (250 * USEC_PER_MSEC)
 
+/* Upper limit for the number of events collected with a single epoll_wait() call */
+#define EPOLL_QUEUE_MAX 4096U
+
+/* Child sources that only wait for the process to exit are watched through a pidfd in epoll, and dispatched
+ * individually as soon as it becomes readable. All others are found by process_child() after SIGCHLD. */
+#define EVENT_SOURCE_WATCH_PIDFD(s) ((s)->type == SOURCE_CHILD && (s)->child.pidfd >= 0)
+
 static const char* const event_source_type_table[_SOURCE_EVENT_SOURCE_TYPE_MAX] = {
         [SOURCE_IO] = "io",
         [SOURCE_TIME_REALTIME] = "realtime",
@@ -45,6 +58,15 @@ static const char* const event_source_type_table[_SOURCE_EVENT_SOURCE_TYPE_MAX]
 
 DEFINE_PRIVATE_STRING_TABLE_LOOKUP_TO_STRING(event_source_type, int);
 
+struct work_item {
+        sd_event_work_handler_t callback;
+        void *userdata;
+        struct work_item *next;
+};
+
+/* Marks the work queue as not accepting any work, because there's no event source dispatching it */
+#define WORK_QUEUE_DEAD ((struct work_item*) -1)
+
 #define EVENT_SOURCE_IS_TIME(t) IN_SET((t), SOURCE_TIME_REALTIME, SOURCE_TIME_BOOTTIME, SOURCE_TIME_MONOTONIC, SOURCE_TIME_REALTIME_ALARM, SOURCE_TIME_BOOTTIME_ALARM)
 
 struct sd_event {
@@ -109,6 +131,18 @@ struct sd_event {
 
         usec_t last_run, last_log;
         unsigned delays[sizeof(usec_t) * 8];
+
+        /* Work posted from other threads, as a lock-free stack (newest first), the eventfd that wakes us up
+         * when it turns non-empty, and the event source watching it. The stack is WORK_QUEUE_DEAD while there
+         * is no such source. The eventfd is kept until the event loop is freed, since other threads may still
+         * be about to write to it after the source went away. */
+        struct work_item *work_queue;
+        int work_fd;
+        sd_event_source *work_source;
+
+        /* Buffer epoll_wait() writes into, kept around between iterations */
+        struct epoll_event *event_queue;
+        size_t event_queue_allocated;
 };
 
 static thread_local sd_event *default_event = NULL;
@@ -257,6 +291,9 @@ static sd_event *event_free(sd_event *e) {
 
         safe_close(e->epoll_fd);
         safe_close(e->watchdog_fd);
+        assert(!e->work_source);
+        assert(e->work_queue == WORK_QUEUE_DEAD);
+        safe_close(e->work_fd);
 
         free_clock_data(&e->realtime);
         free_clock_data(&e->boottime);
@@ -276,6 +313,8 @@ static sd_event *event_free(sd_event *e) {
         hashmap_free(e->child_sources);
         set_free(e->post_sources);
 
+        free(e->event_queue);
+
         return mfree(e);
 }
 
@@ -293,6 +332,8 @@ _public_ int sd_event_new(sd_event** ret) {
                 .n_ref = 1,
                 .epoll_fd = -1,
                 .watchdog_fd = -1,
+                .work_fd = -1,
+                .work_queue = WORK_QUEUE_DEAD,
                 .realtime.wakeup = WAKEUP_CLOCK_DATA,
                 .realtime.fd = -1,
                 .realtime.next = USEC_INFINITY,
@@ -397,6 +438,51 @@ static int source_io_register(
         return 0;
 }
 
+static void source_child_pidfd_unregister(sd_event_source *s) {
+        int r;
+
+        assert(s);
+        assert(EVENT_SOURCE_WATCH_PIDFD(s));
+
+        if (event_pid_changed(s->event))
+                return;
+
+        if (!s->child.registered)
+                return;
+
+        r = epoll_ctl(s->event->epoll_fd, EPOLL_CTL_DEL, s->child.pidfd, NULL);
+        if (r < 0)
+                log_debug_errno(errno, "Failed to remove source %s (type %s) from epoll: %m",
+                                strna(s->description), event_source_type_to_string(s->type));
+
+        s->child.registered = false;
+}
+
+static int source_child_pidfd_register(sd_event_source *s) {
+        struct epoll_event ev;
+        int r;
+
+        assert(s);
+        assert(EVENT_SOURCE_WATCH_PIDFD(s));
+
+        /* Once reaped the pidfd is readable for good, don't busy loop on it */
+        if (s->child.registered || s->child.exited)
+                return 0;
+
+        ev = (struct epoll_event) {
+                .events = EPOLLIN,
+                .data.ptr = s,
+        };
+
+        r = epoll_ctl(s->event->epoll_fd, EPOLL_CTL_ADD, s->child.pidfd, &ev);
+        if (r < 0)
+                return -errno;
+
+        s->child.registered = true;
+
+        return 0;
+}
+
 static clockid_t event_source_type_to_clock(EventSourceType t) {
 
         switch (t) {
@@ -470,6 +556,27 @@ static struct clock_data* event_get_clock_data(sd_event *e, EventSourceType t) {
         }
 }
 
+static void event_source_time_prioq_reshuffle(sd_event_source *s) {
+        struct clock_data *d;
+
+        assert(s);
+        assert(EVENT_SOURCE_IS_TIME(s->type));
+
+        d = event_get_clock_data(s->event, s->type);
+        assert(d);
+
+        /* The timerfd is programmed from the heads of the two queues only. If the source neither was nor
+         * becomes the head of either, the wakeup time stays the same and there's no need to recalculate it. */
+        if (s->time.earliest_index == 0 || s->time.latest_index == 0)
+                d->needs_rearm = true;
+
+        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
+        prioq_reshuffle(d->latest, s, &s->time.latest_index);
+
+        if (s->time.earliest_index == 0 || s->time.latest_index == 0)
+                d->needs_rearm = true;
+}
+
 static int event_make_signal_data(
                 sd_event *e,
                 int sig,
@@ -642,6 +749,22 @@ static void event_gc_signal_data(sd_event *e, const int64_t *priority, int sig)
                 event_unmask_signal_data(e, d, sig);
 }
 
+static void work_queue_kill(sd_event *e) {
+        struct work_item *w;
+
+        assert(e);
+
+        /* Refuse any further work, and drop what was posted but not run yet, since nothing would run it */
+
+        w = __sync_lock_test_and_set(&e->work_queue, WORK_QUEUE_DEAD);
+        while (w && w != WORK_QUEUE_DEAD) {
+                struct work_item *next = w->next;
+
+                free(w);
+                w = next;
+        }
+}
+
 static void source_disconnect(sd_event_source *s) {
         sd_event *event;
 
@@ -658,6 +781,11 @@ static void source_disconnect(sd_event_source *s) {
                 if (s->io.fd >= 0)
                         source_io_unregister(s);
 
+                if (s == s->event->work_source) {
+                        s->event->work_source = NULL;
+                        work_queue_kill(s->event);
+                }
+
                 break;
 
         case SOURCE_TIME_REALTIME:
@@ -689,7 +817,9 @@ static void source_disconnect(sd_event_source *s) {
 
         case SOURCE_CHILD:
                 if (s->child.pid > 0) {
-                        if (s->enabled != SD_EVENT_OFF) {
+                        if (EVENT_SOURCE_WATCH_PIDFD(s))
+                                source_child_pidfd_unregister(s);
+                        else if (s->enabled != SD_EVENT_OFF) {
                                 assert(s->event->n_enabled_child_sources > 0);
                                 s->event->n_enabled_child_sources--;
                         }
@@ -698,6 +828,7 @@ static void source_disconnect(sd_event_source *s) {
                         event_gc_signal_data(s->event, &s->priority, SIGCHLD);
                 }
 
+                s->child.pidfd = safe_close(s->child.pidfd);
                 break;
 
         case SOURCE_DEFER:
@@ -724,7 +855,7 @@ static void source_disconnect(sd_event_source *s) {
                         LIST_REMOVE(inotify.by_inode_data, inode_data->event_sources, s);
                         s->inotify.inode_data = NULL;
 
-                        if (s->pending) {
+                        if (s->pending && !s->inotify.coalesce) {
                                 assert(inotify_data->n_pending > 0);
                                 inotify_data->n_pending--;
                         }
@@ -797,6 +928,7 @@ static int source_set_pending(sd_event_source *s, bool b) {
 
         if (b) {
                 s->pending_iteration = s->event->iteration;
+                s->pending_since = now(CLOCK_MONOTONIC);
 
                 r = prioq_put(s->event->pending, s, &s->pending_index);
                 if (r < 0) {
@@ -806,16 +938,8 @@ static int source_set_pending(sd_event_source *s, bool b) {
         } else
                 assert_se(prioq_remove(s->event->pending, s, &s->pending_index));
 
-        if (EVENT_SOURCE_IS_TIME(s->type)) {
-                struct clock_data *d;
-
-                d = event_get_clock_data(s->event, s->type);
-                assert(d);
-
-                prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                d->needs_rearm = true;
-        }
+        if (EVENT_SOURCE_IS_TIME(s->type))
+                event_source_time_prioq_reshuffle(s);
 
         if (s->type == SOURCE_SIGNAL && !b) {
                 struct signal_data *d;
@@ -825,7 +949,8 @@ static int source_set_pending(sd_event_source *s, bool b) {
                         d->current = NULL;
         }
 
-        if (s->type == SOURCE_INOTIFY) {
+        /* Coalescing inotify sources keep their own copy of the event, and don't hold up the buffer */
+        if (s->type == SOURCE_INOTIFY && !s->inotify.coalesce) {
 
                 assert(s->inotify.inode_data);
                 assert(s->inotify.inode_data->inotify_data);
@@ -1141,9 +1266,11 @@ _public_ int sd_event_add_child(
         if (!s)
                 return -ENOMEM;
 
+        s->wakeup = WAKEUP_EVENT_SOURCE;
         s->child.pid = pid;
         s->child.options = options;
         s->child.callback = callback;
+        s->child.pidfd = -1;
         s->userdata = userdata;
         s->enabled = SD_EVENT_ONESHOT;
 
@@ -1151,6 +1278,25 @@ _public_ int sd_event_add_child(
         if (r < 0)
                 return r;
 
+        if (options == WEXITED) {
+                /* If the kernel supports pidfds, watch for the exit in epoll, so that we don't have to
+                 * waitid() on every single child we watch whenever any SIGCHLD comes in. */
+                s->child.pidfd = pidfd_open(pid, 0);
+                if (s->child.pidfd < 0)
+                        log_debug_errno(errno, "Failed to open pidfd for child " PID_FMT ", falling back to SIGCHLD: %m", pid);
+                else {
+                        r = source_child_pidfd_register(s);
+                        if (r < 0)
+                                return r;
+
+                        if (ret)
+                                *ret = s;
+                        TAKE_PTR(s);
+
+                        return 0;
+                }
+        }
+
         e->n_enabled_child_sources++;
 
         r = event_make_signal_data(e, SIGCHLD, NULL);
@@ -1279,6 +1425,120 @@ _public_ int sd_event_add_exit(
         return 0;
 }
 
+static int work_queue_dispatch(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        sd_event *e = sd_event_source_get_event(s);
+        struct work_item *w, *l = NULL;
+        uint64_t x;
+        int r;
+
+        assert(e);
+
+        /* Reset the counter before taking the queue, so that work posted after this point is guaranteed to
+         * wake us up again */
+        (void) read(fd, &x, sizeof(x));
+
+        /* Take the whole stack in one go, and reverse it, so that work is run in the order it was posted */
+        w = __sync_lock_test_and_set(&e->work_queue, NULL);
+        while (w) {
+                struct work_item *next = w->next;
+
+                w->next = l;
+                l = w;
+                w = next;
+        }
+
+        while ((w = l)) {
+                l = w->next;
+
+                r = w->callback(e, w->userdata);
+                if (r < 0)
+                        log_debug_errno(r, "Work item posted to event loop failed, ignoring: %m");
+
+                free(w);
+        }
+
+        return 1;
+}
+
+_public_ int sd_event_add_work_queue(sd_event *e, sd_event_source **ret) {
+        sd_event_source *s;
+        int r;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(!event_pid_changed(e), -ECHILD);
+
+        if (e->work_source)
+                return -EBUSY;
+
+        if (e->work_fd < 0) {
+                e->work_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+                if (e->work_fd < 0)
+                        return -errno;
+        }
+
+        r = sd_event_add_io(e, &s, e->work_fd, EPOLLIN, work_queue_dispatch, NULL);
+        if (r < 0)
+                return r;
+
+        if (!ret) {
+                /* Hand our reference to the event loop */
+                r = sd_event_source_set_floating(s, true);
+                sd_event_source_unref(s);
+                if (r < 0)
+                        return r;
+        }
+
+        e->work_source = s;
+
+        /* Only now accept work, as it can be dispatched */
+        assert_se(__sync_bool_compare_and_swap(&e->work_queue, WORK_QUEUE_DEAD, NULL));
+
+        if (ret)
+                *ret = s;
+
+        return 0;
+}
+
+_public_ int sd_event_post_work(sd_event *e, sd_event_work_handler_t callback, void *userdata) {
+        struct work_item *w, *head;
+
+        /* This may be called from any thread, hence doesn't touch anything but the queue and the eventfd,
+         * and the default event loop can't be addressed, it is per thread. */
+
+        assert_return(e, -EINVAL);
+        assert_return(e != SD_EVENT_DEFAULT, -EINVAL);
+        assert_return(callback, -EINVAL);
+
+        w = new(struct work_item, 1);
+        if (!w)
+                return -ENOMEM;
+
+        *w = (struct work_item) {
+                .callback = callback,
+                .userdata = userdata,
+        };
+
+        do {
+                head = e->work_queue;
+                if (head == WORK_QUEUE_DEAD) {
+                        /* No work queue was set up, or its event source is gone */
+                        free(w);
+                        return -ENXIO;
+                }
+
+                w->next = head;
+        } while (!__sync_bool_compare_and_swap(&e->work_queue, head, w));
+
+        /* Only the first item needs to wake up the loop, the others are collected along with it. The counter
+         * can't overflow, as it is reset on every dispatch. */
+        if (!head)
+                (void) eventfd_write(e->work_fd, 1);
+
+        return 0;
+}
+
 static void event_free_inotify_data(sd_event *e, struct inotify_data *d) {
         assert(e);
 
@@ -1993,18 +2253,10 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                 case SOURCE_TIME_BOOTTIME:
                 case SOURCE_TIME_MONOTONIC:
                 case SOURCE_TIME_REALTIME_ALARM:
-                case SOURCE_TIME_BOOTTIME_ALARM: {
-                        struct clock_data *d;
-
+                case SOURCE_TIME_BOOTTIME_ALARM:
                         s->enabled = m;
-                        d = event_get_clock_data(s->event, s->type);
-                        assert(d);
-
-                        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                        d->needs_rearm = true;
+                        event_source_time_prioq_reshuffle(s);
                         break;
-                }
 
                 case SOURCE_SIGNAL:
                         s->enabled = m;
@@ -2015,6 +2267,11 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                 case SOURCE_CHILD:
                         s->enabled = m;
 
+                        if (EVENT_SOURCE_WATCH_PIDFD(s)) {
+                                source_child_pidfd_unregister(s);
+                                break;
+                        }
+
                         assert(s->event->n_enabled_child_sources > 0);
                         s->event->n_enabled_child_sources--;
 
@@ -2059,18 +2316,10 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
                 case SOURCE_TIME_BOOTTIME:
                 case SOURCE_TIME_MONOTONIC:
                 case SOURCE_TIME_REALTIME_ALARM:
-                case SOURCE_TIME_BOOTTIME_ALARM: {
-                        struct clock_data *d;
-
+                case SOURCE_TIME_BOOTTIME_ALARM:
                         s->enabled = m;
-                        d = event_get_clock_data(s->event, s->type);
-                        assert(d);
-
-                        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                        d->needs_rearm = true;
+                        event_source_time_prioq_reshuffle(s);
                         break;
-                }
 
                 case SOURCE_SIGNAL:
 
@@ -2087,6 +2336,15 @@ _public_ int sd_event_source_set_enabled(sd_event_source *s, int m) {
 
                 case SOURCE_CHILD:
 
+                        if (EVENT_SOURCE_WATCH_PIDFD(s)) {
+                                r = source_child_pidfd_register(s);
+                                if (r < 0)
+                                        return r;
+
+                                s->enabled = m;
+                                break;
+                        }
+
                         if (s->enabled == SD_EVENT_OFF)
                                 s->event->n_enabled_child_sources++;
 
@@ -2138,7 +2396,6 @@ _public_ int sd_event_source_get_time(sd_event_source *s, uint64_t *usec) {
 }
 
 _public_ int sd_event_source_set_time(sd_event_source *s, uint64_t usec) {
-        struct clock_data *d;
         int r;
 
         assert_return(s, -EINVAL);
@@ -2146,18 +2403,16 @@ _public_ int sd_event_source_set_time(sd_event_source *s, uint64_t usec) {
         assert_return(s->event->state != SD_EVENT_FINISHED, -ESTALE);
         assert_return(!event_pid_changed(s->event), -ECHILD);
 
+        /* Re-arming to the same time is common for per-object timeouts, and doesn't need to touch the queues */
+        if (!s->pending && s->time.next == usec)
+                return 0;
+
         r = source_set_pending(s, false);
         if (r < 0)
                 return r;
 
         s->time.next = usec;
-
-        d = event_get_clock_data(s->event, s->type);
-        assert(d);
-
-        prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-        prioq_reshuffle(d->latest, s, &s->time.latest_index);
-        d->needs_rearm = true;
+        event_source_time_prioq_reshuffle(s);
 
         return 0;
 }
@@ -2189,6 +2444,9 @@ _public_ int sd_event_source_set_time_accuracy(sd_event_source *s, uint64_t usec
         if (usec == 0)
                 usec = DEFAULT_ACCURACY_USEC;
 
+        if (s->time.accuracy == usec)
+                return 0;
+
         s->time.accuracy = usec;
 
         d = event_get_clock_data(s->event, s->type);
@@ -2230,6 +2488,29 @@ _public_ int sd_event_source_get_inotify_mask(sd_event_source *s, uint32_t *mask
         return 0;
 }
 
+_public_ int sd_event_source_get_inotify_coalesce(sd_event_source *s) {
+        assert_return(s, -EINVAL);
+        assert_return(s->type == SOURCE_INOTIFY, -EDOM);
+        assert_return(!event_pid_changed(s->event), -ECHILD);
+
+        return s->inotify.coalesce;
+}
+
+_public_ int sd_event_source_set_inotify_coalesce(sd_event_source *s, int b) {
+        assert_return(s, -EINVAL);
+        assert_return(s->type == SOURCE_INOTIFY, -EDOM);
+        assert_return(!event_pid_changed(s->event), -ECHILD);
+
+        /* Switching while an event is queued would confuse the accounting of the shared buffer */
+        if (s->pending)
+                return -EBUSY;
+
+        s->inotify.coalesce = b;
+        s->inotify.coalesced = (struct inotify_event) { .wd = -1 };
+
+        return 0;
+}
+
 _public_ int sd_event_source_set_prepare(sd_event_source *s, sd_event_handler_t callback) {
         int r;
 
@@ -2437,6 +2718,30 @@ static int process_io(sd_event *e, sd_event_source *s, uint32_t revents) {
         return source_set_pending(s, true);
 }
 
+static int process_pidfd(sd_event *e, sd_event_source *s, uint32_t revents) {
+        assert(e);
+        assert(s);
+        assert(EVENT_SOURCE_WATCH_PIDFD(s));
+
+        if (s->pending)
+                return 0;
+
+        if (s->enabled == SD_EVENT_OFF)
+                return 0;
+
+        /* The pidfd became readable, hence the process is a zombie now. Like process_child() we don't reap it
+         * here, so that the callback still sees it. */
+
+        zero(s->child.siginfo);
+        if (waitid(P_PID, s->child.pid, &s->child.siginfo, WNOHANG|WNOWAIT|WEXITED) < 0)
+                return -errno;
+
+        if (s->child.siginfo.si_pid == 0)
+                return 0;
+
+        return source_set_pending(s, true);
+}
+
 static int flush_timer(sd_event *e, int fd, uint32_t events, usec_t *next) {
         uint64_t x;
         ssize_t ss;
@@ -2482,13 +2787,10 @@ static int process_timer(
                     s->pending)
                         break;
 
+                /* This moves the source behind all non-pending ones in both queues, too */
                 r = source_set_pending(s, true);
                 if (r < 0)
                         return r;
-
-                prioq_reshuffle(d->earliest, s, &s->time.earliest_index);
-                prioq_reshuffle(d->latest, s, &s->time.latest_index);
-                d->needs_rearm = true;
         }
 
         return 0;
@@ -2530,6 +2832,9 @@ static int process_child(sd_event *e) {
                 if (s->enabled == SD_EVENT_OFF)
                         continue;
 
+                if (EVENT_SOURCE_WATCH_PIDFD(s))
+                        continue;
+
                 zero(s->child.siginfo);
                 r = waitid(P_PID, s->child.pid, &s->child.siginfo,
                            WNOHANG | (s->child.options & WEXITED ? WNOWAIT : 0) | s->child.options);
@@ -2667,7 +2972,24 @@ static void event_inotify_data_drop(sd_event *e, struct inotify_data *d, size_t
                 LIST_REMOVE(buffered, e->inotify_data_buffered, d);
 }
 
+static int source_inotify_trigger(sd_event_source *s, const struct inotify_event *ev) {
+        assert(s);
+        assert(s->type == SOURCE_INOTIFY);
+        assert(ev);
+
+        if (s->inotify.coalesce) {
+                /* Merge with whatever is queued for this source already. The handler gets the combined mask,
+                 * without names, and is expected to rescan. IN_Q_OVERFLOW carries no watch descriptor. */
+                if (ev->wd >= 0)
+                        s->inotify.coalesced.wd = ev->wd;
+                s->inotify.coalesced.mask |= ev->mask;
+        }
+
+        return source_set_pending(s, true);
+}
+
 static int event_inotify_data_process(sd_event *e, struct inotify_data *d) {
+        bool triggered = false;
         int r;
 
         assert(e);
@@ -2703,9 +3025,11 @@ static int event_inotify_data_process(sd_event *e, struct inotify_data *d) {
                                         if (s->enabled == SD_EVENT_OFF)
                                                 continue;
 
-                                        r = source_set_pending(s, true);
+                                        r = source_inotify_trigger(s, &d->buffer.ev);
                                         if (r < 0)
                                                 return r;
+
+                                        triggered = true;
                                 }
                         }
                 } else {
@@ -2743,27 +3067,34 @@ static int event_inotify_data_process(sd_event *e, struct inotify_data *d) {
                                     (s->inotify.mask & d->buffer.ev.mask & IN_ALL_EVENTS) == 0)
                                         continue;
 
-                                r = source_set_pending(s, true);
+                                r = source_inotify_trigger(s, &d->buffer.ev);
                                 if (r < 0)
                                         return r;
+
+                                triggered = true;
                         }
                 }
 
-                /* Something pending now? If so, let's finish, otherwise let's read more. */
+                /* Something pending now that needs this very event? If so, let's finish, otherwise drop it and
+                 * look at the next one. Coalescing sources have taken what they need already, and so a burst
+                 * of events is folded into a single dispatch for them. */
                 if (d->n_pending > 0)
                         return 1;
+
+                event_inotify_data_drop(e, d, sz);
         }
 
-        return 0;
+        return triggered;
 }
 
 static int process_inotify(sd_event *e) {
-        struct inotify_data *d;
+        struct inotify_data *d, *n;
         int r, done = 0;
 
         assert(e);
 
-        LIST_FOREACH(buffered, d, e->inotify_data_buffered) {
+        /* Processing may drop the buffer, and with it the entry from the list */
+        LIST_FOREACH_SAFE(buffered, d, n, e->inotify_data_buffered) {
                 r = event_inotify_data_process(e, d);
                 if (r < 0)
                         return r;
@@ -2774,8 +3105,30 @@ static int process_inotify(sd_event *e) {
         return done;
 }
 
+static void source_account_dispatch(sd_event_source *s, usec_t start, usec_t end) {
+        usec_t d;
+
+        assert(s);
+
+        s->stats.n_dispatched++;
+
+        if (s->pending_since > 0 && start > s->pending_since) {
+                d = start - s->pending_since;
+                s->stats.pending_usec += d;
+                s->stats.pending_max_usec = MAX(s->stats.pending_max_usec, d);
+        }
+
+        d = end > start ? end - start : 0;
+        s->stats.dispatch_usec += d;
+        s->stats.dispatch_max_usec = MAX(s->stats.dispatch_max_usec, d);
+
+        /* Defer and exit sources stay pending across dispatches, count their next wait from here */
+        s->pending_since = IN_SET(s->type, SOURCE_DEFER, SOURCE_EXIT) ? end : 0;
+}
+
 static int source_dispatch(sd_event_source *s) {
         EventSourceType saved_type;
+        usec_t start;
         int r = 0;
 
         assert(s);
@@ -2815,6 +3168,7 @@ static int source_dispatch(sd_event_source *s) {
         }
 
         s->dispatching = true;
+        start = now(CLOCK_MONOTONIC);
 
         switch (s->type) {
 
@@ -2842,9 +3196,14 @@ static int source_dispatch(sd_event_source *s) {
                 r = s->child.callback(s, &s->child.siginfo, s->userdata);
 
                 /* Now, reap the PID for good. */
-                if (zombie)
+                if (zombie) {
                         (void) waitid(P_PID, s->child.pid, &s->child.siginfo, WNOHANG|WEXITED);
 
+                        s->child.exited = true;
+                        if (EVENT_SOURCE_WATCH_PIDFD(s))
+                                source_child_pidfd_unregister(s);
+                }
+
                 break;
         }
 
@@ -2865,6 +3224,15 @@ static int source_dispatch(sd_event_source *s) {
                 struct inotify_data *d;
                 size_t sz;
 
+                if (s->inotify.coalesce) {
+                        struct inotify_event ev = s->inotify.coalesced;
+
+                        s->inotify.coalesced = (struct inotify_event) { .wd = -1 };
+
+                        r = s->inotify.callback(s, &ev, s->userdata);
+                        break;
+                }
+
                 assert(s->inotify.inode_data);
                 assert_se(d = s->inotify.inode_data->inotify_data);
 
@@ -2889,6 +3257,7 @@ static int source_dispatch(sd_event_source *s) {
         }
 
         s->dispatching = false;
+        source_account_dispatch(s, start, now(CLOCK_MONOTONIC));
 
         if (r < 0)
                 log_debug_errno(r, "Event source %s (type %s) returned error, disabling: %m",
@@ -3093,42 +3462,11 @@ pending:
         return r;
 }
 
-_public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
-        struct epoll_event *ev_queue;
-        unsigned ev_queue_max;
-        int r, m, i;
-
-        assert_return(e, -EINVAL);
-        assert_return(e = event_resolve(e), -ENOPKG);
-        assert_return(!event_pid_changed(e), -ECHILD);
-        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
-        assert_return(e->state == SD_EVENT_ARMED, -EBUSY);
-
-        if (e->exit_requested) {
-                e->state = SD_EVENT_PENDING;
-                return 1;
-        }
-
-        ev_queue_max = MAX(e->n_sources, 1u);
-        ev_queue = newa(struct epoll_event, ev_queue_max);
-
-        /* If we still have inotify data buffered, then query the other fds, but don't wait on it */
-        if (e->inotify_data_buffered)
-                timeout = 0;
-
-        m = epoll_wait(e->epoll_fd, ev_queue, ev_queue_max,
-                       timeout == (uint64_t) -1 ? -1 : (int) ((timeout + USEC_PER_MSEC - 1) / USEC_PER_MSEC));
-        if (m < 0) {
-                if (errno == EINTR) {
-                        e->state = SD_EVENT_PENDING;
-                        return 1;
-                }
+static int process_epoll(sd_event *e, const struct epoll_event *ev_queue, int m) {
+        int r = 0, i;
 
-                r = -errno;
-                goto finish;
-        }
-
-        triple_timestamp_get(&e->timestamp);
+        assert(e);
+        assert(ev_queue || m == 0);
 
         for (i = 0; i < m; i++) {
 
@@ -3139,9 +3477,15 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
 
                         switch (*t) {
 
-                        case WAKEUP_EVENT_SOURCE:
-                                r = process_io(e, ev_queue[i].data.ptr, ev_queue[i].events);
+                        case WAKEUP_EVENT_SOURCE: {
+                                sd_event_source *s = ev_queue[i].data.ptr;
+
+                                if (s->type == SOURCE_CHILD)
+                                        r = process_pidfd(e, s, ev_queue[i].events);
+                                else
+                                        r = process_io(e, s, ev_queue[i].events);
                                 break;
+                        }
 
                         case WAKEUP_CLOCK_DATA: {
                                 struct clock_data *d = ev_queue[i].data.ptr;
@@ -3161,8 +3505,78 @@ _public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
                                 assert_not_reached("Invalid wake-up pointer");
                         }
                 }
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+_public_ int sd_event_wait(sd_event *e, uint64_t timeout) {
+        struct epoll_event *ev_queue;
+        size_t ev_queue_max, n_collected = 0;
+        int r, m;
+
+        assert_return(e, -EINVAL);
+        assert_return(e = event_resolve(e), -ENOPKG);
+        assert_return(!event_pid_changed(e), -ECHILD);
+        assert_return(e->state != SD_EVENT_FINISHED, -ESTALE);
+        assert_return(e->state == SD_EVENT_ARMED, -EBUSY);
+
+        if (e->exit_requested) {
+                e->state = SD_EVENT_PENDING;
+                return 1;
+        }
+
+        /* Size the queue so that all sources can report in one go, but don't let it grow without bounds.
+         * With more sources than that, we call epoll_wait() repeatedly below. */
+        ev_queue_max = CLAMP((size_t) e->n_sources, 1u, EPOLL_QUEUE_MAX);
+        if (!GREEDY_REALLOC(e->event_queue, e->event_queue_allocated, ev_queue_max)) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        ev_queue = e->event_queue;
+        ev_queue_max = MIN(e->event_queue_allocated, (size_t) EPOLL_QUEUE_MAX);
+
+        /* If we still have inotify data buffered, then query the other fds, but don't wait on it */
+        if (e->inotify_data_buffered)
+                timeout = 0;
+
+        for (;;) {
+                m = epoll_wait(e->epoll_fd, ev_queue, ev_queue_max,
+                               timeout == (uint64_t) -1 ? -1 : (int) ((timeout + USEC_PER_MSEC - 1) / USEC_PER_MSEC));
+                if (m < 0) {
+                        if (errno != EINTR) {
+                                r = -errno;
+                                goto finish;
+                        }
+
+                        if (n_collected == 0) {
+                                e->state = SD_EVENT_PENDING;
+                                return 1;
+                        }
+
+                        break;
+                }
+
+                if (n_collected == 0)
+                        triple_timestamp_get(&e->timestamp);
+
+                r = process_epoll(e, ev_queue, m);
                 if (r < 0)
                         goto finish;
+
+                /* If the buffer filled up there might be more events ready. Collect them too, without
+                 * waiting, so that all sources get their turn in this iteration and are dispatched by
+                 * priority, instead of only those the kernel happened to return first. Sources that are
+                 * already pending stay ready and are returned again, hence stop once we had as many
+                 * events as there are sources. */
+                n_collected += m;
+                if ((size_t) m < ev_queue_max || n_collected >= e->n_sources)
+                        break;
+
+                timeout = 0;
         }
 
         r = process_watchdog(e);
@@ -3513,6 +3927,82 @@ _public_ int sd_event_source_get_destroy_callback(sd_event_source *s, sd_event_d
         return !!s->destroy_callback;
 }
 
+_public_ int sd_event_source_get_stats(sd_event_source *s, sd_event_source_stats *ret, size_t size) {
+        size_t n;
+
+        assert_return(s, -EINVAL);
+        assert_return(ret, -EINVAL);
+        assert_return(size > 0, -EINVAL);
+        assert_return(!event_pid_changed(s->event), -ECHILD);
+
+        /* The caller passes the size of the structure it was compiled with, so that fields can be added later
+         * without breaking the ABI. Whatever we don't know about is zeroed, and we return how much we filled in. */
+
+        n = MIN(size, sizeof(s->stats));
+        memcpy(ret, &s->stats, n);
+        if (size > n)
+                memzero((uint8_t*) ret + n, size - n);
+
+        return (int) n;
+}
+
+static int source_stats_compare(const void *a, const void *b) {
+        const sd_event_source *x = *(sd_event_source**) a, *y = *(sd_event_source**) b;
+
+        /* Most expensive first */
+        return -CMP(x->stats.dispatch_usec, y->stats.dispatch_usec);
+}
+
+int event_dump_source_stats(sd_event *e, FILE *f, const char *prefix) {
+        _cleanup_free_ sd_event_source **array = NULL;
+        sd_event_source *s;
+        size_t n = 0, i;
+
+        assert(e);
+        assert(f);
+
+        /* Writes one "key value" line per counter for every source that was dispatched at least once, the ones
+         * that spent the most time in their handler first. Sources without a description are named after their
+         * type and their position in this list. */
+
+        array = new(sd_event_source*, e->n_sources);
+        if (!array && e->n_sources > 0)
+                return -ENOMEM;
+
+        LIST_FOREACH(sources, s, e->sources)
+                if (s->stats.n_dispatched > 0)
+                        array[n++] = s;
+
+        qsort_safe(array, n, sizeof(sd_event_source*), source_stats_compare);
+
+        for (i = 0; i < n; i++) {
+                char name[DECIMAL_STR_MAX(size_t) + 32];
+                const char *d;
+
+                s = array[i];
+
+                d = s->description;
+                if (!d) {
+                        xsprintf(name, "%s-%zu", event_source_type_to_string(s->type), i);
+                        d = name;
+                }
+
+                fprintf(f,
+                        "%s%s.dispatched %" PRIu64 "\n"
+                        "%s%s.dispatch_usec %" PRIu64 "\n"
+                        "%s%s.dispatch_max_usec %" PRIu64 "\n"
+                        "%s%s.pending_usec %" PRIu64 "\n"
+                        "%s%s.pending_max_usec %" PRIu64 "\n",
+                        strempty(prefix), d, s->stats.n_dispatched,
+                        strempty(prefix), d, s->stats.dispatch_usec,
+                        strempty(prefix), d, s->stats.dispatch_max_usec,
+                        strempty(prefix), d, s->stats.pending_usec,
+                        strempty(prefix), d, s->stats.pending_max_usec);
+        }
+
+        return 0;
+}
+
 _public_ int sd_event_source_get_floating(sd_event_source *s) {
         assert_return(s, -EINVAL);
 
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <pthread.h>
 #include <sys/wait.h>
 
 #include "sd-event.h"
@@ -481,15 +482,255 @@ static void test_inotify(unsigned n_create_events) {
         sd_event_unref(e);
 }
 
+static int coalesce_handler(sd_event_source *s, const struct inotify_event *ev, void *userdata) {
+        unsigned *n = userdata;
+
+        assert_se(ev);
+        assert_se(ev->len == 0);
+        assert_se(ev->wd >= 0);
+        assert_se(ev->mask & IN_CREATE);
+        assert_se((ev->mask & ~(IN_CREATE|IN_Q_OVERFLOW)) == 0);
+
+        (*n)++;
+        return 1;
+}
+
+static void test_inotify_coalesce(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *p = NULL;
+        sd_event_source *s = NULL;
+        sd_event *e = NULL;
+        unsigned i, n = 0;
+        int r;
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(mkdtemp_malloc("/tmp/test-inotify-XXXXXX", &p) >= 0);
+
+        assert_se(sd_event_add_inotify(e, &s, p, IN_CREATE, coalesce_handler, &n) >= 0);
+        assert_se(sd_event_source_get_inotify_coalesce(s) == 0);
+        assert_se(sd_event_source_set_inotify_coalesce(s, true) >= 0);
+        assert_se(sd_event_source_get_inotify_coalesce(s) > 0);
+
+        for (i = 0; i < 100; i++) {
+                char buf[DECIMAL_STR_MAX(unsigned)+1];
+                _cleanup_free_ char *z;
+
+                xsprintf(buf, "%u", i);
+                assert_se(z = strjoin(p, "/", buf));
+
+                assert_se(touch(z) >= 0);
+        }
+
+        while ((r = sd_event_run(e, 0)) > 0)
+                ;
+        assert_se(r == 0);
+
+        /* Each read from the inotify fd should be folded into a single dispatch */
+        log_info("%u dispatches for 100 created files", n);
+        assert_se(n > 0);
+        assert_se(n < 100);
+
+        sd_event_source_unref(s);
+        sd_event_unref(e);
+}
+
+#define N_CHILDREN 64U
+
+static int exit_child_handler(sd_event_source *s, const siginfo_t *si, void *userdata) {
+        unsigned *n = userdata;
+
+        assert_se(s);
+        assert_se(si);
+        assert_se(si->si_code == CLD_EXITED);
+        assert_se(si->si_status == EXIT_SUCCESS);
+
+        if (--(*n) == 0)
+                assert_se(sd_event_exit(sd_event_source_get_event(s), 0) >= 0);
+
+        return 1;
+}
+
+static void test_child(void) {
+        sd_event_source *sources[N_CHILDREN+1] = {};
+        pid_t pids[N_CHILDREN+1];
+        unsigned n = N_CHILDREN+1, i;
+        sd_event *e = NULL;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        assert_se(sigprocmask_many(SIG_BLOCK, NULL, SIGCHLD, -1) >= 0);
+
+        /* All but the last child only watch for the exit, which is picked up through pidfds where supported. The
+         * last one also watches for stops, and hence always goes through SIGCHLD and waitid(). */
+        for (i = 0; i < N_CHILDREN+1; i++) {
+                pids[i] = fork();
+                assert_se(pids[i] >= 0);
+
+                if (pids[i] == 0)
+                        _exit(EXIT_SUCCESS);
+
+                assert_se(sd_event_add_child(e, &sources[i], pids[i], i < N_CHILDREN ? WEXITED : WEXITED|WSTOPPED,
+                                             exit_child_handler, &n) >= 0);
+        }
+
+        assert_se(sd_event_loop(e) >= 0);
+        assert_se(n == 0);
+
+        /* All children have been reaped after dispatching */
+        for (i = 0; i < N_CHILDREN+1; i++) {
+                siginfo_t si = {};
+
+                assert_se(waitid(P_PID, pids[i], &si, WEXITED|WNOHANG) < 0);
+                assert_se(errno == ECHILD);
+
+                sd_event_source_unref(sources[i]);
+        }
+
+        sd_event_unref(e);
+}
+
+#define N_WORK_THREADS 4U
+#define N_WORK_ITEMS 1000U
+
+static struct {
+        sd_event *event;
+        unsigned seq[N_WORK_THREADS][N_WORK_ITEMS];
+        unsigned next_seq[N_WORK_THREADS];
+        unsigned n_done;
+} work;
+
+static int work_handler(sd_event *e, void *userdata) {
+        unsigned *seq = userdata, t;
+
+        assert_se(e == work.event);
+        assert_se(seq);
+
+        t = (seq - &work.seq[0][0]) / N_WORK_ITEMS;
+        assert_se(t < N_WORK_THREADS);
+
+        /* Work posted by one thread is run in the order it was posted */
+        assert_se(*seq == work.next_seq[t]);
+        work.next_seq[t]++;
+
+        if (++work.n_done == N_WORK_THREADS * N_WORK_ITEMS)
+                assert_se(sd_event_exit(e, 0) >= 0);
+
+        return 0;
+}
+
+static void *work_thread(void *p) {
+        unsigned *seq = p, i;
+
+        for (i = 0; i < N_WORK_ITEMS; i++)
+                assert_se(sd_event_post_work(work.event, work_handler, seq + i) >= 0);
+
+        return NULL;
+}
+
+static int work_count_handler(sd_event *e, void *userdata) {
+        unsigned *n = userdata;
+
+        (*n)++;
+        return 0;
+}
+
+static void test_work_queue(void) {
+        pthread_t threads[N_WORK_THREADS];
+        sd_event_source *s = NULL;
+        unsigned i, j;
+
+        assert_se(sd_event_new(&work.event) >= 0);
+
+        assert_se(sd_event_post_work(work.event, work_handler, NULL) == -ENXIO);
+
+        assert_se(sd_event_add_work_queue(work.event, &s) >= 0);
+        assert_se(sd_event_add_work_queue(work.event, NULL) == -EBUSY);
+
+        for (i = 0; i < N_WORK_THREADS; i++)
+                for (j = 0; j < N_WORK_ITEMS; j++)
+                        work.seq[i][j] = j;
+
+        for (i = 0; i < N_WORK_THREADS; i++)
+                assert_se(pthread_create(&threads[i], NULL, work_thread, work.seq[i]) == 0);
+
+        assert_se(sd_event_loop(work.event) >= 0);
+
+        for (i = 0; i < N_WORK_THREADS; i++) {
+                assert_se(pthread_join(threads[i], NULL) == 0);
+                assert_se(work.next_seq[i] == N_WORK_ITEMS);
+        }
+
+        sd_event_source_unref(s);
+        work.event = sd_event_unref(work.event);
+}
+
+static void test_work_queue_lifetime(void) {
+        sd_event_source *s = NULL;
+        sd_event *e = NULL;
+        unsigned n = 0;
+
+        assert_se(sd_event_new(&e) >= 0);
+
+        /* Work posted before the source goes away is dropped, after that it is refused rather than queued
+         * for nobody */
+        assert_se(sd_event_add_work_queue(e, &s) >= 0);
+        assert_se(sd_event_post_work(e, work_count_handler, &n) >= 0);
+        sd_event_source_unref(s);
+        assert_se(sd_event_post_work(e, work_count_handler, &n) == -ENXIO);
+
+        /* The queue may be set up again */
+        assert_se(sd_event_add_work_queue(e, NULL) >= 0);
+        assert_se(sd_event_add_work_queue(e, NULL) == -EBUSY);
+        assert_se(sd_event_post_work(e, work_count_handler, &n) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(n == 1);
+
+        sd_event_unref(e);
+}
+
+static int stats_handler(sd_event_source *s, void *userdata) {
+        usleep(1000);
+        return 0;
+}
+
+static void test_source_stats(void) {
+        sd_event_source_stats stats;
+        sd_event_source *s = NULL;
+        sd_event *e = NULL;
+
+        assert_se(sd_event_new(&e) >= 0);
+        assert_se(sd_event_add_defer(e, &s, stats_handler, NULL) >= 0);
+
+        assert_se(sd_event_source_get_stats(s, &stats, sizeof(stats)) == sizeof(stats));
+        assert_se(stats.n_dispatched == 0);
+
+        assert_se(sd_event_run(e, 0) > 0);
+        assert_se(sd_event_source_set_enabled(s, SD_EVENT_ONESHOT) >= 0);
+        assert_se(sd_event_run(e, 0) > 0);
+
+        assert_se(sd_event_source_get_stats(s, &stats, sizeof(stats)) == sizeof(stats));
+        assert_se(stats.n_dispatched == 2);
+        assert_se(stats.dispatch_usec >= 2000);
+        assert_se(stats.dispatch_max_usec >= 1000);
+        assert_se(stats.dispatch_max_usec <= stats.dispatch_usec);
+
+        sd_event_source_unref(s);
+        sd_event_unref(e);
+}
+
 int main(int argc, char *argv[]) {
         test_setup_logging(LOG_DEBUG);
 
         test_basic();
         test_sd_event_now();
         test_rtqueue();
+        test_child();
+        test_work_queue();
+        test_work_queue_lifetime();
+        test_source_stats();
 
         test_inotify(100); /* should work without overflow */
         test_inotify(33000); /* should trigger a q overflow */
+        test_inotify_coalesce();
 
         return 0;
 }
@@ -73,18 +73,24 @@ static int trie_children_cmp(const struct trie_child_entry *a, const struct trie
 
 static int node_add_child(struct trie *trie, struct trie_node *node, struct trie_node *node_child, uint8_t c) {
         struct trie_child_entry *child;
+        size_t i;
 
-        /* extend array, add new entry, sort for bisection */
+        /* extend array, insert new entry at its sorted position for bisection */
         child = reallocarray(node->children, node->children_count + 1, sizeof(struct trie_child_entry));
         if (!child)
                 return -ENOMEM;
 
         node->children = child;
         trie->children_count++;
-        node->children[node->children_count].c = c;
-        node->children[node->children_count].child = node_child;
+
+        for (i = node->children_count; i > 0 && node->children[i - 1].c > c; i--)
+                node->children[i] = node->children[i - 1];
+
+        node->children[i] = (struct trie_child_entry) {
+                .c = c,
+                .child = node_child,
+        };
         node->children_count++;
-        typesafe_qsort(node->children, node->children_count, trie_children_cmp);
         trie->nodes_count++;
 
         return 0;
@@ -125,16 +131,12 @@ static void trie_free(struct trie *trie) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(struct trie*, trie_free);
 
-static int trie_values_cmp(const struct trie_value_entry *a, const struct trie_value_entry *b, struct trie *trie) {
-        return strcmp(trie->strings->buf + a->key_off,
-                      trie->strings->buf + b->key_off);
-}
-
 static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                                const char *key, const char *value,
                                const char *filename, uint16_t file_priority, uint32_t line_number, bool compat) {
         ssize_t k, v, fn = 0;
         struct trie_value_entry *val;
+        size_t lo = 0, hi;
 
         k = strbuf_add_string(trie->strings, key, strlen(key));
         if (k < 0)
@@ -149,31 +151,37 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                         return fn;
         }
 
-        if (node->values_count) {
-                struct trie_value_entry search = {
-                        .key_off = k,
-                        .value_off = v,
-                };
+        /* bisect for the key, and remember where it would have to be inserted */
+        hi = node->values_count;
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                int d;
 
-                val = typesafe_bsearch_r(&search, node->values, node->values_count, trie_values_cmp, trie);
-                if (val) {
+                d = strcmp(key, trie->strings->buf + node->values[mid].key_off);
+                if (d == 0) {
                         /* At this point we have 2 identical properties on the same match-string.
                          * Since we process files in order, we just replace the previous value. */
+                        val = node->values + mid;
                         val->value_off = v;
                         val->filename_off = fn;
                         val->file_priority = file_priority;
                         val->line_number = line_number;
                         return 0;
                 }
+                if (d < 0)
+                        hi = mid;
+                else
+                        lo = mid + 1;
         }
 
-        /* extend array, add new entry, sort for bisection */
+        /* extend array, insert new entry at its sorted position for bisection */
         val = reallocarray(node->values, node->values_count + 1, sizeof(struct trie_value_entry));
         if (!val)
                 return -ENOMEM;
         trie->values_count++;
         node->values = val;
-        node->values[node->values_count] = (struct trie_value_entry) {
+        memmove(node->values + lo + 1, node->values + lo, (node->values_count - lo) * sizeof(struct trie_value_entry));
+        node->values[lo] = (struct trie_value_entry) {
                 .key_off = k,
                 .value_off = v,
                 .filename_off = fn,
@@ -181,7 +189,6 @@ static int trie_node_add_value(struct trie *trie, struct trie_node *node,
                 .line_number = line_number,
         };
         node->values_count++;
-        typesafe_qsort_r(node->values, node->values_count, trie_values_cmp, trie);
         return 0;
 }
 
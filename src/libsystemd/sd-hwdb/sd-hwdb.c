@@ -35,6 +35,9 @@ struct sd_hwdb {
         OrderedHashmap *properties;
         Iterator properties_iterator;
         bool properties_modified;
+
+        /* The modalias the current properties were looked up for */
+        char *properties_modalias;
 };
 
 struct linebuf {
@@ -367,6 +370,7 @@ static sd_hwdb *hwdb_free(sd_hwdb *hwdb) {
                 munmap((void *)hwdb->map, hwdb->st.st_size);
         safe_fclose(hwdb->f);
         ordered_hashmap_free(hwdb->properties);
+        free(hwdb->properties_modalias);
         return mfree(hwdb);
 }
 
@@ -398,13 +402,28 @@ bool hwdb_validate(sd_hwdb *hwdb) {
 }
 
 static int properties_prepare(sd_hwdb *hwdb, const char *modalias) {
+        int r;
+
         assert(hwdb);
         assert(modalias);
 
+        /* Callers usually ask for several keys of the same modalias in a row, don't walk the trie again for
+         * each of them. */
+        if (streq_ptr(hwdb->properties_modalias, modalias))
+                return 0;
+
         ordered_hashmap_clear(hwdb->properties);
         hwdb->properties_modified = true;
+        hwdb->properties_modalias = mfree(hwdb->properties_modalias);
 
-        return trie_search_f(hwdb, modalias);
+        r = trie_search_f(hwdb, modalias);
+        if (r < 0)
+                return r;
+
+        /* If this fails, we'll simply search again next time */
+        hwdb->properties_modalias = strdup(modalias);
+
+        return 0;
 }
 
 _public_ int sd_hwdb_get(sd_hwdb *hwdb, const char *modalias, const char *key, const char **_value) {
@@ -2791,7 +2791,7 @@ int match_job_removed(sd_bus_message *message, void *userdata, sd_bus_error *err
                         (void) session_jobs_reply(session, unit, result);
 
                         session_save(session);
-                        user_save(session->user);
+                        user_add_to_save_queue(session->user);
                 }
 
                 session_add_to_gc_queue(session);
@@ -722,8 +722,11 @@ int session_send_create_reply(Session *s, sd_bus_error *error) {
         if (fifo_fd < 0)
                 return fifo_fd;
 
-        /* Update the session state file before we notify the client about the result. */
+        /* Update the session state file before we notify the client about the result, and the user's too, in
+         * case it is still queued. */
         session_save(s);
+        if (s->user->in_save_queue)
+                user_save(s->user);
 
         p = session_bus_path(s);
         if (!p)
@@ -112,6 +112,9 @@ User *user_free(User *u) {
         if (u->in_gc_queue)
                 LIST_REMOVE(gc_queue, u->manager->user_gc_queue, u);
 
+        if (u->in_save_queue)
+                LIST_REMOVE(save_queue, u->manager->user_save_queue, u);
+
         while (u->sessions)
                 session_free(u->sessions);
 
@@ -300,6 +303,11 @@ fail:
 int user_save(User *u) {
         assert(u);
 
+        if (u->in_save_queue) {
+                LIST_REMOVE(save_queue, u->manager->user_save_queue, u);
+                u->in_save_queue = false;
+        }
+
         if (!u->started)
                 return 0;
 
@@ -616,6 +624,20 @@ void user_add_to_gc_queue(User *u) {
         u->in_gc_queue = true;
 }
 
+void user_add_to_save_queue(User *u) {
+        assert(u);
+
+        /* The user state file lists all sessions of the user, hence writing it is O(n) in the number of sessions.
+         * Session changes thus only queue it for writing, and the queue is flushed once per event loop iteration,
+         * see manager_dispatch_user_save_queue(). */
+
+        if (u->in_save_queue)
+                return;
+
+        LIST_PREPEND(save_queue, u->manager->user_save_queue, u);
+        u->in_save_queue = true;
+}
+
 UserState user_get_state(User *u) {
         Session *i;
 
@@ -1140,6 +1140,16 @@ static int manager_startup(Manager *m) {
         return 0;
 }
 
+static void manager_dispatch_user_save_queue(Manager *m) {
+        User *user;
+
+        assert(m);
+
+        /* user_save() removes the user from the queue */
+        while ((user = m->user_save_queue))
+                (void) user_save(user);
+}
+
 static int manager_run(Manager *m) {
         int r;
 
@@ -1149,10 +1159,13 @@ static int manager_run(Manager *m) {
                 r = sd_event_get_state(m->event);
                 if (r < 0)
                         return r;
-                if (r == SD_EVENT_FINISHED)
+                if (r == SD_EVENT_FINISHED) {
+                        manager_dispatch_user_save_queue(m);
                         return 0;
+                }
 
                 manager_gc(m, true);
+                manager_dispatch_user_save_queue(m);
 
                 r = manager_dispatch_delayed(m, false);
                 if (r < 0)
@@ -4041,10 +4041,9 @@ int link_save(Link *link) {
         if (r < 0)
                 goto fail;
 
-        if (rename(temp_path, link->state_file) < 0) {
-                r = -errno;
+        r = state_file_replace(temp_path, link->state_file);
+        if (r < 0)
                 goto fail;
-        }
 
         return 0;
 
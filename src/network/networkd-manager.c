@@ -424,6 +424,10 @@ int manager_rtnl_process_route(sd_netlink *rtnl, sd_netlink_message *message, vo
         switch (type) {
         case RTM_NEWROUTE:
                 if (!route) {
+                        if (!m->manage_foreign_routes)
+                                /* Don't keep track of routes we didn't configure ourselves */
+                                return 0;
+
                         /* A route appeared that we did not request */
                         r = route_add_foreign(link, family, &dst, dst_prefixlen, tos, priority, table, &route);
                         if (r < 0) {
@@ -1171,10 +1175,9 @@ static int manager_save(Manager *m) {
         if (r < 0)
                 goto fail;
 
-        if (rename(temp_path, m->state_file) < 0) {
-                r = -errno;
+        r = state_file_replace(temp_path, m->state_file);
+        if (r < 0)
                 goto fail;
-        }
 
         if (m->operational_state != operstate) {
                 m->operational_state = operstate;
@@ -1349,6 +1352,8 @@ int manager_new(Manager **ret) {
         if (!m->state_file)
                 return -ENOMEM;
 
+        m->manage_foreign_routes = true;
+
         r = sd_event_default(&m->event);
         if (r < 0)
                 return r;
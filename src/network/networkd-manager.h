@@ -32,6 +32,8 @@ struct Manager {
         bool enumerating:1;
         bool dirty:1;
 
+        bool manage_foreign_routes;
+
         Set *dirty_links;
 
         char *state_file;
@@ -1,7 +1,9 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include "alloc-util.h"
 #include "condition.h"
 #include "conf-parser.h"
+#include "fileio.h"
 #include "networkd-util.h"
 #include "parse-util.h"
 #include "string-table.h"
@@ -102,3 +104,27 @@ int kernel_route_expiration_supported(void) {
         }
         return cached;
 }
+
+/* Moves a freshly written state file into place, unless the old file has the very same contents. Clients watch
+ * the state files via inotify, hence don't wake them up again and again for nothing while links are being
+ * configured. */
+int state_file_replace(const char *temp_path, const char *path) {
+        _cleanup_free_ char *old = NULL, *new = NULL;
+        size_t old_size, new_size;
+
+        assert(temp_path);
+        assert(path);
+
+        if (read_full_file(path, &old, &old_size) >= 0 &&
+            read_full_file(temp_path, &new, &new_size) >= 0 &&
+            old_size == new_size &&
+            memcmp(old, new, old_size) == 0) {
+                (void) unlink(temp_path);
+                return 0;
+        }
+
+        if (rename(temp_path, path) < 0)
+                return -errno;
+
+        return 1;
+}
@@ -105,10 +105,12 @@ int main(int argc, char *argv[]) {
                 goto out;
         }
 
-        r = manager_rtnl_enumerate_routes(m);
-        if (r < 0) {
-                log_error_errno(r, "Could not enumerate routes: %m");
-                goto out;
+        if (m->manage_foreign_routes) {
+                r = manager_rtnl_enumerate_routes(m);
+                if (r < 0) {
+                        log_error_errno(r, "Could not enumerate routes: %m");
+                        goto out;
+                }
         }
 
         r = manager_rtnl_enumerate_rules(m);
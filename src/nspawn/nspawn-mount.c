@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <sched.h>
+#include <signal.h>
 #include <sys/mount.h>
 #include <linux/magic.h>
 
@@ -7,16 +9,21 @@
 #include "escape.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "format-util.h"
 #include "fs-util.h"
 #include "label.h"
+#include "missing.h"
 #include "mkdir.h"
 #include "mount-util.h"
 #include "nspawn-mount.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "process-util.h"
+#include "raw-clone.h"
 #include "rm-rf.h"
 #include "set.h"
 #include "stat-util.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "user-util.h"
@@ -1070,3 +1077,88 @@ done:
 
         return r;
 }
+
+/* The on-disk UID/GID that the host's root user is mapped to on idmapped mounts, see remount_idmap(). That's the
+ * last UID in the signed 32bit range but one, far outside of any container's range. */
+#define UID_MAPPED_ROOT ((uid_t) (INT32_MAX - 1))
+
+static int make_userns(uid_t uid_shift, uid_t uid_range) {
+        char path[STRLEN("/proc//uid_map") + DECIMAL_STR_MAX(pid_t) + 1], line[(DECIMAL_STR_MAX(uid_t)*3+3+1)*2];
+        int userns_fd = -1, r;
+        pid_t pid;
+
+        /* Allocates a user namespace with the specified mapping, and returns an fd referencing it. For that we fork
+         * off a child that does nothing but sit in the namespace until we configured it and grabbed a reference.
+         *
+         * Besides the container's range we also map the host's root user, to UID_MAPPED_ROOT. Without that, inodes
+         * can't be created by host root on the idmapped mount at all (the kernel refuses that with EOVERFLOW), but
+         * nspawn populates the tree from the host before the container runs. What it creates that way is chowned to
+         * the container's users right after, and the UID isn't mapped into the container's namespace, hence grants
+         * nothing there. */
+
+        pid = raw_clone(SIGCHLD|CLONE_NEWUSER);
+        if (pid < 0)
+                return -errno;
+        if (pid == 0)
+                for (;;)
+                        pause();
+
+        xsprintf(line,
+                 UID_FMT " " UID_FMT " " UID_FMT "\n"
+                 UID_FMT " " UID_FMT " " UID_FMT "\n",
+                 0, uid_shift, uid_range,
+                 UID_MAPPED_ROOT, 0, 1);
+
+        xsprintf(path, "/proc/" PID_FMT "/uid_map", pid);
+        r = write_string_file(path, line, WRITE_STRING_FILE_DISABLE_BUFFER);
+        if (r < 0)
+                goto finish;
+
+        /* We always assign the same UID and GID ranges */
+        xsprintf(path, "/proc/" PID_FMT "/gid_map", pid);
+        r = write_string_file(path, line, WRITE_STRING_FILE_DISABLE_BUFFER);
+        if (r < 0)
+                goto finish;
+
+        xsprintf(path, "/proc/" PID_FMT "/ns/user", pid);
+        userns_fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        r = userns_fd < 0 ? -errno : userns_fd;
+
+finish:
+        (void) kill(pid, SIGKILL);
+        (void) wait_for_terminate(pid, NULL);
+
+        return r;
+}
+
+int remount_idmap(const char *p, uid_t uid_shift, uid_t uid_range) {
+        _cleanup_close_ int userns_fd = -1, mount_fd = -1;
+
+        assert(p);
+
+        /* Replaces the mount tree at the specified path by a copy of it that is idmapped, so that on-disk UIDs/GIDs
+         * 0…uid_range-1 show up as uid_shift…uid_shift+uid_range-1, and the host's root user may still create inodes
+         * on it, see make_userns(). This only works on reasonably new kernels and for file systems that support
+         * idmapped mounts, hence callers should be ready to fall back to something else. The copy is placed on top of
+         * the original, hence if we fail the original mount is left in place untouched. */
+
+        userns_fd = make_userns(uid_shift, uid_range);
+        if (userns_fd < 0)
+                return log_debug_errno(userns_fd, "Failed to allocate user namespace for idmapped mount: %m");
+
+        mount_fd = open_tree(AT_FDCWD, p, OPEN_TREE_CLONE|OPEN_TREE_CLOEXEC|AT_RECURSIVE);
+        if (mount_fd < 0)
+                return log_debug_errno(errno, "Failed to clone mount tree %s: %m", p);
+
+        if (mount_setattr(mount_fd, "", AT_EMPTY_PATH|AT_RECURSIVE,
+                          &(struct mount_attr) {
+                                  .attr_set = MOUNT_ATTR_IDMAP,
+                                  .userns_fd = userns_fd,
+                          }, MOUNT_ATTR_SIZE_VER0) < 0)
+                return log_debug_errno(errno, "Failed to apply ID mapping to mount tree %s: %m", p);
+
+        if (move_mount(mount_fd, "", AT_FDCWD, p, MOVE_MOUNT_F_EMPTY_PATH) < 0)
+                return log_debug_errno(errno, "Failed to attach idmapped mount tree to %s: %m", p);
+
+        return 0;
+}
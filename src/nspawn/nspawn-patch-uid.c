@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/vfs.h>
+#include <sys/xattr.h>
 #include <unistd.h>
 
 #include "acl-util.h"
@@ -82,6 +83,32 @@ static int set_acl(int fd, const char *name, acl_type_t type, acl_t acl) {
         return 0;
 }
 
+static int has_acl(int fd, const char *name, acl_type_t type) {
+        const char *xattr;
+        ssize_t n;
+
+        assert(fd >= 0);
+
+        /* Checks whether the inode carries an extended ACL of the specified type at all. Most inodes of an OS tree
+         * don't, and for them this saves us the openat() + close() and the full libacl round trip, in favour of a
+         * single getxattr() call. Returns -EOPNOTSUPP if the file system doesn't do ACLs. */
+
+        xattr = type == ACL_TYPE_ACCESS ? "system.posix_acl_access" : "system.posix_acl_default";
+
+        if (name) {
+                char procfs_path[STRLEN("/proc/self/fd/") + DECIMAL_STR_MAX(int) + 1 + NAME_MAX + 1];
+
+                /* The entry is never a symlink here, but let's not follow it anyway */
+                xsprintf(procfs_path, "/proc/self/fd/%i/%s", fd, name);
+                n = lgetxattr(procfs_path, xattr, NULL, 0);
+        } else
+                n = fgetxattr(fd, xattr, NULL, 0);
+        if (n < 0)
+                return errno == ENODATA ? 0 : -errno;
+
+        return n > 0;
+}
+
 static int shift_acl(acl_t acl, uid_t shift, acl_t *ret) {
         _cleanup_(acl_freep) acl_t copy = NULL;
         acl_entry_t i;
@@ -174,21 +201,28 @@ static int patch_acls(int fd, const char *name, const struct stat *st, uid_t shi
         if (S_ISLNK(st->st_mode))
                 return 0;
 
-        r = get_acl(fd, name, ACL_TYPE_ACCESS, &acl);
+        r = has_acl(fd, name, ACL_TYPE_ACCESS);
         if (r == -EOPNOTSUPP)
                 return 0;
         if (r < 0)
                 return r;
-
-        r = shift_acl(acl, shift, &shifted);
-        if (r < 0)
-                return r;
         if (r > 0) {
-                r = set_acl(fd, name, ACL_TYPE_ACCESS, shifted);
+                r = get_acl(fd, name, ACL_TYPE_ACCESS, &acl);
+                if (r == -EOPNOTSUPP)
+                        return 0;
                 if (r < 0)
                         return r;
 
-                changed = true;
+                r = shift_acl(acl, shift, &shifted);
+                if (r < 0)
+                        return r;
+                if (r > 0) {
+                        r = set_acl(fd, name, ACL_TYPE_ACCESS, shifted);
+                        if (r < 0)
+                                return r;
+
+                        changed = true;
+                }
         }
 
         if (S_ISDIR(st->st_mode)) {
@@ -197,6 +231,12 @@ static int patch_acls(int fd, const char *name, const struct stat *st, uid_t shi
 
                 acl = shifted = NULL;
 
+                r = has_acl(fd, name, ACL_TYPE_DEFAULT);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        return changed;
+
                 r = get_acl(fd, name, ACL_TYPE_DEFAULT, &acl);
                 if (r < 0)
                         return r;
@@ -46,6 +46,10 @@ struct DnsCacheItem {
         union in_addr_union owner_address;
 
         unsigned prioq_idx;
+
+        uint64_t last_use;
+        unsigned use_prioq_idx;
+
         LIST_FIELDS(DnsCacheItem, by_key);
 };
 
@@ -98,6 +102,7 @@ static void dns_cache_item_unlink_and_free(DnsCache *c, DnsCacheItem *i) {
                 hashmap_remove(c->by_key, i->key);
 
         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+        prioq_remove(c->by_use, i, &i->use_prioq_idx);
 
         dns_cache_item_free(i);
 }
@@ -132,6 +137,7 @@ static bool dns_cache_remove_by_key(DnsCache *c, DnsResourceKey *key) {
 
         LIST_FOREACH_SAFE(by_key, i, n, first) {
                 prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                prioq_remove(c->by_use, i, &i->use_prioq_idx);
                 dns_cache_item_free(i);
         }
 
@@ -148,9 +154,11 @@ void dns_cache_flush(DnsCache *c) {
 
         assert(hashmap_size(c->by_key) == 0);
         assert(prioq_size(c->by_expiry) == 0);
+        assert(prioq_size(c->by_use) == 0);
 
         c->by_key = hashmap_free(c->by_key);
         c->by_expiry = prioq_free(c->by_expiry);
+        c->by_use = prioq_free(c->by_use);
 }
 
 static void dns_cache_make_space(DnsCache *c, unsigned add) {
@@ -162,7 +170,12 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
         /* Makes space for n new entries. Note that we actually allow
          * the cache to grow beyond CACHE_MAX, but only when we shall
          * add more RRs to the cache than CACHE_MAX at once. In that
-         * case the cache will be emptied completely otherwise. */
+         * case the cache will be emptied completely otherwise.
+         *
+         * Entries are evicted least recently used first. Expired
+         * entries are removed by dns_cache_prune() anyway, and
+         * evicting by expiry would throw out names with short TTLs
+         * first, which are typically the popular ones. */
 
         for (;;) {
                 _cleanup_(dns_resource_key_unrefp) DnsResourceKey *key = NULL;
@@ -174,7 +187,7 @@ static void dns_cache_make_space(DnsCache *c, unsigned add) {
                 if (prioq_size(c->by_expiry) + add < CACHE_MAX)
                         break;
 
-                i = prioq_peek(c->by_expiry);
+                i = prioq_peek(c->by_use);
                 assert(i);
 
                 /* Take an extra reference to the key so that it
@@ -231,6 +244,20 @@ static int dns_cache_item_prioq_compare_func(const void *a, const void *b) {
         return CMP(x->until, y->until);
 }
 
+static int dns_cache_item_use_prioq_compare_func(const void *a, const void *b) {
+        const DnsCacheItem *x = a, *y = b;
+
+        return CMP(x->last_use, y->last_use);
+}
+
+static void dns_cache_item_touch(DnsCache *c, DnsCacheItem *i) {
+        assert(c);
+        assert(i);
+
+        i->last_use = ++c->use_counter;
+        prioq_reshuffle(c->by_use, i, &i->use_prioq_idx);
+}
+
 static int dns_cache_init(DnsCache *c) {
         int r;
 
@@ -240,6 +267,10 @@ static int dns_cache_init(DnsCache *c) {
         if (r < 0)
                 return r;
 
+        r = prioq_ensure_allocated(&c->by_use, dns_cache_item_use_prioq_compare_func);
+        if (r < 0)
+                return r;
+
         r = hashmap_ensure_allocated(&c->by_key, &dns_resource_key_hash_ops);
         if (r < 0)
                 return r;
@@ -258,6 +289,13 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
         if (r < 0)
                 return r;
 
+        i->last_use = ++c->use_counter;
+        r = prioq_put(c->by_use, i, &i->use_prioq_idx);
+        if (r < 0) {
+                prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                return r;
+        }
+
         first = hashmap_get(c->by_key, i->key);
         if (first) {
                 _cleanup_(dns_resource_key_unrefp) DnsResourceKey *k = NULL;
@@ -279,6 +317,7 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
                 r = hashmap_put(c->by_key, i->key, i);
                 if (r < 0) {
                         prioq_remove(c->by_expiry, i, &i->prioq_idx);
+                        prioq_remove(c->by_use, i, &i->use_prioq_idx);
                         return r;
                 }
         }
@@ -376,6 +415,7 @@ static void dns_cache_item_update_positive(
         i->owner_address = *owner_address;
 
         prioq_reshuffle(c->by_expiry, i, &i->prioq_idx);
+        dns_cache_item_touch(c, i);
 }
 
 static int dns_cache_put_positive(
@@ -449,6 +489,7 @@ static int dns_cache_put_positive(
         i->owner_family = owner_family;
         i->owner_address = *owner_address;
         i->prioq_idx = PRIOQ_IDX_NULL;
+        i->use_prioq_idx = PRIOQ_IDX_NULL;
 
         r = dns_cache_link_item(c, i);
         if (r < 0)
@@ -533,6 +574,7 @@ static int dns_cache_put_negative(
         i->owner_family = owner_family;
         i->owner_address = *owner_address;
         i->prioq_idx = PRIOQ_IDX_NULL;
+        i->use_prioq_idx = PRIOQ_IDX_NULL;
         i->rcode = rcode;
 
         if (i->type == DNS_CACHE_NXDOMAIN) {
@@ -862,6 +904,8 @@ int dns_cache_lookup(DnsCache *c, DnsResourceKey *key, bool clamp_ttl, int *rcod
         }
 
         LIST_FOREACH(by_key, j, first) {
+                dns_cache_item_touch(c, j);
+
                 if (j->rr) {
                         if (j->rr->key->type == DNS_TYPE_NSEC)
                                 nsec = j;
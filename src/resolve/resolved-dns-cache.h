@@ -9,6 +9,8 @@
 typedef struct DnsCache {
         Hashmap *by_key;
         Prioq *by_expiry;
+        Prioq *by_use;
+        uint64_t use_counter;
         unsigned n_hit;
         unsigned n_miss;
 } DnsCache;
@@ -1381,8 +1381,11 @@ int dns_packet_read_name(
 
         _cleanup_(rewind_dns_packet) DnsPacketRewinder rewinder;
         size_t after_rindex = 0, jump_barrier;
-        _cleanup_free_ char *ret = NULL;
-        size_t n = 0, allocated = 0;
+        /* Assemble the name on the stack first, so that we allocate exactly what is needed for the common case of
+         * names of regular length. Only if a name gets longer we move it to the heap. */
+        char stack[DNS_HOSTNAME_MAX + 1 + DNS_LABEL_ESCAPED_MAX], *ret = stack;
+        _cleanup_free_ char *heap = NULL;
+        size_t n = 0, allocated = sizeof(stack);
         bool first = true;
         int r;
 
@@ -1412,8 +1415,14 @@ int dns_packet_read_name(
                         if (r < 0)
                                 return r;
 
-                        if (!GREEDY_REALLOC(ret, allocated, n + !first + DNS_LABEL_ESCAPED_MAX))
-                                return -ENOMEM;
+                        if (n + !first + DNS_LABEL_ESCAPED_MAX > allocated) {
+                                if (!GREEDY_REALLOC(heap, allocated, n + !first + DNS_LABEL_ESCAPED_MAX))
+                                        return -ENOMEM;
+
+                                if (ret == stack)
+                                        memcpy(heap, stack, n);
+                                ret = heap;
+                        }
 
                         if (first)
                                 first = false;
@@ -1448,15 +1457,18 @@ int dns_packet_read_name(
                         return -EBADMSG;
         }
 
-        if (!GREEDY_REALLOC(ret, allocated, n + 1))
-                return -ENOMEM;
-
         ret[n] = 0;
 
+        if (ret == stack) {
+                heap = memdup(stack, n + 1);
+                if (!heap)
+                        return -ENOMEM;
+        }
+
         if (after_rindex != 0)
                 p->rindex= after_rindex;
 
-        *_ret = TAKE_PTR(ret);
+        *_ret = TAKE_PTR(heap);
 
         if (start)
                 *start = rewinder.saved_rindex;
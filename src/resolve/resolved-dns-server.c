@@ -17,6 +17,12 @@
 /* The number of times we will attempt a certain feature set before degrading */
 #define DNS_SERVER_FEATURE_RETRY_ATTEMPTS 3
 
+/* The range of time to wait for a reply to a UDP packet before resending, adjusted to the server's round-trip
+ * time. The lower bound is the minimum retransmission timeout of RFC 6298, the upper bound is the fixed timeout we
+ * use until we have measured the server at all. */
+#define DNS_TIMEOUT_MIN_USEC (1 * USEC_PER_SEC)
+#define DNS_TIMEOUT_MAX_USEC (SD_RESOLVED_QUERY_TIMEOUT_USEC / DNS_TRANSACTION_ATTEMPTS_MAX)
+
 int dns_server_new(
                 Manager *m,
                 DnsServer **ret,
@@ -53,6 +59,7 @@ int dns_server_new(
         s->family = family;
         s->address = *in_addr;
         s->ifindex = ifindex;
+        s->resend_timeout = DNS_TIMEOUT_MAX_USEC;
 
         dns_server_reset_features(s);
 
@@ -238,12 +245,35 @@ static void dns_server_reset_counters(DnsServer *s) {
          * incomplete. */
 }
 
-void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t size) {
+static void dns_server_update_rtt(DnsServer *s, usec_t rtt) {
+        usec_t delta;
+
+        assert(s);
+
+        /* Estimate the round-trip time and its variation the way RFC 6298 does for TCP, and wait that long plus
+         * four times the variation before resending. A new sample also undoes any backoff after lost packets, so
+         * that a server that was slow for a while recovers once it answers quickly again. */
+
+        if (s->srtt == 0) {
+                s->srtt = MAX(rtt, 1U);
+                s->rttvar = rtt / 2;
+        } else {
+                delta = s->srtt > rtt ? s->srtt - rtt : rtt - s->srtt;
+                s->rttvar = (3 * s->rttvar + delta) / 4;
+                s->srtt = MAX((7 * s->srtt + rtt) / 8, 1U);
+        }
+
+        s->resend_timeout = CLAMP(s->srtt + 4 * s->rttvar, DNS_TIMEOUT_MIN_USEC, DNS_TIMEOUT_MAX_USEC);
+}
+
+void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, usec_t rtt, size_t size) {
         assert(s);
 
         if (protocol == IPPROTO_UDP) {
                 if (s->possible_feature_level == level)
                         s->n_failed_udp = 0;
+
+                dns_server_update_rtt(s, rtt);
         } else if (protocol == IPPROTO_TCP) {
                 if (DNS_SERVER_FEATURE_LEVEL_IS_TLS(level)) {
                         if (s->possible_feature_level == level)
@@ -279,10 +309,13 @@ void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLeve
                 s->received_udp_packet_max = size;
 }
 
-void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level) {
+void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level, usec_t usec) {
         assert(s);
         assert(s->manager);
 
+        if (protocol == IPPROTO_UDP && s->resend_timeout <= usec)
+                s->resend_timeout = MIN(s->resend_timeout * 2, DNS_TIMEOUT_MAX_USEC);
+
         if (s->possible_feature_level == level) {
                 if (protocol == IPPROTO_UDP)
                         s->n_failed_udp++;
@@ -867,6 +900,14 @@ void dns_server_dump(DnsServer *s, FILE *f) {
         fputs(strna(dns_server_feature_level_to_string(s->possible_feature_level)), f);
         fputc('\n', f);
 
+        if (s->srtt > 0) {
+                char buf[FORMAT_TIMESPAN_MAX];
+
+                fprintf(f, "\tSmoothed UDP round-trip time: %s\n", format_timespan(buf, sizeof(buf), s->srtt, USEC_PER_MSEC));
+                fprintf(f, "\tUDP round-trip time variation: %s\n", format_timespan(buf, sizeof(buf), s->rttvar, USEC_PER_MSEC));
+                fprintf(f, "\tUDP resend timeout: %s\n", format_timespan(buf, sizeof(buf), s->resend_timeout, USEC_PER_MSEC));
+        }
+
         fputs("\tDNSSEC Mode: ", f);
         fputs(strna(dnssec_mode_to_string(dns_server_get_dnssec_mode(s))), f);
         fputc('\n', f);
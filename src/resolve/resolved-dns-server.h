@@ -65,6 +65,12 @@ struct DnsServer {
 
         size_t received_udp_packet_max;
 
+        /* The smoothed round-trip time of UDP packets and its variation, and the resulting time to wait before
+         * resending */
+        usec_t srtt;
+        usec_t rttvar;
+        usec_t resend_timeout;
+
         unsigned n_failed_udp;
         unsigned n_failed_tcp;
         unsigned n_failed_tls;
@@ -102,8 +108,8 @@ DnsServer* dns_server_unref(DnsServer *s);
 void dns_server_unlink(DnsServer *s);
 void dns_server_move_back_and_unmark(DnsServer *s);
 
-void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, size_t size);
-void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level);
+void dns_server_packet_received(DnsServer *s, int protocol, DnsServerFeatureLevel level, usec_t rtt, size_t size);
+void dns_server_packet_lost(DnsServer *s, int protocol, DnsServerFeatureLevel level, usec_t usec);
 void dns_server_packet_truncated(DnsServer *s, DnsServerFeatureLevel level);
 void dns_server_packet_rrsig_missing(DnsServer *s, DnsServerFeatureLevel level);
 void dns_server_packet_bad_opt(DnsServer *s, DnsServerFeatureLevel level);
@@ -9,6 +9,7 @@
 #include "resolved-dns-stream.h"
 
 #define DNS_STREAM_TIMEOUT_USEC (10 * USEC_PER_SEC)
+#define DNS_STREAM_MESSAGE_TIMEOUT_USEC (10 * USEC_PER_SEC)
 #define DNS_STREAMS_MAX 128
 
 static void dns_stream_stop(DnsStream *s) {
@@ -264,6 +265,20 @@ static ssize_t dns_stream_read(DnsStream *s, void *buf, size_t count) {
         return ss;
 }
 
+static bool dns_stream_busy(DnsStream *s) {
+        assert(s);
+
+        /* Are we in the middle of reading a message, or do we have one to write? */
+
+        if (s->write_packet && s->n_written < sizeof(s->write_size) + s->write_packet->size)
+                return true;
+
+        if (s->n_read > 0 && (!s->read_packet || s->n_read < sizeof(s->read_size) + s->read_packet->size))
+                return true;
+
+        return false;
+}
+
 static int on_stream_timeout(sd_event_source *es, usec_t usec, void *userdata) {
         DnsStream *s = userdata;
 
@@ -274,6 +289,8 @@ static int on_stream_timeout(sd_event_source *es, usec_t usec, void *userdata) {
 
 static int on_stream_io(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
         DnsStream *s = userdata;
+        bool progressed = false, completed = false;
+        usec_t n, t;
         int r;
 
         assert(s);
@@ -321,11 +338,15 @@ static int on_stream_io(sd_event_source *es, int fd, uint32_t revents, void *use
                 if (ss < 0) {
                         if (!IN_SET(-ss, EINTR, EAGAIN))
                                 return dns_stream_complete(s, -ss);
-                } else
+                } else {
+                        progressed = true;
                         s->n_written += ss;
+                }
 
                 /* Are we done? If so, disable the event source for EPOLLOUT */
                 if (s->n_written >= sizeof(s->write_size) + s->write_packet->size) {
+                        completed = true;
+
                         r = dns_stream_update_io(s);
                         if (r < 0)
                                 return dns_stream_complete(s, -r);
@@ -345,8 +366,10 @@ static int on_stream_io(sd_event_source *es, int fd, uint32_t revents, void *use
                                         return dns_stream_complete(s, -ss);
                         } else if (ss == 0)
                                 return dns_stream_complete(s, ECONNRESET);
-                        else
+                        else {
+                                progressed = true;
                                 s->n_read += ss;
+                        }
                 }
 
                 if (s->n_read >= sizeof(s->read_size)) {
@@ -395,12 +418,16 @@ static int on_stream_io(sd_event_source *es, int fd, uint32_t revents, void *use
                                                 return dns_stream_complete(s, -ss);
                                 } else if (ss == 0)
                                         return dns_stream_complete(s, ECONNRESET);
-                                else
+                                else {
+                                        progressed = true;
                                         s->n_read += ss;
+                                }
                         }
 
                         /* Are we done? If so, disable the event source for EPOLLIN */
                         if (s->n_read >= sizeof(s->read_size) + be16toh(s->read_size)) {
+                                completed = true;
+
                                 /* If there's a packet handler
                                  * installed, call that. Note that
                                  * this is optional... */
@@ -421,6 +448,26 @@ static int on_stream_io(sd_event_source *es, int fd, uint32_t revents, void *use
             (s->read_packet && s->n_read >= sizeof(s->read_size) + s->read_packet->size))
                 return dns_stream_complete(s, 0);
 
+        /* The timeout is about idle streams: as long as data is flowing, a shared stream (and in particular its
+         * TLS session) is worth keeping, instead of reconnecting every DNS_STREAM_TIMEOUT_USEC. However, a peer
+         * that trickles in a byte now and then must not be able to keep a stream busy forever, hence each
+         * message also has to be transferred completely within DNS_STREAM_MESSAGE_TIMEOUT_USEC, regardless of
+         * any progress in between. */
+        if (progressed && s->timeout_event_source) {
+                n = now(clock_boottime_or_monotonic());
+
+                if (!dns_stream_busy(s))
+                        s->message_deadline = USEC_INFINITY;
+                else if (completed || s->message_deadline == USEC_INFINITY)
+                        s->message_deadline = usec_add(n, DNS_STREAM_MESSAGE_TIMEOUT_USEC);
+
+                t = MIN(usec_add(n, DNS_STREAM_TIMEOUT_USEC), s->message_deadline);
+
+                r = sd_event_source_set_time(s->timeout_event_source, t);
+                if (r < 0)
+                        log_warning_errno(r, "Couldn't restart TCP connection timeout, ignoring: %m");
+        }
+
         return 0;
 }
 
@@ -480,6 +527,7 @@ int dns_stream_new(Manager *m, DnsStream **ret, DnsProtocol protocol, int fd, co
         s->n_ref = 1;
         s->fd = -1;
         s->protocol = protocol;
+        s->message_deadline = USEC_INFINITY;
 
         r = sd_event_add_io(m->event, &s->io_event_source, fd, EPOLLIN, on_stream_io, s);
         if (r < 0)
@@ -808,6 +808,7 @@ int dissected_image_mount(DissectedImage *m, const char *where, uid_t uid_shift,
 typedef struct DecryptedPartition {
         struct crypt_device *device;
         char *name;
+        int fd; /* A device set up by somebody else is held open, so that its deferred removal can't happen under us */
         bool relinquished;
 } DecryptedPartition;
 
@@ -838,6 +839,7 @@ DecryptedImage* decrypted_image_unref(DecryptedImage* d) {
                 if (p->device)
                         crypt_free(p->device);
                 free(p->name);
+                safe_close(p->fd);
         }
 
         free(d);
@@ -926,6 +928,7 @@ static int decrypt_partition(
 
         d->decrypted[d->n_decrypted].name = TAKE_PTR(name);
         d->decrypted[d->n_decrypted].device = TAKE_PTR(cd);
+        d->decrypted[d->n_decrypted].fd = -1;
         d->n_decrypted++;
 
         m->decrypted_node = TAKE_PTR(node);
@@ -933,6 +936,77 @@ static int decrypt_partition(
         return 0;
 }
 
+static int verity_can_reuse(const void *root_hash, size_t root_hash_size, const char *name, struct crypt_device **ret_cd) {
+        _cleanup_(crypt_freep) struct crypt_device *cd = NULL;
+        _cleanup_free_ void *existing = NULL;
+        size_t existing_size;
+        int r;
+
+        assert(root_hash);
+        assert(name);
+        assert(ret_cd);
+
+        /* The verity device exists already, because somebody else set it up on the same shared loop device. Only
+         * use it if it verifies against the very same root hash we were asked to use. */
+
+        r = crypt_init_by_name(&cd, name);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to open existing verity device %s: %m", name);
+
+        if (!streq_ptr(crypt_get_type(cd), CRYPT_VERITY)) {
+                log_debug("Existing device %s is not a verity device, refusing to reuse it.", name);
+                return -EEXIST;
+        }
+
+        existing_size = root_hash_size;
+        existing = malloc0(existing_size);
+        if (!existing)
+                return -ENOMEM;
+
+        r = crypt_volume_key_get(cd, CRYPT_ANY_SLOT, existing, &existing_size, NULL, 0);
+        if (r < 0)
+                return log_debug_errno(r, "Failed to get root hash of existing verity device %s: %m", name);
+
+        if (existing_size != root_hash_size || memcmp(existing, root_hash, root_hash_size) != 0) {
+                log_debug("Existing verity device %s uses a different root hash, refusing to reuse it.", name);
+                return -EEXIST;
+        }
+
+        *ret_cd = TAKE_PTR(cd);
+        return 0;
+}
+
+static int verity_open_existing(
+                const char *node,
+                const char *name,
+                const void *root_hash,
+                size_t root_hash_size,
+                struct crypt_device **ret_cd,
+                int *ret_fd) {
+
+        _cleanup_close_ int fd = -1;
+        int r;
+
+        assert(node);
+        assert(ret_fd);
+
+        /* Opens a verity device set up by somebody else, if there is one. We open the node before checking the
+         * device, and keep it open until we are done with it, as its creator requested deferred removal: the kernel
+         * removes the device as soon as nobody has it open anymore, possibly right between our check and our
+         * mount. Returns -ENOENT if there's no such device. */
+
+        fd = open(node, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        r = verity_can_reuse(root_hash, root_hash_size, name, ret_cd);
+        if (r < 0)
+                return r;
+
+        *ret_fd = TAKE_FD(fd);
+        return 0;
+}
+
 static int verity_partition(
                 DissectedPartition *m,
                 DissectedPartition *v,
@@ -943,6 +1017,7 @@ static int verity_partition(
 
         _cleanup_free_ char *node = NULL, *name = NULL;
         _cleanup_(crypt_freep) struct crypt_device *cd = NULL;
+        _cleanup_close_ int fd = -1;
         int r;
 
         assert(m);
@@ -966,24 +1041,38 @@ static int verity_partition(
         if (!GREEDY_REALLOC0(d->decrypted, d->n_allocated, d->n_decrypted + 1))
                 return -ENOMEM;
 
-        r = crypt_init(&cd, v->node);
-        if (r < 0)
-                return r;
+        /* If set up already via a shared loop device, the device isn't ours, and stays around as long as any of its
+         * users has it open, thanks to the deferred removal its creator requested. */
+        r = verity_open_existing(node, name, root_hash, root_hash_size, &cd, &fd);
+        if (r == -ENOENT) {
+                r = crypt_init(&cd, v->node);
+                if (r < 0)
+                        return r;
 
-        r = crypt_load(cd, CRYPT_VERITY, NULL);
-        if (r < 0)
-                return r;
+                r = crypt_load(cd, CRYPT_VERITY, NULL);
+                if (r < 0)
+                        return r;
 
-        r = crypt_set_data_device(cd, m->node);
-        if (r < 0)
-                return r;
+                r = crypt_set_data_device(cd, m->node);
+                if (r < 0)
+                        return r;
 
-        r = crypt_activate_by_volume_key(cd, name, root_hash, root_hash_size, CRYPT_ACTIVATE_READONLY);
+                r = crypt_activate_by_volume_key(cd, name, root_hash, root_hash_size, CRYPT_ACTIVATE_READONLY);
+                if (r == -EEXIST) {
+                        /* Somebody else using the same shared loop device was faster than us, use theirs */
+                        crypt_free(cd);
+                        cd = NULL;
+
+                        r = verity_open_existing(node, name, root_hash, root_hash_size, &cd, &fd);
+                }
+        }
         if (r < 0)
                 return r;
 
         d->decrypted[d->n_decrypted].name = TAKE_PTR(name);
         d->decrypted[d->n_decrypted].device = TAKE_PTR(cd);
+        d->decrypted[d->n_decrypted].relinquished = fd >= 0;
+        d->decrypted[d->n_decrypted].fd = TAKE_FD(fd);
         d->n_decrypted++;
 
         m->decrypted_node = TAKE_PTR(node);
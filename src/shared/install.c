@@ -709,24 +709,52 @@ static int is_symlink_with_known_name(const UnitFileInstallInfo *i, const char *
         return false;
 }
 
-static int find_symlinks_fd(
+typedef struct SymlinkEntry {
+        char *path; /* The absolute path of the symlink */
+        char *dest; /* Where it points to, made absolute */
+} SymlinkEntry;
+
+typedef struct SymlinkDir {
+        SymlinkEntry *entries;
+        size_t n_entries, n_allocated;
+        int error; /* The first error we ran into while reading the directory tree */
+} SymlinkDir;
+
+static void symlink_dir_free(SymlinkDir *d) {
+        size_t k;
+
+        if (!d)
+                return;
+
+        for (k = 0; k < d->n_entries; k++) {
+                free(d->entries[k].path);
+                free(d->entries[k].dest);
+        }
+
+        free(d->entries);
+        free(d);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(SymlinkDir*, symlink_dir_free);
+
+static Hashmap* symlinks_cache_free(Hashmap *h) {
+        return hashmap_free_with_destructor(h, symlink_dir_free);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(Hashmap*, symlinks_cache_free);
+
+static int symlink_dir_load_fd(
                 const char *root_dir,
-                UnitFileInstallInfo *i,
-                bool match_aliases,
+                SymlinkDir *sd,
                 int fd,
-                const char *path,
-                const char *config_path,
-                bool *same_name_link) {
+                const char *path) {
 
         _cleanup_closedir_ DIR *d = NULL;
         struct dirent *de;
-        int r = 0;
 
-        assert(i);
+        assert(sd);
         assert(fd >= 0);
         assert(path);
-        assert(config_path);
-        assert(same_name_link);
 
         d = fdopendir(fd);
         if (!d) {
@@ -747,8 +775,8 @@ static int find_symlinks_fd(
                                 if (errno == ENOENT)
                                         continue;
 
-                                if (r == 0)
-                                        r = -errno;
+                                if (sd->error == 0)
+                                        sd->error = -errno;
                                 continue;
                         }
 
@@ -759,16 +787,14 @@ static int find_symlinks_fd(
                         }
 
                         /* This will close nfd, regardless whether it succeeds or not */
-                        q = find_symlinks_fd(root_dir, i, match_aliases, nfd,
-                                             p, config_path, same_name_link);
-                        if (q > 0)
-                                return 1;
-                        if (r == 0)
-                                r = q;
+                        q = symlink_dir_load_fd(root_dir, sd, nfd, p);
+                        if (q == -ENOMEM)
+                                return q;
+                        if (q < 0 && sd->error == 0)
+                                sd->error = q;
 
                 } else if (de->d_type == DT_LNK) {
                         _cleanup_free_ char *p = NULL, *dest = NULL;
-                        bool found_path, found_dest, b = false;
                         int q;
 
                         /* Acquire symlink name */
@@ -781,8 +807,8 @@ static int find_symlinks_fd(
                         if (q == -ENOENT)
                                 continue;
                         if (q < 0) {
-                                if (r == 0)
-                                        r = q;
+                                if (sd->error == 0)
+                                        sd->error = q;
                                 continue;
                         }
 
@@ -798,77 +824,144 @@ static int find_symlinks_fd(
                                 dest = x;
                         }
 
-                        /* Check if the symlink itself matches what we
-                         * are looking for */
-                        if (path_is_absolute(i->name))
-                                found_path = path_equal(p, i->name);
-                        else
-                                found_path = streq(de->d_name, i->name);
+                        if (!GREEDY_REALLOC(sd->entries, sd->n_allocated, sd->n_entries + 1))
+                                return -ENOMEM;
 
-                        /* Check if what the symlink points to
-                         * matches what we are looking for */
-                        if (path_is_absolute(i->name))
-                                found_dest = path_equal(dest, i->name);
-                        else
-                                found_dest = streq(basename(dest), i->name);
+                        sd->entries[sd->n_entries++] = (SymlinkEntry) {
+                                .path = TAKE_PTR(p),
+                                .dest = TAKE_PTR(dest),
+                        };
+                }
+        }
 
-                        if (found_path && found_dest) {
-                                _cleanup_free_ char *t = NULL;
+        return 0;
+}
 
-                                /* Filter out same name links in the main
-                                 * config path */
-                                t = path_make_absolute(i->name, config_path);
-                                if (!t)
-                                        return -ENOMEM;
+static int symlinks_cache_get(
+                Hashmap **cache,
+                const char *root_dir,
+                const char *config_path,
+                SymlinkDir **ret) {
 
-                                b = path_equal(t, p);
-                        }
+        _cleanup_(symlink_dir_freep) SymlinkDir *n = NULL;
+        SymlinkDir *sd;
+        int fd, r;
 
-                        if (b)
-                                *same_name_link = true;
-                        else if (found_path || found_dest) {
-                                if (!match_aliases)
-                                        return 1;
-
-                                /* Check if symlink name is in the set of names used by [Install] */
-                                q = is_symlink_with_known_name(i, de->d_name);
-                                if (q < 0)
-                                        return q;
-                                if (q > 0)
-                                        return 1;
-                        }
-                }
+        assert(cache);
+        assert(config_path);
+        assert(ret);
+
+        /* Reading all symlinks below a directory is the expensive part of determining the state of a unit file,
+         * hence we do it only once per directory and keep the result around in the cache, for all units that
+         * are looked at in one go. */
+
+        sd = hashmap_get(*cache, config_path);
+        if (sd) {
+                *ret = sd;
+                return 0;
         }
 
-        return r;
+        r = hashmap_ensure_allocated(cache, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        n = new0(SymlinkDir, 1);
+        if (!n)
+                return -ENOMEM;
+
+        fd = open(config_path, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC);
+        if (fd < 0) {
+                if (!IN_SET(errno, ENOENT, ENOTDIR, EACCES))
+                        n->error = -errno;
+        } else {
+                /* This takes possession of fd and closes it */
+                r = symlink_dir_load_fd(root_dir, n, fd, config_path);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0 && n->error == 0)
+                        n->error = r;
+        }
+
+        /* The key is owned by the LookupPaths object, which outlives the cache */
+        r = hashmap_put(*cache, config_path, n);
+        if (r < 0)
+                return r;
+
+        *ret = TAKE_PTR(n);
+        return 0;
 }
 
 static int find_symlinks(
+                Hashmap **cache,
                 const char *root_dir,
                 UnitFileInstallInfo *i,
-                bool match_name,
+                bool match_aliases,
                 const char *config_path,
                 bool *same_name_link) {
 
-        int fd;
+        SymlinkDir *sd;
+        size_t k;
+        int r;
 
         assert(i);
         assert(config_path);
         assert(same_name_link);
 
-        fd = open(config_path, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC);
-        if (fd < 0) {
-                if (IN_SET(errno, ENOENT, ENOTDIR, EACCES))
-                        return 0;
-                return -errno;
+        r = symlinks_cache_get(cache, root_dir, config_path, &sd);
+        if (r < 0)
+                return r;
+
+        for (k = 0; k < sd->n_entries; k++) {
+                const SymlinkEntry *e = sd->entries + k;
+                const char *name = basename(e->path);
+                bool found_path, found_dest, b = false;
+
+                /* Check if the symlink itself matches what we
+                 * are looking for */
+                if (path_is_absolute(i->name))
+                        found_path = path_equal(e->path, i->name);
+                else
+                        found_path = streq(name, i->name);
+
+                /* Check if what the symlink points to
+                 * matches what we are looking for */
+                if (path_is_absolute(i->name))
+                        found_dest = path_equal(e->dest, i->name);
+                else
+                        found_dest = streq(basename(e->dest), i->name);
+
+                if (found_path && found_dest) {
+                        _cleanup_free_ char *t = NULL;
+
+                        /* Filter out same name links in the main
+                         * config path */
+                        t = path_make_absolute(i->name, config_path);
+                        if (!t)
+                                return -ENOMEM;
+
+                        b = path_equal(t, e->path);
+                }
+
+                if (b)
+                        *same_name_link = true;
+                else if (found_path || found_dest) {
+                        if (!match_aliases)
+                                return 1;
+
+                        /* Check if symlink name is in the set of names used by [Install] */
+                        r = is_symlink_with_known_name(i, name);
+                        if (r < 0)
+                                return r;
+                        if (r > 0)
+                                return 1;
+                }
         }
 
-        /* This takes possession of fd and closes it */
-        return find_symlinks_fd(root_dir, i, match_name, fd,
-                                config_path, config_path, same_name_link);
+        return sd->error;
 }
 
 static int find_symlinks_in_scope(
+                Hashmap **cache,
                 UnitFileScope scope,
                 const LookupPaths *paths,
                 UnitFileInstallInfo *i,
@@ -886,7 +979,7 @@ static int find_symlinks_in_scope(
         STRV_FOREACH(p, paths->search_path)  {
                 bool same_name_link = false;
 
-                r = find_symlinks(paths->root_dir, i, match_name, *p, &same_name_link);
+                r = find_symlinks(cache, paths->root_dir, i, match_name, *p, &same_name_link);
                 if (r < 0)
                         return r;
                 if (r > 0) {
@@ -2638,7 +2731,8 @@ int unit_file_get_default(
         return 0;
 }
 
-int unit_file_lookup_state(
+static int unit_file_lookup_state_internal(
+                Hashmap **cache,
                 UnitFileScope scope,
                 const LookupPaths *paths,
                 const char *name,
@@ -2694,7 +2788,7 @@ int unit_file_lookup_state(
                 /* Check if any of the Alias= symlinks have been created.
                  * We ignore other aliases, and only check those that would
                  * be created by systemctl enable for this unit. */
-                r = find_symlinks_in_scope(scope, paths, i, true, &state);
+                r = find_symlinks_in_scope(cache, scope, paths, i, true, &state);
                 if (r < 0)
                         return r;
                 if (r > 0)
@@ -2702,7 +2796,7 @@ int unit_file_lookup_state(
 
                 /* Check if the file is known under other names. If it is,
                  * it might be in use. Report that as UNIT_FILE_INDIRECT. */
-                r = find_symlinks_in_scope(scope, paths, i, false, &state);
+                r = find_symlinks_in_scope(cache, scope, paths, i, false, &state);
                 if (r < 0)
                         return r;
                 if (r > 0)
@@ -2726,6 +2820,17 @@ int unit_file_lookup_state(
         return 0;
 }
 
+int unit_file_lookup_state(
+                UnitFileScope scope,
+                const LookupPaths *paths,
+                const char *name,
+                UnitFileState *ret) {
+
+        _cleanup_(symlinks_cache_freep) Hashmap *cache = NULL;
+
+        return unit_file_lookup_state_internal(&cache, scope, paths, name, ret);
+}
+
 int unit_file_get_state(
                 UnitFileScope scope,
                 const char *root_dir,
@@ -2925,19 +3030,16 @@ static int read_presets(UnitFileScope scope, const char *root_dir, Presets *pres
 static int pattern_match_multiple_instances(
                         const PresetRule rule,
                         const char *unit_name,
+                        const char *templated_name,
                         char ***ret) {
 
-        _cleanup_free_ char *templated_name = NULL;
         int r;
 
-        /* If no ret is needed or the rule itself does not have instances
-         * initalized, we return not matching */
-        if (!ret || !rule.instances)
+        /* If no ret is needed, the unit is neither a template nor an instance,
+         * or the rule itself does not have instances initalized, we return not matching */
+        if (!ret || !templated_name || !rule.instances)
                 return 0;
 
-        r = unit_name_template(unit_name, &templated_name);
-        if (r < 0)
-                return r;
         if (!streq(rule.pattern, templated_name))
                 return 0;
 
@@ -2978,14 +3080,25 @@ static int pattern_match_multiple_instances(
 }
 
 static int query_presets(const char *name, const Presets presets, char ***instance_name_list) {
+        _cleanup_free_ char *templated_name = NULL;
         PresetAction action = PRESET_UNKNOWN;
         size_t i;
         char **s;
+        int r;
+
         if (!unit_name_is_valid(name, UNIT_NAME_ANY))
                 return -EINVAL;
 
+        /* This is called for every unit file on preset-all, and matched against every rule, hence determine the
+         * template name only once, and only if it might be needed. */
+        if (instance_name_list && unit_name_is_valid(name, UNIT_NAME_INSTANCE|UNIT_NAME_TEMPLATE)) {
+                r = unit_name_template(name, &templated_name);
+                if (r < 0)
+                        return r;
+        }
+
         for (i = 0; i < presets.n_rules; i++)
-                if (pattern_match_multiple_instances(presets.rules[i], name, instance_name_list) > 0 ||
+                if (pattern_match_multiple_instances(presets.rules[i], name, templated_name, instance_name_list) > 0 ||
                     fnmatch(presets.rules[i].pattern, name, FNM_NOESCAPE) == 0) {
                         action = presets.rules[i].action;
                         break;
@@ -3244,6 +3357,7 @@ int unit_file_get_list(
                 char **patterns) {
 
         _cleanup_(lookup_paths_free) LookupPaths paths = {};
+        _cleanup_(symlinks_cache_freep) Hashmap *cache = NULL;
         char **i;
         int r;
 
@@ -3296,7 +3410,7 @@ int unit_file_get_list(
                         if (!f->path)
                                 return -ENOMEM;
 
-                        r = unit_file_lookup_state(scope, &paths, de->d_name, &f->state);
+                        r = unit_file_lookup_state_internal(&cache, scope, &paths, de->d_name, &f->state);
                         if (r < 0)
                                 f->state = UNIT_FILE_BAD;
 
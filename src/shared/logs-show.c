@@ -102,18 +102,37 @@ typedef struct ParseFieldVec {
 #define PARSE_FIELD_VEC_ENTRY(_field, _target, _target_len) \
         { .field = _field, .field_len = strlen(_field), .target = _target, .target_len = _target_len }
 
-static int parse_fieldv(const void *data, size_t length, const ParseFieldVec *fields, unsigned n_fields) {
+static int get_fieldv(sd_journal *j, const ParseFieldVec *fields, unsigned n_fields) {
+        const char **names;
+        const void **data;
+        size_t *lengths;
         unsigned i;
+        int r;
+
+        /* Fetch all fields in one go, so that data objects of other fields are never decompressed */
+
+        names = newa(const char*, n_fields);
+        data = newa(const void*, n_fields);
+        lengths = newa(size_t, n_fields);
+
+        for (i = 0; i < n_fields; i++) {
+                assert(fields[i].field_len > 0 && fields[i].field[fields[i].field_len - 1] == '=');
+                names[i] = strndupa(fields[i].field, fields[i].field_len - 1);
+        }
+
+        r = sd_journal_get_data_batch(j, names, n_fields, data, lengths);
+        if (r < 0)
+                return r;
 
         for (i = 0; i < n_fields; i++) {
                 const ParseFieldVec *f = &fields[i];
-                int r;
 
-                r = parse_field(data, length, f->field, f->field_len, f->target, f->target_len);
+                if (!data[i])
+                        continue;
+
+                r = parse_field(data[i], lengths[i], f->field, f->field_len, f->target, f->target_len);
                 if (r < 0)
                         return r;
-                else if (r > 0)
-                        break;
         }
 
         return 0;
@@ -378,8 +397,6 @@ static int output_short(
                 const size_t highlight[2]) {
 
         int r;
-        const void *data;
-        size_t length;
         size_t n = 0;
         _cleanup_free_ char *hostname = NULL, *identifier = NULL, *comm = NULL, *pid = NULL, *fake_pid = NULL, *message = NULL, *realtime = NULL, *monotonic = NULL, *priority = NULL, *unit = NULL, *user_unit = NULL;
         size_t hostname_len = 0, identifier_len = 0, comm_len = 0, pid_len = 0, fake_pid_len = 0, message_len = 0, realtime_len = 0, monotonic_len = 0, priority_len = 0, unit_len = 0, user_unit_len = 0;
@@ -411,11 +428,7 @@ static int output_short(
          */
         sd_journal_set_data_threshold(j, flags & (OUTPUT_SHOW_ALL|OUTPUT_FULL_WIDTH) ? 0 : PRINT_CHAR_THRESHOLD + 1);
 
-        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
-                r = parse_fieldv(data, length, fields, ELEMENTSOF(fields));
-                if (r < 0)
-                        return r;
-        }
+        r = get_fieldv(j, fields, ELEMENTSOF(fields));
         if (r == -EBADMSG) {
                 log_debug_errno(r, "Skipping message we can't read: %m");
                 return 0;
@@ -730,6 +743,18 @@ void json_escape(
                 fputc('\"', f);
 
                 while (l > 0) {
+                        size_t k;
+
+                        /* Write out runs of characters that need no escaping in one go */
+                        for (k = 0; k < l && (uint8_t) p[k] >= ' ' && !IN_SET(p[k], '"', '\\'); k++)
+                                ;
+                        if (k > 0) {
+                                fwrite(p, 1, k, f);
+                                p += k;
+                                l -= k;
+                                continue;
+                        }
+
                         if (IN_SET(*p, '"', '\\')) {
                                 fputc('\\', f);
                                 fputc(*p, f);
@@ -1113,6 +1138,37 @@ static int maybe_print_begin_newline(FILE *f, OutputFlags *flags) {
         return 0;
 }
 
+static int skip_previous_not_before(sd_journal *j, unsigned how_many, usec_t not_before) {
+        unsigned i;
+        int r;
+
+        assert(j);
+
+        /* Like sd_journal_previous_skip(), but doesn't go further back than the first entry older than not_before:
+         * entries before that are not shown anyway, and each step backwards means a match lookup in every single
+         * journal file. Returns > 0 if we are positioned on an entry. */
+
+        for (i = 0; i < how_many; i++) {
+                usec_t usec;
+
+                r = sd_journal_previous(j);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                r = sd_journal_get_monotonic_usec(j, &usec, NULL);
+                if (r == -ESTALE)
+                        return 1;
+                if (r < 0)
+                        return r;
+                if (usec < not_before)
+                        return 1;
+        }
+
+        return i > 0;
+}
+
 int show_journal(
                 FILE *f,
                 sd_journal *j,
@@ -1140,7 +1196,10 @@ int show_journal(
                 if (r < 0)
                         return log_error_errno(r, "Failed to seek to tail: %m");
 
-                r = sd_journal_previous_skip(j, how_many);
+                if (not_before > 0)
+                        r = skip_previous_not_before(j, how_many, not_before);
+                else
+                        r = sd_journal_previous_skip(j, how_many);
                 if (r < 0)
                         return log_error_errno(r, "Failed to skip previous: %m");
         }
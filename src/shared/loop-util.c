@@ -7,9 +7,12 @@
 #include <sys/stat.h>
 
 #include "alloc-util.h"
+#include "dirent-util.h"
 #include "fd-util.h"
 #include "loop-util.h"
+#include "parse-util.h"
 #include "stat-util.h"
+#include "string-util.h"
 
 int loop_device_make(int fd, int open_flags, LoopDevice **ret) {
         const struct loop_info64 info = {
@@ -106,6 +109,103 @@ int loop_device_make_by_path(const char *path, int open_flags, LoopDevice **ret)
         return loop_device_make(fd, open_flags, ret);
 }
 
+static int loop_device_find_shared(const struct stat *st, LoopDevice **ret) {
+        _cleanup_closedir_ DIR *d = NULL;
+        struct dirent *de;
+
+        assert(st);
+        assert(ret);
+
+        /* Looks for a loop device that is already set up read-only and with auto-clear for the whole of the
+         * specified file. The kernel keeps such a device around as long as anybody has it open, hence once we have
+         * it open it's ours to use just like the other users', and it goes away when the last one of us is done. We
+         * hence mark it as relinquished right away, it's not ours to clean up. */
+
+        d = opendir("/sys/block");
+        if (!d)
+                return errno == ENOENT ? 0 : -errno;
+
+        FOREACH_DIRENT(de, d, return -errno) {
+                _cleanup_close_ int loop = -1;
+                _cleanup_free_ char *node = NULL;
+                struct loop_info64 info;
+                const char *e;
+                LoopDevice *l;
+                int nr;
+
+                e = startswith(de->d_name, "loop");
+                if (!e || safe_atoi(e, &nr) < 0 || nr < 0)
+                        continue;
+
+                /* The "loop" subdirectory only exists for bound devices, don't bother with the others */
+                if (faccessat(dirfd(d), strjoina(de->d_name, "/loop"), F_OK, 0) < 0)
+                        continue;
+
+                if (asprintf(&node, "/dev/loop%i", nr) < 0)
+                        return -ENOMEM;
+
+                loop = open(node, O_RDONLY|O_CLOEXEC|O_NONBLOCK|O_NOCTTY);
+                if (loop < 0)
+                        continue;
+
+                /* Only check the backing file now that we have the device open, so that it can't go away anymore */
+                if (ioctl(loop, LOOP_GET_STATUS64, &info) < 0)
+                        continue;
+
+                if (info.lo_device != st->st_dev ||
+                    info.lo_inode != st->st_ino ||
+                    info.lo_offset != 0 ||
+                    info.lo_sizelimit != 0 ||
+                    (info.lo_flags & (LO_FLAGS_AUTOCLEAR|LO_FLAGS_PARTSCAN|LO_FLAGS_READ_ONLY)) != (LO_FLAGS_AUTOCLEAR|LO_FLAGS_PARTSCAN|LO_FLAGS_READ_ONLY))
+                        continue;
+
+                l = new(LoopDevice, 1);
+                if (!l)
+                        return -ENOMEM;
+
+                *l = (LoopDevice) {
+                        .fd = TAKE_FD(loop),
+                        .node = TAKE_PTR(node),
+                        .nr = nr,
+                        .relinquished = true,
+                };
+
+                *ret = l;
+                return 1;
+        }
+
+        return 0;
+}
+
+int loop_device_make_by_path_shared(const char *path, LoopDevice **ret) {
+        _cleanup_close_ int fd = -1;
+        struct stat st;
+        int r;
+
+        assert(path);
+        assert(ret);
+
+        /* Like loop_device_make_by_path() for O_RDONLY, but reuses an existing loop device for the same file if
+         * there is one. This is useful when the same image is used by many consumers at the same time. */
+
+        fd = open(path, O_CLOEXEC|O_NONBLOCK|O_NOCTTY|O_RDONLY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (S_ISREG(st.st_mode)) {
+                r = loop_device_find_shared(&st, ret);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to look for existing loop device for %s, ignoring: %m", path);
+                if (r > 0)
+                        return (*ret)->fd;
+        }
+
+        return loop_device_make(fd, O_RDONLY, ret);
+}
+
 LoopDevice* loop_device_unref(LoopDevice *d) {
         if (!d)
                 return NULL;
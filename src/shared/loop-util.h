@@ -16,6 +16,7 @@ struct LoopDevice {
 
 int loop_device_make(int fd, int open_flags, LoopDevice **ret);
 int loop_device_make_by_path(const char *path, int open_flags, LoopDevice **ret);
+int loop_device_make_by_path_shared(const char *path, LoopDevice **ret);
 
 LoopDevice* loop_device_unref(LoopDevice *d);
 DEFINE_TRIVIAL_CLEANUP_FUNC(LoopDevice*, loop_device_unref);
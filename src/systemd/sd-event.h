@@ -78,6 +78,16 @@ typedef void* sd_event_child_handler_t;
 #endif
 typedef int (*sd_event_inotify_handler_t)(sd_event_source *s, const struct inotify_event *event, void *userdata);
 typedef void (*sd_event_destroy_t)(void *userdata);
+typedef int (*sd_event_work_handler_t)(sd_event *e, void *userdata);
+
+/* Fields are only ever appended to this structure, pass its size to sd_event_source_get_stats() */
+typedef struct sd_event_source_stats {
+        uint64_t n_dispatched;      /* number of times the handler was called */
+        uint64_t dispatch_usec;     /* cumulative time spent in the handler */
+        uint64_t dispatch_max_usec; /* longest single handler call */
+        uint64_t pending_usec;      /* cumulative time between becoming pending and being dispatched */
+        uint64_t pending_max_usec;
+} sd_event_source_stats;
 
 int sd_event_default(sd_event **e);
 
@@ -93,6 +103,8 @@ int sd_event_add_inotify(sd_event *e, sd_event_source **s, const char *path, uin
 int sd_event_add_defer(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
 int sd_event_add_post(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
 int sd_event_add_exit(sd_event *e, sd_event_source **s, sd_event_handler_t callback, void *userdata);
+int sd_event_add_work_queue(sd_event *e, sd_event_source **s);
+int sd_event_post_work(sd_event *e, sd_event_work_handler_t callback, void *userdata);
 
 int sd_event_prepare(sd_event *e);
 int sd_event_wait(sd_event *e, uint64_t usec);
@@ -141,10 +153,13 @@ int sd_event_source_get_time_clock(sd_event_source *s, clockid_t *clock);
 int sd_event_source_get_signal(sd_event_source *s);
 int sd_event_source_get_child_pid(sd_event_source *s, pid_t *pid);
 int sd_event_source_get_inotify_mask(sd_event_source *s, uint32_t *ret);
+int sd_event_source_get_inotify_coalesce(sd_event_source *s);
+int sd_event_source_set_inotify_coalesce(sd_event_source *s, int b);
 int sd_event_source_set_destroy_callback(sd_event_source *s, sd_event_destroy_t callback);
 int sd_event_source_get_destroy_callback(sd_event_source *s, sd_event_destroy_t *ret);
 int sd_event_source_get_floating(sd_event_source *s);
 int sd_event_source_set_floating(sd_event_source *s, int b);
+int sd_event_source_get_stats(sd_event_source *s, sd_event_source_stats *ret, size_t size);
 
 /* Define helpers so that __attribute__((cleanup(sd_event_unrefp))) and similar may be used. */
 _SD_DEFINE_POINTER_CLEANUP_FUNC(sd_event, sd_event_unref);
@@ -36,6 +36,7 @@ int sd_journal_print(int priority, const char *format, ...) _sd_printf_(2, 3);
 int sd_journal_printv(int priority, const char *format, va_list ap) _sd_printf_(2, 0);
 int sd_journal_send(const char *format, ...) _sd_printf_(1, 0) _sd_sentinel_;
 int sd_journal_sendv(const struct iovec *iov, int n);
+int sd_journal_sendv_batch(const struct iovec *iov, const int *n, size_t n_entries);
 int sd_journal_perror(const char *message);
 
 /* Used by the macros below. You probably don't want to call this directly. */
@@ -102,6 +103,7 @@ int sd_journal_get_data_threshold(sd_journal *j, size_t *sz);
 
 int sd_journal_get_data(sd_journal *j, const char *field, const void **data, size_t *l);
 int sd_journal_enumerate_data(sd_journal *j, const void **data, size_t *l);
+int sd_journal_get_data_batch(sd_journal *j, const char * const *fields, size_t n_fields, const void **data, size_t *l);
 void sd_journal_restart_data(sd_journal *j);
 
 int sd_journal_add_match(sd_journal *j, const void *data, size_t size);
@@ -236,6 +236,39 @@ static void test_copy_bytes_regular_file(const char *src, bool try_reflink, uint
         unlink(fn3);
 }
 
+static void test_copy_bytes_sparse(void) {
+        char fn[] = "/tmp/test-copy-sparse-XXXXXX", fn2[] = "/tmp/test-copy-sparse-XXXXXX";
+        _cleanup_free_ char *data = NULL, *copy = NULL;
+        _cleanup_close_ int fd = -1, fd2 = -1;
+        const size_t sz = 256 * 1024;
+        struct stat st;
+
+        /* Data with a large run of NUL bytes in the middle and one at the end */
+        assert_se(data = new0(char, sz));
+        memset(data, 'a', 1000);
+        memset(data + 100 * 1024, 'b', 1000);
+
+        fd = mkostemp_safe(fn);
+        assert_se(fd >= 0);
+        unlink(fn);
+
+        fd2 = mkostemp_safe(fn2);
+        assert_se(fd2 >= 0);
+        unlink(fn2);
+
+        assert_se(write(fd, data, sz) == (ssize_t) sz);
+        assert_se(lseek(fd, 0, SEEK_SET) == 0);
+
+        assert_se(copy_bytes(fd, fd2, (uint64_t) -1, COPY_SPARSE) == 0);
+
+        assert_se(fstat(fd2, &st) >= 0);
+        assert_se((size_t) st.st_size == sz);
+
+        assert_se(copy = new(char, sz));
+        assert_se(pread(fd2, copy, sz, 0) == (ssize_t) sz);
+        assert_se(memcmp(data, copy, sz) == 0);
+}
+
 static void test_copy_atomic(void) {
         _cleanup_(rm_rf_physical_and_freep) char *p = NULL;
         const char *q;
@@ -267,6 +300,7 @@ int main(int argc, char *argv[]) {
         test_copy_bytes_regular_file(argv[0], true, 1000);
         test_copy_bytes_regular_file(argv[0], false, 32000); /* larger than copy buffer size */
         test_copy_bytes_regular_file(argv[0], true, 32000);
+        test_copy_bytes_sparse();
         test_copy_atomic();
 
         return 0;
@@ -1,8 +1,10 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "alloc-util.h"
 #include "log.h"
@@ -68,11 +70,48 @@ static void test_bad_input(void) {
         assert_se(journal_importer_eof(&imp));
 }
 
+static void test_push_data(void) {
+        _cleanup_(journal_importer_cleanup) JournalImporter imp = {
+                .fd = STDIN_FILENO,
+                .passive_fd = true,
+        };
+        static const char data[] =
+                "FOO=1\n"
+                "BAR=2\n"
+                "\n"
+                "BAZ=3\n"
+                "\n"
+                "INCOMPLETE=4\n";
+        struct iovec *iovec;
+
+        assert_se(journal_importer_push_data(&imp, data, strlen(data)) >= 0);
+
+        /* Each call parses a complete entry */
+        assert_se(journal_importer_process_data(&imp) == 1);
+        assert_se(imp.iovw.count == 2);
+        assert_iovec_entry(&imp.iovw.iovec[0], "FOO=1");
+        assert_iovec_entry(&imp.iovw.iovec[1], "BAR=2");
+        iovec = imp.iovw.iovec;
+        journal_importer_drop_iovw(&imp);
+
+        assert_se(journal_importer_process_data(&imp) == 1);
+        assert_se(imp.iovw.count == 1);
+        assert_iovec_entry(&imp.iovw.iovec[0], "BAZ=3");
+        /* The iovec array is reused for the next entry */
+        assert_se(imp.iovw.iovec == iovec);
+        journal_importer_drop_iovw(&imp);
+
+        assert_se(journal_importer_process_data(&imp) == -EAGAIN);
+        assert_se(!journal_importer_eof(&imp));
+        assert_se(journal_importer_bytes_remaining(&imp) > 0);
+}
+
 int main(int argc, char **argv) {
         test_setup_logging(LOG_DEBUG);
 
         test_basic_parsing();
         test_bad_input();
+        test_push_data();
 
         return 0;
 }
@@ -387,6 +387,19 @@ static void test_depth(void) {
         fputs("\n", stdout);
 }
 
+static void test_format_string(void) {
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL, *w = NULL;
+        _cleanup_free_ char *s = NULL;
+
+        /* Make sure the runs of unescaped characters are written out correctly, around all kinds of escapes */
+        assert_se(json_variant_new_string(&v, "plain \"quoted\" back\\slash/\b\f\n\r\t\x01\x1f\xc3\xa4 end") >= 0);
+        assert_se(json_variant_format(v, 0, &s) >= 0);
+        assert_se(streq(s, "\"plain \\\"quoted\\\" back\\\\slash\\/\\b\\f\\n\\r\\t\\u0001\\u001f\xc3\xa4 end\""));
+
+        assert_se(json_parse(s, &w, NULL, NULL) >= 0);
+        assert_se(json_variant_equal(v, w));
+}
+
 int main(int argc, char *argv[]) {
 
         log_set_max_level(LOG_DEBUG);
@@ -427,6 +440,10 @@ int main(int argc, char *argv[]) {
         test_tokenizer("\"\\ud800a\"", -EINVAL);
         test_tokenizer("\"\\udc00\\udc00\"", -EINVAL);
         test_tokenizer("\"\\ud801\\udc37\"", JSON_TOKEN_STRING, "\xf0\x90\x90\xb7", JSON_TOKEN_END);
+        test_tokenizer("\"abc\\\"def\xc3\xa4ghi\\\\\"", JSON_TOKEN_STRING, "abc\"def\xc3\xa4ghi\\", JSON_TOKEN_END);
+        test_tokenizer("\"foo\x01" "bar\"", -EINVAL);
+        test_tokenizer("\"foo\x7f\"", -EINVAL);
+        test_tokenizer("\"foo", -EINVAL);
 
         test_tokenizer("[1, 2, -3]", JSON_TOKEN_ARRAY_OPEN, JSON_TOKEN_UNSIGNED, (uintmax_t) 1, JSON_TOKEN_COMMA, JSON_TOKEN_UNSIGNED, (uintmax_t) 2, JSON_TOKEN_COMMA, JSON_TOKEN_INTEGER, (intmax_t) -3, JSON_TOKEN_ARRAY_CLOSE, JSON_TOKEN_END);
 
@@ -442,5 +459,7 @@ int main(int argc, char *argv[]) {
 
         test_depth();
 
+        test_format_string();
+
         return 0;
 }
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <sys/socket.h>
+
+#include "fd-util.h"
+#include "json.h"
+#include "manager-query.h"
+#include "manager.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "test-helper.h"
+#include "tests.h"
+
+static void query(Manager *m, int fd, const char *request, JsonVariant **ret) {
+        char buf[4096];
+        ssize_t n;
+
+        assert_se(send(fd, request, strlen(request), 0) == (ssize_t) strlen(request));
+
+        /* Run the manager's event loop until the reply is there, or the connection got dropped */
+        for (;;) {
+                n = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+                if (n >= 0)
+                        break;
+
+                assert_se(errno == EAGAIN);
+                assert_se(sd_event_run(m->event, 5 * USEC_PER_SEC) > 0);
+        }
+
+        if (n == 0) {
+                *ret = NULL;
+                return;
+        }
+
+        buf[n] = 0;
+        log_info("%s → %s", request, buf);
+        assert_se(json_parse(buf, ret, NULL, NULL) >= 0);
+}
+
+static void assert_error(JsonVariant *v, const char *error) {
+        JsonVariant *e;
+
+        assert_se(v);
+        assert_se(e = json_variant_by_key(v, "error"));
+        assert_se(streq(json_variant_string(e), error));
+}
+
+static void test_query(Manager *m) {
+        _cleanup_(json_variant_unrefp) JsonVariant *v = NULL, *w = NULL, *x = NULL, *y = NULL, *z = NULL;
+        _cleanup_close_pair_ int p[2] = { -1, -1 };
+        JsonVariant *parameters, *e;
+        Unit *a;
+
+        assert_se(manager_load_startable_unit_or_warn(m, "a.service", NULL, &a) >= 0);
+
+        assert_se(socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC|SOCK_NONBLOCK, 0, p) >= 0);
+        assert_se(manager_query_add_connection(m, p[0]) >= 0);
+        p[0] = -1;
+
+        query(m, p[1], "{\"method\":\"io.systemd.Manager.GetUnit\",\"parameters\":{\"name\":\"a.service\"}}", &v);
+        assert_se(v);
+        assert_se(parameters = json_variant_by_key(v, "parameters"));
+        assert_se(e = json_variant_by_key(parameters, "unit"));
+        assert_se(streq(json_variant_string(e), "a.service"));
+        assert_se(e = json_variant_by_key(parameters, "path"));
+        assert_se(streq(json_variant_string(e), "/org/freedesktop/systemd1/unit/a_2eservice"));
+        assert_se(e = json_variant_by_key(parameters, "loadState"));
+        assert_se(streq(json_variant_string(e), "loaded"));
+        assert_se(e = json_variant_by_key(parameters, "activeState"));
+        assert_se(streq(json_variant_string(e), "inactive"));
+
+        query(m, p[1], "{\"method\":\"io.systemd.Manager.GetUnit\",\"parameters\":{\"name\":\"nonexistent.service\"}}", &w);
+        assert_error(w, "io.systemd.Manager.NoSuchUnit");
+
+        query(m, p[1], "{\"method\":\"io.systemd.Manager.GetUnit\",\"parameters\":{}}", &x);
+        assert_error(x, "org.varlink.service.InvalidParameter");
+
+        query(m, p[1], "{\"method\":\"io.systemd.Manager.StartUnit\",\"parameters\":{\"name\":\"a.service\"}}", &y);
+        assert_error(y, "org.varlink.service.MethodNotFound");
+
+        /* Garbage gets the connection dropped */
+        query(m, p[1], "{\"method\":", &z);
+        assert_se(!z);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        r = enter_cgroup_subroot();
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        assert_se(set_unit_path(get_testdata_dir()) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+        r = manager_new(UNIT_FILE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (MANAGER_SKIP_TEST(r))
+                return log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL) >= 0);
+
+        test_query(m);
+
+        return 0;
+}
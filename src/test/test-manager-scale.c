@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fdset.h"
+#include "fileio.h"
+#include "manager.h"
+#include "parse-util.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "test-helper.h"
+#include "tests.h"
+#include "time-util.h"
+
+/* A manual benchmark for the manager's hot paths on a synthetic unit graph: loading, building a start
+ * transaction and serialization. Invoke as "test-manager-scale [N_UNITS]", and compare the numbers between
+ * builds to catch scaling regressions. */
+
+#define N_UNITS_DEFAULT 1000U
+
+static void write_units(const char *dir, unsigned n) {
+        _cleanup_free_ char *target = NULL;
+        size_t target_allocated = 0, target_size = 0;
+        unsigned i;
+
+        for (i = 0; i < n; i++) {
+                _cleanup_free_ char *path = NULL, *unit = NULL;
+                char name[STRLEN("bench-") + DECIMAL_STR_MAX(unsigned) + STRLEN(".service")];
+
+                xsprintf(name, "bench-%u.service", i);
+
+                /* Every service is ordered after its predecessor and requires its parent in a binary tree, so
+                 * that the transaction has both long ordering chains and fan-out to deal with. */
+                if (i > 0)
+                        assert_se(asprintf(&unit,
+                                           "[Unit]\n"
+                                           "After=bench-%u.service\n"
+                                           "Requires=bench-%u.service\n"
+                                           "[Service]\n"
+                                           "ExecStart=/bin/true\n",
+                                           i - 1, (i - 1) / 2) >= 0);
+                else
+                        assert_se(unit = strdup("[Service]\n"
+                                                "ExecStart=/bin/true\n"));
+
+                assert_se(path = path_join(NULL, dir, name));
+                assert_se(write_string_file(path, unit, WRITE_STRING_FILE_CREATE) >= 0);
+
+                assert_se(GREEDY_REALLOC(target, target_allocated, target_size + STRLEN("Wants=\n") + strlen(name) + 1));
+                target_size += sprintf(target + target_size, "Wants=%s\n", name);
+        }
+
+        if (target) {
+                _cleanup_free_ char *path = NULL, *unit = NULL;
+
+                assert_se(unit = strappend("[Unit]\n", target));
+                assert_se(path = path_join(NULL, dir, "bench.target"));
+                assert_se(write_string_file(path, unit, WRITE_STRING_FILE_CREATE) >= 0);
+        }
+}
+
+static void report(const char *what, usec_t start) {
+        char buf[FORMAT_TIMESPAN_MAX];
+
+        log_info("%-24s %s", what, format_timespan(buf, sizeof(buf), now(CLOCK_MONOTONIC) - start, 1));
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL, *unit_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_(fdset_freep) FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        unsigned n = N_UNITS_DEFAULT;
+        struct rusage ru;
+        Unit *target;
+        usec_t ts;
+        Job *j;
+        int r;
+
+        test_setup_logging(LOG_INFO);
+
+        if (argc > 1)
+                assert_se(safe_atou(argv[1], &n) >= 0 && n > 0);
+
+        r = enter_cgroup_subroot();
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        assert_se(mkdtemp_malloc("/tmp/test-manager-scale-XXXXXX", &unit_dir) >= 0);
+        write_units(unit_dir, n);
+
+        assert_se(set_unit_path(unit_dir) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+
+        r = manager_new(UNIT_FILE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (MANAGER_SKIP_TEST(r))
+                return log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+
+        log_info("Benchmarking with %u units:", n);
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_startup(m, NULL, NULL) >= 0);
+        report("manager_startup():", ts);
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_load_startable_unit_or_warn(m, "bench.target", NULL, &target) >= 0);
+        report("Loading units:", ts);
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_add_job(m, JOB_START, target, JOB_REPLACE, NULL, &j) >= 0);
+        report("Start transaction:", ts);
+
+        ts = now(CLOCK_MONOTONIC);
+        manager_clear_jobs(m);
+        report("Clearing jobs:", ts);
+
+        assert_se(fds = fdset_new());
+        r = open_tmpfile_unlinkable(NULL, O_RDWR|O_CLOEXEC);
+        assert_se(r >= 0);
+        assert_se(f = fdopen(r, "w+"));
+
+        ts = now(CLOCK_MONOTONIC);
+        assert_se(manager_serialize(m, f, fds, false) >= 0);
+        report("Serialization:", ts);
+
+        assert_se(getrusage(RUSAGE_SELF, &ru) >= 0);
+        log_info("%-24s %li KiB", "Peak RSS:", ru.ru_maxrss);
+
+        return EXIT_SUCCESS;
+}
@@ -51,6 +51,14 @@
 /* Maximum number of missed replies before selecting another source. */
 #define NTP_MAX_MISSED_REPLIES          2
 
+/*
+ * Number of initial requests sent in short succession after startup, so
+ * that spike detection has enough samples to work with without waiting
+ * one minimum poll interval for each of them.
+ */
+#define NTP_BURST_SAMPLES               4
+#define NTP_BURST_INTERVAL_USEC         (2 * USEC_PER_SEC)
+
 #define RETRY_USEC (30*USEC_PER_SEC)
 #define RATELIMIT_INTERVAL_USEC (10*USEC_PER_SEC)
 #define RATELIMIT_BURST 10
@@ -620,7 +628,7 @@ static int manager_receive_response(sd_event_source *source, int fd, uint32_t re
                 sd_notifyf(false, "STATUS=Synchronized to time server %s (%s).", strna(pretty), m->current_server_name->string);
         }
 
-        r = manager_arm_timer(m, m->poll_interval_usec);
+        r = manager_arm_timer(m, m->packet_count < NTP_BURST_SAMPLES ? NTP_BURST_INTERVAL_USEC : m->poll_interval_usec);
         if (r < 0)
                 return log_error_errno(r, "Failed to rearm timer: %m");
 
@@ -48,6 +48,7 @@
 #include "path-util.h"
 #include "rm-rf.h"
 #include "selinux-util.h"
+#include "smack-util.h"
 #include "set.h"
 #include "specifier.h"
 #include "stat-util.h"
@@ -458,14 +459,26 @@ static bool unix_socket_alive(const char *fn) {
         return true;
 }
 
-static int dir_is_mount_point(DIR *d, const char *subdir) {
+static int dir_is_mount_point(DIR *d, int *cached_parent, const char *subdir) {
 
         int mount_id_parent, mount_id;
         int r_p, r;
 
-        r_p = name_to_handle_at_loop(dirfd(d), ".", NULL, &mount_id_parent, 0);
-        if (r_p < 0)
-                r_p = -errno;
+        assert(cached_parent);
+
+        /* The parent's mount ID is the same for all entries of a directory, hence callers pass in a cache for it,
+         * initialized to INT_MIN. We store either the mount ID or the negative errno we got. */
+        if (*cached_parent == INT_MIN) {
+                r_p = name_to_handle_at_loop(dirfd(d), ".", NULL, &mount_id_parent, 0);
+                *cached_parent = r_p < 0 ? -errno : mount_id_parent;
+        }
+
+        if (*cached_parent < 0)
+                r_p = *cached_parent;
+        else {
+                mount_id_parent = *cached_parent;
+                r_p = 0;
+        }
 
         r = name_to_handle_at_loop(dirfd(d), subdir, NULL, &mount_id, 0);
         if (r < 0)
@@ -512,6 +525,22 @@ static DIR* opendir_nomod(const char *path) {
         return xopendirat_nomod(AT_FDCWD, path);
 }
 
+static bool dir_cleanup_has_item(const char *path) {
+
+        /* Is there an item configured for this path? */
+        if (ordered_hashmap_get(items, path)) {
+                log_debug("Ignoring \"%s\": a separate entry exists.", path);
+                return true;
+        }
+
+        if (find_glob(globs, path)) {
+                log_debug("Ignoring \"%s\": a separate glob exists.", path);
+                return true;
+        }
+
+        return false;
+}
+
 static int dir_cleanup(
                 Item *i,
                 const char *p,
@@ -526,7 +555,7 @@ static int dir_cleanup(
         struct dirent *dent;
         struct timespec times[2];
         bool deleted = false;
-        int r = 0;
+        int mount_id = INT_MIN, r = 0;
 
         FOREACH_DIRENT_ALL(dent, d, break) {
                 struct stat s;
@@ -555,7 +584,7 @@ static int dir_cleanup(
                 /* Try to detect bind mounts of the same filesystem instance; they
                  * do not differ in device major/minors. This type of query is not
                  * supported on all kernels or filesystem types though. */
-                if (S_ISDIR(s.st_mode) && dir_is_mount_point(d, dent->d_name) > 0) {
+                if (S_ISDIR(s.st_mode) && dir_is_mount_point(d, &mount_id, dent->d_name) > 0) {
                         log_debug("Ignoring \"%s/%s\": different mount of the same filesystem.",
                                   p, dent->d_name);
                         continue;
@@ -567,19 +596,11 @@ static int dir_cleanup(
                         goto finish;
                 }
 
-                /* Is there an item configured for this path? */
-                if (ordered_hashmap_get(items, sub_path)) {
-                        log_debug("Ignoring \"%s\": a separate entry exists.", sub_path);
-                        continue;
-                }
-
-                if (find_glob(globs, sub_path)) {
-                        log_debug("Ignoring \"%s\": a separate glob exists.", sub_path);
-                        continue;
-                }
-
                 if (S_ISDIR(s.st_mode)) {
 
+                        if (dir_cleanup_has_item(sub_path))
+                                continue;
+
                         if (mountpoint &&
                             streq(dent->d_name, "lost+found") &&
                             s.st_uid == 0) {
@@ -709,6 +730,11 @@ static int dir_cleanup(
                                 continue;
                         }
 
+                        /* Checked last for files, as matching against all globs is the most expensive part, and
+                         * most files are skipped for the reasons above anyway. */
+                        if (dir_cleanup_has_item(sub_path))
+                                continue;
+
                         log_debug("unlink \"%s\"", sub_path);
 
                         if (unlinkat(dirfd(d), dent->d_name, 0) < 0)
@@ -2073,6 +2099,13 @@ static int create_item(Item *i) {
                 break;
 
         case RECURSIVE_RELABEL_PATH:
+                /* Without any mode or ownership to set, the only thing left to do is relabelling. Don't walk the
+                 * entire tree just to find out that no security module is in use. */
+                if (!i->mode_set && !i->uid_set && !i->gid_set && !mac_selinux_use() && !mac_smack_use()) {
+                        log_debug("Nothing to do for \"%s\", skipping.", i->path);
+                        break;
+                }
+
                 r = glob_item_recursively(i, fd_set_perms);
                 if (r < 0)
                         return r;
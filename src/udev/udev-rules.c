@@ -104,6 +104,7 @@ enum string_glob_type {
         GL_SPLIT,                       /* multi-value A|B */
         GL_SPLIT_GLOB,                  /* multi-value with glob A*|B* */
         GL_SOMETHING,                   /* commonly used "?*" */
+        GL_PREFIX,                      /* commonly used "foo*", a literal prefix */
 };
 
 enum string_subst_type {
@@ -113,19 +114,20 @@ enum string_subst_type {
         SB_SUBSYS,
 };
 
-/* tokens of a rule are sorted/handled in this order */
+/* tokens of a rule are sorted/handled in this order, ACTION and SUBSYSTEM come first as they are cheap to check
+ * and rule out most rules for any given event */
 enum token_type {
         TK_UNSET,
         TK_RULE,
 
         TK_M_ACTION,                    /* val */
+        TK_M_SUBSYSTEM,                 /* val */
         TK_M_DEVPATH,                   /* val */
         TK_M_KERNEL,                    /* val */
         TK_M_DEVLINK,                   /* val */
         TK_M_NAME,                      /* val */
         TK_M_ENV,                       /* val, attr */
         TK_M_TAG,                       /* val */
-        TK_M_SUBSYSTEM,                 /* val */
         TK_M_DRIVER,                    /* val */
         TK_M_WAITFOR,                   /* val */
         TK_M_ATTR,                      /* val, attr */
@@ -244,6 +246,7 @@ static const char *string_glob_str(enum string_glob_type type) {
                 [GL_SPLIT] =            "split",
                 [GL_SPLIT_GLOB] =       "split-glob",
                 [GL_SOMETHING] =        "split-glob",
+                [GL_PREFIX] =           "prefix",
         };
 
         return string_glob_strs[type];
@@ -255,13 +258,13 @@ static const char *token_str(enum token_type type) {
                 [TK_RULE] =                     "RULE",
 
                 [TK_M_ACTION] =                 "M ACTION",
+                [TK_M_SUBSYSTEM] =              "M SUBSYSTEM",
                 [TK_M_DEVPATH] =                "M DEVPATH",
                 [TK_M_KERNEL] =                 "M KERNEL",
                 [TK_M_DEVLINK] =                "M DEVLINK",
                 [TK_M_NAME] =                   "M NAME",
                 [TK_M_ENV] =                    "M ENV",
                 [TK_M_TAG] =                    "M TAG",
-                [TK_M_SUBSYSTEM] =              "M SUBSYSTEM",
                 [TK_M_DRIVER] =                 "M DRIVER",
                 [TK_M_WAITFOR] =                "M WAITFOR",
                 [TK_M_ATTR] =                   "M ATTR",
@@ -471,6 +474,21 @@ static void log_unknown_owner(int error, const char *entity, const char *owner)
                 log_error_errno(error, "Error resolving %s '%s': %m", entity, owner);
 }
 
+/* Returns the length of the literal prefix if the first n bytes of the pattern are just that followed by a single
+ * trailing "*", for which a strncmp() does what fnmatch() would. Returns (size_t) -1 otherwise. */
+static size_t glob_prefix_length(const char *pattern, size_t n) {
+        size_t k;
+
+        if (n == 0 || pattern[n-1] != '*')
+                return (size_t) -1;
+
+        k = strcspn(pattern, GLOB_CHARS "\\");
+        if (k != n-1)
+                return (size_t) -1;
+
+        return k;
+}
+
 static uid_t add_uid(struct udev_rules *rules, const char *owner) {
         unsigned i;
         uid_t uid = 0;
@@ -935,6 +953,8 @@ static void rule_add_key(struct rule_tmp *rule_tmp, enum token_type type,
                 } else if (has_glob) {
                         if (streq(value, "?*"))
                                 glob = GL_SOMETHING;
+                        else if (glob_prefix_length(value, strlen(value)) != (size_t) -1)
+                                glob = GL_PREFIX;
                         else
                                 glob = GL_GLOB;
                 } else {
@@ -1641,24 +1661,36 @@ static int match_key(struct udev_rules *rules, struct token *token, const char *
                 {
                         char value[UTIL_PATH_SIZE];
 
-                        strscpy(value, sizeof(value), rules_str(rules, token->key.value_off));
-                        key_value = value;
+                        key_value = rules_str(rules, token->key.value_off);
                         while (key_value != NULL) {
+                                size_t n, k;
+
                                 pos = strchr(key_value, '|');
-                                if (pos != NULL) {
-                                        pos[0] = '\0';
-                                        pos = &pos[1];
-                                }
-                                match = (fnmatch(key_value, val, 0) == 0);
+                                n = pos ? (size_t) (pos - key_value) : strlen(key_value);
+
+                                /* Literal alternatives with a trailing "*" don't need fnmatch(), nor a copy */
+                                k = glob_prefix_length(key_value, n);
+                                if (k != (size_t) -1)
+                                        match = strneq(key_value, val, k);
+                                else if (n < sizeof(value)) {
+                                        memcpy(value, key_value, n);
+                                        value[n] = '\0';
+                                        match = (fnmatch(value, val, 0) == 0);
+                                } else
+                                        match = false;
                                 if (match)
                                         break;
-                                key_value = pos;
+
+                                key_value = pos ? &pos[1] : NULL;
                         }
                         break;
                 }
         case GL_SOMETHING:
                 match = (val[0] != '\0');
                 break;
+        case GL_PREFIX:
+                match = strneq(key_value, val, strlen(key_value) - 1);
+                break;
         case GL_UNSET:
                 return -1;
         }
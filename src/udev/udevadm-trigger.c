@@ -19,13 +19,55 @@
 static bool arg_verbose = false;
 static bool arg_dry_run = false;
 
-static int exec_list(sd_device_enumerator *e, const char *action, Set *settle_set) {
+static int prioritized_set_add(Set **s, sd_device *d) {
+        _cleanup_free_ char *p = NULL;
+        const char *devpath;
+        char *e;
+        int r;
+
+        /* Adds the devpath of the device and of all its parents */
+
+        if (sd_device_get_devpath(d, &devpath) < 0)
+                return 0;
+
+        p = strdup(devpath);
+        if (!p)
+                return -ENOMEM;
+
+        r = set_ensure_allocated(s, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                r = set_put_strdup(*s, p);
+                if (r < 0)
+                        return r;
+                if (r == 0) /* parents are in already too */
+                        return 0;
+
+                e = strrchr(p, '/');
+                if (!e || e == p)
+                        return 0;
+                *e = 0;
+        }
+}
+
+static int exec_list_pass(sd_device_enumerator *e, const char *action, Set *first, bool first_pass, Set *settle_set) {
         sd_device *d;
         int r;
 
         FOREACH_DEVICE_AND_SUBSYSTEM(e, d) {
                 _cleanup_free_ char *filename = NULL;
-                const char *syspath;
+                const char *syspath, *devpath;
+
+                /* In the first pass only trigger the prioritized devices, in the second all others */
+                if (first) {
+                        bool is_first;
+
+                        is_first = sd_device_get_devpath(d, &devpath) >= 0 && set_contains(first, devpath);
+                        if (is_first != first_pass)
+                                continue;
+                }
 
                 if (sd_device_get_syspath(d, &syspath) < 0)
                         continue;
@@ -55,6 +97,35 @@ static int exec_list(sd_device_enumerator *e, const char *action, Set *settle_se
         return 0;
 }
 
+static int exec_list(sd_device_enumerator *e, const char *action, char **prioritized, Set *settle_set) {
+        _cleanup_set_free_free_ Set *first = NULL;
+        sd_device *d;
+        int r;
+
+        /* If subsystems to prioritize are specified, first trigger the devices of those subsystems together
+         * with their parents, so that parents are still triggered before their children, and then the rest. */
+        if (!strv_isempty(prioritized))
+                FOREACH_DEVICE_AND_SUBSYSTEM(e, d) {
+                        const char *subsystem;
+
+                        if (sd_device_get_subsystem(d, &subsystem) < 0 ||
+                            !strv_contains(prioritized, subsystem))
+                                continue;
+
+                        r = prioritized_set_add(&first, d);
+                        if (r < 0)
+                                return log_oom();
+                }
+
+        if (first) {
+                r = exec_list_pass(e, action, first, true, settle_set);
+                if (r < 0)
+                        return r;
+        }
+
+        return exec_list_pass(e, action, first, false, settle_set);
+}
+
 static int device_monitor_handler(sd_device_monitor *m, sd_device *dev, void *userdata) {
         Set *settle_set = userdata;
         const char *syspath;
@@ -117,6 +188,8 @@ static int help(void) {
                "     --name-match=NAME              Trigger devices with this /dev name\n"
                "  -b --parent-match=NAME            Trigger devices with that parent device\n"
                "  -w --settle                       Wait for the triggered events to complete\n"
+               "     --prioritized-subsystem=SUBSYSTEM[,SUBSYSTEM…]\n"
+               "                                    Trigger devices from a matching subsystem first\n"
                , program_invocation_short_name);
 
         return 0;
@@ -125,6 +198,7 @@ static int help(void) {
 int trigger_main(int argc, char *argv[], void *userdata) {
         enum {
                 ARG_NAME = 0x100,
+                ARG_PRIORITIZED_SUBSYSTEM,
         };
 
         static const struct option options[] = {
@@ -142,6 +216,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                 { "name-match",        required_argument, NULL, ARG_NAME },
                 { "parent-match",      required_argument, NULL, 'b'      },
                 { "settle",            no_argument,       NULL, 'w'      },
+                { "prioritized-subsystem", required_argument, NULL, ARG_PRIORITIZED_SUBSYSTEM },
                 { "version",           no_argument,       NULL, 'V'      },
                 { "help",              no_argument,       NULL, 'h'      },
                 {}
@@ -155,6 +230,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_device_monitor_unrefp) sd_device_monitor *m = NULL;
         _cleanup_(sd_event_unrefp) sd_event *event = NULL;
         _cleanup_set_free_free_ Set *settle_set = NULL;
+        _cleanup_strv_free_ char **prioritized = NULL;
         bool settle = false;
         int c, r;
 
@@ -256,6 +332,19 @@ int trigger_main(int argc, char *argv[], void *userdata) {
                         settle = true;
                         break;
 
+                case ARG_PRIORITIZED_SUBSYSTEM: {
+                        _cleanup_strv_free_ char **l = NULL;
+
+                        l = strv_split(optarg, ",");
+                        if (!l)
+                                return log_oom();
+
+                        r = strv_extend_strv(&prioritized, l, true);
+                        if (r < 0)
+                                return log_oom();
+                        break;
+                }
+
                 case ARG_NAME: {
                         _cleanup_(sd_device_unrefp) sd_device *dev = NULL;
 
@@ -328,7 +417,7 @@ int trigger_main(int argc, char *argv[], void *userdata) {
         default:
                 assert_not_reached("Unknown device type");
         }
-        r = exec_list(e, action, settle_set);
+        r = exec_list(e, action, prioritized, settle_set);
         if (r < 0)
                 return r;
 
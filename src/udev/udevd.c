@@ -530,7 +530,7 @@ out:
         }
 }
 
-static void event_run(Manager *manager, struct event *event) {
+static int event_run(Manager *manager, struct event *event) {
         struct worker *worker;
         Iterator i;
 
@@ -552,17 +552,18 @@ static void event_run(Manager *manager, struct event *event) {
                         continue;
                 }
                 worker_attach_event(worker, event);
-                return;
+                return 0;
         }
 
         if (hashmap_size(manager->workers) >= arg_children_max) {
                 if (arg_children_max > 1)
                         log_debug("maximum number (%i) of children reached", hashmap_size(manager->workers));
-                return;
+                return -EBUSY;
         }
 
         /* start new worker and pass initial device */
         worker_spawn(manager, event);
+        return 0;
 }
 
 static int event_queue_insert(Manager *manager, struct udev_device *dev) {
@@ -807,7 +808,10 @@ static void event_queue_start(Manager *manager) {
                 if (is_devpath_busy(manager, event))
                         continue;
 
-                event_run(manager, event);
+                /* All workers are busy, and we may not fork any more. Don't bother checking the rest of the
+                 * queue, which is O(n²) in the queue length, we'll be called again when a worker finishes. */
+                if (event_run(manager, event) == -EBUSY)
+                        break;
         }
 }
 